@@ -16,6 +16,26 @@
 // Device Configuration
 #define DEVICE_NAME "ESP32-Controller-01"
 #define MAX_OUTPUTS 16
+#define OUTPUT_NAME_MAX_LEN 20                  // Longest custom output name (matches the UI input limit)
+
+// Web Server Configuration
+#define BODY_POOL_SLOTS 4                       // POST bodies assembled at the same time
+#define MAX_BODY_SIZE 2048                      // Larger bodies are refused with 413
+
+// Effect Engine Configuration
+#define EFFECT_TICK_MS 1                        // Period of the effect task loop (blink stepping)
+#define EFFECT_TASK_CORE 1                      // Core the effect task is pinned to (WiFi runs on core 0)
+#define EFFECT_TASK_PRIORITY 3                  // Above loop() (priority 1) so network bursts cannot delay PWM
+#define EFFECT_TASK_STACK 4096                  // Effect task stack size in bytes
+#define COMMAND_QUEUE_SIZE 32                   // Pending output commands (power of two)
+
+// Persistence Configuration
+#define NVS_FLUSH_QUIET_MS 2000                 // Commit dirty outputs after this long without changes
+#define NVS_FLUSH_MAX_DELAY_MS 10000            // ...but never hold a change back longer than this
+
+// Diagnostics
+#define TRACE_RING_SIZE 512                     // Request trace spans kept for /api/debug/trace (power of two)
+#define CPU_LOAD_MAX_TASKS 32                   // Tasks in the per-task CPU breakdown (run-time stats need room for every task)
 
 // WiFiManager Configuration
 #define WIFIMANAGER_AP_SSID "RailHub32-Setup"  // Configuration portal AP name
@@ -0,0 +1,145 @@
+"""
+Packs the web UI in web/ into include/web_assets.h before every build.
+
+index.html, app.css and app.js are minified, gzipped and emitted as PROGMEM
+arrays with a strong ETag (content hash) each. index.html references the CSS
+and JS with ?v=<hash>, so those two are served with a one-year immutable
+Cache-Control; the page itself is revalidated with its ETag and answered
+with 304 when unchanged. The header is only rewritten when its content
+changes, so an unchanged UI does not trigger a rebuild.
+
+Runs as a PlatformIO pre-script (extra_scripts in platformio.ini) or
+standalone: python scripts/build_web.py
+"""
+
+import gzip
+import hashlib
+import io
+import os
+import re
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+    PROJECT_DIR = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+WEB_DIR = os.path.join(PROJECT_DIR, "web")
+OUTPUT = os.path.join(PROJECT_DIR, "include", "web_assets.h")
+
+CACHE_IMMUTABLE = "public, max-age=31536000, immutable"
+CACHE_REVALIDATE = "no-cache"
+
+
+def minify_css(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"\s+", " ", text)
+    text = re.sub(r"\s*([{};,>])\s*", r"\1", text)
+    text = re.sub(r":\s+", ":", text)
+    return text.replace(";}", "}").strip()
+
+
+def minify_js(text):
+    # Line-based only: indentation, blank lines and whole-line // comments go,
+    # line breaks stay so automatic semicolon insertion is unaffected
+    lines = []
+    for line in text.splitlines():
+        line = line.strip()
+        if line and not line.startswith("//"):
+            lines.append(line)
+    return "\n".join(lines)
+
+
+def minify_html(text):
+    text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+    return "\n".join(line.strip() for line in text.splitlines() if line.strip())
+
+
+def compress(data):
+    # Fixed mtime keeps the output, and with it the ETag, reproducible
+    buffer = io.BytesIO()
+    with gzip.GzipFile(fileobj=buffer, mode="wb", compresslevel=9, mtime=0) as out:
+        out.write(data)
+    return buffer.getvalue()
+
+
+def content_hash(data):
+    return hashlib.sha256(data).hexdigest()[:16]
+
+
+def read(name):
+    with open(os.path.join(WEB_DIR, name), encoding="utf-8") as f:
+        return f.read()
+
+
+def c_array(name, data):
+    rows = []
+    for i in range(0, len(data), 20):
+        rows.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 20]))
+    return "const uint8_t %s[] PROGMEM = {\n%s\n};\n" % (name, ",\n".join(rows))
+
+
+def build():
+    css = minify_css(read("app.css")).encode("utf-8")
+    js = minify_js(read("app.js")).encode("utf-8")
+
+    # Fingerprint the sub-resources so the page picks up new versions at once
+    html = minify_html(read("index.html"))
+    html = html.replace('href="/app.css"', 'href="/app.css?v=%s"' % content_hash(css))
+    html = html.replace('src="/app.js"', 'src="/app.js?v=%s"' % content_hash(js))
+    html = html.encode("utf-8")
+
+    assets = [
+        ("/", "INDEX_HTML", "text/html", html, CACHE_REVALIDATE),
+        ("/app.css", "APP_CSS", "text/css", css, CACHE_IMMUTABLE),
+        ("/app.js", "APP_JS", "application/javascript", js, CACHE_IMMUTABLE),
+    ]
+
+    out = [
+        "// Generated by scripts/build_web.py from web/ - do not edit",
+        "#ifndef WEB_ASSETS_H",
+        "#define WEB_ASSETS_H",
+        "",
+        "#include <Arduino.h>",
+        "",
+        "struct WebAsset {",
+        "    const char* path;",
+        "    const char* contentType;",
+        "    const uint8_t* data;     // gzip, in flash",
+        "    size_t length;",
+        "    const char* etag;",
+        "    const char* cacheControl;",
+        "};",
+        "",
+    ]
+    table = []
+    total_raw = 0
+    total_gz = 0
+    for path, symbol, content_type, raw, cache in assets:
+        gz = compress(raw)
+        total_raw += len(raw)
+        total_gz += len(gz)
+        out.append("// %s: %d bytes minified, %d gzipped" % (path, len(raw), len(gz)))
+        out.append(c_array(symbol + "_GZ", gz))
+        table.append('    { "%s", "%s", %s_GZ, sizeof(%s_GZ), "\\"%s\\"", "%s" },'
+                     % (path, content_type, symbol, symbol, content_hash(gz), cache))
+
+    out.append("const WebAsset WEB_ASSETS[] = {")
+    out.extend(table)
+    out.append("};")
+    out.append("const size_t WEB_ASSET_COUNT = sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]);")
+    out.append("")
+    out.append("#endif")
+    text = "\n".join(out) + "\n"
+
+    current = None
+    if os.path.exists(OUTPUT):
+        with open(OUTPUT, encoding="utf-8") as f:
+            current = f.read()
+    if text != current:
+        with open(OUTPUT, "w", encoding="utf-8") as f:
+            f.write(text)
+    print("[WEB] Web UI: %d bytes minified, %d bytes gzipped" % (total_raw, total_gz))
+
+
+build()
@@ -0,0 +1,172 @@
+/**
+ * @file Arduino.h
+ * @brief Arduino-ESP32 core API for the native simulator
+ *
+ * What the firmware uses from the Arduino core, ESP-IDF logging and
+ * FreeRTOS, forwarded to the simulator HAL (sim_hal.h). Tasks are host
+ * threads; their core and priority are accepted and ignored.
+ */
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "WString.h"
+#include "IPAddress.h"
+#include "esp_err.h"
+#include "sim_hal.h"
+
+using std::min;
+using std::max;
+
+#define PROGMEM
+#define PGM_P const char *
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define PULLUP 0x04
+#define INPUT_PULLUP 0x05
+#define PULLDOWN 0x08
+#define INPUT_PULLDOWN 0x09
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    const long dividend = outMax - outMin;
+    const long divisor = inMax - inMin;
+    const long delta = x - inMin;
+    if (divisor == 0) return -1;
+    return (delta * dividend + (divisor / 2)) / divisor + outMin;
+}
+
+// Time
+inline unsigned long millis() { return (unsigned long)(simClockUs() / 1000); }
+inline unsigned long micros() { return (unsigned long)simClockUs(); }
+inline void delay(uint32_t ms) { simSleepUntilUs(simClockUs() + (uint64_t)ms * 1000); }
+inline void delayMicroseconds(uint32_t us) { simSleepUntilUs(simClockUs() + us); }
+void yield();
+
+// GPIO and LEDC
+inline void pinMode(uint8_t pin, uint8_t mode) { simGpioMode(pin, mode); }
+inline void digitalWrite(uint8_t pin, uint8_t level) { simGpioWrite(pin, level); }
+inline int digitalRead(uint8_t pin) { return simGpioRead(pin); }
+inline uint32_t ledcSetup(uint8_t channel, uint32_t frequency, uint8_t resolutionBits) {
+    simPwmSetup(channel, frequency, resolutionBits);
+    return frequency;
+}
+inline void ledcAttachPin(uint8_t pin, uint8_t channel) { simPwmAttach(pin, channel); }
+inline void ledcWrite(uint8_t channel, uint32_t duty) { simPwmWrite(channel, duty); }
+
+// Serial console: stdout of the simulator
+class HardwareSerial {
+public:
+    void begin(unsigned long baud) {}
+    void flush();
+    size_t write(const char *text, size_t length);
+
+    size_t print(const char *text) { return write(text, strlen(text)); }
+    size_t print(const String &text) { return write(text.c_str(), text.length()); }
+    size_t print(char c) { return write(&c, 1); }
+    size_t print(int number) { return printf("%d", number); }
+    size_t print(unsigned int number) { return printf("%u", number); }
+    size_t print(long number) { return printf("%ld", number); }
+    size_t print(unsigned long number) { return printf("%lu", number); }
+    size_t print(long long number) { return printf("%lld", number); }
+    size_t print(unsigned long long number) { return printf("%llu", number); }
+    size_t print(double number, int decimals = 2) { return printf("%.*f", decimals, number); }
+    size_t print(const IPAddress &address) { return print(address.toString()); }
+
+    template <typename T>
+    size_t println(const T &value) { return print(value) + println(); }
+    size_t println() { return write("\r\n", 2); }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+// Chip
+#define F_CPU 240000000L
+
+class EspClass {
+public:
+    const char *getChipModel() { return "ESP32-SIM"; }
+    uint8_t getChipRevision() { return 0; }
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint32_t getCycleCount();       // F_CPU counter derived from the host clock
+    uint32_t getFlashChipSize() { return 4 * 1024 * 1024; }
+    uint32_t getFreeHeap();
+    uint32_t getSketchSize() { return 1048576; }
+    uint32_t getFreeSketchSpace() { return 1310720; }
+    [[noreturn]] void restart() { simRestart(); }
+};
+
+extern EspClass ESP;
+
+// ESP-IDF logging
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+inline void esp_log_level_set(const char *tag, esp_log_level_t level) {}
+
+// FreeRTOS: tasks on host threads, a 1 kHz tick
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+inline TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+inline void vTaskDelay(TickType_t ticks) { delay(ticks); }
+inline void vTaskDelayUntil(TickType_t *previousWake, TickType_t period) {
+    *previousWake += period;
+    simSleepUntilUs((uint64_t)*previousWake * 1000);
+}
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) { return 1024; }
+
+// Two cores like the ESP32; host threads don't report which one they run on
+#define portNUM_PROCESSORS 2
+#define configGENERATE_RUN_TIME_STATS 0     // No run-time stats, so the firmware times its own tasks
+inline BaseType_t xPortGetCoreID() { return 1; }  // loop() asks; it runs on core 1 on the chip
+
+// Spinlock of a critical section (portENTER_CRITICAL / portEXIT_CRITICAL)
+typedef struct {
+    bool locked;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {false}
+
+inline void portENTER_CRITICAL(portMUX_TYPE *mux) {
+    while (__atomic_test_and_set(&mux->locked, __ATOMIC_ACQUIRE)) {
+    }
+}
+
+inline void portEXIT_CRITICAL(portMUX_TYPE *mux) {
+    __atomic_clear(&mux->locked, __ATOMIC_RELEASE);
+}
+
+#endif
@@ -0,0 +1,303 @@
+/**
+ * @file ESPAsyncWebServer.h
+ * @brief ESPAsyncWebServer and AsyncWebSocket for the native simulator
+ *
+ * The API surface the firmware uses, served over real sockets by the
+ * simulator's network task (sim_net.cpp). As on the chip, handlers are
+ * matched in the order they were added (a URI also matches its
+ * sub-paths), a POST body reaches the body handler in the pieces it
+ * arrived in, every response closes its connection, and a WebSocket
+ * client holds at most WS_MAX_QUEUED_MESSAGES unsent messages; later
+ * ones are dropped. Frames are delivered whole (AwsFrameInfo::index 0).
+ *
+ * Handlers and WebSocket events run on the network task; the client and
+ * socket functions may be called from any task.
+ */
+
+#ifndef SIM_ESPASYNCWEBSERVER_H
+#define SIM_ESPASYNCWEBSERVER_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Arduino.h"
+
+#ifndef WS_MAX_QUEUED_MESSAGES
+#define WS_MAX_QUEUED_MESSAGES 32
+#endif
+
+#define DEFAULT_MAX_WS_CLIENTS 8
+
+class AsyncWebServer;
+class AsyncWebServerRequest;
+class AsyncWebSocket;
+class AsyncWebSocketClient;
+struct SimConnection;
+
+typedef enum {
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_PATCH = 0b00010000,
+    HTTP_HEAD = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY = 0b01111111
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+typedef std::function<void(void)> ArDisconnectHandler;
+typedef std::function<size_t(uint8_t *buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+typedef std::function<void(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data,
+                           size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)>
+    ArBodyHandlerFunction;
+
+// Peer of a connection
+class AsyncClient {
+public:
+    IPAddress remoteIP() const { return address; }
+    uint16_t remotePort() const { return port; }
+
+    IPAddress address;
+    uint16_t port = 0;
+};
+
+// Query string parameter (not URL-decoded)
+class AsyncWebParameter {
+public:
+    AsyncWebParameter(const String &name, const String &value) : paramName(name), paramValue(value) {}
+    const String &name() const { return paramName; }
+    const String &value() const { return paramValue; }
+
+private:
+    String paramName;
+    String paramValue;
+};
+
+class AsyncWebServerResponse {
+public:
+    AsyncWebServerResponse(int code, const String &contentType, const std::string &content);
+    void addHeader(const String &name, const String &value);
+    int code() const { return statusCode; }
+    std::string render() const;     // Status line, headers and body
+
+private:
+    int statusCode;
+    String type;
+    std::string body;
+    std::vector<std::pair<String, String>> headers;
+};
+
+class AsyncWebHandler {
+public:
+    virtual ~AsyncWebHandler() {}
+    virtual bool canHandle(AsyncWebServerRequest *request) { return false; }
+    virtual void handleRequest(AsyncWebServerRequest *request) {}
+    virtual void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {}
+};
+
+class AsyncWebServerRequest {
+public:
+    AsyncWebServerRequest(SimConnection *connection, const AsyncClient &peer);
+    ~AsyncWebServerRequest();
+
+    AsyncClient *client() { return &peer; }
+    WebRequestMethodComposite method() const { return requestMethod; }
+    const String &url() const { return path; }
+    size_t contentLength() const { return length; }
+    bool hasHeader(const char *name) const;
+    String header(const char *name) const;
+    bool hasParam(const char *name) const;
+    AsyncWebParameter *getParam(const char *name);
+
+    AsyncWebServerResponse *beginResponse(int code, const String &contentType = String(), const String &content = String());
+    AsyncWebServerResponse *beginResponse_P(int code, const String &contentType, const uint8_t *content, size_t len);
+    AsyncWebServerResponse *beginChunkedResponse(const String &contentType, AwsResponseFiller filler);
+    void send(AsyncWebServerResponse *response);
+    void send(int code, const String &contentType = String(), const String &content = String());
+    void onDisconnect(ArDisconnectHandler fn) { disconnectHandler = fn; }
+
+    // Filled by the network task
+    WebRequestMethodComposite requestMethod = 0;
+    String path;
+    size_t length = 0;
+    std::vector<std::pair<String, String>> headers;
+    std::vector<AsyncWebParameter> params;
+    AsyncWebHandler *handler = nullptr;
+    bool responded = false;
+    SimConnection *connection;
+
+private:
+    AsyncClient peer;
+    ArDisconnectHandler disconnectHandler;
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler {
+public:
+    AsyncCallbackWebHandler(const String &uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                            ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody)
+        : uri(uri), method(method), onRequest(onRequest), onUpload(onUpload), onBody(onBody) {}
+
+    bool canHandle(AsyncWebServerRequest *request) override;
+    void handleRequest(AsyncWebServerRequest *request) override;
+    void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) override;
+
+private:
+    String uri;
+    WebRequestMethodComposite method;
+    ArRequestHandlerFunction onRequest;
+    ArUploadHandlerFunction onUpload;
+    ArBodyHandlerFunction onBody;
+};
+
+class AsyncWebServer {
+public:
+    explicit AsyncWebServer(uint16_t port);
+    ~AsyncWebServer();
+
+    void begin();
+    void end();
+    AsyncWebHandler &addHandler(AsyncWebHandler *handler);
+    AsyncCallbackWebHandler &on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
+    AsyncCallbackWebHandler &on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                                ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody = nullptr);
+    void onNotFound(ArRequestHandlerFunction handler) { notFound = handler; }
+
+    // Network task
+    uint16_t port() const { return firmwarePort; }
+    AsyncWebHandler *findHandler(AsyncWebServerRequest *request);
+    void handleNotFound(AsyncWebServerRequest *request);
+
+private:
+    uint16_t firmwarePort;
+    std::vector<AsyncWebHandler *> handlers;
+    ArRequestHandlerFunction notFound;
+};
+
+// WebSocket
+typedef enum {
+    WS_CONTINUATION,
+    WS_TEXT,
+    WS_BINARY,
+    WS_DISCONNECT = 0x08,
+    WS_PING,
+    WS_PONG
+} AwsFrameType;
+
+typedef enum {
+    WS_EVT_CONNECT,
+    WS_EVT_DISCONNECT,
+    WS_EVT_PONG,
+    WS_EVT_ERROR,
+    WS_EVT_DATA
+} AwsEventType;
+
+typedef enum {
+    WS_DISCONNECTED,
+    WS_CONNECTED,
+    WS_DISCONNECTING
+} AwsClientStatus;
+
+typedef struct {
+    uint8_t message_opcode;     // Opcode of the message (WS_TEXT/WS_BINARY)
+    uint32_t num;               // Frame number within the message
+    uint8_t final;              // Last frame of the message
+    uint8_t masked;
+    uint8_t opcode;             // Opcode of this frame
+    uint64_t len;               // Payload length of this frame
+    uint8_t mask[4];
+    uint64_t index;             // Offset of data within the frame
+} AwsFrameInfo;
+
+typedef std::function<void(AsyncWebSocket *socket, AsyncWebSocketClient *client, AwsEventType type, void *arg,
+                           uint8_t *data, size_t len)> AwsEventHandler;
+
+// One copy of a message, queued to any number of clients
+class AsyncWebSocketMessageBuffer {
+public:
+    AsyncWebSocketMessageBuffer(const uint8_t *data, size_t size)
+        : content(std::make_shared<std::string>((const char *)data, size)) {}
+    void lock() { locks++; }
+    void unlock() { if (locks > 0) locks--; }
+    bool canDelete() const { return locks == 0; }
+    size_t length() const { return content->size(); }
+
+    std::shared_ptr<std::string> content;
+
+private:
+    uint32_t locks = 0;
+};
+
+class AsyncWebSocketClient {
+public:
+    AsyncWebSocketClient(AsyncWebSocket *server, SimConnection *connection, uint32_t id, const AsyncClient &peer);
+
+    uint32_t id() const { return clientId; }
+    AwsClientStatus status() const { return state; }
+    IPAddress remoteIP() const { return peer.address; }
+    uint16_t remotePort() const { return peer.port; }
+    AsyncWebSocket *server() const { return socket; }
+
+    void close(uint16_t code = 0, const char *message = nullptr);
+    bool queueIsFull() const;
+    size_t queueLen() const;
+    bool canSend() const { return !queueIsFull(); }
+
+    void text(const char *message) { text(message, strlen(message)); }
+    void text(const char *message, size_t len);
+    void text(const String &message) { text(message.c_str(), message.length()); }
+    void text(AsyncWebSocketMessageBuffer *buffer);
+    void binary(const uint8_t *message, size_t len);
+    void binary(AsyncWebSocketMessageBuffer *buffer);
+
+    // Network task
+    void detach();
+
+private:
+    AsyncWebSocket *socket;
+    SimConnection *connection;
+    uint32_t clientId;
+    AsyncClient peer;
+    AwsClientStatus state = WS_CONNECTED;
+};
+
+class AsyncWebSocket : public AsyncWebHandler {
+public:
+    explicit AsyncWebSocket(const String &url) : path(url) {}
+    ~AsyncWebSocket() override;
+
+    const char *url() const { return path.c_str(); }
+    void onEvent(AwsEventHandler handler) { eventHandler = handler; }
+    size_t count() const;
+    AsyncWebSocketClient *client(uint32_t id);
+    bool hasClient(uint32_t id) { return client(id) != nullptr; }
+    void cleanupClients(uint16_t maxClients = DEFAULT_MAX_WS_CLIENTS);
+
+    void textAll(const char *message);
+    void textAll(const String &message) { textAll(message.c_str()); }
+    AsyncWebSocketMessageBuffer *makeBuffer(size_t size = 0);
+    AsyncWebSocketMessageBuffer *makeBuffer(uint8_t *data, size_t size);
+    void _cleanBuffers();
+
+    bool canHandle(AsyncWebServerRequest *request) override;
+    void handleRequest(AsyncWebServerRequest *request) override;
+
+    // Network task
+    void event(AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
+    void removeClient(AsyncWebSocketClient *client);
+
+private:
+    String path;
+    AwsEventHandler eventHandler;
+    uint32_t nextId = 1;
+    std::vector<AsyncWebSocketClient *> clients;
+    std::vector<AsyncWebSocketClient *> closed;     // Freed by cleanupClients()
+    std::vector<AsyncWebSocketMessageBuffer *> buffers;
+};
+
+#endif
@@ -0,0 +1,56 @@
+/**
+ * @file ESPAsyncWiFiManager.h
+ * @brief ESPAsyncWiFiManager for the native simulator
+ *
+ * The simulated station has credentials and connects at once, so
+ * autoConnect() succeeds without opening the configuration portal and
+ * parameters keep the value they were created with.
+ */
+
+#ifndef SIM_ESPASYNCWIFIMANAGER_H
+#define SIM_ESPASYNCWIFIMANAGER_H
+
+#include <functional>
+#include "Arduino.h"
+#include "ESPAsyncWebServer.h"
+#include "WiFi.h"
+
+class DNSServer {
+public:
+    void processNextRequest() {}
+};
+
+class AsyncWiFiManagerParameter {
+public:
+    AsyncWiFiManagerParameter(const char *id, const char *placeholder, const char *defaultValue, int length)
+        : fieldId(id), fieldValue(defaultValue ? defaultValue : "") {}
+    const char *getID() const { return fieldId; }
+    const char *getValue() const { return fieldValue.c_str(); }
+
+private:
+    const char *fieldId;
+    String fieldValue;
+};
+
+class AsyncWiFiManager {
+public:
+    AsyncWiFiManager(AsyncWebServer *server, DNSServer *dns) {}
+
+    void addParameter(AsyncWiFiManagerParameter *parameter) {}
+    void setCustomHeadElement(const char *element) {}
+    void setMinimumSignalQuality(int quality) {}
+    void setRemoveDuplicateAPs(bool remove) {}
+    void setSaveConfigCallback(std::function<void()> callback) {}
+    void setAPCallback(std::function<void(AsyncWiFiManager *)> callback) {}
+    void setConfigPortalTimeout(unsigned long seconds) {}
+    void setDebugOutput(bool debug) {}
+    void setAPStaticIPConfig(IPAddress ip, IPAddress gateway, IPAddress subnet) {}
+
+    bool autoConnect(const char *apName, const char *apPassword = nullptr) {
+        WiFi.mode(WIFI_STA);
+        return true;
+    }
+    void loop() {}
+};
+
+#endif
@@ -0,0 +1,19 @@
+/**
+ * @file ESPmDNS.h
+ * @brief mDNS responder for the native simulator (nothing is announced)
+ */
+
+#ifndef SIM_ESPMDNS_H
+#define SIM_ESPMDNS_H
+
+#include "Arduino.h"
+
+class MDNSResponder {
+public:
+    bool begin(const char *hostname) { return true; }
+    void addService(const char *service, const char *protocol, uint16_t port) {}
+};
+
+extern MDNSResponder MDNS;
+
+#endif
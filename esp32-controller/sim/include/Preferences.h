@@ -0,0 +1,45 @@
+/**
+ * @file Preferences.h
+ * @brief Arduino-ESP32 Preferences for the native simulator
+ *
+ * A thin layer over the nvs_* API, as in the Arduino core: every put is
+ * committed right away, a read-only begin() of a namespace that was never
+ * written fails.
+ */
+
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include "Arduino.h"
+#include "nvs.h"
+
+class Preferences {
+public:
+    bool begin(const char *name, bool readOnly = false, const char *partition = nullptr);
+    void end();
+
+    bool clear();
+    bool remove(const char *key);
+    bool isKey(const char *key);
+
+    size_t putBool(const char *key, bool value) { return putUChar(key, value ? 1 : 0); }
+    size_t putUChar(const char *key, uint8_t value);
+    size_t putUInt(const char *key, uint32_t value);
+    size_t putString(const char *key, const char *value);
+    size_t putString(const char *key, const String &value) { return putString(key, value.c_str()); }
+    size_t putBytes(const char *key, const void *value, size_t length);
+
+    bool getBool(const char *key, bool defaultValue = false) { return getUChar(key, defaultValue ? 1 : 0) == 1; }
+    uint8_t getUChar(const char *key, uint8_t defaultValue = 0);
+    uint32_t getUInt(const char *key, uint32_t defaultValue = 0);
+    String getString(const char *key, const String &defaultValue = String());
+    size_t getBytesLength(const char *key);
+    size_t getBytes(const char *key, void *buffer, size_t maxLength);
+
+private:
+    nvs_handle_t handle = 0;
+    bool started = false;
+    bool readOnly = false;
+};
+
+#endif
@@ -0,0 +1,122 @@
+/**
+ * @file WString.h
+ * @brief Arduino String for the native simulator
+ *
+ * The subset of the Arduino core's String the firmware uses, on top of
+ * std::string: number constructors, concatenation, comparison with C
+ * strings and the in-place edits (trim, toLowerCase, replace). concat()
+ * reports success so ArduinoJson can serialize into a String.
+ */
+
+#ifndef SIM_WSTRING_H
+#define SIM_WSTRING_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+
+class String {
+public:
+    String() {}
+    String(const char *text) : value(text ? text : "") {}
+    String(const std::string &text) : value(text) {}
+    explicit String(char c) : value(1, c) {}
+    explicit String(unsigned char number) : value(std::to_string((unsigned)number)) {}
+    explicit String(int number) : value(std::to_string(number)) {}
+    explicit String(unsigned int number) : value(std::to_string(number)) {}
+    explicit String(long number) : value(std::to_string(number)) {}
+    explicit String(unsigned long number) : value(std::to_string(number)) {}
+    explicit String(long long number) : value(std::to_string(number)) {}
+    explicit String(unsigned long long number) : value(std::to_string(number)) {}
+    explicit String(double number, unsigned int decimals = 2) {
+        char buffer[40];
+        snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, number);
+        value = buffer;
+    }
+
+    const char *c_str() const { return value.c_str(); }
+    unsigned int length() const { return (unsigned int)value.size(); }
+    char operator[](unsigned int index) const { return index < value.size() ? value[index] : '\0'; }
+    char charAt(unsigned int index) const { return (*this)[index]; }
+
+    bool concat(const char *text) {
+        if (!text) return false;
+        value += text;
+        return true;
+    }
+    bool concat(const String &text) {
+        value += text.value;
+        return true;
+    }
+    bool concat(char c) {
+        value += c;
+        return true;
+    }
+
+    String &operator+=(const String &text) { value += text.value; return *this; }
+    String &operator+=(const char *text) { concat(text); return *this; }
+    String &operator+=(char c) { value += c; return *this; }
+
+    friend String operator+(const String &left, const String &right) { return String(left.value + right.value); }
+    friend String operator+(const String &left, const char *right) { return String(left.value + (right ? right : "")); }
+    friend String operator+(const char *left, const String &right) { return String((left ? left : "") + right.value); }
+    friend String operator+(const String &left, char right) { return String(left.value + right); }
+
+    bool equals(const char *text) const { return value == (text ? text : ""); }
+    bool equals(const String &text) const { return value == text.value; }
+    bool operator==(const char *text) const { return equals(text); }
+    bool operator==(const String &text) const { return equals(text); }
+    bool operator!=(const char *text) const { return !equals(text); }
+    bool operator!=(const String &text) const { return !equals(text); }
+    bool operator<(const String &text) const { return value < text.value; }
+
+    bool startsWith(const String &prefix) const { return value.compare(0, prefix.value.size(), prefix.value) == 0; }
+    bool endsWith(const String &suffix) const {
+        return value.size() >= suffix.value.size() &&
+               value.compare(value.size() - suffix.value.size(), suffix.value.size(), suffix.value) == 0;
+    }
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t at = value.find(c, from);
+        return at == std::string::npos ? -1 : (int)at;
+    }
+    int indexOf(const String &text, unsigned int from = 0) const {
+        size_t at = value.find(text.value, from);
+        return at == std::string::npos ? -1 : (int)at;
+    }
+    String substring(unsigned int from) const { return from < value.size() ? String(value.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) { unsigned int swap = from; from = to; to = swap; }
+        if (from >= value.size()) return String();
+        return String(value.substr(from, to - from));
+    }
+
+    void trim() {
+        size_t first = 0;
+        while (first < value.size() && isspace((unsigned char)value[first])) first++;
+        size_t last = value.size();
+        while (last > first && isspace((unsigned char)value[last - 1])) last--;
+        value = value.substr(first, last - first);
+    }
+    void toLowerCase() {
+        for (size_t i = 0; i < value.size(); i++) value[i] = (char)tolower((unsigned char)value[i]);
+    }
+    void toUpperCase() {
+        for (size_t i = 0; i < value.size(); i++) value[i] = (char)toupper((unsigned char)value[i]);
+    }
+    void replace(const String &find, const String &with) {
+        if (find.value.empty()) return;
+        size_t at = 0;
+        while ((at = value.find(find.value, at)) != std::string::npos) {
+            value.replace(at, find.value.size(), with.value);
+            at += with.value.size();
+        }
+    }
+    long toInt() const { return strtol(value.c_str(), nullptr, 10); }
+
+private:
+    std::string value;
+};
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * @file WiFi.h
+ * @brief Arduino-ESP32 WiFi for the native simulator
+ *
+ * The simulated station is always connected: its address is the loopback
+ * interface the web server listens on, the soft AP has no stations.
+ */
+
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include "Arduino.h"
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} wifi_mode_t;
+
+class WiFiClass {
+public:
+    bool mode(wifi_mode_t newMode) {
+        currentMode = newMode;
+        return true;
+    }
+    wifi_mode_t getMode() { return currentMode; }
+    bool disconnect(bool wifiOff = false, bool eraseAp = false) { return true; }
+    bool isConnected() { return currentMode & WIFI_STA; }
+
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+    String macAddress() { return String("02:00:00:52:48:32"); }
+    String SSID() { return String("RailHub32-Sim"); }
+    int8_t RSSI() { return -42; }
+
+    bool softAPConfig(IPAddress local, IPAddress gateway, IPAddress subnet) {
+        apAddress = local;
+        return true;
+    }
+    bool softAP(const char *ssid, const char *password = nullptr, int channel = 1, int hidden = 0, int maxConnections = 4) {
+        currentMode = (wifi_mode_t)(currentMode | WIFI_AP);
+        return true;
+    }
+    IPAddress softAPIP() { return apAddress; }
+    String softAPmacAddress() { return String("02:00:00:52:48:33"); }
+    uint8_t softAPgetStationNum() { return 0; }
+
+private:
+    wifi_mode_t currentMode = WIFI_STA;
+    IPAddress apAddress = IPAddress(192, 168, 4, 1);
+};
+
+extern WiFiClass WiFi;
+
+#endif
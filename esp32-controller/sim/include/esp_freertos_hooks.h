@@ -0,0 +1,20 @@
+/**
+ * @file esp_freertos_hooks.h
+ * @brief ESP-IDF idle hooks for the native simulator
+ *
+ * Host threads have no idle task, so registration fails and the firmware
+ * reports per-core load as not measured.
+ */
+
+#ifndef SIM_ESP_FREERTOS_HOOKS_H
+#define SIM_ESP_FREERTOS_HOOKS_H
+
+#include "esp_err.h"
+
+typedef bool (*esp_freertos_idle_cb_t)();
+
+inline esp_err_t esp_register_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t callback, int cpu) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
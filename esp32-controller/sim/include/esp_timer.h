@@ -0,0 +1,14 @@
+/**
+ * @file esp_timer.h
+ * @brief ESP-IDF high-resolution timer for the native simulator
+ */
+
+#ifndef SIM_ESP_TIMER_H
+#define SIM_ESP_TIMER_H
+
+#include <stdint.h>
+#include "sim_hal.h"
+
+inline int64_t esp_timer_get_time() { return (int64_t)simClockUs(); }
+
+#endif
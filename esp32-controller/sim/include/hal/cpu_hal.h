@@ -0,0 +1,12 @@
+/**
+ * @file cpu_hal.h
+ * @brief ESP-IDF CPU HAL for the native simulator
+ */
+
+#ifndef SIM_CPU_HAL_H
+#define SIM_CPU_HAL_H
+
+// Only reached from idle hooks, which the simulator never calls
+inline void cpu_hal_waiti() {}
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * @file sim_hal.h
+ * @brief Hardware the native simulator runs the firmware on
+ *
+ * The firmware talks to the board only through the Arduino core, ESP-IDF
+ * and its libraries. The headers next to this one stand in for those
+ * (Arduino.h, WiFi.h, Preferences.h, nvs.h, ESPAsyncWebServer.h, ...) and
+ * forward to the functions below, so src/main.cpp builds unchanged for
+ * the host ([env:sim] in platformio.ini):
+ *
+ *   clock    microseconds since the simulated boot (steady host clock)
+ *   GPIO/PWM a virtual sink: pin levels and LEDC duties, optionally traced
+ *            to a CSV file, inputs settable from the console
+ *   NVS      namespaces and typed keys, saved to a file on every commit
+ *   WiFi     always connected as a station on the loopback interface
+ *   sockets  the async web server and WebSocket on a localhost port
+ *
+ * setup() and loop() run on the main thread, the effect task and the
+ * network ("async_tcp") on threads of their own, as on the two cores of
+ * the ESP32.
+ */
+
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#define SIM_GPIO_COUNT 40
+#define SIM_PWM_CHANNELS 16
+
+struct SimOptions {
+    uint16_t httpPort;          // Port the firmware's port 80 is served on
+    std::string nvsPath;        // NVS image, kept across runs and restarts
+    std::string pwmTracePath;   // CSV of every LEDC write ("" = off)
+    bool quiet;                 // Drop Serial output (load tests)
+    bool console;               // Read simulator commands from stdin
+};
+
+// Options and command line of the running simulator (sim_main.cpp)
+const SimOptions &simOptions();
+
+// Clock (sim_clock.cpp)
+uint64_t simClockUs();
+void simSleepUntilUs(uint64_t deadlineUs);
+
+// GPIO and PWM sink (sim_gpio.cpp)
+void simGpioMode(uint8_t pin, uint8_t mode);
+void simGpioWrite(uint8_t pin, uint8_t level);
+int simGpioRead(uint8_t pin);
+void simGpioSetInput(uint8_t pin, uint8_t level);   // Press (LOW) or release (HIGH) a button
+void simPwmSetup(uint8_t channel, uint32_t frequency, uint8_t resolutionBits);
+void simPwmAttach(uint8_t pin, uint8_t channel);
+void simPwmWrite(uint8_t channel, uint32_t duty);
+uint32_t simPwmDuty(uint8_t channel);
+int simPwmPin(uint8_t channel);                     // -1 while unattached
+uint32_t simPwmWrites();
+void simPwmTraceOpen(const std::string &path);
+void simPwmTraceFlush();
+
+// NVS (sim_nvs.cpp): one store behind both Preferences and the nvs_* API
+enum SimNvsType : uint8_t {
+    SIM_NVS_U8 = 1,
+    SIM_NVS_U32 = 4,
+    SIM_NVS_STR = 0x21,
+    SIM_NVS_BLOB = 0x42
+};
+
+bool simNvsLoad(const std::string &path);
+bool simNvsNamespaceExists(const char *ns);
+bool simNvsGet(const char *ns, const char *key, SimNvsType type, std::string &value);
+bool simNvsSet(const char *ns, const char *key, SimNvsType type, const void *data, size_t length);
+bool simNvsErase(const char *ns, const char *key);
+void simNvsEraseAll(const char *ns);
+bool simNvsCommit();
+
+// Sockets (sim_net.cpp): the network task serving every started AsyncWebServer
+void simNetStart();
+uint16_t simNetPort(uint16_t firmwarePort);
+
+// Restart: the process re-executes itself, NVS and the port carry over
+[[noreturn]] void simRestart();
+
+#endif
@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""Load test for the native simulator.
+
+Drives a running simulator with HTTP control requests and WebSocket
+commands from several threads at once, then reports request latency
+percentiles, failures, messages received by the WebSocket clients and
+what reached the PWM sink (GET /sim/pwm).
+
+    .pio/build/sim/program --quiet --no-console &
+    python sim/load_test.py --port 8080 --http 4 --ws 4 --seconds 10
+
+Only the Python standard library is needed.
+"""
+
+import argparse
+import base64
+import http.client
+import json
+import os
+import random
+import socket
+import struct
+import threading
+import time
+
+OUTPUT_PINS = [2, 4, 5, 18, 19, 21, 22, 23, 25, 26, 27, 32, 33, 12, 13, 14]
+
+
+def percentile(values, fraction):
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def random_command():
+    pin = random.choice(OUTPUT_PINS)
+    return {"pin": pin, "active": random.random() < 0.5, "brightness": random.randint(0, 100)}
+
+
+class Results:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.latencies = {}
+        self.failures = {}
+        self.received = 0
+
+    def add(self, kind, seconds, ok):
+        with self.lock:
+            self.latencies.setdefault(kind, []).append(seconds * 1000.0)
+            if not ok:
+                self.failures[kind] = self.failures.get(kind, 0) + 1
+
+
+def http_worker(port, deadline, results):
+    while time.monotonic() < deadline:
+        body = json.dumps(random_command())
+        start = time.monotonic()
+        try:
+            connection = http.client.HTTPConnection("127.0.0.1", port, timeout=5)
+            connection.request("POST", "/api/control", body, {"Content-Type": "application/json"})
+            ok = connection.getresponse().status == 200
+            connection.close()
+        except OSError:
+            ok = False
+        results.add("http", time.monotonic() - start, ok)
+
+
+class WebSocket:
+    def __init__(self, port):
+        self.sock = socket.create_connection(("127.0.0.1", port), timeout=5)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall((
+            "GET /ws HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+            "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n" % key).encode())
+        self.buffer = b""
+        while b"\r\n\r\n" not in self.buffer:
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                raise OSError("handshake closed")
+            self.buffer += chunk
+        head, self.buffer = self.buffer.split(b"\r\n\r\n", 1)
+        if b" 101 " not in head.split(b"\r\n")[0]:
+            raise OSError("handshake refused")
+
+    def send(self, text):
+        data = text.encode()
+        mask = os.urandom(4)
+        header = bytes([0x81])
+        if len(data) < 126:
+            header += bytes([0x80 | len(data)])
+        else:
+            header += bytes([0x80 | 126]) + struct.pack(">H", len(data))
+        self.sock.sendall(header + mask + bytes(b ^ mask[i % 4] for i, b in enumerate(data)))
+
+    def receive(self):
+        while True:
+            if len(self.buffer) >= 2:
+                length = self.buffer[1] & 0x7F
+                offset = 2
+                if length == 126:
+                    length, offset = struct.unpack(">H", self.buffer[2:4])[0], 4
+                elif length == 127:
+                    length, offset = struct.unpack(">Q", self.buffer[2:10])[0], 10
+                if len(self.buffer) >= offset + length:
+                    opcode = self.buffer[0] & 0x0F
+                    payload = self.buffer[offset:offset + length]
+                    self.buffer = self.buffer[offset + length:]
+                    return opcode, payload
+            chunk = self.sock.recv(65536)
+            if not chunk:
+                raise OSError("closed")
+            self.buffer += chunk
+
+    def close(self):
+        self.sock.close()
+
+
+def ws_worker(port, deadline, results):
+    try:
+        ws = WebSocket(port)
+    except OSError:
+        results.add("ws", 0, False)
+        return
+    next_id = 1
+    try:
+        while time.monotonic() < deadline:
+            command = random_command()
+            command.update({"cmd": "control", "id": next_id})
+            start = time.monotonic()
+            ws.send(json.dumps(command))
+            # Deltas and telemetry arrive in between; wait for our ack
+            while True:
+                opcode, payload = ws.receive()
+                with results.lock:
+                    results.received += 1
+                if opcode == 1:
+                    message = json.loads(payload)
+                    if message.get("type") == "ack" and message.get("id") == next_id:
+                        results.add("ws", time.monotonic() - start, message.get("status") == 200)
+                        break
+                elif opcode == 8:
+                    raise OSError("closed by server")
+            next_id += 1
+    except (OSError, ValueError):
+        results.add("ws", 0, False)
+    finally:
+        ws.close()
+
+
+def fetch_json(port, path):
+    connection = http.client.HTTPConnection("127.0.0.1", port, timeout=5)
+    connection.request("GET", path)
+    data = json.loads(connection.getresponse().read())
+    connection.close()
+    return data
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--http", type=int, default=4, help="HTTP client threads")
+    parser.add_argument("--ws", type=int, default=4, help="WebSocket client threads")
+    parser.add_argument("--seconds", type=float, default=10.0)
+    args = parser.parse_args()
+
+    before = fetch_json(args.port, "/sim/pwm")
+    results = Results()
+    deadline = time.monotonic() + args.seconds
+    threads = [threading.Thread(target=http_worker, args=(args.port, deadline, results)) for _ in range(args.http)]
+    threads += [threading.Thread(target=ws_worker, args=(args.port, deadline, results)) for _ in range(args.ws)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    after = fetch_json(args.port, "/sim/pwm")
+
+    print("%-5s %8s %8s %8s %8s %8s %8s" % ("kind", "count", "failed", "p50 ms", "p95 ms", "p99 ms", "max ms"))
+    for kind in sorted(results.latencies):
+        values = results.latencies[kind]
+        print("%-5s %8d %8d %8.2f %8.2f %8.2f %8.2f" % (
+            kind, len(values), results.failures.get(kind, 0), percentile(values, 0.50),
+            percentile(values, 0.95), percentile(values, 0.99), max(values)))
+    total = sum(len(values) for values in results.latencies.values())
+    print("requests/s: %.0f" % (total / args.seconds))
+    print("ws messages received: %d" % results.received)
+    print("LEDC writes: %d, ws messages dropped: %d" % (
+        after["writes"] - before["writes"], after["wsDropped"] - before["wsDropped"]))
+
+    failed = sum(results.failures.values())
+    raise SystemExit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
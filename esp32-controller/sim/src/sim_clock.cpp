@@ -0,0 +1,45 @@
+/**
+ * @file sim_clock.cpp
+ * @brief Clock and tasks of the native simulator
+ *
+ * Time is the steady host clock since the simulator started, so millis(),
+ * micros() and esp_timer_get_time() behave as after a boot. FreeRTOS tasks
+ * run on detached host threads.
+ */
+
+#include <Arduino.h>
+#include <chrono>
+#include <thread>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+#include "sim_hal.h"
+
+static const std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+
+uint64_t simClockUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+void simSleepUntilUs(uint64_t deadlineUs) {
+    std::this_thread::sleep_until(bootTime + std::chrono::microseconds(deadlineUs));
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+    std::thread task([function, parameter, name]() {
+#ifdef __linux__
+        char threadName[16];
+        snprintf(threadName, sizeof(threadName), "%s", name);
+        pthread_setname_np(pthread_self(), threadName);
+#endif
+        function(parameter);
+    });
+    if (handle) *handle = (TaskHandle_t)(uintptr_t)task.native_handle();
+    task.detach();
+    return pdPASS;
+}
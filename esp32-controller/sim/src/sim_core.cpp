@@ -0,0 +1,56 @@
+/**
+ * @file sim_core.cpp
+ * @brief Arduino core objects of the native simulator
+ *
+ * Serial goes to stdout (one lock, so lines of different tasks don't
+ * interleave mid-write; --quiet drops it), the chip reports a fixed heap.
+ */
+
+#include <Arduino.h>
+#include <ESPmDNS.h>
+#include <WiFi.h>
+#include <mutex>
+
+#define SIM_FREE_HEAP 200000    // Typical free heap of the firmware after setup()
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+MDNSResponder MDNS;
+
+static std::mutex serialLock;
+
+size_t HardwareSerial::write(const char *text, size_t length) {
+    if (simOptions().quiet) return length;
+    std::lock_guard<std::mutex> guard(serialLock);
+    return fwrite(text, 1, length, stdout);
+}
+
+void HardwareSerial::flush() {
+    std::lock_guard<std::mutex> guard(serialLock);
+    fflush(stdout);
+}
+
+size_t HardwareSerial::printf(const char *format, ...) {
+    char small[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (length < 0) return 0;
+    if ((size_t)length < sizeof(small)) return write(small, length);
+
+    std::string large(length + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&large[0], large.size(), format, args);
+    va_end(args);
+    return write(large.data(), length);
+}
+
+uint32_t EspClass::getCycleCount() {
+    return (uint32_t)(simClockUs() * (F_CPU / 1000000));
+}
+
+uint32_t EspClass::getFreeHeap() {
+    return SIM_FREE_HEAP;
+}
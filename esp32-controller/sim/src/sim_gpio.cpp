@@ -0,0 +1,100 @@
+/**
+ * @file sim_gpio.cpp
+ * @brief GPIO and PWM sink of the native simulator
+ *
+ * Pins hold the level last written, or for inputs the level set from the
+ * console (pulled-up inputs read HIGH until pressed). LEDC channels keep
+ * their duty and pin; with --pwm-trace every write is appended to a CSV
+ * file as "time_us,channel,pin,duty".
+ */
+
+#include <Arduino.h>
+#include <atomic>
+#include <mutex>
+#include "sim_hal.h"
+
+static std::atomic<uint8_t> pinModes[SIM_GPIO_COUNT];
+static std::atomic<uint8_t> pinLevels[SIM_GPIO_COUNT];
+static std::atomic<int> channelPins[SIM_PWM_CHANNELS];
+static std::atomic<uint32_t> channelDuties[SIM_PWM_CHANNELS];
+static std::atomic<uint32_t> pwmWrites(0);
+
+static std::mutex traceLock;
+static FILE *trace = nullptr;
+
+static struct PinsInit {
+    PinsInit() {
+        for (int channel = 0; channel < SIM_PWM_CHANNELS; channel++) channelPins[channel] = -1;
+    }
+} pinsInit;
+
+void simGpioMode(uint8_t pin, uint8_t mode) {
+    if (pin >= SIM_GPIO_COUNT) return;
+    pinModes[pin] = mode;
+    if (mode & PULLUP) pinLevels[pin] = HIGH;
+}
+
+void simGpioWrite(uint8_t pin, uint8_t level) {
+    if (pin >= SIM_GPIO_COUNT) return;
+    pinLevels[pin] = level ? HIGH : LOW;
+}
+
+int simGpioRead(uint8_t pin) {
+    if (pin >= SIM_GPIO_COUNT) return LOW;
+    return pinLevels[pin];
+}
+
+void simGpioSetInput(uint8_t pin, uint8_t level) {
+    if (pin >= SIM_GPIO_COUNT) return;
+    pinLevels[pin] = level ? HIGH : LOW;
+}
+
+void simPwmSetup(uint8_t channel, uint32_t frequency, uint8_t resolutionBits) {
+    if (channel >= SIM_PWM_CHANNELS) return;
+    channelDuties[channel] = 0;
+}
+
+void simPwmAttach(uint8_t pin, uint8_t channel) {
+    if (channel >= SIM_PWM_CHANNELS || pin >= SIM_GPIO_COUNT) return;
+    channelPins[channel] = pin;
+    pinModes[pin] = OUTPUT;
+}
+
+void simPwmWrite(uint8_t channel, uint32_t duty) {
+    if (channel >= SIM_PWM_CHANNELS) return;
+    channelDuties[channel] = duty;
+    pwmWrites++;
+
+    std::lock_guard<std::mutex> guard(traceLock);
+    if (trace) {
+        fprintf(trace, "%llu,%u,%d,%u\n", (unsigned long long)simClockUs(), channel, channelPins[channel].load(), duty);
+    }
+}
+
+uint32_t simPwmDuty(uint8_t channel) {
+    return channel < SIM_PWM_CHANNELS ? channelDuties[channel].load() : 0;
+}
+
+int simPwmPin(uint8_t channel) {
+    return channel < SIM_PWM_CHANNELS ? channelPins[channel].load() : -1;
+}
+
+uint32_t simPwmWrites() {
+    return pwmWrites;
+}
+
+void simPwmTraceOpen(const std::string &path) {
+    std::lock_guard<std::mutex> guard(traceLock);
+    trace = fopen(path.c_str(), "w");
+    if (!trace) {
+        fprintf(stderr, "[SIM] Cannot open PWM trace %s\n", path.c_str());
+        return;
+    }
+    fprintf(trace, "time_us,channel,pin,duty\n");
+}
+
+// Restart and exit: keep what was traced
+void simPwmTraceFlush() {
+    std::lock_guard<std::mutex> guard(traceLock);
+    if (trace) fflush(trace);
+}
@@ -0,0 +1,166 @@
+/**
+ * @file sim_main.cpp
+ * @brief Entry point of the native simulator
+ *
+ * Starts the network task, runs the firmware's setup() and then loop()
+ * forever on the main thread, like the Arduino core's loopTask. A console
+ * thread reads simulator commands from stdin (press/release a button,
+ * show the PWM sink, restart, quit).
+ *
+ *   .pio/build/sim/program [--port 8080] [--nvs railhub-nvs.bin]
+ *                          [--pwm-trace pwm.csv] [--loop-us 1000]
+ *                          [--quiet] [--no-console]
+ */
+
+#include <Arduino.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "sim_hal.h"
+
+void setup();
+void loop();
+
+static SimOptions options = {8080, "railhub-nvs.bin", "", false, true};
+static uint32_t loopPeriodUs = 1000;
+static std::vector<std::string> arguments;
+
+const SimOptions &simOptions() {
+    return options;
+}
+
+static void usage(const char *program) {
+    printf("Usage: %s [options]\n"
+           "  --port N         Serve the firmware's port 80 on 127.0.0.1:N (default 8080)\n"
+           "  --nvs FILE       NVS image kept across runs (default railhub-nvs.bin)\n"
+           "  --pwm-trace FILE Write every LEDC write to FILE as CSV\n"
+           "  --loop-us N      Pause between loop() passes in us (default 1000, 0 = spin)\n"
+           "  --quiet          Drop the firmware's Serial output\n"
+           "  --no-console     Don't read simulator commands from stdin\n",
+           program);
+}
+
+static bool parseOptions(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (option == "--port" && hasValue) {
+            options.httpPort = (uint16_t)atoi(argv[++i]);
+        } else if (option == "--nvs" && hasValue) {
+            options.nvsPath = argv[++i];
+        } else if (option == "--pwm-trace" && hasValue) {
+            options.pwmTracePath = argv[++i];
+        } else if (option == "--loop-us" && hasValue) {
+            loopPeriodUs = (uint32_t)atol(argv[++i]);
+        } else if (option == "--quiet") {
+            options.quiet = true;
+        } else if (option == "--no-console") {
+            options.console = false;
+        } else {
+            usage(argv[0]);
+            return false;
+        }
+    }
+    return options.httpPort != 0;
+}
+
+static void printPwm() {
+    for (uint8_t channel = 0; channel < SIM_PWM_CHANNELS; channel++) {
+        int pin = simPwmPin(channel);
+        if (pin < 0) continue;
+        fprintf(stderr, "[SIM] ch%-2u GPIO%-2d duty %3u\n", channel, pin, simPwmDuty(channel));
+    }
+    fprintf(stderr, "[SIM] %u LEDC writes\n", simPwmWrites());
+}
+
+// Power off: what was committed or traced is kept
+[[noreturn]] static void powerOff() {
+    simNvsCommit();
+    simPwmTraceFlush();
+    fflush(stdout);
+    _exit(0);
+}
+
+// Ctrl-C and kill end the simulator through powerOff(), on a thread of its own
+static void signals(sigset_t set) {
+    int signal;
+    sigwait(&set, &signal);
+    powerOff();
+}
+
+static void console() {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream words(line);
+        std::string command;
+        int pin = -1;
+        words >> command >> pin;
+
+        if (command == "press" && pin >= 0) {
+            simGpioSetInput(pin, LOW);
+        } else if (command == "release" && pin >= 0) {
+            simGpioSetInput(pin, HIGH);
+        } else if (command == "pwm") {
+            printPwm();
+        } else if (command == "restart") {
+            simRestart();
+        } else if (command == "quit") {
+            powerOff();
+        } else if (!command.empty()) {
+            fprintf(stderr, "[SIM] Commands: press <pin>, release <pin>, pwm, restart, quit\n");
+        }
+    }
+}
+
+// Like a reset: NVS and the trace are on "flash", everything else starts over
+void simRestart() {
+    simNvsCommit();
+    simPwmTraceFlush();
+    fflush(stdout);
+
+    std::vector<char *> argv;
+    for (std::string &argument : arguments) argv.push_back(&argument[0]);
+    argv.push_back(nullptr);
+    execv("/proc/self/exe", argv.data());
+    execv(argv[0], argv.data());
+    fprintf(stderr, "[SIM] Restart failed, exiting\n");
+    _exit(1);
+}
+
+int main(int argc, char **argv) {
+    for (int i = 0; i < argc; i++) arguments.push_back(argv[i]);
+    if (!parseOptions(argc, argv)) return 2;
+
+    // A client that hangs up mid-response must not end the process
+    signal(SIGPIPE, SIG_IGN);
+
+    // Blocked before any task starts, so only the signal thread sees them
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+    std::thread(signals, stopSignals).detach();
+
+    simNvsLoad(options.nvsPath);
+    if (!options.pwmTracePath.empty()) simPwmTraceOpen(options.pwmTracePath);
+    simNetStart();
+    if (options.console) std::thread(console).detach();
+
+    setup();
+    uint64_t nextPass = simClockUs();
+    for (;;) {
+        loop();
+        if (loopPeriodUs > 0) {
+            nextPass += loopPeriodUs;
+            uint64_t now = simClockUs();
+            if (nextPass < now) nextPass = now;
+            simSleepUntilUs(nextPass);
+        }
+    }
+}
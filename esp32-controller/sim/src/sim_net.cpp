@@ -0,0 +1,939 @@
+/**
+ * @file sim_net.cpp
+ * @brief Network task of the native simulator: HTTP and WebSocket on localhost
+ *
+ * One thread ("async_tcp") polls every listening socket and connection,
+ * parses requests and WebSocket frames and runs the firmware's handlers,
+ * like the AsyncTCP task on the chip. All state here is guarded by one
+ * recursive lock, held while handlers run and taken by the client and
+ * socket functions other tasks call; a pipe wakes the poll when they
+ * queue something to send.
+ *
+ * GET /sim/pwm is answered by the simulator itself with the PWM sink.
+ */
+
+#include <ESPAsyncWebServer.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include "sim_hal.h"
+
+#define SIM_HTTP_HEADER_MAX 8192            // Larger request heads are answered with 431
+#define SIM_WS_FRAME_MAX (64 * 1024)        // Larger frames close the socket with 1009
+#define SIM_READ_CHUNK 4096                 // Bytes per recv(), so bodies arrive in pieces
+#define SIM_TCP_SEGMENT 1436                // Bytes per chunked response filler call (lwIP MSS)
+#define SIM_WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+struct SimWsMessage {
+    uint8_t opcode;
+    std::shared_ptr<std::string> payload;
+};
+
+struct SimConnection {
+    enum Phase { HEADERS, BODY, DONE, WEBSOCKET };
+
+    int fd = -1;
+    AsyncWebServer *server = nullptr;
+    AsyncClient peer;
+    Phase phase = HEADERS;
+    std::string input;
+    std::string output;
+    size_t outputSent = 0;
+    bool closeAfterFlush = false;
+    bool closed = false;
+
+    // HTTP
+    AsyncWebServerRequest *request = nullptr;
+    size_t bodyIndex = 0;
+
+    // WebSocket
+    AsyncWebSocket *socket = nullptr;
+    AsyncWebSocketClient *client = nullptr;
+    std::deque<SimWsMessage> queue;
+    uint8_t messageOpcode = 0;
+    uint32_t frameNumber = 0;
+
+    bool sending() const { return outputSent < output.size(); }
+};
+
+struct SimListener {
+    AsyncWebServer *server;
+    int fd;
+};
+
+static std::recursive_mutex netLock;
+static std::vector<SimListener> listeners;
+static std::vector<SimConnection *> connections;
+static int wakePipe[2] = {-1, -1};
+static uint32_t wsMessagesDropped = 0;
+
+static void wake() {
+    if (wakePipe[1] < 0) return;
+    char signal = 1;
+    ssize_t ignored = write(wakePipe[1], &signal, 1);
+    (void)ignored;
+}
+
+static void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+// SHA-1 and base64 for Sec-WebSocket-Accept
+static uint32_t rotateLeft(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static void sha1(const std::string &message, uint8_t digest[20]) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::string data = message;
+    uint64_t bitLength = (uint64_t)message.size() * 8;
+    data += (char)0x80;
+    while (data.size() % 64 != 56) data += (char)0;
+    for (int i = 7; i >= 0; i--) data += (char)((bitLength >> (i * 8)) & 0xFF);
+
+    for (size_t chunk = 0; chunk < data.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const uint8_t *p = (const uint8_t *)data.data() + chunk + i * 4;
+            w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+        }
+        for (int i = 16; i < 80; i++) w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+            uint32_t temp = rotateLeft(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = rotateLeft(b, 30); b = a; a = temp;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    for (int i = 0; i < 5; i++) {
+        digest[i * 4] = h[i] >> 24;
+        digest[i * 4 + 1] = h[i] >> 16;
+        digest[i * 4 + 2] = h[i] >> 8;
+        digest[i * 4 + 3] = h[i];
+    }
+}
+
+static std::string base64(const uint8_t *data, size_t length) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t triple = (uint32_t)data[i] << 16;
+        if (i + 1 < length) triple |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < length) triple |= data[i + 2];
+        out += alphabet[(triple >> 18) & 0x3F];
+        out += alphabet[(triple >> 12) & 0x3F];
+        out += i + 1 < length ? alphabet[(triple >> 6) & 0x3F] : '=';
+        out += i + 2 < length ? alphabet[triple & 0x3F] : '=';
+    }
+    return out;
+}
+
+static const char *reasonPhrase(int code) {
+    switch (code) {
+        case 101: return "Switching Protocols";
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 413: return "Payload Too Large";
+        case 426: return "Upgrade Required";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "";
+    }
+}
+
+// Responses
+AsyncWebServerResponse::AsyncWebServerResponse(int code, const String &contentType, const std::string &content)
+    : statusCode(code), type(contentType), body(content) {}
+
+void AsyncWebServerResponse::addHeader(const String &name, const String &value) {
+    headers.push_back(std::make_pair(name, value));
+}
+
+std::string AsyncWebServerResponse::render() const {
+    bool hasBody = statusCode != 204 && statusCode != 304;
+    char line[64];
+    snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\n", statusCode, reasonPhrase(statusCode));
+    std::string out = line;
+    out += "Connection: close\r\nAccept-Ranges: none\r\n";
+    if (hasBody) {
+        out += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+        if (type.length() > 0) out += std::string("Content-Type: ") + type.c_str() + "\r\n";
+    }
+    for (const auto &header : headers) {
+        out += std::string(header.first.c_str()) + ": " + header.second.c_str() + "\r\n";
+    }
+    out += "\r\n";
+    if (hasBody) out += body;
+    return out;
+}
+
+// Requests
+AsyncWebServerRequest::AsyncWebServerRequest(SimConnection *connection, const AsyncClient &peer)
+    : connection(connection), peer(peer) {}
+
+// The connection is gone once the request is deleted, as in the library
+AsyncWebServerRequest::~AsyncWebServerRequest() {
+    if (disconnectHandler) disconnectHandler();
+}
+
+bool AsyncWebServerRequest::hasHeader(const char *name) const {
+    for (const auto &header : headers) {
+        if (strcasecmp(header.first.c_str(), name) == 0) return true;
+    }
+    return false;
+}
+
+String AsyncWebServerRequest::header(const char *name) const {
+    for (const auto &header : headers) {
+        if (strcasecmp(header.first.c_str(), name) == 0) return header.second;
+    }
+    return String();
+}
+
+bool AsyncWebServerRequest::hasParam(const char *name) const {
+    for (const auto &param : params) {
+        if (param.name() == name) return true;
+    }
+    return false;
+}
+
+AsyncWebParameter *AsyncWebServerRequest::getParam(const char *name) {
+    for (auto &param : params) {
+        if (param.name() == name) return &param;
+    }
+    return nullptr;
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(int code, const String &contentType, const String &content) {
+    return new AsyncWebServerResponse(code, contentType, std::string(content.c_str(), content.length()));
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse_P(int code, const String &contentType,
+                                                               const uint8_t *content, size_t len) {
+    return new AsyncWebServerResponse(code, contentType, std::string((const char *)content, len));
+}
+
+// The filler is drained right away, one TCP segment per call as on the chip,
+// and sent with a Content-Length instead of chunked encoding
+AsyncWebServerResponse *AsyncWebServerRequest::beginChunkedResponse(const String &contentType, AwsResponseFiller filler) {
+    std::string content;
+    uint8_t segment[SIM_TCP_SEGMENT];
+    for (;;) {
+        size_t length = filler(segment, sizeof(segment), content.size());
+        if (length == 0) break;
+        content.append((const char *)segment, length);
+    }
+    return new AsyncWebServerResponse(200, contentType, content);
+}
+
+// Only the first response of a request is sent, as in the library
+void AsyncWebServerRequest::send(AsyncWebServerResponse *response) {
+    std::lock_guard<std::recursive_mutex> guard(netLock);
+    if (!responded && connection && !connection->closed) {
+        responded = true;
+        connection->output += response->render();
+        wake();
+    }
+    delete response;
+}
+
+void AsyncWebServerRequest::send(int code, const String &contentType, const String &content) {
+    send(beginResponse(code, contentType, content));
+}
+
+// Handlers
+bool AsyncCallbackWebHandler::canHandle(AsyncWebServerRequest *request) {
+    if (!onRequest) return false;
+    if (!(method & request->method())) return false;
+    if (uri.length() > 0 && uri.endsWith("*")) {
+        return request->url().startsWith(uri.substring(0, uri.length() - 1));
+    }
+    if (uri.length() > 0 && uri != request->url() && !request->url().startsWith(uri + "/")) return false;
+    return true;
+}
+
+void AsyncCallbackWebHandler::handleRequest(AsyncWebServerRequest *request) {
+    if (onRequest) {
+        onRequest(request);
+    } else {
+        request->send(500);
+    }
+}
+
+void AsyncCallbackWebHandler::handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+    if (onBody) onBody(request, data, len, index, total);
+}
+
+// Server
+AsyncWebServer::AsyncWebServer(uint16_t port) : firmwarePort(port) {}
+
+AsyncWebServer::~AsyncWebServer() {
+    end();
+}
+
+void AsyncWebServer::begin() {
+    std::lock_guard<std::recursive_mutex> guard(netLock);
+    uint16_t port = simNetPort(firmwarePort);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || bind(fd, (sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 16) != 0) {
+        fprintf(stderr, "[SIM] Cannot listen on 127.0.0.1:%u (firmware port %u): %s\n", port, firmwarePort, strerror(errno));
+        exit(1);
+    }
+    setNonBlocking(fd);
+    listeners.push_back({this, fd});
+    fprintf(stderr, "[SIM] Firmware port %u served on http://127.0.0.1:%u\n", firmwarePort, port);
+    wake();
+}
+
+void AsyncWebServer::end() {
+    std::lock_guard<std::recursive_mutex> guard(netLock);
+    for (size_t i = 0; i < listeners.size(); i++) {
+        if (listeners[i].server == this) {
+            close(listeners[i].fd);
+            listeners.erase(listeners.begin() + i);
+            break;
+        }
+    }
+}
+
+AsyncWebHandler &AsyncWebServer::addHandler(AsyncWebHandler *handler) {
+    std::lock_guard<std::recursive_mutex> guard(netLock);
+    handlers.push_back(handler);
+    return *handler;
+}
+
+AsyncCallbackWebHandler &AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest) {
+    return on(uri, method, onRequest, nullptr, nullptr);
+}
+
+AsyncCallbackWebHandler &AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                                            ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody) {
+    AsyncCallbackWebHandler *handler = new AsyncCallbackWebHandler(uri, method, onRequest, onUpload, onBody);
+    addHandler(handler);
+    return *handler;
+}
+
+AsyncWebHandler *AsyncWebServer::findHandler(AsyncWebServerRequest *request) {
+    for (AsyncWebHandler *handler : handlers) {
+        if (handler->canHandle(request)) return handler;
+    }
+    return nullptr;
+}
+
+void AsyncWebServer::handleNotFound(AsyncWebServerRequest *request) {
+    if (notFound) {
+        notFound(request);
+    } else {
+        request->send(404);
+    }
+}
+
+// WebSocket frames
+static std::string wsFrame(uint8_t opcode, const std::string &payload) {
+    std::string frame;
+    frame += (char)(0x80 | opcode);
+    size_t length = payload.size();
+    if (length < 126) {
+        frame += (char)length;
+    } else if (length < 65536) {
+        frame += (char)126;
+        frame += (char)(length >> 8);
+        frame += (char)(length & 0xFF);
+    } else {
+        frame += (char)127;
+        for (int i = 7; i >= 0; i--) frame += (char)(((uint64_t)length >> (i * 8)) & 0xFF);
+    }
+    return frame + payload;
+}
+
+static size_t wsQueueLength(const SimConnection *connection) {
+    return connection->queue.size() + (connection->phase == SimConnection::WEBSOCKET && connection->sending() ? 1 : 0);
+}
+
+AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebSocket *server, SimConnection *connection, uint32_t id, const AsyncClient &peer)
+    : socket(server), connection(connection), clientId(id), peer(peer) {}
+
+bool AsyncWebSocketClient::queueIsFull() const {
+    std::lock_guard<std::recursive_mutex> guard(netLock);
+    return !connection || state != WS_CONNECTED || wsQueueLength(connection) >= WS_MAX_QUEUED_MESSAGES;
+}
+
+size_t AsyncWebSocketClient::queueLen() const {
+    std::lock_guard<std::recursive_mutex> guard(netLock);
+    return connection ? wsQueueLength(connection) : 0;
+}
+
+static void wsQueue(SimConnection *connection, AwsClientStatus state, uint8_t opcode, const std::shared_ptr<std::string> &payload) {
+    std::lock_guard<std::recursive_mutex> guard(netLock);
+    if (!connection || state != WS_CONNECTED) return;
+    if (wsQueueLength(connection) >= WS_MAX_QUEUED_MESSAGES) {
+        wsMessagesDropped++;
+        return;
+    }
+    connection->queue.push_back({opcode, payload});
+    wake();
+}
+
+void AsyncWebSocketClient::text(const char *message, size_t len) {
+    wsQueue(connection, state, WS_TEXT, std::make_shared<std::string>(message, len));
+}
+
+void AsyncWebSocketClient::text(AsyncWebSocketMessageBuffer *buffer) {
+    wsQueue(connection, state, WS_TEXT, buffer->content);
+}
+
+void AsyncWebSocketClient::binary(const uint8_t *message, size_t len) {
+    wsQueue(connection, state, WS_BINARY, std::make_shared<std::string>((const char *)message, len));
+}
+
+void AsyncWebSocketClient::binary(AsyncWebSocketMessageBuffer *buffer) {
+    wsQueue(connection, state, WS_BINARY, buffer->content);
+}
+
+// Unsent messages are dropped; the socket closes once the close frame is out
+void AsyncWebSocketClient::close(uint16_t code, const char *message) {
+    std::lock_guard<std::recursive_mutex> guard(netLock);
+    if (!connection || state != WS_CONNECTED) return;
+    std::string payload;
+    if (code != 0) {
+        payload += (char)(code >> 8);
+        payload += (char)(code & 0xFF);
+        if (message) payload += message;
+    }
+    connection->queue.clear();
+    connection->queue.push_back({WS_DISCONNECT, std::make_shared<std::string>(payload)});
+    connection->closeAfterFlush = true;
+    state = WS_DISCONNECTING;
+    wake();
+}
+
+void AsyncWebSocketClient::detach() {
+    connection = nullptr;
+    state = WS_DISCONNECTED;
+}
+
+AsyncWebSocket::~AsyncWebSocket() {
+    _cleanBuffers();
+}
+
+size_t AsyncWebSocket::count() const {
+    std::lock_guard<std::recursive_mutex> guard(netLock);
+    size_t connected = 0;
+    for (AsyncWebSocketClient *client : clients) {
+        if (client->status() == WS_CONNECTED) connected++;
+    }
+    return connected;
+}
+
+AsyncWebSocketClient *AsyncWebSocket::client(uint32_t id) {
+    std::lock_guard<std::recursive_mutex> guard(netLock);
+    for (AsyncWebSocketClient *client : clients) {
+        if (client->id() == id && client->status() == WS_CONNECTED) return client;
+    }
+    return nullptr;
+}
+
+// Oldest clients beyond maxClients are closed; disconnected ones are freed
+void AsyncWebSocket::cleanupClients(uint16_t maxClients) {
+    std::lock_guard<std::recursive_mutex> guard(netLock);
+    size_t connected = count();
+    for (AsyncWebSocketClient *client : clients) {
+        if (connected <= maxClients) break;
+        if (client->status() == WS_CONNECTED) {
+            client->close();
+            connected--;
+        }
+    }
+    for (AsyncWebSocketClient *client : closed) {
+        delete client;
+    }
+    closed.clear();
+}
+
+void AsyncWebSocket::textAll(const char *message) {
+    std::lock_guard<std::recursive_mutex> guard(netLock);
+    for (AsyncWebSocketClient *client : clients) {
+        client->text(message);
+    }
+}
+
+AsyncWebSocketMessageBuffer *AsyncWebSocket::makeBuffer(size_t size) {
+    std::string zeros(size, '\0');
+    return makeBuffer((uint8_t *)&zeros[0], size);
+}
+
+AsyncWebSocketMessageBuffer *AsyncWebSocket::makeBuffer(uint8_t *data, size_t size) {
+    std::lock_guard<std::recursive_mutex> guard(netLock);
+    AsyncWebSocketMessageBuffer *buffer = new AsyncWebSocketMessageBuffer(data, size);
+    buffers.push_back(buffer);
+    return buffer;
+}
+
+// Queued messages hold their own reference to the bytes
+void AsyncWebSocket::_cleanBuffers() {
+    std::lock_guard<std::recursive_mutex> guard(netLock);
+    for (size_t i = 0; i < buffers.size();) {
+        if (buffers[i]->canDelete()) {
+            delete buffers[i];
+            buffers.erase(buffers.begin() + i);
+        } else {
+            i++;
+        }
+    }
+}
+
+bool AsyncWebSocket::canHandle(AsyncWebServerRequest *request) {
+    return request->method() == HTTP_GET && request->url() == path &&
+           strcasecmp(request->header("Upgrade").c_str(), "websocket") == 0;
+}
+
+void AsyncWebSocket::handleRequest(AsyncWebServerRequest *request) {
+    if (!request->hasHeader("Sec-WebSocket-Key")) {
+        request->send(400);
+        return;
+    }
+    if (request->header("Sec-WebSocket-Version") != "13") {
+        AsyncWebServerResponse *response = request->beginResponse(426);
+        response->addHeader("Sec-WebSocket-Version", "13");
+        request->send(response);
+        return;
+    }
+
+    uint8_t digest[20];
+    sha1(std::string(request->header("Sec-WebSocket-Key").c_str()) + SIM_WS_GUID, digest);
+    SimConnection *connection = request->connection;
+    connection->output += "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Accept: " + base64(digest, sizeof(digest)) + "\r\n\r\n";
+    request->responded = true;
+    connection->phase = SimConnection::WEBSOCKET;
+    connection->socket = this;
+    connection->client = new AsyncWebSocketClient(this, connection, nextId++, connection->peer);
+    clients.push_back(connection->client);
+    wake();
+    event(connection->client, WS_EVT_CONNECT, nullptr, nullptr, 0);
+}
+
+void AsyncWebSocket::event(AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
+    if (eventHandler) eventHandler(this, client, type, arg, data, len);
+}
+
+void AsyncWebSocket::removeClient(AsyncWebSocketClient *client) {
+    for (size_t i = 0; i < clients.size(); i++) {
+        if (clients[i] == client) {
+            clients.erase(clients.begin() + i);
+            closed.push_back(client);
+            return;
+        }
+    }
+}
+
+// Connections (network task only, netLock held)
+static void closeConnection(SimConnection *connection) {
+    if (connection->closed) return;
+    connection->closed = true;
+    close(connection->fd);
+    if (connection->client) {
+        AsyncWebSocketClient *client = connection->client;
+        client->detach();
+        connection->socket->event(client, WS_EVT_DISCONNECT, nullptr, nullptr, 0);
+        connection->socket->removeClient(client);
+    }
+}
+
+static void handleFrame(SimConnection *connection, bool final, uint8_t opcode, const uint8_t mask[4], std::string &payload) {
+    AsyncWebSocketClient *client = connection->client;
+    switch (opcode) {
+        case WS_CONTINUATION:
+        case WS_TEXT:
+        case WS_BINARY: {
+            if (opcode != WS_CONTINUATION) {
+                connection->messageOpcode = opcode;
+                connection->frameNumber = 0;
+            } else {
+                connection->frameNumber++;
+            }
+            AwsFrameInfo info = {};
+            info.message_opcode = connection->messageOpcode;
+            info.num = connection->frameNumber;
+            info.final = final;
+            info.masked = 1;
+            info.opcode = opcode;
+            info.len = payload.size();
+            memcpy(info.mask, mask, 4);
+            info.index = 0;
+            connection->socket->event(client, WS_EVT_DATA, &info, (uint8_t *)&payload[0], payload.size());
+            break;
+        }
+        case WS_DISCONNECT:
+            if (client->status() == WS_CONNECTED) {
+                // Echo the status code, then close
+                std::string reply = payload.size() >= 2 ? payload.substr(0, 2) : std::string();
+                connection->queue.clear();
+                connection->queue.push_back({WS_DISCONNECT, std::make_shared<std::string>(reply)});
+                connection->closeAfterFlush = true;
+                client->detach();
+            } else {
+                closeConnection(connection);
+            }
+            break;
+        case WS_PING:
+            connection->queue.push_front({WS_PONG, std::make_shared<std::string>(payload)});
+            break;
+        case WS_PONG:
+            connection->socket->event(client, WS_EVT_PONG, nullptr, (uint8_t *)&payload[0], payload.size());
+            break;
+        default:
+            break;
+    }
+}
+
+static void readFrames(SimConnection *connection) {
+    size_t offset = 0;
+    while (!connection->closed && !connection->closeAfterFlush) {
+        const uint8_t *p = (const uint8_t *)connection->input.data() + offset;
+        size_t available = connection->input.size() - offset;
+        if (available < 2) break;
+
+        bool final = p[0] & 0x80;
+        uint8_t opcode = p[0] & 0x0F;
+        bool masked = p[1] & 0x80;
+        uint64_t length = p[1] & 0x7F;
+        size_t header = 2;
+        if (length == 126) {
+            if (available < 4) break;
+            length = ((uint64_t)p[2] << 8) | p[3];
+            header = 4;
+        } else if (length == 127) {
+            if (available < 10) break;
+            length = 0;
+            for (int i = 0; i < 8; i++) length = (length << 8) | p[2 + i];
+            header = 10;
+        }
+        if (length > SIM_WS_FRAME_MAX) {
+            connection->client->close(1009, "Frame too large");
+            break;
+        }
+        uint8_t mask[4] = {0, 0, 0, 0};
+        if (masked) {
+            if (available < header + 4) break;
+            memcpy(mask, p + header, 4);
+            header += 4;
+        }
+        if (available < header + length) break;
+
+        std::string payload((const char *)p + header, (size_t)length);
+        for (size_t i = 0; masked && i < payload.size(); i++) payload[i] ^= mask[i % 4];
+        offset += header + length;
+        handleFrame(connection, final, opcode, mask, payload);
+    }
+    if (!connection->closed) connection->input.erase(0, offset);
+}
+
+static void respondRaw(SimConnection *connection, int code) {
+    AsyncWebServerResponse response(code, "text/plain", reasonPhrase(code));
+    connection->output += response.render();
+    connection->phase = SimConnection::DONE;
+    if (connection->request) connection->request->responded = true;
+    connection->closeAfterFlush = true;
+}
+
+// GET /sim/pwm: the PWM sink, for load tests that check what reached the outputs
+static void simEndpoint(SimConnection *connection) {
+    std::string json = "{\"uptimeUs\":" + std::to_string(simClockUs()) + ",\"writes\":" + std::to_string(simPwmWrites()) +
+                       ",\"wsDropped\":" + std::to_string(wsMessagesDropped) + ",\"channels\":[";
+    for (uint8_t channel = 0; channel < SIM_PWM_CHANNELS; channel++) {
+        if (channel > 0) json += ",";
+        json += "{\"channel\":" + std::to_string(channel) + ",\"pin\":" + std::to_string(simPwmPin(channel)) +
+                ",\"duty\":" + std::to_string(simPwmDuty(channel)) + "}";
+    }
+    json += "]}";
+    connection->request->send(200, "application/json", String(json));
+    connection->phase = SimConnection::DONE;
+}
+
+static void finishBody(SimConnection *connection) {
+    connection->phase = SimConnection::DONE;
+    AsyncWebServerRequest *request = connection->request;
+    if (request->handler) {
+        request->handler->handleRequest(request);
+    } else {
+        connection->server->handleNotFound(request);
+    }
+}
+
+static void feedBody(SimConnection *connection, const char *data, size_t length) {
+    AsyncWebServerRequest *request = connection->request;
+    size_t take = std::min(length, request->length - connection->bodyIndex);
+    if (take == 0) return;
+    if (request->handler) {
+        request->handler->handleBody(request, (uint8_t *)data, take, connection->bodyIndex, request->length);
+    }
+    connection->bodyIndex += take;
+    if (connection->bodyIndex == request->length) finishBody(connection);
+}
+
+static WebRequestMethodComposite parseMethod(const std::string &name) {
+    if (name == "GET") return HTTP_GET;
+    if (name == "POST") return HTTP_POST;
+    if (name == "DELETE") return HTTP_DELETE;
+    if (name == "PUT") return HTTP_PUT;
+    if (name == "PATCH") return HTTP_PATCH;
+    if (name == "HEAD") return HTTP_HEAD;
+    if (name == "OPTIONS") return HTTP_OPTIONS;
+    return 0;
+}
+
+// Request line and headers; the handler is attached before the body arrives
+static void readHead(SimConnection *connection) {
+    size_t end = connection->input.find("\r\n\r\n");
+    if (end == std::string::npos) {
+        if (connection->input.size() > SIM_HTTP_HEADER_MAX) respondRaw(connection, 431);
+        return;
+    }
+    std::string head = connection->input.substr(0, end);
+    std::string rest = connection->input.substr(end + 4);
+    connection->input.clear();
+
+    AsyncWebServerRequest *request = new AsyncWebServerRequest(connection, connection->peer);
+    connection->request = request;
+
+    size_t lineEnd = head.find("\r\n");
+    std::string requestLine = head.substr(0, lineEnd);
+    size_t firstSpace = requestLine.find(' ');
+    size_t secondSpace = requestLine.find(' ', firstSpace + 1);
+    if (firstSpace == std::string::npos || secondSpace == std::string::npos) {
+        respondRaw(connection, 400);
+        return;
+    }
+    request->requestMethod = parseMethod(requestLine.substr(0, firstSpace));
+    std::string target = requestLine.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+    size_t queryStart = target.find('?');
+    request->path = String(target.substr(0, queryStart));
+    if (queryStart != std::string::npos) {
+        std::istringstream query(target.substr(queryStart + 1));
+        std::string pair;
+        while (std::getline(query, pair, '&')) {
+            size_t equals = pair.find('=');
+            if (pair.empty()) continue;
+            request->params.emplace_back(String(pair.substr(0, equals)),
+                                         String(equals == std::string::npos ? "" : pair.substr(equals + 1)));
+        }
+    }
+
+    size_t at = lineEnd;
+    while (at != std::string::npos && at < head.size()) {
+        size_t next = head.find("\r\n", at + 2);
+        std::string line = head.substr(at + 2, next == std::string::npos ? std::string::npos : next - at - 2);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            size_t valueStart = line.find_first_not_of(' ', colon + 1);
+            std::string value = valueStart == std::string::npos ? "" : line.substr(valueStart);
+            request->headers.push_back(std::make_pair(String(line.substr(0, colon)), String(value)));
+        }
+        at = next;
+    }
+    request->length = strtoul(request->header("Content-Length").c_str(), nullptr, 10);
+
+    if (request->requestMethod == 0) {
+        respondRaw(connection, 400);
+        return;
+    }
+    if (request->requestMethod == HTTP_GET && request->url() == "/sim/pwm") {
+        simEndpoint(connection);
+        return;
+    }
+
+    request->handler = connection->server->findHandler(request);
+    if (request->handler && request->handler == connection->server->findHandler(request) &&
+        dynamic_cast<AsyncWebSocket *>(request->handler)) {
+        request->handler->handleRequest(request);
+        if (connection->phase == SimConnection::WEBSOCKET && !rest.empty()) {
+            connection->input = rest;
+            readFrames(connection);
+        } else if (connection->phase != SimConnection::WEBSOCKET) {
+            connection->phase = SimConnection::DONE;
+        }
+        return;
+    }
+
+    if (request->length > 0) {
+        connection->phase = SimConnection::BODY;
+        if (!rest.empty()) feedBody(connection, rest.data(), rest.size());
+    } else {
+        finishBody(connection);
+    }
+}
+
+static void readFrom(SimConnection *connection) {
+    char buffer[SIM_READ_CHUNK];
+    ssize_t received = recv(connection->fd, buffer, sizeof(buffer), 0);
+    if (received == 0) {
+        closeConnection(connection);
+        return;
+    }
+    if (received < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) closeConnection(connection);
+        return;
+    }
+
+    switch (connection->phase) {
+        case SimConnection::HEADERS:
+            connection->input.append(buffer, received);
+            readHead(connection);
+            break;
+        case SimConnection::BODY:
+            feedBody(connection, buffer, received);
+            break;
+        case SimConnection::WEBSOCKET:
+            connection->input.append(buffer, received);
+            readFrames(connection);
+            break;
+        case SimConnection::DONE:
+            break;
+    }
+}
+
+static void writeTo(SimConnection *connection) {
+    while (!connection->closed) {
+        if (!connection->sending()) {
+            connection->output.clear();
+            connection->outputSent = 0;
+            if (connection->phase != SimConnection::WEBSOCKET || connection->queue.empty()) break;
+            SimWsMessage message = connection->queue.front();
+            connection->queue.pop_front();
+            connection->output = wsFrame(message.opcode, *message.payload);
+        }
+        ssize_t sent = send(connection->fd, connection->output.data() + connection->outputSent,
+                            connection->output.size() - connection->outputSent, 0);
+        if (sent < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) closeConnection(connection);
+            return;
+        }
+        connection->outputSent += sent;
+    }
+    if (connection->closed || connection->sending()) return;
+
+    // HTTP closes after its response, WebSocket after its close frame
+    bool answered = connection->phase == SimConnection::DONE && connection->request && connection->request->responded;
+    if (answered || (connection->closeAfterFlush && connection->queue.empty())) {
+        closeConnection(connection);
+    }
+}
+
+static void acceptFrom(const SimListener &listener) {
+    for (;;) {
+        sockaddr_in address = {};
+        socklen_t length = sizeof(address);
+        int fd = accept(listener.fd, (sockaddr *)&address, &length);
+        if (fd < 0) return;
+        setNonBlocking(fd);
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        SimConnection *connection = new SimConnection();
+        connection->fd = fd;
+        connection->server = listener.server;
+        uint32_t ip = ntohl(address.sin_addr.s_addr);
+        connection->peer.address = IPAddress(ip >> 24, ip >> 16, ip >> 8, ip);
+        connection->peer.port = ntohs(address.sin_port);
+        connections.push_back(connection);
+    }
+}
+
+static void netTask() {
+    std::vector<pollfd> fds;
+    std::vector<SimConnection *> polled;
+    size_t listenerCount = 0;
+
+    for (;;) {
+        {
+            std::lock_guard<std::recursive_mutex> guard(netLock);
+            fds.clear();
+            polled.clear();
+            fds.push_back({wakePipe[0], POLLIN, 0});
+            for (const SimListener &listener : listeners) {
+                fds.push_back({listener.fd, POLLIN, 0});
+            }
+            listenerCount = listeners.size();
+            for (SimConnection *connection : connections) {
+                short events = POLLIN;
+                if (connection->sending() || (connection->phase == SimConnection::WEBSOCKET && !connection->queue.empty())) {
+                    events |= POLLOUT;
+                }
+                fds.push_back({connection->fd, events, 0});
+                polled.push_back(connection);
+            }
+        }
+
+        poll(fds.data(), fds.size(), 1000);
+
+        std::lock_guard<std::recursive_mutex> guard(netLock);
+        char drain[64];
+        while (read(wakePipe[0], drain, sizeof(drain)) > 0) {
+        }
+        for (size_t i = 0; i < listenerCount && i < listeners.size(); i++) {
+            if (fds[1 + i].revents & POLLIN) acceptFrom(listeners[i]);
+        }
+        for (size_t i = 0; i < polled.size(); i++) {
+            SimConnection *connection = polled[i];
+            if (!connection->closed && (fds[1 + listenerCount + i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                readFrom(connection);
+            }
+        }
+
+        // Handlers and other tasks may have queued output for any connection
+        for (size_t i = 0; i < connections.size();) {
+            SimConnection *connection = connections[i];
+            writeTo(connection);
+            if (connection->closed) {
+                delete connection->request;
+                delete connection;
+                connections.erase(connections.begin() + i);
+            } else {
+                i++;
+            }
+        }
+    }
+}
+
+void simNetStart() {
+    if (pipe(wakePipe) != 0) {
+        fprintf(stderr, "[SIM] Cannot create wake pipe: %s\n", strerror(errno));
+        exit(1);
+    }
+    setNonBlocking(wakePipe[0]);
+    setNonBlocking(wakePipe[1]);
+    xTaskCreatePinnedToCore([](void *) { netTask(); }, "async_tcp", 8192, nullptr, 3, nullptr, 0);
+}
+
+uint16_t simNetPort(uint16_t firmwarePort) {
+    return simOptions().httpPort + (firmwarePort - 80);
+}
@@ -0,0 +1,354 @@
+/**
+ * @file sim_nvs.cpp
+ * @brief NVS of the native simulator, and the nvs_* and Preferences APIs on it
+ *
+ * Namespaces of typed keys in memory. Every commit rewrites the store file
+ * (--nvs) through a temporary file and a rename, so a killed simulator
+ * keeps the last committed state like the chip keeps its flash. File
+ * format: "RHNV", then per entry the namespace, key, type and value, each
+ * string and value prefixed with its 32-bit length.
+ */
+
+#include <Preferences.h>
+#include <nvs.h>
+#include <map>
+#include <mutex>
+#include "sim_hal.h"
+
+#define SIM_NVS_NAME_MAX 15     // Namespace and key length, as on the chip
+#define SIM_NVS_MAGIC "RHNV"
+
+struct SimNvsEntry {
+    SimNvsType type;
+    std::string value;
+};
+
+typedef std::map<std::string, std::map<std::string, SimNvsEntry>> SimNvsStore;
+
+struct SimNvsHandle {
+    std::string ns;
+    bool readOnly;
+};
+
+static std::recursive_mutex storeLock;
+static SimNvsStore store;
+static std::string storePath;
+static std::map<nvs_handle_t, SimNvsHandle> handles;
+static nvs_handle_t nextHandle = 1;
+
+static void writeLength(std::string &out, uint32_t length) {
+    out.append((const char *)&length, sizeof(length));
+}
+
+static void writeString(std::string &out, const std::string &value) {
+    writeLength(out, value.size());
+    out += value;
+}
+
+static bool readString(FILE *file, std::string &value) {
+    uint32_t length;
+    if (fread(&length, sizeof(length), 1, file) != 1 || length > 1024 * 1024) return false;
+    value.resize(length);
+    return length == 0 || fread(&value[0], 1, length, file) == length;
+}
+
+bool simNvsLoad(const std::string &path) {
+    std::lock_guard<std::recursive_mutex> guard(storeLock);
+    storePath = path;
+    store.clear();
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    char magic[4];
+    bool ok = fread(magic, 1, 4, file) == 4 && memcmp(magic, SIM_NVS_MAGIC, 4) == 0;
+    while (ok) {
+        std::string ns, key, value;
+        uint8_t type;
+        if (!readString(file, ns)) break;
+        ok = readString(file, key) && fread(&type, 1, 1, file) == 1 && readString(file, value);
+        if (ok) store[ns][key] = {(SimNvsType)type, value};
+    }
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "[SIM] NVS file %s is damaged, starting empty\n", path.c_str());
+        store.clear();
+    }
+    return ok;
+}
+
+bool simNvsNamespaceExists(const char *ns) {
+    std::lock_guard<std::recursive_mutex> guard(storeLock);
+    return store.count(ns) > 0;
+}
+
+bool simNvsGet(const char *ns, const char *key, SimNvsType type, std::string &value) {
+    std::lock_guard<std::recursive_mutex> guard(storeLock);
+    auto space = store.find(ns);
+    if (space == store.end()) return false;
+    auto entry = space->second.find(key);
+    if (entry == space->second.end() || entry->second.type != type) return false;
+    value = entry->second.value;
+    return true;
+}
+
+bool simNvsSet(const char *ns, const char *key, SimNvsType type, const void *data, size_t length) {
+    std::lock_guard<std::recursive_mutex> guard(storeLock);
+    store[ns][key] = {type, std::string((const char *)data, length)};
+    return true;
+}
+
+bool simNvsErase(const char *ns, const char *key) {
+    std::lock_guard<std::recursive_mutex> guard(storeLock);
+    auto space = store.find(ns);
+    return space != store.end() && space->second.erase(key) > 0;
+}
+
+void simNvsEraseAll(const char *ns) {
+    std::lock_guard<std::recursive_mutex> guard(storeLock);
+    auto space = store.find(ns);
+    if (space != store.end()) space->second.clear();
+}
+
+bool simNvsCommit() {
+    std::lock_guard<std::recursive_mutex> guard(storeLock);
+    if (storePath.empty()) return true;
+
+    std::string image = SIM_NVS_MAGIC;
+    for (const auto &space : store) {
+        for (const auto &entry : space.second) {
+            writeString(image, space.first);
+            writeString(image, entry.first);
+            image += (char)entry.second.type;
+            writeString(image, entry.second.value);
+        }
+    }
+
+    std::string temporary = storePath + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (!file) return false;
+    bool ok = fwrite(image.data(), 1, image.size(), file) == image.size();
+    ok = fclose(file) == 0 && ok;
+    return ok && rename(temporary.c_str(), storePath.c_str()) == 0;
+}
+
+// nvs_* API
+static bool validName(const char *name) {
+    return name && name[0] != '\0' && strlen(name) <= SIM_NVS_NAME_MAX;
+}
+
+static esp_err_t lookup(nvs_handle_t handle, const char *key, bool write, SimNvsHandle &open) {
+    auto found = handles.find(handle);
+    if (found == handles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!key || key[0] == '\0') return ESP_ERR_NVS_INVALID_NAME;
+    if (strlen(key) > SIM_NVS_NAME_MAX) return ESP_ERR_NVS_KEY_TOO_LONG;
+    if (write && found->second.readOnly) return ESP_ERR_NVS_READ_ONLY;
+    open = found->second;
+    return ESP_OK;
+}
+
+static esp_err_t getValue(nvs_handle_t handle, const char *key, SimNvsType type, std::string &value) {
+    std::lock_guard<std::recursive_mutex> guard(storeLock);
+    SimNvsHandle open;
+    esp_err_t err = lookup(handle, key, false, open);
+    if (err != ESP_OK) return err;
+    return simNvsGet(open.ns.c_str(), key, type, value) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+static esp_err_t setValue(nvs_handle_t handle, const char *key, SimNvsType type, const void *data, size_t length) {
+    std::lock_guard<std::recursive_mutex> guard(storeLock);
+    SimNvsHandle open;
+    esp_err_t err = lookup(handle, key, true, open);
+    if (err != ESP_OK) return err;
+    simNvsSet(open.ns.c_str(), key, type, data, length);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle) {
+    std::lock_guard<std::recursive_mutex> guard(storeLock);
+    if (!validName(name)) return ESP_ERR_NVS_INVALID_NAME;
+    if (!simNvsNamespaceExists(name)) {
+        if (mode == NVS_READONLY) return ESP_ERR_NVS_NOT_FOUND;
+        store[name];
+    }
+    *handle = nextHandle++;
+    handles[*handle] = {name, mode == NVS_READONLY};
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    std::lock_guard<std::recursive_mutex> guard(storeLock);
+    handles.erase(handle);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value, size_t *length) {
+    std::string stored;
+    esp_err_t err = getValue(handle, key, SIM_NVS_BLOB, stored);
+    if (err != ESP_OK) return err;
+    if (!value) {
+        *length = stored.size();
+        return ESP_OK;
+    }
+    if (*length < stored.size()) return ESP_ERR_NVS_INVALID_LENGTH;
+    memcpy(value, stored.data(), stored.size());
+    *length = stored.size();
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    return setValue(handle, key, SIM_NVS_BLOB, value, length);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *value) {
+    std::string stored;
+    esp_err_t err = getValue(handle, key, SIM_NVS_U8, stored);
+    if (err == ESP_OK) memcpy(value, stored.data(), sizeof(*value));
+    return err;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value) {
+    return setValue(handle, key, SIM_NVS_U8, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *value) {
+    std::string stored;
+    esp_err_t err = getValue(handle, key, SIM_NVS_U32, stored);
+    if (err == ESP_OK) memcpy(value, stored.data(), sizeof(*value));
+    return err;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value) {
+    return setValue(handle, key, SIM_NVS_U32, &value, sizeof(value));
+}
+
+// Length includes the terminating zero, as on the chip
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *value, size_t *length) {
+    std::string stored;
+    esp_err_t err = getValue(handle, key, SIM_NVS_STR, stored);
+    if (err != ESP_OK) return err;
+    if (!value) {
+        *length = stored.size() + 1;
+        return ESP_OK;
+    }
+    if (*length < stored.size() + 1) return ESP_ERR_NVS_INVALID_LENGTH;
+    memcpy(value, stored.c_str(), stored.size() + 1);
+    *length = stored.size() + 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value) {
+    return setValue(handle, key, SIM_NVS_STR, value, strlen(value));
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+    std::lock_guard<std::recursive_mutex> guard(storeLock);
+    SimNvsHandle open;
+    esp_err_t err = lookup(handle, key, true, open);
+    if (err != ESP_OK) return err;
+    return simNvsErase(open.ns.c_str(), key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+    std::lock_guard<std::recursive_mutex> guard(storeLock);
+    auto found = handles.find(handle);
+    if (found == handles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (found->second.readOnly) return ESP_ERR_NVS_READ_ONLY;
+    simNvsEraseAll(found->second.ns.c_str());
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    std::lock_guard<std::recursive_mutex> guard(storeLock);
+    if (handles.find(handle) == handles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    return simNvsCommit() ? ESP_OK : ESP_FAIL;
+}
+
+// Preferences
+bool Preferences::begin(const char *name, bool readOnlyMode, const char *partition) {
+    if (started) return false;
+    readOnly = readOnlyMode;
+    if (nvs_open(name, readOnly ? NVS_READONLY : NVS_READWRITE, &handle) != ESP_OK) return false;
+    started = true;
+    return true;
+}
+
+void Preferences::end() {
+    if (!started) return;
+    nvs_close(handle);
+    started = false;
+}
+
+bool Preferences::clear() {
+    if (!started || readOnly) return false;
+    return nvs_erase_all(handle) == ESP_OK && nvs_commit(handle) == ESP_OK;
+}
+
+bool Preferences::remove(const char *key) {
+    if (!started || !key || readOnly) return false;
+    return nvs_erase_key(handle, key) == ESP_OK && nvs_commit(handle) == ESP_OK;
+}
+
+bool Preferences::isKey(const char *key) {
+    if (!started) return false;
+    std::string ignored;
+    const SimNvsType types[] = {SIM_NVS_U8, SIM_NVS_U32, SIM_NVS_STR, SIM_NVS_BLOB};
+    for (SimNvsType type : types) {
+        if (getValue(handle, key, type, ignored) == ESP_OK) return true;
+    }
+    return false;
+}
+
+size_t Preferences::putUChar(const char *key, uint8_t value) {
+    if (!started || !key || readOnly) return 0;
+    if (nvs_set_u8(handle, key, value) != ESP_OK || nvs_commit(handle) != ESP_OK) return 0;
+    return sizeof(value);
+}
+
+size_t Preferences::putUInt(const char *key, uint32_t value) {
+    if (!started || !key || readOnly) return 0;
+    if (nvs_set_u32(handle, key, value) != ESP_OK || nvs_commit(handle) != ESP_OK) return 0;
+    return sizeof(value);
+}
+
+size_t Preferences::putString(const char *key, const char *value) {
+    if (!started || !key || !value || readOnly) return 0;
+    if (nvs_set_str(handle, key, value) != ESP_OK || nvs_commit(handle) != ESP_OK) return 0;
+    return strlen(value);
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t length) {
+    if (!started || !key || !value || !length || readOnly) return 0;
+    if (nvs_set_blob(handle, key, value, length) != ESP_OK || nvs_commit(handle) != ESP_OK) return 0;
+    return length;
+}
+
+uint8_t Preferences::getUChar(const char *key, uint8_t defaultValue) {
+    uint8_t value = defaultValue;
+    if (started && key) nvs_get_u8(handle, key, &value);
+    return value;
+}
+
+uint32_t Preferences::getUInt(const char *key, uint32_t defaultValue) {
+    uint32_t value = defaultValue;
+    if (started && key) nvs_get_u32(handle, key, &value);
+    return value;
+}
+
+String Preferences::getString(const char *key, const String &defaultValue) {
+    std::string value;
+    if (!started || !key || getValue(handle, key, SIM_NVS_STR, value) != ESP_OK) return defaultValue;
+    return String(value);
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+    size_t length = 0;
+    if (!started || !key || nvs_get_blob(handle, key, nullptr, &length) != ESP_OK) return 0;
+    return length;
+}
+
+// Nothing is copied when the buffer is too small, as in the Arduino core
+size_t Preferences::getBytes(const char *key, void *buffer, size_t maxLength) {
+    size_t length = getBytesLength(key);
+    if (length == 0 || !buffer || length > maxLength) return 0;
+    if (nvs_get_blob(handle, key, buffer, &length) != ESP_OK) return 0;
+    return length;
+}
@@ -3,9 +3,30 @@
 #include <ESPAsyncWebServer.h>
 #include <ESPAsyncWiFiManager.h>
 #include <Preferences.h>
+#include <nvs.h>
 #include <ESPmDNS.h>
-#include <WebSocketsServer.h>
+#include <esp_timer.h>
+#include <esp_freertos_hooks.h>
+#include <hal/cpu_hal.h>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <body_pool.h>
+#include <command_json.h>
+#include <command_parser.h>
+#include <command_queue.h>
+#include <config_slots.h>
+#include <cpu_load.h>
+#include <json_writer.h>
+#include <loop_profiler.h>
+#include <output_core.h>
+#include <pin_map.h>
+#include <request_trace.h>
+#include <status_frame.h>
+#include <tick_jitter.h>
+#include <write_behind.h>
 #include "config.h"
+#include "web_assets.h"
 
 // Forward declarations
 void initializeOutputs();
@@ -13,16 +34,22 @@ void initializeWiFi();
 void initializeWiFiManager();
 void checkConfigPortalTrigger();
 void initializeWebServer();
-void executeOutputCommand(int pin, bool active, int brightnessPercent);
-void saveOutputState(int index);
+bool executeOutputCommand(int pin, bool active, int brightnessPercent, uint32_t traceId);
+void flushOutputStates();
 void loadOutputStates();
 void saveAllOutputStates();
 void saveCustomParameters();
 void loadCustomParameters();
-void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length);
-void broadcastStatus();
-void updateBlinkingOutputs();
-void setOutputInterval(int index, unsigned int intervalMs);
+void loadPinMap();
+void onWebSocketEvent(AsyncWebSocket* socket, AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t length);
+void broadcastDelta(uint32_t changedMask);
+void broadcastTelemetry();
+void serviceWebSocketClients();
+void requestSnapshot(uint32_t id, int binary);
+bool setOutputInterval(int index, unsigned int intervalMs, uint32_t traceId);
+void startEffectTask();
+void persistAndBroadcastChanges();
+void resetSavedStates();
 
 // Global variables
 // Web Server
@@ -32,12 +59,50 @@ DNSServer dns;
 AsyncWiFiManager wifiManager(&portalServer, &dns);
 Preferences preferences;
 
-// WebSocket server
-WebSocketsServer* ws = nullptr;
+// POST bodies are assembled here until all of their TCP pieces have arrived
+BodyPool<BODY_POOL_SLOTS, MAX_BODY_SIZE + 1> bodyPool;
 
-// WebSocket broadcast timer
+// WebSocket endpoint /ws on the web server's port, driven by the async_tcp task
+AsyncWebSocket* ws = nullptr;
+
+// WebSocket status sync: "hello" with static device info and a full "snapshot"
+// on connect, then a "delta" with only the changed outputs as soon as they
+// change. Every delta bumps statusSeq; a client that sees a gap asks for a new
+// snapshot. The timer only sends "telemetry" (uptime, heap, CPU load).
 unsigned long lastBroadcast = 0;
-const unsigned long BROADCAST_INTERVAL = 2000; // 2 seconds
+const unsigned long BROADCAST_INTERVAL = 2000; // Telemetry every 2 seconds
+uint32_t statusSeq = 0;
+
+// Per-client state, written by WebSocket events (async_tcp) and read by loop(),
+// which does all status sending. A client whose send queue is full
+// (WS_MAX_QUEUED_MESSAGES, set in platformio.ini) gets no more deltas or
+// telemetry; it is marked for a snapshot instead, sent once its queue has
+// room again. Slow clients cost at most a full queue and never stall loop().
+#define WS_MAX_CLIENTS 8
+struct WsClientState {
+    uint32_t id;            // AsyncWebSocketClient id, 0 = free slot
+    bool binary;            // Asked for binary status frames ({"cmd":"hello","format":"binary"})
+    bool needsHello;
+    bool needsSnapshot;     // New client, resync request, or deltas dropped while slow
+};
+WsClientState wsClients[WS_MAX_CLIENTS];
+portMUX_TYPE wsClientsLock = portMUX_INITIALIZER_UNLOCKED;
+
+StatusFrameWriter<MAX_OUTPUTS, OUTPUT_NAME_MAX_LEN> statusFrame;
+
+// JSON status messages are written into this static buffer (loop() only);
+// each message is copied once into a buffer shared by all its recipients
+#define STATUS_JSON_SIZE 2048
+char statusBuffer[STATUS_JSON_SIZE];
+JsonWriter statusJson(statusBuffer, STATUS_JSON_SIZE);
+
+// GET /api/status writes into its own static buffer (room for every output and
+// 32 tasks). Handlers run one at a time on async_tcp, but the response goes out
+// over several callbacks, so the buffer stays taken until that connection
+// closes; a status request arriving meanwhile gets 503.
+#define STATUS_API_JSON_SIZE 5120
+char statusApiBuffer[STATUS_API_JSON_SIZE];
+bool statusApiBusy = false;
 
 String macAddress;
 char customDeviceName[40] = DEVICE_NAME; // Custom device name from WiFiManager
@@ -46,19 +111,332 @@ unsigned long portalButtonPressTime = 0;
 bool wifiConnected = false;
 
 // Output pin configuration
-int outputPins[MAX_OUTPUTS] = LED_PINS;
-bool outputStates[MAX_OUTPUTS] = {false};
-int outputBrightness[MAX_OUTPUTS] = {255}; // 0-255 for PWM
-String outputNames[MAX_OUTPUTS]; // Custom names for outputs
-unsigned int outputIntervals[MAX_OUTPUTS] = {0}; // Blink interval in ms (0 = no blink)
-unsigned long lastBlinkTime[MAX_OUTPUTS] = {0}; // Last blink toggle time
-bool blinkState[MAX_OUTPUTS] = {false}; // Current blink state
-
-// CPU load tracking
+// Output-to-GPIO map: LED_PINS unless another map was saved through /api/pins
+const int DEFAULT_OUTPUT_PINS[MAX_OUTPUTS] = LED_PINS;
+PinMap<MAX_OUTPUTS, 40> pinMap;
+// Custom output names ("" = default label). /api/name and the WebSocket set them
+// on the async_tcp task while loop() reads them, so every access copies under the lock.
+char outputNames[MAX_OUTPUTS][OUTPUT_NAME_MAX_LEN + 1];
+portMUX_TYPE outputNamesLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Copies a name into out (room for OUTPUT_NAME_MAX_LEN + 1)
+void getOutputName(int index, char* out) {
+    portENTER_CRITICAL(&outputNamesLock);
+    memcpy(out, outputNames[index], OUTPUT_NAME_MAX_LEN + 1);
+    portEXIT_CRITICAL(&outputNamesLock);
+}
+
+// Sets a name, cut to OUTPUT_NAME_MAX_LEN
+void setOutputName(int index, const char* name, size_t length) {
+    if (length > OUTPUT_NAME_MAX_LEN) length = OUTPUT_NAME_MAX_LEN;
+    portENTER_CRITICAL(&outputNamesLock);
+    memcpy(outputNames[index], name, length);
+    outputNames[index][length] = '\0';
+    portEXIT_CRITICAL(&outputNamesLock);
+}
+
+// Output state and blink engine (output_core.h); LEDC channel i drives output i
+struct Esp32Outputs {
+    static void writeOutput(uint16_t index, uint8_t duty) { ledcWrite(index, duty); }
+    static uint32_t stepGroup(uint8_t slot) { return 0; } // No chasing groups on the ESP32
+};
+OutputCore<MAX_OUTPUTS, 0, Esp32Outputs> outputCore;
+
+// Command handed from the web/WebSocket front-ends to the effect task
+enum OutputCommandType : uint8_t {
+    OUTPUT_CMD_SET_STATE,
+    OUTPUT_CMD_SET_INTERVAL,
+    OUTPUT_CMD_SET_OUTPUT,   // State, brightness and interval at once (batch entries)
+    OUTPUT_CMD_RESET_ALL     // Every output off, full brightness, no blink (index unused)
+};
+
+struct OutputCommand {
+    OutputCommandType type;
+    uint8_t index;           // Output index (not GPIO)
+    bool active;
+    uint8_t brightness;      // 0-255 PWM duty
+    uint32_t interval;       // Blink interval in ms (OUTPUT_CMD_SET_INTERVAL, OUTPUT_CMD_SET_OUTPUT)
+    int64_t queuedAtUs;      // esp_timer_get_time() at enqueue, for command-to-GPIO latency
+    uint32_t traceId;        // Request trace id, 0 = untraced
+};
+
+// Effect task: fixed-rate loop pinned to EFFECT_TASK_CORE. After setup() it is
+// the only writer of output state, the scheduler and the LEDC channels; every
+// other task hands it commands through the lock-free queue.
+TaskHandle_t effectTaskHandle = nullptr;
+CommandQueue<OutputCommand, COMMAND_QUEUE_SIZE> commandQueue;
+TickJitter effectJitter(EFFECT_TICK_MS * 1000UL);
+
+// Work the effect task leaves for loop(): each set bit is an output to save to NVS and send as a delta
+std::atomic<uint32_t> pendingSaveMask(0);
+static_assert(MAX_OUTPUTS <= 32, "pendingSaveMask holds one bit per output");
+
+// All output state lives in one versioned record, written A/B to the NVS
+// blobs "outputs_a"/"outputs_b" with a generation counter and CRC32
+// (ConfigSlots), so a power cut mid-save always leaves the previous record
+// intact. Names are packed NUL-terminated into a pool and addressed by
+// offset. Devices still on the single "outputs" blob or the legacy
+// out_<i>_<s|b|i|n> keys are migrated on first boot.
+#define OUTPUT_BLOB_KEY "outputs"
+#define OUTPUT_BLOB_VERSION 1
+#define OUTPUT_NAME_NONE 0xFFFF
+#define OUTPUT_NAME_POOL_SIZE (MAX_OUTPUTS * (OUTPUT_NAME_MAX_LEN + 1))
+
+struct OutputStateBlob {
+    uint16_t version;                        // OUTPUT_BLOB_VERSION
+    uint16_t outputCount;                    // MAX_OUTPUTS of the firmware that wrote it
+    uint32_t stateBits;                      // Bit i set = output i on
+    uint8_t brightness[MAX_OUTPUTS];         // 0-255 PWM duty
+    uint32_t intervals[MAX_OUTPUTS];         // Blink interval in ms (0 = solid)
+    uint16_t nameOffsets[MAX_OUTPUTS];       // Offset into names, OUTPUT_NAME_NONE if unnamed
+    char names[OUTPUT_NAME_POOL_SIZE];       // Packed NUL-terminated names
+};
+
+// NVS blob per slot; each write is a single nvs_set_blob + nvs_commit
+class NvsSlotStore {
+public:
+    bool read(uint8_t slot, void* data, size_t length) {
+        nvs_handle_t handle;
+        if (nvs_open("railhub32", NVS_READONLY, &handle) != ESP_OK) return false;
+        size_t stored = length;
+        esp_err_t err = nvs_get_blob(handle, slotKey(slot), data, &stored);
+        nvs_close(handle);
+        return err == ESP_OK && stored == length;
+    }
+    
+    bool write(uint8_t slot, const void* data, size_t length) {
+        nvs_handle_t handle;
+        if (nvs_open("railhub32", NVS_READWRITE, &handle) != ESP_OK) return false;
+        esp_err_t err = nvs_set_blob(handle, slotKey(slot), data, length);
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+        if (err != ESP_OK) {
+            Serial.println("[ERROR] NVS slot write failed: " + String(esp_err_to_name(err)));
+        }
+        return err == ESP_OK;
+    }
+    
+private:
+    static const char* slotKey(uint8_t slot) {
+        return slot == 0 ? "outputs_a" : "outputs_b";
+    }
+};
+
+NvsSlotStore nvsSlotStore;
+ConfigSlots<NvsSlotStore, OutputStateBlob> outputSlots(nvsSlotStore);
+
+// Write-behind persistence: applied commands only mark outputs dirty; loop()
+// writes the blob once changes have been quiet for NVS_FLUSH_QUIET_MS (or
+// NVS_FLUSH_MAX_DELAY_MS during a long drag), and before every restart.
+// persistedBlob mirrors what NVS holds so an unchanged blob is never rewritten.
+WriteBehind nvsWriteBehind(NVS_FLUSH_QUIET_MS, NVS_FLUSH_MAX_DELAY_MS);
+OutputStateBlob persistedBlob;
+bool persistedBlobValid = false;
+uint32_t nvsFlushes = 0;
+uint32_t nvsWrites = 0;
+
+// Command-to-GPIO latency: written by the effect task, read elsewhere as a snapshot under the lock
+struct CommandLatency {
+    uint32_t applied;
+    uint32_t maxUs;
+    uint64_t totalUs;
+};
+CommandLatency commandLatency = {0, 0, 0};
+portMUX_TYPE commandLatencyLock = portMUX_INITIALIZER_UNLOCKED;
+
+CommandLatency commandLatencySnapshot() {
+    portENTER_CRITICAL(&commandLatencyLock);
+    CommandLatency snapshot = commandLatency;
+    portEXIT_CRITICAL(&commandLatencyLock);
+    return snapshot;
+}
+
+// Request tracing (request_trace.h): per-stage spans of every API and
+// WebSocket command, read back through GET /api/debug/trace
+TraceRing<TRACE_RING_SIZE> requestTrace;
+#define TRACE_JSON_BASE_SIZE 768               // /api/debug/trace statistics, sent before the spans
+#define LOOP_PROFILE_JSON_SIZE 1024            // /api/debug/loop
+
+uint32_t traceNowUs() {
+    return (uint32_t)esp_timer_get_time();
+}
+
+// Span of one stage from startUs until now; returns now, where the next stage starts
+uint32_t traceSpan(uint32_t id, TraceStage stage, uint32_t startUs) {
+    uint32_t now = traceNowUs();
+    requestTrace.record(id, stage, startUs, now);
+    return now;
+}
+
+// Sends the JSON in statusApiBuffer straight from the buffer, piece by piece
+void sendStatusApiBuffer(AsyncWebServerRequest* request, size_t length) {
+    request->send(request->beginChunkedResponse("application/json", [length](uint8_t *out, size_t maxLen, size_t index) -> size_t {
+        size_t n = min(maxLen, length - index);
+        memcpy(out, statusApiBuffer + index, n);
+        return n;
+    }));
+}
+
+// One /api/debug/trace response: the statistics are written up front, then
+// the spans of the snapshot one at a time as the TCP stack asks for more, so
+// the whole document is never held in memory
+struct TraceResponse {
+    TraceSpan* spans = nullptr;
+    uint16_t count = 0;
+    uint16_t nextSpan = 0;
+    bool withSpans = true;
+    bool closed = false;
+    char piece[TRACE_JSON_BASE_SIZE];
+    size_t pieceLength = 0;
+    size_t pieceSent = 0;
+    
+    ~TraceResponse() { free(spans); }
+    
+    // Next span, or the closing brackets, into piece; false once everything is out
+    bool nextPiece() {
+        if (withSpans && nextSpan < count) {
+            const TraceSpan& span = spans[nextSpan];
+            size_t comma = nextSpan > 0 ? 1 : 0;
+            piece[0] = ',';
+            JsonWriter json(piece + comma, sizeof(piece) - comma);
+            json.beginArray();
+            json.add(nullptr, (unsigned long)span.id);
+            json.add(nullptr, traceStageName(span.stage));
+            json.add(nullptr, (unsigned long)span.startUs);
+            json.add(nullptr, (unsigned long)span.durationUs);
+            json.endArray();
+            pieceLength = comma + json.length();
+            nextSpan++;
+        } else if (!closed) {
+            strcpy(piece, withSpans ? "]}" : "}");
+            pieceLength = strlen(piece);
+            closed = true;
+        } else {
+            return false;
+        }
+        pieceSent = 0;
+        return true;
+    }
+    
+    // Chunked response filler
+    size_t fill(uint8_t* out, size_t maxLen) {
+        size_t written = 0;
+        while (written < maxLen) {
+            if (pieceSent == pieceLength && !nextPiece()) break;
+            size_t n = min(pieceLength - pieceSent, maxLen - written);
+            memcpy(out + written, piece + pieceSent, n);
+            pieceSent += n;
+            written += n;
+        }
+        return written;
+    }
+};
+
+// Set by POST /api/pins: restart at this millis() value (0 = none pending)
+unsigned long pinMapRestartAt = 0;
+
+// Set by POST /api/reset on the async_tcp task; loop(), which owns NVS and the
+// dirty state, carries it out
+std::atomic<bool> resetRequested(false);
+
+// loop() profiler (loop_profiler.h): a cycle counter reading after every
+// subsystem call; GET /api/debug/loop and the telemetry message report it
+enum LoopSection : uint8_t {
+    LOOP_WIFI_MANAGER,
+    LOOP_CHANGES,           // persistAndBroadcastChanges()
+    LOOP_WS_CLIENTS,        // serviceWebSocketClients()
+    LOOP_TELEMETRY,
+    LOOP_CPU_LOAD,
+    LOOP_PORTAL,            // checkConfigPortalTrigger()
+    LOOP_OTHER,             // Pin map restart check and yield()
+    LOOP_SECTIONS
+};
+const char* const LOOP_SECTION_NAMES[LOOP_SECTIONS] = {
+    "wifiManager", "changes", "wsClients", "telemetry", "cpuLoad", "portal", "other"
+};
+LoopProfiler<LOOP_SECTIONS> loopProfiler(F_CPU / 1000000);
+
+// Charges the cycles since lapStart to a loop() section; returns the start of the next one
+uint32_t loopLap(LoopSection section, uint32_t lapStart) {
+    return loopProfiler.lap(section, lapStart, ESP.getCycleCount());
+}
+
+// CPU load: idle time per core from idle hooks, CPU share per task from FreeRTOS run-time
+// stats or, when the framework is built without them, from timing our own tasks
+CoreLoad<portNUM_PROCESSORS> coreLoad;
+TaskLoad<CPU_LOAD_MAX_TASKS> taskLoad;
+bool idleHooksRegistered = false;
+std::atomic<uint32_t> effectBusyCycles(0);
 unsigned long lastCpuCheck = 0;
+uint32_t lastCpuSampleCycles = 0;
+int64_t lastCpuSampleUs = 0;
 float cpuLoad0 = 0.0;
 float cpuLoad1 = 0.0;
 
+// Idle hook: waits for the next interrupt itself, as the idle task would, and counts the wait as idle
+template <uint8_t Core>
+bool idleHook() {
+    uint32_t start = ESP.getCycleCount();
+    cpu_hal_waiti();
+    coreLoad.addIdle(Core, ESP.getCycleCount() - start);
+    return false;
+}
+
+void startCpuLoad() {
+    idleHooksRegistered = esp_register_freertos_idle_hook_for_cpu(idleHook<0>, 0) == ESP_OK &&
+                          esp_register_freertos_idle_hook_for_cpu(idleHook<1>, 1) == ESP_OK;
+    lastCpuSampleCycles = ESP.getCycleCount();
+    lastCpuSampleUs = esp_timer_get_time();
+    if (!idleHooksRegistered) {
+        Serial.println("[CPU] Idle hooks unavailable - per-core load not measured");
+    }
+}
+
+// Once per second from loop()
+void sampleCpuLoad() {
+    uint32_t nowCycles = ESP.getCycleCount();
+    int64_t nowUs = esp_timer_get_time();
+    uint32_t elapsedCycles = nowCycles - lastCpuSampleCycles;
+    uint32_t elapsedUs = (uint32_t)(nowUs - lastCpuSampleUs);
+    lastCpuSampleCycles = nowCycles;
+    lastCpuSampleUs = nowUs;
+    
+    if (idleHooksRegistered) {
+        coreLoad.sample(elapsedCycles);
+        cpuLoad0 = coreLoad.load(0);
+        cpuLoad1 = coreLoad.load(1);
+    }
+    
+#if configGENERATE_RUN_TIME_STATS
+    // Run time counters are in esp_timer microseconds
+    static TaskStatus_t statuses[CPU_LOAD_MAX_TASKS];
+    static TaskRunTime tasks[CPU_LOAD_MAX_TASKS];
+    uint32_t totalRunTime;
+    UBaseType_t count = uxTaskGetSystemState(statuses, CPU_LOAD_MAX_TASKS, &totalRunTime);
+    for (UBaseType_t i = 0; i < count; i++) {
+        tasks[i].id = statuses[i].xTaskNumber;
+        tasks[i].name = statuses[i].pcTaskName;
+#if configTASKLIST_INCLUDE_COREID
+        tasks[i].core = statuses[i].xCoreID < portNUM_PROCESSORS ? statuses[i].xCoreID : -1;
+#else
+        tasks[i].core = -1;
+#endif
+        tasks[i].runTime = statuses[i].ulRunTimeCounter;
+    }
+    if (count > 0) taskLoad.sample(tasks, count, elapsedUs);
+#else
+    // async_tcp, wifi and the other system tasks need run-time stats; ours are timed in cycles
+    (void)elapsedUs;
+    TaskRunTime tasks[] = {
+        {1, "loopTask", (int8_t)xPortGetCoreID(), loopProfiler.busyCycles()},
+        {2, "effects", EFFECT_TASK_CORE, effectBusyCycles.load(std::memory_order_relaxed)},
+    };
+    taskLoad.sample(tasks, sizeof(tasks) / sizeof(tasks[0]), elapsedCycles);
+#endif
+}
+
 // Timing variables
 
 void setup() {
@@ -86,6 +464,10 @@ void setup() {
     Serial.println("[INIT] Configuring portal trigger pin (GPIO " + String(PORTAL_TRIGGER_PIN) + ")");
     pinMode(PORTAL_TRIGGER_PIN, INPUT_PULLUP);
     
+    // Output-to-GPIO map from NVRAM (or LED_PINS), needed before the pins are set up
+    Serial.println("[INIT] Loading pin map...");
+    loadPinMap();
+    
     // Initialize output pins
     Serial.println("[INIT] Initializing " + String(MAX_OUTPUTS) + " output pins...");
     initializeOutputs();
@@ -98,6 +480,13 @@ void setup() {
     Serial.println("[INIT] Loading saved output states...");
     loadOutputStates();
     
+    // Start stepping effects before WiFi so blinking runs during connect/portal
+    Serial.println("[INIT] Starting effect task (" + String(EFFECT_TICK_MS) + "ms tick, core " + String(EFFECT_TASK_CORE) + ")...");
+    startEffectTask();
+    
+    // Idle hooks count idle time per core from here on
+    startCpuLoad();
+    
     // Initialize WiFi with WiFiManager
     Serial.println("[INIT] Initializing WiFi Manager...");
     initializeWiFiManager();
@@ -106,14 +495,15 @@ void setup() {
     if (wifiConnected) {
         Serial.println("[INIT] Starting web server on port 80...");
         server = new AsyncWebServer(80);
+        
+        // Real-time traffic shares the web server's port and TCP task
+        ws = new AsyncWebSocket("/ws");
+        ws->onEvent(onWebSocketEvent);
+        server->addHandler(ws);
+        
         initializeWebServer();
         Serial.println("[WEB] Web server initialized successfully");
-        
-        Serial.println("[INIT] Starting WebSocket server on port 81...");
-        ws = new WebSocketsServer(81);
-        ws->onEvent(webSocketEvent);
-        ws->begin();
-        Serial.println("[WS] WebSocket server started on port 81");
+        Serial.println("[WS] WebSocket endpoint /ws on port 80");
     } else {
         Serial.println("[WARN] WiFi not connected - web server not started");
     }
@@ -127,41 +517,54 @@ void setup() {
 }
 
 void loop() {
+    uint32_t lapStart = loopProfiler.beginIteration(ESP.getCycleCount());
+    
     // Process WiFiManager tasks (required for async operation)
     wifiManager.loop();
+    lapStart = loopLap(LOOP_WIFI_MANAGER, lapStart);
     
-    // Handle WebSocket events
-    if (ws) {
-        ws->loop();
+    // Save and publish whatever the effect task applied since the last pass
+    if (resetRequested.exchange(false)) {
+        resetSavedStates();
     }
+    persistAndBroadcastChanges();
+    lapStart = loopLap(LOOP_CHANGES, lapStart);
+    
+    // Hello/snapshot for new, resyncing and recovered slow clients
+    serviceWebSocketClients();
+    lapStart = loopLap(LOOP_WS_CLIENTS, lapStart);
     
-    // Broadcast status updates via WebSocket
+    // Heartbeat with telemetry; output changes go out as deltas
     unsigned long currentMillis = millis();
     if (ws && currentMillis - lastBroadcast >= BROADCAST_INTERVAL) {
         lastBroadcast = currentMillis;
-        broadcastStatus();
+        broadcastTelemetry();
+        ws->cleanupClients(WS_MAX_CLIENTS);
+        lapStart = loopLap(LOOP_TELEMETRY, lapStart);
     }
     
     // Update CPU load every second
     if (currentMillis - lastCpuCheck >= 1000) {
         lastCpuCheck = currentMillis;
-        // Estimate CPU load based on idle task execution
-        // Core 0 typically runs user tasks, Core 1 runs WiFi/system tasks
-        cpuLoad0 = 100.0 - (float)(uxTaskGetStackHighWaterMark(NULL)) / 100.0;
-        cpuLoad0 = constrain(cpuLoad0, 0.0, 100.0);
-        // Simple estimation for core 1 based on WiFi activity and heap fragmentation
-        cpuLoad1 = map(ESP.getFreeHeap(), 100000, 320000, 80, 10);
-        cpuLoad1 = constrain(cpuLoad1, 0.0, 100.0);
+        sampleCpuLoad();
+        lapStart = loopLap(LOOP_CPU_LOAD, lapStart);
     }
     
-    // Update blinking outputs
-    updateBlinkingOutputs();
-    
     // Check for config portal trigger button
     checkConfigPortalTrigger();
+    lapStart = loopLap(LOOP_PORTAL, lapStart);
+    
+    // A new pin map takes effect on restart, once its response has gone out
+    if (pinMapRestartAt != 0 && (long)(currentMillis - pinMapRestartAt) >= 0) {
+        flushOutputStates();
+        Serial.println("[PINS] Restarting ESP32 to apply the new pin map...");
+        Serial.flush();
+        ESP.restart();
+    }
     
     // Handle any other tasks
     yield();
+    loopProfiler.endIteration(loopLap(LOOP_OTHER, lapStart));
 }
 
 // Periodic status logging (called every 60 seconds via timer)
@@ -183,7 +586,7 @@ void logSystemStatus() {
         // Count active outputs
         int activeCount = 0;
         for (int i = 0; i < MAX_OUTPUTS; i++) {
-            if (outputStates[i]) activeCount++;
+            if (outputCore.state[i]) activeCount++;
         }
         Serial.println("[STATUS] Active Outputs: " + String(activeCount) + "/" + String(MAX_OUTPUTS));
         Serial.println("[STATUS] ========================\n");
@@ -194,13 +597,13 @@ void initializeOutputs() {
     Serial.println("[OUTPUT] Initializing outputs...");
     
     for (int i = 0; i < MAX_OUTPUTS; i++) {
-        Serial.print("[OUTPUT] Configuring Output " + String(i) + " on GPIO " + String(outputPins[i]));
-        pinMode(outputPins[i], OUTPUT);
-        digitalWrite(outputPins[i], LOW);
+        Serial.print("[OUTPUT] Configuring Output " + String(i) + " on GPIO " + String(pinMap.pin(i)));
+        pinMode(pinMap.pin(i), OUTPUT);
+        digitalWrite(pinMap.pin(i), LOW);
         
         // Configure PWM channel for brightness control
         ledcSetup(i, 5000, 8); // 5kHz frequency, 8-bit resolution
-        ledcAttachPin(outputPins[i], i);
+        ledcAttachPin(pinMap.pin(i), i);
         ledcWrite(i, 0);
         Serial.println(" - OK (PWM Ch" + String(i) + ", 5kHz, 8-bit)");
     }
@@ -444,6 +847,7 @@ document.addEventListener('DOMContentLoaded', function() {
         Serial.println(customDeviceName);
         Serial.println("[WIFI] WiFi credentials will be used on next boot");
         Serial.println("[WIFI] Restarting ESP32 to apply new configuration...");
+        flushOutputStates();
         delay(2000);
         ESP.restart();
     });
@@ -588,6 +992,7 @@ void checkConfigPortalTrigger() {
                 delay(1000);
                 
                 // Restart to trigger portal
+                flushOutputStates();
                 Serial.println("[PORTAL] Restarting ESP32 in 1s...");
                 Serial.flush();
                 delay(1000);
@@ -660,21 +1065,64 @@ void loadCustomParameters() {
     }
 }
 
-void executeOutputCommand(int pin, bool active, int brightnessPercent) {
-    unsigned long startTime = millis();
+// Pin maps other than LED_PINS are checked against the chip: strapping pins
+// only where the stock wiring already uses them, never the config button
+PinCheck checkPinMap(const int* pins, uint8_t& badIndex) {
+    PinRules rules = ESP32_PIN_RULES;
+    rules.reserved |= PIN_BIT(PORTAL_TRIGGER_PIN);
+    return pinMap.check(rules, pinMap.mask(DEFAULT_OUTPUT_PINS, MAX_OUTPUTS), pins, badIndex);
+}
+
+// Saved map if there is a valid one, LED_PINS otherwise
+void loadPinMap() {
+    pinMap.set(DEFAULT_OUTPUT_PINS);
     
-    // Find the output index for the given pin
-    int outputIndex = -1;
-    for (int i = 0; i < MAX_OUTPUTS; i++) {
-        if (outputPins[i] == pin) {
-            outputIndex = i;
-            break;
-        }
+    uint8_t saved[MAX_OUTPUTS];
+    if (!preferences.begin("railhub32", true)) {
+        Serial.println("[ERROR] Failed to open preferences for loading the pin map");
+        return;
+    }
+    size_t length = preferences.getBytes("pinMap", saved, sizeof(saved));
+    preferences.end();
+    if (length != sizeof(saved)) {
+        Serial.println("[NVRAM] No saved pin map, using LED_PINS");
+        return;
     }
     
+    int pins[MAX_OUTPUTS];
+    for (int i = 0; i < MAX_OUTPUTS; i++) {
+        pins[i] = saved[i];
+    }
+    uint8_t badIndex = 0;
+    PinCheck result = checkPinMap(pins, badIndex);
+    if (result != PIN_OK) {
+        Serial.println("[ERROR] Saved pin map rejected (output " + String(badIndex) + ": " + pinCheckText(result) + ") - using LED_PINS");
+        return;
+    }
+    pinMap.set(pins);
+    Serial.println("[NVRAM] Loaded saved pin map");
+}
+
+bool savePinMap(const int* pins) {
+    uint8_t saved[MAX_OUTPUTS];
+    for (int i = 0; i < MAX_OUTPUTS; i++) {
+        saved[i] = pins[i];
+    }
+    if (!preferences.begin("railhub32", false)) {
+        Serial.println("[ERROR] Failed to open preferences for saving the pin map");
+        return false;
+    }
+    bool ok = preferences.putBytes("pinMap", saved, sizeof(saved)) == sizeof(saved);
+    preferences.end();
+    return ok;
+}
+
+// Queue an output command for the effect task; returns false only if the queue is full
+bool executeOutputCommand(int pin, bool active, int brightnessPercent, uint32_t traceId) {
+    int outputIndex = pinMap.indexOf(pin);
     if (outputIndex == -1) {
         Serial.println("[ERROR] Invalid GPIO pin: " + String(pin));
-        return;
+        return true;
     }
     
     // Validate brightness range
@@ -683,1466 +1131,997 @@ void executeOutputCommand(int pin, bool active, int brightnessPercent) {
         brightnessPercent = constrain(brightnessPercent, 0, 100);
     }
     
-    // Update state
-    outputStates[outputIndex] = active;
-    outputBrightness[outputIndex] = map(brightnessPercent, 0, 100, 0, 255);
+    OutputCommand cmd = {};
+    cmd.type = OUTPUT_CMD_SET_STATE;
+    cmd.index = outputIndex;
+    cmd.active = active;
+    cmd.brightness = map(brightnessPercent, 0, 100, 0, 255);
+    cmd.queuedAtUs = esp_timer_get_time();
+    cmd.traceId = traceId;
+    
+    char name[OUTPUT_NAME_MAX_LEN + 1];
+    getOutputName(outputIndex, name);
+    String nameStr = name[0] != '\0' ? " [" + String(name) + "]" : "";
+    if (!commandQueue.push(cmd)) {
+        Serial.println("[ERROR] Command queue full, dropped Output " + String(outputIndex) + " (GPIO " + String(pin) + ")" + nameStr);
+        return false;
+    }
+    
+    Serial.println("[CMD] Output " + String(outputIndex) + " (GPIO " + String(pin) + ")" + nameStr + ": " + 
+                   (active ? "ON" : "OFF") + " @ " + String(brightnessPercent) + "% (queued)");
+    return true;
+}
+
+// Fields of any command body, filled without a document tree (see command_parser.h)
+typedef CommandFields<MAX_OUTPUTS> CommandRequest;
+
+// Largest command document for the ArduinoJson fallback: a batch with an entry per output
+const size_t COMMAND_JSON_CAPACITY = JSON_OBJECT_SIZE(6) + JSON_ARRAY_SIZE(MAX_OUTPUTS) + MAX_OUTPUTS * JSON_OBJECT_SIZE(4) + 128;
+
+// Command body into req: the schema parser, or ArduinoJson for shapes it leaves alone
+DeserializationError parseCommandRequest(const char* text, size_t length, CommandRequest& req) {
+    if (parseCommand(text, length, req)) {
+        return DeserializationError::Ok;
+    }
+    DynamicJsonDocument doc(COMMAND_JSON_CAPACITY);
+    DeserializationError error = deserializeJson(doc, text, length);
+    if (!error) {
+        commandFromJson(doc.as<JsonObjectConst>(), req);
+    }
+    return error;
+}
+
+// Batch entry for one output; fields the request leaves out keep the output's current value
+OutputCommand makeBatchCommand(int index, const CommandEntry& fields) {
+    OutputCommand cmd = {};
+    cmd.type = OUTPUT_CMD_SET_OUTPUT;
+    cmd.index = index;
+    outputCore.resolve(index, fields, cmd.active, cmd.brightness, cmd.interval);
+    return cmd;
+}
+
+// Queue a batch as one unit: the effect task applies it in a single tick, or nothing is queued
+bool executeOutputBatch(OutputCommand* cmds, uint8_t count, uint32_t traceId) {
+    int64_t now = esp_timer_get_time();
+    for (uint8_t i = 0; i < count; i++) {
+        cmds[i].queuedAtUs = now;
+        cmds[i].traceId = traceId;
+    }
     
-    // Apply the command
-    if (active) {
-        ledcWrite(outputIndex, outputBrightness[outputIndex]);
-    } else {
-        ledcWrite(outputIndex, 0);
+    if (!commandQueue.pushBatch(cmds, count)) {
+        Serial.println("[ERROR] Command queue full, dropped batch of " + String(count) + " outputs");
+        return false;
     }
     
-    // Save the state to persistent storage
-    saveOutputState(outputIndex);
+    Serial.println("[CMD] Batch of " + String(count) + " outputs (queued)");
+    return true;
+}
+
+// Snapshot every output into a blob (zero-filled so equal states compare equal)
+void packOutputBlob(OutputStateBlob& blob) {
+    memset(&blob, 0, sizeof(blob));
+    blob.version = OUTPUT_BLOB_VERSION;
+    blob.outputCount = MAX_OUTPUTS;
     
-    unsigned long duration = millis() - startTime;
-    String nameStr = outputNames[outputIndex].length() > 0 ? " [" + outputNames[outputIndex] + "]" : "";
-    Serial.println("[CMD] Output " + String(outputIndex) + " (GPIO " + String(pin) + ")" + nameStr + ": " + 
-                   (active ? "ON" : "OFF") + " @ " + String(brightnessPercent) + "% (" + String(duration) + "ms)");
+    uint16_t poolUsed = 0;
+    for (int i = 0; i < MAX_OUTPUTS; i++) {
+        if (outputCore.state[i]) {
+            blob.stateBits |= 1UL << i;
+        }
+        blob.brightness[i] = outputCore.duty[i];
+        blob.intervals[i] = outputCore.interval[i];
+        
+        // Names are capped at OUTPUT_NAME_MAX_LEN, so the pool cannot overflow
+        char name[OUTPUT_NAME_MAX_LEN + 1];
+        getOutputName(i, name);
+        size_t nameLength = strlen(name);
+        if (nameLength == 0) {
+            blob.nameOffsets[i] = OUTPUT_NAME_NONE;
+            continue;
+        }
+        blob.nameOffsets[i] = poolUsed;
+        memcpy(blob.names + poolUsed, name, nameLength);
+        poolUsed += nameLength + 1;
+    }
 }
 
-void saveOutputState(int index) {
-    if (index < 0 || index >= MAX_OUTPUTS) {
-        Serial.print("[ERROR] Invalid output index for state save: ");
-        Serial.println(index);
-        return;
+// Copy a CRC-checked record into the output arrays
+bool unpackOutputBlob(const OutputStateBlob& blob) {
+    if (blob.version != OUTPUT_BLOB_VERSION || blob.outputCount != MAX_OUTPUTS) {
+        Serial.println("[NVRAM] Output blob has unsupported layout (version " + String(blob.version) + ")");
+        return false;
     }
     
-    if (!preferences.begin("railhub32", false)) {
-        Serial.print("[ERROR] Failed to open preferences for saving Output ");
-        Serial.println(index);
-        return;
+    for (int i = 0; i < MAX_OUTPUTS; i++) {
+        outputCore.state[i] = (blob.stateBits >> i) & 1;
+        outputCore.duty[i] = blob.brightness[i];
+        outputCore.interval[i] = blob.intervals[i];
+        
+        uint16_t offset = blob.nameOffsets[i];
+        if (offset < OUTPUT_NAME_POOL_SIZE && memchr(blob.names + offset, '\0', OUTPUT_NAME_POOL_SIZE - offset)) {
+            setOutputName(i, blob.names + offset, strlen(blob.names + offset));
+        } else {
+            setOutputName(i, "", 0);
+        }
     }
+    return true;
+}
+
+// Write all outputs as one blob if anything changed since the last write
+void flushOutputStates() {
+    unsigned long startTime = millis();
+    nvsWriteBehind.mark(pendingSaveMask.exchange(0), startTime);
+    if (nvsWriteBehind.dirty() == 0) return;
     
-    // Create keys for state and brightness
-    String stateKey = "out_" + String(index) + "_s";
-    String brightKey = "out_" + String(index) + "_b";
-    String intervalKey = "out_" + String(index) + "_i";
+    uint32_t traceStartUs = traceNowUs();
+    int flushedCount = __builtin_popcount(nvsWriteBehind.dirty());
     
-    size_t stateWritten = preferences.putBool(stateKey.c_str(), outputStates[index]);
-    size_t brightWritten = preferences.putUChar(brightKey.c_str(), outputBrightness[index]);
-    size_t intervalWritten = preferences.putUInt(intervalKey.c_str(), outputIntervals[index]);
+    // Snapshot; the effect task may keep changing outputs meanwhile
+    static OutputStateBlob blob;
+    packOutputBlob(blob);
     
-    preferences.end();
+    if (persistedBlobValid && memcmp(&blob, &persistedBlob, sizeof(blob)) == 0) {
+        nvsWriteBehind.clear();
+        Serial.println("[NVRAM] " + String(flushedCount) + " dirty outputs back at their saved values, nothing written");
+        return;
+    }
     
-    if (stateWritten > 0 && brightWritten > 0 && intervalWritten > 0) {
-        Serial.print("[NVRAM] Saved state for Output ");
-        Serial.print(index);
-        Serial.print(" (GPIO ");
-        Serial.print(outputPins[index]);
-        Serial.print("): ");
-        Serial.print(outputStates[index] ? "ON" : "OFF");
-        Serial.print(" @ ");
-        Serial.print(outputBrightness[index]);
-        Serial.println(" PWM");
-    } else {
-        Serial.print("[ERROR] Failed to save state for Output ");
-        Serial.println(index);
+    if (!outputSlots.save(blob)) {
+        nvsWriteBehind.failed(startTime); // Retry after another quiet period
+        return;
     }
+    
+    memcpy(&persistedBlob, &blob, sizeof(blob));
+    persistedBlobValid = true;
+    nvsWriteBehind.clear();
+    nvsWrites++;
+    nvsFlushes++;
+    traceSpan(0, TRACE_PERSIST, traceStartUs);
+    
+    unsigned long duration = millis() - startTime;
+    Serial.println("[NVRAM] Flushed " + String(flushedCount) + " dirty outputs to slot " + String(outputSlots.activeSlot() ? "B" : "A") + 
+                   " (generation " + String(outputSlots.generation()) + ", " + String(duration) + "ms)");
+}
+
+// Entries a save-per-command scheme would have written, minus what was actually written
+uint32_t nvsWritesAvoided() {
+    uint32_t requested = commandLatencySnapshot().applied * 3;
+    return requested > nvsWrites ? requested - nvsWrites : 0;
 }
 
+// Update an output name; it is persisted with the next blob flush
 void saveOutputName(int index, String name) {
     if (index < 0 || index >= MAX_OUTPUTS) {
         Serial.println("[ERROR] Invalid output index for name save: " + String(index));
         return;
     }
     
-    if (!preferences.begin("railhub32", false)) {
-        Serial.println("[ERROR] Failed to open preferences for name save");
-        return;
+    // Empty or whitespace-only names revert to the default label
+    name.trim(); // Trim modifies in place
+    if (name.length() > OUTPUT_NAME_MAX_LEN) {
+        name = name.substring(0, OUTPUT_NAME_MAX_LEN);
     }
+    setOutputName(index, name.c_str(), name.length());
+    pendingSaveMask.fetch_or(1UL << index);
     
-    String nameKey = "out_" + String(index) + "_n";
-    
-    // If name is empty or whitespace-only, remove the preference key
-    name.trim(); // Trim modifies in place
     if (name.length() == 0) {
-        bool removed = preferences.remove(nameKey.c_str());
-        preferences.end();
-        outputNames[index] = "";
-        if (removed) {
-            Serial.println("[NVRAM] Removed custom name for Output " + String(index) + " (GPIO " + String(outputPins[index]) + ") - using default");
-        } else {
-            Serial.println("[NVRAM] No custom name to remove for Output " + String(index));
-        }
-        return;
+        Serial.println("[NVRAM] Removed custom name for Output " + String(index) + " (GPIO " + String(pinMap.pin(index)) + ") - using default");
+    } else {
+        Serial.println("[NVRAM] Name for Output " + String(index) + " (GPIO " + String(pinMap.pin(index)) + "): '" + name + "' (saved with next flush)");
+    }
+}
+
+// Pre-blob layout: four keys per output. Returns false if the namespace could not be opened.
+bool loadLegacyOutputStates() {
+    if (!preferences.begin("railhub32", true)) {
+        return false;
+    }
+    
+    for (int i = 0; i < MAX_OUTPUTS; i++) {
+        String stateKey = "out_" + String(i) + "_s";
+        String brightKey = "out_" + String(i) + "_b";
+        String nameKey = "out_" + String(i) + "_n";
+        String intervalKey = "out_" + String(i) + "_i";
+        
+        outputCore.state[i] = preferences.getBool(stateKey.c_str(), false);
+        outputCore.duty[i] = preferences.getUChar(brightKey.c_str(), 255);
+        outputCore.interval[i] = preferences.getUInt(intervalKey.c_str(), 0);
+        String name = preferences.getString(nameKey.c_str(), "");
+        setOutputName(i, name.c_str(), name.length());
     }
     
-    size_t written = preferences.putString(nameKey.c_str(), name);
     preferences.end();
+    return true;
+}
+
+// Single "outputs" blob written before the A/B slots: the record followed by its CRC32
+struct SingleOutputBlob {
+    OutputStateBlob state;
+    uint32_t crc;
+};
+
+bool loadSingleOutputBlob() {
+    nvs_handle_t handle;
+    if (nvs_open("railhub32", NVS_READONLY, &handle) != ESP_OK) return false;
+    
+    static SingleOutputBlob single;
+    size_t length = sizeof(single);
+    esp_err_t err = nvs_get_blob(handle, OUTPUT_BLOB_KEY, &single, &length);
+    nvs_close(handle);
+    
+    if (err != ESP_OK || length != sizeof(single)) return false;
+    if (single.crc != crc32(&single.state, sizeof(single.state))) {
+        Serial.println("[ERROR] Single output blob CRC mismatch");
+        return false;
+    }
+    return unpackOutputBlob(single.state);
+}
+
+// One-time migration: write slot A, then drop the old keys in one commit
+void migrateOutputStates() {
+    packOutputBlob(persistedBlob);
+    if (!outputSlots.save(persistedBlob)) {
+        Serial.println("[ERROR] Failed to write output slot during migration");
+        return;
+    }
+    persistedBlobValid = true;
     
-    if (written > 0) {
-        outputNames[index] = name;
-        Serial.println("[NVRAM] Saved name for Output " + String(index) + " (GPIO " + String(outputPins[index]) + "): '" + name + "' (" + String(written) + " bytes)");
-    } else {
-        Serial.println("[ERROR] Failed to save name for output " + String(index));
+    nvs_handle_t handle;
+    if (nvs_open("railhub32", NVS_READWRITE, &handle) != ESP_OK) return;
+    
+    // ESP_ERR_NVS_NOT_FOUND is expected for keys that were never set
+    nvs_erase_key(handle, OUTPUT_BLOB_KEY);
+    const char suffixes[] = {'s', 'b', 'i', 'n'};
+    char key[12];
+    for (int i = 0; i < MAX_OUTPUTS; i++) {
+        for (size_t s = 0; s < sizeof(suffixes); s++) {
+            snprintf(key, sizeof(key), "out_%d_%c", i, suffixes[s]);
+            nvs_erase_key(handle, key);
+        }
     }
+    nvs_commit(handle);
+    nvs_close(handle);
+    Serial.println("[NVRAM] Migrated saved output states to A/B slots");
 }
 
 void loadOutputStates() {
+    unsigned long startTime = millis();
     Serial.println("[NVRAM] Loading saved output states...");
     
-    if (!preferences.begin("railhub32", true)) {
-        Serial.println("[ERROR] Failed to open preferences in read-only mode");
-        return;
+    // Defaults for a fresh device
+    outputCore.reset();
+    for (int i = 0; i < MAX_OUTPUTS; i++) {
+        setOutputName(i, "", 0);
+    }
+    
+    // Newest valid slot wins; a torn save simply fails its CRC
+    if (outputSlots.load(persistedBlob) && unpackOutputBlob(persistedBlob)) {
+        persistedBlobValid = true;
+        Serial.println("[NVRAM] Using slot " + String(outputSlots.activeSlot() ? "B" : "A") + " (generation " + String(outputSlots.generation()) + ")");
+    } else if (loadSingleOutputBlob() || loadLegacyOutputStates()) {
+        migrateOutputStates();
+    } else {
+        Serial.println("[NVRAM] No saved output states, using defaults");
     }
     
     int loadedCount = 0;
     int namedCount = 0;
     
     for (int i = 0; i < MAX_OUTPUTS; i++) {
-        String stateKey = "out_" + String(i) + "_s";
-        String brightKey = "out_" + String(i) + "_b";
-        String nameKey = "out_" + String(i) + "_n";
-        String intervalKey = "out_" + String(i) + "_i";
-        
-        // Load state (default to false if not found)
-        outputStates[i] = preferences.getBool(stateKey.c_str(), false);
-        
-        // Load brightness (default to 255 if not found)
-        outputBrightness[i] = preferences.getUChar(brightKey.c_str(), 255);
-        
-        // Load interval (default to 0 if not found)
-        outputIntervals[i] = preferences.getUInt(intervalKey.c_str(), 0);
-        
-        // Load custom name (default to empty string)
-        outputNames[i] = preferences.getString(nameKey.c_str(), "");
-        if (outputNames[i].length() > 0) {
+        if (outputNames[i][0] != '\0') {
             namedCount++;
         }
         
         // Apply the loaded state to the output
-        if (outputStates[i]) {
-            ledcWrite(i, outputBrightness[i]);
-            int brightPercent = map(outputBrightness[i], 0, 255, 0, 100);
-            Serial.print("[NVRAM] Output " + String(i) + " (GPIO " + String(outputPins[i]) + "): ON @ " + String(brightPercent) + "%");
-            if (outputNames[i].length() > 0) {
-                Serial.println(" [Name: " + outputNames[i] + "]");
+        outputCore.set(i, outputCore.state[i], outputCore.duty[i], millis());
+        if (outputCore.state[i]) {
+            int brightPercent = map(outputCore.duty[i], 0, 255, 0, 100);
+            Serial.print("[NVRAM] Output " + String(i) + " (GPIO " + String(pinMap.pin(i)) + "): ON @ " + String(brightPercent) + "%");
+            if (outputNames[i][0] != '\0') {
+                Serial.println(" [Name: " + String(outputNames[i]) + "]");
             } else {
                 Serial.println("");
             }
             loadedCount++;
-        } else {
-            ledcWrite(i, 0);
         }
     }
     
-    preferences.end();
-    Serial.println("[NVRAM] Loaded " + String(loadedCount) + " active outputs, " + String(namedCount) + " custom names");
+    unsigned long duration = millis() - startTime;
+    Serial.println("[NVRAM] Loaded " + String(loadedCount) + " active outputs, " + String(namedCount) + " custom names (" + String(duration) + "ms)");
 }
 
 void saveAllOutputStates() {
-    unsigned long startTime = millis();
     Serial.println("[NVRAM] Saving all output states (batch operation)...");
     
-    if (!preferences.begin("railhub32", false)) {
-        Serial.println("[ERROR] Failed to open preferences for batch save");
-        return;
+    // Everything goes through the write-behind flusher as one transaction
+    nvsWriteBehind.mark(0xFFFFFFFFUL >> (32 - MAX_OUTPUTS), millis());
+    flushOutputStates();
+}
+
+// Apply one queued command to output state and the LEDC channel (effect task only)
+void applyOutputCommand(const OutputCommand& cmd) {
+    int index = cmd.index;
+    uint32_t now = millis();
+    
+    switch (cmd.type) {
+        case OUTPUT_CMD_SET_STATE:
+            outputCore.set(index, cmd.active, cmd.brightness, now);
+            break;
+        case OUTPUT_CMD_SET_INTERVAL:
+            outputCore.setInterval(index, cmd.interval, now);
+            break;
+        case OUTPUT_CMD_SET_OUTPUT:
+            outputCore.apply(index, cmd.active, cmd.brightness, cmd.interval, now);
+            break;
+        case OUTPUT_CMD_RESET_ALL:
+            for (int i = 0; i < MAX_OUTPUTS; i++) {
+                outputCore.apply(i, false, 255, 0, now);
+            }
+            break;
     }
     
-    int savedCount = 0;
-    int failedCount = 0;
+    int64_t appliedAtUs = esp_timer_get_time();
+    uint32_t latencyUs = (uint32_t)(appliedAtUs - cmd.queuedAtUs);
+    portENTER_CRITICAL(&commandLatencyLock);
+    if (latencyUs > commandLatency.maxUs) {
+        commandLatency.maxUs = latencyUs;
+    }
+    commandLatency.totalUs += latencyUs;
+    commandLatency.applied++;
+    portEXIT_CRITICAL(&commandLatencyLock);
+    if (cmd.traceId != 0) {
+        requestTrace.record(cmd.traceId, TRACE_APPLY, (uint32_t)cmd.queuedAtUs, (uint32_t)appliedAtUs);
+    }
     
-    for (int i = 0; i < MAX_OUTPUTS; i++) {
-        String stateKey = "out_" + String(i) + "_s";
-        String brightKey = "out_" + String(i) + "_b";
-        
-        size_t stateWritten = preferences.putBool(stateKey.c_str(), outputStates[i]);
-        size_t brightWritten = preferences.putUChar(brightKey.c_str(), outputBrightness[i]);
+    pendingSaveMask.fetch_or(cmd.type == OUTPUT_CMD_RESET_ALL ? 0xFFFFFFFFUL >> (32 - MAX_OUTPUTS) : 1UL << index);
+}
+
+// Fixed-rate effect loop: drain commands, then step due effects
+void effectTask(void* param) {
+    const TickType_t period = pdMS_TO_TICKS(EFFECT_TICK_MS) > 0 ? pdMS_TO_TICKS(EFFECT_TICK_MS) : 1;
+    TickType_t lastWake = xTaskGetTickCount();
+    
+    for (;;) {
+        vTaskDelayUntil(&lastWake, period);
+        uint32_t busyStart = ESP.getCycleCount();
+        effectJitter.record((uint32_t)esp_timer_get_time());
         
-        if (stateWritten > 0 && brightWritten > 0) {
-            savedCount++;
-        } else {
-            failedCount++;
-            Serial.print("[ERROR] Failed to save Output ");
-            Serial.println(i);
+        OutputCommand cmd;
+        while (commandQueue.pop(cmd)) {
+            applyOutputCommand(cmd);
         }
+        outputCore.step(millis());
+        effectBusyCycles.fetch_add(ESP.getCycleCount() - busyStart, std::memory_order_relaxed);
+    }
+}
+
+void startEffectTask() {
+    BaseType_t created = xTaskCreatePinnedToCore(effectTask, "effects", EFFECT_TASK_STACK, nullptr,
+                                                 EFFECT_TASK_PRIORITY, &effectTaskHandle, EFFECT_TASK_CORE);
+    if (created != pdPASS) {
+        Serial.println("[ERROR] Failed to start effect task");
+        return;
     }
+    Serial.println("[EFFECT] Effect task running every " + String(EFFECT_TICK_MS) + "ms on core " + String(EFFECT_TASK_CORE));
+}
+
+// Runs in loop(): NVS writes and WebSocket sends stay off the effect task
+void persistAndBroadcastChanges() {
+    unsigned long now = millis();
     
-    preferences.end();
+    uint32_t changed = pendingSaveMask.exchange(0);
+    if (changed) {
+        nvsWriteBehind.mark(changed, now);
+        
+        // Clients hear about a change right away; NVS waits for things to settle
+        broadcastDelta(changed);
+    }
     
-    unsigned long duration = millis() - startTime;
-    Serial.print("[NVRAM] Batch save complete: ");
-    Serial.print(savedCount);
-    Serial.print(" outputs saved, ");
-    Serial.print(failedCount);
-    Serial.print(" failed (");
-    Serial.print(duration);
-    Serial.println("ms)");
+    if (nvsWriteBehind.due(now)) {
+        flushOutputStates();
+    }
 }
 
-void updateBlinkingOutputs() {
-    unsigned long currentMillis = millis();
+// POST /api/reset, from loop(): clear NVS, then put every output and name back to
+// its default. Pending writes predate the reset and are dropped; the defaults
+// come back from the effect task as ordinary changes, so clients get a delta.
+void resetSavedStates() {
+    Serial.println("[NVRAM] Resetting all saved states...");
+    if (!preferences.begin("railhub32", false)) {
+        Serial.println("[ERROR] Failed to open preferences for reset");
+        return;
+    }
+    preferences.clear(); // Clear all saved preferences
+    preferences.end();
     
+    pendingSaveMask.store(0);
+    nvsWriteBehind.clear();
+    persistedBlobValid = false;
     for (int i = 0; i < MAX_OUTPUTS; i++) {
-        // Only process if output is active and has a blink interval set
-        if (outputStates[i] && outputIntervals[i] > 0) {
-            // Check if it's time to toggle
-            if (currentMillis - lastBlinkTime[i] >= outputIntervals[i]) {
-                lastBlinkTime[i] = currentMillis;
-                blinkState[i] = !blinkState[i];
-                
-                // Toggle the output
-                if (blinkState[i]) {
-                    ledcWrite(i, outputBrightness[i]);
-                } else {
-                    ledcWrite(i, 0);
-                }
-            }
-        } else if (outputStates[i] && outputIntervals[i] == 0) {
-            // No blinking - ensure output is solid on
-            if (!blinkState[i]) {
-                ledcWrite(i, outputBrightness[i]);
-                blinkState[i] = true;
-            }
-        }
+        setOutputName(i, "", 0);
     }
+    
+    OutputCommand cmd = {};
+    cmd.type = OUTPUT_CMD_RESET_ALL;
+    cmd.queuedAtUs = esp_timer_get_time();
+    while (!commandQueue.push(cmd)) {
+        vTaskDelay(1); // Queue full: the effect task drains it within a tick
+    }
+    Serial.println("[NVRAM] All saved states cleared, outputs back to defaults");
 }
 
-void setOutputInterval(int index, unsigned int intervalMs) {
-    if (index < 0 || index >= MAX_OUTPUTS) return;
-    
-    outputIntervals[index] = intervalMs;
-    
-    // Reset blink state
-    lastBlinkTime[index] = millis();
-    blinkState[index] = false;
+// Queue a blink interval change for the effect task; returns false only if the queue is full
+bool setOutputInterval(int index, unsigned int intervalMs, uint32_t traceId) {
+    if (index < 0 || index >= MAX_OUTPUTS) return true;
+    
+    OutputCommand cmd = {};
+    cmd.type = OUTPUT_CMD_SET_INTERVAL;
+    cmd.index = index;
+    cmd.interval = intervalMs;
+    cmd.queuedAtUs = esp_timer_get_time();
+    cmd.traceId = traceId;
+    
+    if (!commandQueue.push(cmd)) {
+        Serial.println("[ERROR] Command queue full, dropped interval for Output " + String(index));
+        return false;
+    }
     
-    if (outputStates[index]) {
+    if (outputCore.state[index]) {
         if (intervalMs > 0) {
-            Serial.println("[INTERVAL] Output " + String(index) + " (GPIO " + String(outputPins[index]) + ") blinking every " + String(intervalMs) + "ms");
+            Serial.println("[INTERVAL] Output " + String(index) + " (GPIO " + String(pinMap.pin(index)) + ") blinking every " + String(intervalMs) + "ms");
         } else {
-            ledcWrite(index, outputBrightness[index]);
-            Serial.println("[INTERVAL] Output " + String(index) + " (GPIO " + String(outputPins[index]) + ") blinking disabled (solid)");
+            Serial.println("[INTERVAL] Output " + String(index) + " (GPIO " + String(pinMap.pin(index)) + ") blinking disabled (solid)");
         }
     }
-    
-    // Save to preferences
-    saveOutputState(index);
+    return true;
 }
 
-void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length) {
-    switch(type) {
-        case WStype_DISCONNECTED:
-            Serial.printf("[WS] Client #%u disconnected\n", num);
-            break;
-        case WStype_CONNECTED:
-            {
-                IPAddress ip = ws->remoteIP(num);
-                Serial.printf("[WS] Client #%u connected from %d.%d.%d.%d\n", num, ip[0], ip[1], ip[2], ip[3]);
-                // Send initial status to the new client
-                broadcastStatus();
-            }
-            break;
-        case WStype_TEXT:
-            Serial.printf("[WS] Received text from client #%u: %s\n", num, payload);
-            break;
-        default:
-            break;
+// Output command handlers shared by the HTTP endpoints and the WebSocket command channel.
+// Each returns an HTTP status code and, on failure, a short reason in error.
+
+int findOutputIndex(int pin) {
+    return pinMap.indexOf(pin);
+}
+
+String commandErrorJson(const char* error) {
+    return String("{\"error\":\"") + error + "\"}";
+}
+
+// {"pin":..,"active":..,"brightness":0-100}
+int controlCommand(const CommandRequest& req, const char*& error, uint32_t traceId) {
+    int pin = req.has(FIELD_PIN) ? req.pin : -1;
+    bool active = req.active;
+    int brightness = req.has(FIELD_BRIGHTNESS) ? req.brightness : 100;
+    
+    Serial.print("[CMD] Control request: GPIO ");
+    Serial.print(pin);
+    Serial.print(" -> ");
+    Serial.print(active ? "ON" : "OFF");
+    Serial.print(" @ ");
+    Serial.print(brightness);
+    Serial.println("%");
+    
+    if (findOutputIndex(pin) < 0) {
+        Serial.println("[ERROR] Invalid GPIO pin: " + String(pin));
+        error = "Output not found";
+        return 404;
     }
+    if (!executeOutputCommand(pin, active, brightness, traceId)) {
+        error = "Command queue full";
+        return 503;
+    }
+    return 200;
 }
 
-void broadcastStatus() {
-    if (!ws) return;
-    
-    DynamicJsonDocument doc(2048);
-    
-    doc["ip"] = WiFi.localIP().toString();
-    doc["macAddress"] = macAddress;
-    doc["uptime"] = millis();
-    doc["freeHeap"] = ESP.getFreeHeap();
-    doc["apClients"] = WiFi.softAPgetStationNum();
-    doc["wsClients"] = ws ? ws->connectedClients() : 0;
-    doc["buildDate"] = String(__DATE__) + " " + String(__TIME__);
-    doc["flashUsed"] = ESP.getSketchSize();
-    doc["flashFree"] = ESP.getFreeSketchSpace();
-    doc["flashPartition"] = ESP.getSketchSize() + ESP.getFreeSketchSpace();
-    doc["cpuLoad0"] = cpuLoad0;
-    doc["cpuLoad1"] = cpuLoad1;
-    
-    JsonArray outputs = doc.createNestedArray("outputs");
-    for (int i = 0; i < MAX_OUTPUTS; i++) {
-        JsonObject output = outputs.createNestedObject();
-        output["pin"] = outputPins[i];
-        output["active"] = outputStates[i];
-        output["brightness"] = map(outputBrightness[i], 0, 255, 0, 100);
-        output["name"] = outputNames[i].length() > 0 ? outputNames[i] : "";
-        output["interval"] = outputIntervals[i];
+// {"pin":..,"interval":ms}
+int intervalCommand(const CommandRequest& req, const char*& error, uint32_t traceId) {
+    int outputIndex = findOutputIndex(req.has(FIELD_PIN) ? req.pin : -1);
+    if (outputIndex < 0) {
+        error = "Output not found";
+        return 404;
     }
-    
-    String jsonString;
-    serializeJson(doc, jsonString);
-    ws->broadcastTXT(jsonString);
+    // Applied and broadcast once the effect task picks it up
+    if (!setOutputInterval(outputIndex, req.has(FIELD_INTERVAL) ? req.interval : 0U, traceId)) {
+        error = "Command queue full";
+        return 503;
+    }
+    return 200;
 }
 
-void initializeWebServer() {
-    if (!server) return;
+// {"pin":..,"name":".."}; an empty name reverts to the default label
+int nameCommand(const CommandRequest& req, const char*& error) {
+    int pin = req.has(FIELD_PIN) ? req.pin : -1;
+    String name = req.name;
+    
+    Serial.print("[CMD] Name update request: GPIO ");
+    Serial.print(pin);
+    Serial.print(" -> '");
+    Serial.print(name);
+    Serial.println("'");
+    
+    int outputIndex = findOutputIndex(pin);
+    if (outputIndex < 0) {
+        Serial.print("[ERROR] GPIO pin not found: ");
+        Serial.println(pin);
+        error = "Output not found";
+        return 404;
+    }
+    // Saved and sent as a delta from loop()
+    saveOutputName(outputIndex, name);
+    return 200;
+}
+
+// {"outputs":[{"pin":..,"active":..,"brightness":..,"interval":..}, ...]}
+// or {"select":"all"|"active", "active":.., "brightness":.., "interval":..}
+int batchCommand(const CommandRequest& req, const char*& error, uint8_t& count, uint32_t traceId) {
+    // Every target is resolved before anything is queued, so a bad pin changes nothing
+    uint8_t targets[MAX_OUTPUTS];
+    int status = outputCore.batchTargets(req, pinMap, targets, count, error);
+    if (status == 0) {
+        error = "Unknown selector";
+        status = 400;
+    }
+    if (status != 200) {
+        Serial.println(String("[ERROR] Batch rejected: ") + error);
+        return status;
+    }
     
-    // Serve main HTML page with RailHub32 styling
-    server->on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
-        Serial.print("[WEB] GET / from ");
-        Serial.println(request->client()->remoteIP());
-        
-        // Build HTML with template replacement to avoid memory issues
-        String html = F("<!DOCTYPE html>\n<html lang=\"en\">\n<head>\n"
-            "<meta charset=\"UTF-8\">\n"
-            "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
-            "<title>RailHub32 - ");
-        html += String(customDeviceName);
-        html += F("</title>\n"
-            "<link rel=\"icon\" href=\"data:image/svg+xml,<svg xmlns='http://www.w3.org/2000/svg' viewBox='0 0 100 100'><text y='0.9em' font-size='90'>🚂</text></svg>\">\n"
-            "<style>\n");
+    bool perOutput = req.has(FIELD_OUTPUTS);
+    OutputCommand cmds[MAX_OUTPUTS];
+    for (uint8_t t = 0; t < count; t++) {
+        cmds[t] = makeBatchCommand(targets[t], perOutput ? req.outputs[t] : req.entry());
+    }
+    
+    // Applied in one effect tick; loop() then persists once and broadcasts once
+    if (!executeOutputBatch(cmds, count, traceId)) {
+        error = "Command queue full";
+        return 503;
+    }
+    return 200;
+}
+
+// WebSocket command: {"id":<n>,"cmd":"control"|"interval"|"name"|"batch"|"snapshot", ...fields of the HTTP endpoint}
+// Answered on the same socket with {"type":"ack","id":<n>,"status":<HTTP status>[,"error":".."]}
+void handleWebSocketCommand(AsyncWebSocketClient* client, uint8_t* payload, size_t length, uint32_t receivedAtUs) {
+    uint32_t traceId = requestTrace.nextId();
+    uint32_t stageStartUs = traceSpan(traceId, TRACE_RECEIVE, receivedAtUs);
+    
+    CommandRequest req;
+    DeserializationError parseError = parseCommandRequest((const char*)payload, length, req);
+    stageStartUs = traceSpan(traceId, TRACE_PARSE, stageStartUs);
+    
+    uint32_t id = 0;
+    int status = 400;
+    const char* error = "Invalid JSON";
+    
+    if (!parseError) {
+        id = req.id;
+        const char* cmd = req.cmd;
+        uint8_t count = 0;
         
-        // Send first chunk - rebuild HTML on EACH request to prevent caching
-        AsyncWebServerResponse *response = request->beginChunkedResponse("text/html", [html](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
-            static String fullHtml;
-            // ALWAYS rebuild HTML, not just on index==0
-            if (index == 0) {
-                fullHtml = "";  // Clear previous content
+        error = nullptr;
+        if (strcmp(cmd, "control") == 0) {
+            status = controlCommand(req, error, traceId);
+        } else if (strcmp(cmd, "interval") == 0) {
+            status = intervalCommand(req, error, traceId);
+        } else if (strcmp(cmd, "name") == 0) {
+            status = nameCommand(req, error);
+        } else if (strcmp(cmd, "batch") == 0) {
+            status = batchCommand(req, error, count, traceId);
+        } else if (strcmp(cmd, "snapshot") == 0) {
+            // Client missed a delta; loop() resyncs it
+            requestSnapshot(client->id(), -1);
+            status = 200;
+        } else if (strcmp(cmd, "hello") == 0) {
+            // Status format negotiation; the new format starts with a snapshot
+            const char* format = req.has(FIELD_FORMAT) ? req.format : "json";
+            if (strcmp(format, "binary") == 0 || strcmp(format, "json") == 0) {
+                Serial.printf("[WS] Client #%u uses %s status frames\n", client->id(), format);
+                requestSnapshot(client->id(), strcmp(format, "binary") == 0);
+                status = 200;
+            } else {
+                status = 400;
+                error = "Unknown format";
             }
-            if (fullHtml.length() == 0) {
-                // Build complete HTML
-                fullHtml = html + String(F(R"rawliteral(
-        :root {
-            --color-bg-primary: #0a0a0a;
-            --color-bg-secondary: #141414;
-            --color-bg-tertiary: #1a1a1a;
-            --color-bg-card: #1c1c1c;
-            --color-border: #2a2a2a;
-            --color-border-hover: #3a3a3a;
-            --color-text-primary: #e8e8e8;
-            --color-text-secondary: #a0a0a0;
-            --color-text-muted: #707070;
-            --color-accent: #6c9bcf;
-            --color-accent-hover: #5a8bc0;
-            --color-success: #4a9b6f;
-            --color-danger: #b85c5c;
-            --color-warning: #c9a257;
-            --font-primary: 'Segoe UI', -apple-system, BlinkMacSystemFont, 'Helvetica Neue', sans-serif;
-        }
-        * { margin: 0; padding: 0; box-sizing: border-box; }
-        body {
-            font-family: var(--font-primary);
-            background: var(--color-bg-primary);
-            color: var(--color-text-primary);
-            min-height: 100vh;
-            font-size: 15px;
-            line-height: 1.6;
-            letter-spacing: 0.01em;
-        }
-        .container {
-            max-width: 1400px;
-            margin: 0 auto;
-            padding: 30px 40px;
-        }
-        header {
-            text-align: left;
-            margin-bottom: 50px;
-            padding-bottom: 25px;
-            border-bottom: 1px solid var(--color-border);
-        }
-        .header-content {
-            margin-bottom: 20px;
-        }
-        h1 {
-            font-size: 2rem;
-            margin-bottom: 8px;
-            font-weight: 300;
-            letter-spacing: 0.03em;
-        }
-        header h1 {
-            font-size: 2rem;
-            margin-bottom: 8px;
-            font-weight: 300;
-            letter-spacing: 0.03em;
-        }
-        header p {
-            font-size: 0.95rem;
-            color: var(--color-text-secondary);
-            font-weight: 300;
-        }
-        .language-selector {
-            display: flex;
-            gap: 8px;
-            flex-wrap: wrap;
-            margin-top: 16px;
-        }
-        .lang-btn {
-            padding: 8px 12px;
-            background: transparent;
-            border: 1px solid var(--color-border);
-            color: var(--color-text-secondary);
-            cursor: pointer;
-            font-size: 0.8rem;
-            font-weight: 400;
-            letter-spacing: 0.05em;
-            transition: all 0.2s ease;
-            text-transform: uppercase;
-        }
-        .lang-btn:hover {
-            border-color: var(--color-border-hover);
-            background: var(--color-bg-tertiary);
-        }
-        .lang-btn.active {
-            background: var(--color-accent);
-            border-color: var(--color-accent);
-            color: var(--color-text-primary);
-        }
-        nav {
-            display: flex;
-            justify-content: flex-start;
-            margin-bottom: 40px;
-            border-bottom: 1px solid var(--color-border);
-        }
-        .tab-button {
-            background: transparent;
-            border: none;
-            color: var(--color-text-secondary);
-            padding: 14px 32px;
-            border-radius: 0;
-            cursor: pointer;
-            font-size: 0.9rem;
-            font-weight: 300;
-            letter-spacing: 0.02em;
-            transition: all 0.2s ease;
-            border-bottom: 2px solid transparent;
-            text-transform: uppercase;
-        }
-        .tab-button:hover {
-            color: var(--color-text-primary);
-        }
-        .tab-button.active {
-            font-weight: 400;
-            color: var(--color-text-primary);
-            border-bottom-color: var(--color-accent);
-        }
-        main { min-height: 500px; }
-        .tab-content { display: none; }
-        .tab-content.active { display: block; }
-        .control-buttons {
-            display: flex;
-            gap: 12px;
-            margin-bottom: 15px;
-        }
-        .control-buttons button {
-            flex: 1;
-            padding: 12px;
-            background: var(--color-accent);
-            color: white;
-            border: none;
-            border-radius: 6px;
-            font-size: 0.95rem;
-            font-weight: 500;
-            cursor: pointer;
-            transition: all 0.2s;
-            position: relative;
-        }
-        .control-buttons button:hover:not(:disabled) {
-            background: var(--color-accent-hover);
-            transform: translateY(-1px);
-        }
-        .control-buttons button:disabled {
-            opacity: 0.6;
-            cursor: not-allowed;
-        }
-        .control-buttons button.processing {
-            background: var(--color-warning);
-        }
-        .control-buttons button.processing::after {
-            content: '⏳';
-            margin-left: 8px;
-            animation: spin 1s linear infinite;
-        }
-        .control-buttons button.active {
-            background: var(--color-success);
-        }
-        .control-buttons button.active:hover:not(:disabled) {
-            background: #3d8a5f;
-        }
-        @keyframes spin {
-            from { transform: rotate(0deg); }
-            to { transform: rotate(360deg); }
-        }
-        .brightness {
-            display: flex;
-            align-items: center;
-            gap: 10px;
-        }
-        .toolbar {
-            display: flex;
-            gap: 12px;
-            margin-bottom: 30px;
-        }
-        .btn {
-            padding: 11px 24px;
-            border: 1px solid var(--color-border);
-            border-radius: 2px;
-            cursor: pointer;
-            font-size: 0.85rem;
-            font-weight: 400;
-            letter-spacing: 0.05em;
-            transition: all 0.2s ease;
-            text-transform: uppercase;
-            background: transparent;
-            color: var(--color-text-primary);
-        }
-        .btn:hover {
-            border-color: var(--color-border-hover);
-            background: var(--color-bg-tertiary);
-        }
-        .btn-primary {
-            background: var(--color-accent);
-            border-color: var(--color-accent);
-        }
-        .btn-primary:hover {
-            background: var(--color-accent-hover);
-            border-color: var(--color-accent-hover);
-        }
-        .status-grid {
-            display: grid;
-            grid-template-columns: repeat(auto-fit, minmax(220px, 1fr));
-            gap: 16px;
-            margin-bottom: 40px;
-        }
-        .status-card {
-            background: var(--color-bg-card);
-            padding: 24px;
-            border: 1px solid var(--color-border);
-            transition: border-color 0.2s ease;
-        }
-        .status-card:hover {
-            border-color: var(--color-border-hover);
-        }
-        .status-value {
-            font-size: 2.2rem;
-            font-weight: 300;
-            color: var(--color-accent);
-            margin-bottom: 8px;
-            letter-spacing: -0.02em;
-        }
-        .status-label {
-            color: var(--color-text-secondary);
-            font-size: 0.85rem;
-            font-weight: 300;
-            text-transform: uppercase;
-            letter-spacing: 0.05em;
-        }
-        .master-brightness-card {
-            margin-bottom: 30px;
-            max-width: 100%;
-        }
-        .outputs-grid {
-            display: grid;
-            grid-template-columns: repeat(auto-fill, minmax(320px, 1fr));
-            gap: 16px;
-        }
-        .output-card {
-            background: var(--color-bg-card);
-            border: 1px solid var(--color-border);
-            padding: 24px;
-            transition: all 0.2s ease;
-        }
-        .output-card:hover {
-            border-color: var(--color-border-hover);
-        }
-        .output-card.active {
-            border-left: 2px solid var(--color-success);
-        }
-        .output-header {
-            display: flex;
-            justify-content: space-between;
-            align-items: center;
-            margin-bottom: 20px;
-            padding-bottom: 16px;
-            border-bottom: 1px solid var(--color-border);
-        }
-        .output-name {
-            font-size: 1.1rem;
-            font-weight: 400;
-            color: var(--color-text-primary);
-            letter-spacing: 0.02em;
-            cursor: pointer;
-            padding: 4px 8px;
-            border-radius: 4px;
-            transition: background 0.2s;
-        }
-        .output-name:hover {
-            background: var(--color-bg-tertiary);
-        }
-        .output-name-edit {
-            display: flex;
-            align-items: center;
-        }
-        .output-status {
-            padding: 5px 14px;
-            font-size: 0.7rem;
-            font-weight: 400;
-            letter-spacing: 0.08em;
-            text-transform: uppercase;
-            border: 1px solid;
-            background: transparent;
-        }
-        .output-status.on {
-            color: var(--color-success);
-            border-color: var(--color-success);
-        }
-        .output-status.off {
-            color: var(--color-text-muted);
-            border-color: var(--color-border);
-        }
-        .output-info {
-            display: flex;
-            align-items: center;
-            justify-content: space-between;
-            font-size: 0.85rem;
-            color: var(--color-text-secondary);
-            margin-bottom: 20px;
-        }
-        .output-info strong {
-            color: var(--color-text-muted);
-            font-weight: 400;
-            text-transform: uppercase;
-            font-size: 0.75rem;
-            letter-spacing: 0.05em;
-        }
-        .output-controls {
-            display: flex;
-            flex-direction: column;
-            gap: 0;
-            margin-top: 16px;
-        }
-        .control-inputs {
-            display: flex;
-            flex-direction: column;
-            gap: 12px;
-        }
-        .toggle-switch {
-            position: relative;
-            width: 44px;
-            height: 22px;
-            background: var(--color-bg-tertiary);
-            border: 1px solid var(--color-border);
-            cursor: pointer;
-            transition: all 0.2s ease;
-        }
-        .toggle-switch.active {
-            background: var(--color-accent);
-            border-color: var(--color-accent);
-        }
-        .toggle-switch::before {
-            content: '';
-            position: absolute;
-            top: 2px;
-            left: 2px;
-            width: 16px;
-            height: 16px;
-            background: var(--color-text-primary);
-            transition: transform 0.2s ease;
-        }
-        .toggle-switch.active::before {
-            transform: translateX(22px);
-        }
-        .brightness-control {
-            display: flex;
-            align-items: center;
-            gap: 12px;
-        }
-        .brightness-label {
-            font-size: 0.75rem;
-            color: var(--color-text-muted);
-            text-transform: uppercase;
-            letter-spacing: 0.05em;
-            min-width: 80px;
-        }
-        .brightness-slider {
-            flex: 1;
-            height: 2px;
-            background: var(--color-border);
-            outline: none;
-            cursor: pointer;
-            -webkit-appearance: none;
-            appearance: none;
-        }
-        .brightness-slider::-webkit-slider-thumb {
-            -webkit-appearance: none;
-            width: 14px;
-            height: 14px;
-            background: var(--color-text-primary);
-            cursor: pointer;
-        }
-        .brightness-slider::-moz-range-thumb {
-            width: 14px;
-            height: 14px;
-            background: var(--color-text-primary);
-            cursor: pointer;
-            border: none;
-        }
-        .brightness-value {
-            font-size: 0.85rem;
-            color: var(--color-text-secondary);
-            min-width: 35px;
-            text-align: right;
-        }
-        .interval-control {
-            display: flex;
-            align-items: center;
-            gap: 8px;
-        }
-        .interval-label {
-            font-size: 0.75rem;
-            color: var(--color-text-muted);
-            text-transform: uppercase;
-            letter-spacing: 0.05em;
-            min-width: 80px;
-        }
-        .interval-input {
-            width: 100px;
-            padding: 6px 10px;
-            background: rgba(255, 255, 255, 0.03);
-            border: 1px solid var(--color-border);
-            color: var(--color-text-primary);
-            border-radius: 4px;
-            font-size: 0.85rem;
-            transition: all 0.2s ease;
-            text-align: center;
-        }
-        .interval-input:focus {
-            outline: none;
-            border-color: var(--color-accent);
-            background: rgba(255, 255, 255, 0.05);
-        }
-        .interval-input::-webkit-inner-spin-button,
-        .interval-input::-webkit-outer-spin-button {
-            opacity: 0.5;
-        }
-        .interval-unit {
-            font-size: 0.75rem;
-            color: var(--color-text-muted);
-        }
-        .section-title {
-            font-size: 0.75rem;
-            font-weight: 400;
-            text-transform: uppercase;
-            letter-spacing: 0.08em;
-            color: var(--color-text-muted);
-            margin-bottom: 24px;
-        }
-        .loading {
-            display: inline-block;
-            width: 18px;
-            height: 18px;
-            border: 2px solid var(--color-border);
-            border-top-color: var(--color-accent);
-            animation: spin 1s linear infinite;
-        }
-        @keyframes spin {
-            to { transform: rotate(360deg); }
-        }
-        footer {
-            text-align: center;
-            padding: 30px 20px;
-            margin-top: 60px;
-            border-top: 1px solid var(--color-border);
-            color: var(--color-text-muted);
-            font-size: 0.85rem;
-            font-weight: 300;
-        }
-        footer a {
-            color: var(--color-accent);
-            text-decoration: none;
-            transition: color 0.2s ease;
-        }
-        footer a:hover {
-            color: var(--color-accent-hover);
-        }
-        @media (max-width: 768px) {
-            .container { padding: 20px; }
-            header { margin-bottom: 30px; }
-            header h1 { font-size: 1.6rem; }
-            nav { overflow-x: auto; }
-            .tab-button { padding: 14px 24px; white-space: nowrap; }
-            .outputs-grid { grid-template-columns: 1fr; }
-            .toolbar { flex-direction: column; }
-            .toolbar .btn { width: 100%; }
+        } else {
+            status = 400;
+            error = "Unknown command";
         }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <header>
-            <div class="header-content">
-                <h1>🚂 RailHub32</h1>
-                <p id="deviceName">)rawliteral"));
-                fullHtml += String(customDeviceName);
-                fullHtml += String(F(R"rawliteral(</p>
-                <div class="language-selector">
-                    <button class="lang-btn active" data-lang="en">EN</button>
-                    <button class="lang-btn" data-lang="de">DE</button>
-                    <button class="lang-btn" data-lang="fr">FR</button>
-                    <button class="lang-btn" data-lang="it">IT</button>
-                    <button class="lang-btn" data-lang="zh">中文</button>
-                    <button class="lang-btn" data-lang="hi">हिं</button>
-                </div>
-            </div>
-        </header>
-
-        <nav>
-            <button id="statusTab" class="tab-button active" data-i18n="nav.status">Status</button>
-            <button id="outputsTab" class="tab-button" data-i18n="nav.outputs">Outputs</button>
-        </nav>
-
-        <main>
-            <!-- Status Tab -->
-            <div id="statusContent" class="tab-content active">
-                <h2 data-i18n="nav.status">Status</h2>
-                <div class="status-grid">
-                    <div class="status-card">
-                        <div class="status-value" id="uptime">0s</div>
-                        <div class="status-label" data-i18n="status.uptime">Uptime</div>
-                    </div>
-                    <div class="status-card">
-                        <div class="status-value" id="buildDate">-</div>
-                        <div class="status-label" data-i18n="status.buildDate">Build Date</div>
-                    </div>
-                </div>
-                
-                <div style="margin-top:15px">
-                    <div class="status-label" style="margin-bottom:8px"><span data-i18n="status.ram">RAM</span> (320 KB)</div>
-                    <div style="background:#333;height:24px;border-radius:3px;overflow:hidden;position:relative">
-                        <div id="ramFill" style="background:linear-gradient(90deg,#4a9b6f,#f39c12);height:100%;width:0%;transition:width 0.3s"></div>
-                        <div id="ramText" style="position:absolute;top:3px;left:0;right:0;text-align:center;font-size:0.75rem;color:#fff;text-shadow:1px 1px 2px rgba(0,0,0,0.8)">-</div>
-                    </div>
-                </div>
-                
-                <div style="margin-top:15px">
-                    <div class="status-label" style="margin-bottom:8px"><span data-i18n="status.programFlash">Program Flash</span> (1.25 MB)</div>
-                    <div style="background:#333;height:24px;border-radius:3px;overflow:hidden;position:relative">
-                        <div id="storageFill" style="background:linear-gradient(90deg,#4a9b6f,#f39c12);height:100%;width:0%;transition:width 0.3s"></div>
-                        <div id="storageText" style="position:absolute;top:3px;left:0;right:0;text-align:center;font-size:0.75rem;color:#fff;text-shadow:1px 1px 2px rgba(0,0,0,0.8)">-</div>
-                    </div>
-                </div>
-                
-                <div style="margin-top:15px">
-                    <div class="status-label" style="margin-bottom:8px"><span data-i18n="status.cpuCore0">CPU Core 0</span></div>
-                    <div style="background:#333;height:24px;border-radius:3px;overflow:hidden;position:relative">
-                        <div id="cpu0Fill" style="background:linear-gradient(90deg,#4a9b6f,#f39c12,#e74c3c);height:100%;width:0%;transition:width 0.3s"></div>
-                        <div id="cpu0Text" style="position:absolute;top:3px;left:0;right:0;text-align:center;font-size:0.75rem;color:#fff;text-shadow:1px 1px 2px rgba(0,0,0,0.8)">-</div>
-                    </div>
-                </div>
-                
-                <div style="margin-top:15px">
-                    <div class="status-label" style="margin-bottom:8px"><span data-i18n="status.cpuCore1">CPU Core 1</span></div>
-                    <div style="background:#333;height:24px;border-radius:3px;overflow:hidden;position:relative">
-                        <div id="cpu1Fill" style="background:linear-gradient(90deg,#4a9b6f,#f39c12,#e74c3c);height:100%;width:0%;transition:width 0.3s"></div>
-                        <div id="cpu1Text" style="position:absolute;top:3px;left:0;right:0;text-align:center;font-size:0.75rem;color:#fff;text-shadow:1px 1px 2px rgba(0,0,0,0.8)">-</div>
-                    </div>
-                </div>
-                
-                <div style="margin-top:20px">
-                    <h2 data-i18n="outputs.controls">Controls</h2>
-                    <div class="control-buttons">
-                        <button id="btnAllOn" onclick="allOn()" data-i18n="buttons.allOn">All ON</button>
-                        <button id="btnAllOff" onclick="allOff()" data-i18n="buttons.allOff">All OFF</button>
-                    </div>
-                    <div class="brightness" style="margin-top:15px">
-                        <label style="display:block;margin-bottom:5px;color:#999;font-size:0.9rem" data-i18n="outputs.masterBrightness">Master Brightness:</label>
-                        <input type="range" min="0" max="100" value="100" id="statusMasterBrightness" oninput="this.nextElementSibling.textContent=this.value+'%'" onchange="setMasterBrightness(this.value)">
-                        <span style="color:#6c9bcf;font-weight:bold">100%</span>
-                    </div>
-                </div>
-            </div>
-
-            <!-- Outputs Tab -->
-            <div id="outputsContent" class="tab-content">
-                <!-- Master Brightness Control -->
-                <div class="output-card master-brightness-card">
-                    <div class="output-header">
-                        <div class="output-name" data-i18n="outputs.master">Master Brightness Control</div>
-                        <div class="output-status on" data-i18n="outputs.all">ALL</div>
-                    </div>
-                    <div class="output-info" data-i18n="outputs.masterDesc">
-                        Adjusts brightness for all active outputs simultaneously
-                    </div>
-                    <div class="brightness-control">
-                        <span class="brightness-label" data-i18n="outputs.brightness">Brightness</span>
-                        <input type="range" 
-                               id="masterBrightness" 
-                               class="brightness-slider" 
-                               min="0" 
-                               max="100" 
-                               value="100">
-                        <span id="masterBrightnessValue" class="brightness-value">100%</span>
-                    </div>
-                </div>
-                
-                <h3 class="section-title" data-i18n="outputs.individual">Individual Output Control</h3>
-                <div id="outputsGrid" class="outputs-grid">
-                    <!-- Outputs will be loaded here -->
-                </div>
-            </div>
-        </main>
-        
-        <footer>
-            Made with ❤️ by innoMO
-        </footer>
-    </div>
-
-    <script>
-        // Translations
-        const translations = {
-            en: {
-                nav: { status: 'Status', outputs: 'Outputs' },
-                buttons: { refresh: '🔄 Refresh', allOn: '💡 All On', allOff: '⚫ All Off' },
-                status: { deviceInfo: 'Device Information', apIp: 'AP IP Address', clients: 'Connected Clients', uptime: 'Uptime', freeHeap: 'Free Heap', macAddr: 'MAC Address', apSsid: 'AP SSID', buildDate: 'Build Date', memoryStorage: 'Memory & Storage', ram: 'RAM', programFlash: 'Program Flash', cpuCore0: 'CPU Core 0', cpuCore1: 'CPU Core 1' },
-                outputs: { master: 'Master Brightness Control', masterBrightness: 'Master Brightness', masterDesc: 'Adjusts brightness for all active outputs simultaneously', individual: 'Individual Output Control', output: 'Output', pin: 'Pin', brightness: 'Brightness', interval: 'Interval', all: 'ALL', on: 'ON', off: 'OFF', editName: 'Edit Name', saveName: 'Save', cancelEdit: 'Cancel', controls: 'Controls' }
-            },
-            de: {
-                nav: { status: 'Status', outputs: 'Ausgänge' },
-                buttons: { refresh: '🔄 Aktualisieren', allOn: '💡 Alle Ein', allOff: '⚫ Alle Aus' },
-                status: { deviceInfo: 'Geräteinformationen', apIp: 'AP IP-Adresse', clients: 'Verbundene Clients', uptime: 'Laufzeit', freeHeap: 'Freier Speicher', macAddr: 'MAC-Adresse', apSsid: 'AP SSID', buildDate: 'Build-Datum', memoryStorage: 'Speicher & Storage', ram: 'RAM', programFlash: 'Programm-Flash', cpuCore0: 'CPU-Kern 0', cpuCore1: 'CPU-Kern 1' },
-                outputs: { master: 'Master-Helligkeitssteuerung', masterBrightness: 'Master-Helligkeit', masterDesc: 'Passt die Helligkeit aller aktiven Ausgänge gleichzeitig an', individual: 'Individuelle Ausgangssteuerung', output: 'Ausgang', pin: 'Pin', brightness: 'Helligkeit', interval: 'Intervall', all: 'ALLE', on: 'EIN', off: 'AUS', editName: 'Name bearbeiten', saveName: 'Speichern', cancelEdit: 'Abbrechen', controls: 'Steuerung' }
-            },
-            fr: {
-                nav: { status: 'Statut', outputs: 'Sorties' },
-                buttons: { refresh: '🔄 Actualiser', allOn: '💡 Tous Allumés', allOff: '⚫ Tous Éteints' },
-                status: { deviceInfo: 'Informations sur l\'appareil', apIp: 'Adresse IP AP', clients: 'Clients connectés', uptime: 'Temps de fonctionnement', freeHeap: 'Mémoire libre', macAddr: 'Adresse MAC', apSsid: 'AP SSID', buildDate: 'Date de compilation', memoryStorage: 'Mémoire & Stockage', ram: 'RAM', programFlash: 'Flash programme', cpuCore0: 'Cœur CPU 0', cpuCore1: 'Cœur CPU 1' },
-                outputs: { master: 'Contrôle principal de la luminosité', masterBrightness: 'Luminosité principale', masterDesc: 'Ajuste la luminosité de toutes les sorties actives simultanément', individual: 'Contrôle individuel des sorties', output: 'Sortie', pin: 'Broche', brightness: 'Luminosité', interval: 'Intervalle', all: 'TOUS', on: 'ALLUMÉ', off: 'ÉTEINT', editName: 'Modifier le nom', saveName: 'Enregistrer', cancelEdit: 'Annuler', controls: 'Contrôles' }
-            },
-            it: {
-                nav: { status: 'Stato', outputs: 'Uscite' },
-                buttons: { refresh: '🔄 Aggiorna', allOn: '💡 Tutti Accesi', allOff: '⚫ Tutti Spenti' },
-                status: { deviceInfo: 'Informazioni dispositivo', apIp: 'Indirizzo IP AP', clients: 'Client connessi', uptime: 'Tempo di attività', freeHeap: 'Memoria libera', macAddr: 'Indirizzo MAC', apSsid: 'AP SSID', buildDate: 'Data compilazione', memoryStorage: 'Memoria & Archiviazione', ram: 'RAM', programFlash: 'Flash programma', cpuCore0: 'Core CPU 0', cpuCore1: 'Core CPU 1' },
-                outputs: { master: 'Controllo luminosità principale', masterBrightness: 'Luminosità principale', masterDesc: 'Regola la luminosità di tutte le uscite attive simultaneamente', individual: 'Controllo uscite individuali', output: 'Uscita', pin: 'Pin', brightness: 'Luminosità', interval: 'Intervallo', all: 'TUTTI', on: 'ACCESO', off: 'SPENTO', editName: 'Modifica nome', saveName: 'Salva', cancelEdit: 'Annulla', controls: 'Controlli' }
-            },
-            zh: {
-                nav: { status: '状态', outputs: '输出' },
-                buttons: { refresh: '🔄 刷新', allOn: '💡 全部开启', allOff: '⚫ 全部关闭' },
-                status: { deviceInfo: '设备信息', apIp: 'AP IP地址', clients: '已连接客户端', uptime: '运行时间', freeHeap: '可用内存', macAddr: 'MAC地址', apSsid: 'AP SSID', buildDate: '构建日期', memoryStorage: '内存与存储', ram: '内存', programFlash: '程序闪存', cpuCore0: 'CPU核心0', cpuCore1: 'CPU核心1' },
-                outputs: { master: '主亮度控制', masterBrightness: '主亮度', masterDesc: '同时调整所有活动输出的亮度', individual: '单独输出控制', output: '输出', pin: '引脚', brightness: '亮度', interval: '间隔', all: '全部', on: '开启', off: '关闭', editName: '编辑名称', saveName: '保存', cancelEdit: '取消', controls: '控制' }
-            },
-            hi: {
-                nav: { status: 'स्थिति', outputs: 'आउटपुट' },
-                buttons: { refresh: '🔄 रिफ्रेश', allOn: '💡 सभी चालू', allOff: '⚫ सभी बंद' },
-                status: { deviceInfo: 'डिवाइस जानकारी', apIp: 'AP IP पता', clients: 'कनेक्टेड क्लाइंट', uptime: 'अपटाइम', freeHeap: 'खाली मेमोरी', macAddr: 'MAC पता', apSsid: 'AP SSID', buildDate: 'बिल्ड तिथि', memoryStorage: 'मेमोरी और स्टोरेज', ram: 'रैम', programFlash: 'प्रोग्राम फ्लैश', cpuCore0: 'सीपीयू कोर 0', cpuCore1: 'सीपीयू कोर 1' },
-                outputs: { master: 'मास्टर चमक नियंत्रण', masterBrightness: 'मास्टर चमक', masterDesc: 'सभी सक्रिय आउटपुट की चमक एक साथ समायोजित करता है', individual: 'व्यक्तिगत आउटपुट नियंत्रण', output: 'आउटपुट', pin: 'पिन', brightness: 'चमक', interval: 'अंतराल', all: 'सभी', on: 'चालू', off: 'बंद', editName: 'नाम संपादित करें', saveName: 'सहेजें', cancelEdit: 'रद्द करें', controls: 'नियंत्रण' }
-            }
-        };
-
-        // Language management
-        let currentLang = localStorage.getItem('railhub32_lang') || 'en';
+        stageStartUs = traceSpan(traceId, TRACE_VALIDATE, stageStartUs);
+    }
+    
+    char ack[96];
+    if (status == 200) {
+        snprintf(ack, sizeof(ack), "{\"type\":\"ack\",\"id\":%lu,\"status\":200}", (unsigned long)id);
+    } else {
+        snprintf(ack, sizeof(ack), "{\"type\":\"ack\",\"id\":%lu,\"status\":%d,\"error\":\"%s\"}",
+                 (unsigned long)id, status, error);
+    }
+    stageStartUs = traceSpan(traceId, TRACE_SERIALIZE, stageStartUs);
+    client->text(ack);
+    traceSpan(traceId, TRACE_SEND, stageStartUs);
+}
 
-        function updateLanguage(lang) {
-            currentLang = lang;
-            localStorage.setItem('railhub32_lang', lang);
-            
-            // Update all elements with data-i18n
-            document.querySelectorAll('[data-i18n]').forEach(elem => {
-                const key = elem.getAttribute('data-i18n');
-                const keys = key.split('.');
-                let value = translations[lang];
-                for (const k of keys) {
-                    value = value[k];
+// async_tcp task: bookkeeping and commands only; status messages are sent from loop()
+void onWebSocketEvent(AsyncWebSocket* socket, AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t length) {
+    switch (type) {
+        case WS_EVT_CONNECT: {
+            bool accepted = false;
+            portENTER_CRITICAL(&wsClientsLock);
+            for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+                if (wsClients[i].id == 0) {
+                    // Static info and the full state go to the new client only
+                    wsClients[i].id = client->id();
+                    wsClients[i].binary = false;
+                    wsClients[i].needsHello = true;
+                    wsClients[i].needsSnapshot = true;
+                    accepted = true;
+                    break;
                 }
-                elem.textContent = value;
-            });
-            
-            // Update language buttons
-            document.querySelectorAll('.lang-btn').forEach(btn => {
-                btn.classList.toggle('active', btn.getAttribute('data-lang') === lang);
-            });
-            
-            // Reload outputs to update labels
-            if (document.getElementById('outputsContent').classList.contains('active')) {
-                loadOutputs();
             }
-        }
-
-        // Language button handlers
-        document.querySelectorAll('.lang-btn').forEach(btn => {
-            btn.addEventListener('click', () => {
-                updateLanguage(btn.getAttribute('data-lang'));
-            });
-        });
-
-        // Initialize language on page load
-        updateLanguage(currentLang);
-
-        // Tab switching with persistence
-        function switchTab(tabName) {
-            document.querySelectorAll('.tab-button').forEach(b => b.classList.remove('active'));
-            document.querySelectorAll('.tab-content').forEach(c => c.classList.remove('active'));
-            document.getElementById(tabName + 'Tab').classList.add('active');
-            document.getElementById(tabName + 'Content').classList.add('active');
-            localStorage.setItem('railhub32_tab', tabName);
+            portEXIT_CRITICAL(&wsClientsLock);
             
-            // Load outputs when switching to outputs tab
-            if (tabName === 'outputs') {
-                loadOutputs();
+            IPAddress ip = client->remoteIP();
+            if (!accepted) {
+                Serial.printf("[WS] Client #%u from %d.%d.%d.%d rejected - %d clients connected\n",
+                              client->id(), ip[0], ip[1], ip[2], ip[3], WS_MAX_CLIENTS);
+                client->close(1013, "Too many clients");
+                return;
             }
+            Serial.printf("[WS] Client #%u connected from %d.%d.%d.%d\n", client->id(), ip[0], ip[1], ip[2], ip[3]);
+            break;
         }
-        
-        document.querySelectorAll('.tab-button').forEach(button => {
-            button.addEventListener('click', function() {
-                const tabName = this.id.replace('Tab', '');
-                switchTab(tabName);
-            });
-        });
-        
-        // Restore last selected tab
-        const savedTab = localStorage.getItem('railhub32_tab') || 'status';
-        switchTab(savedTab);
-
-        // Helper function to update status UI from data
-        function updateStatusFromData(data) {
-            try {
-                // Update uptime
-                const uptimeSeconds = Math.floor(data.uptime / 1000);
-                const hours = Math.floor(uptimeSeconds / 3600);
-                const minutes = Math.floor((uptimeSeconds % 3600) / 60);
-                const seconds = uptimeSeconds % 60;
-                document.getElementById('uptime').textContent = 
-                    hours > 0 ? `${hours}h ${minutes}m` : minutes > 0 ? `${minutes}m ${seconds}s` : `${seconds}s`;
-                
-                // Update build date
-                if (data.buildDate) {
-                    document.getElementById('buildDate').textContent = data.buildDate;
-                }
-                
-                // Update RAM bar
-                const totalRam = 320 * 1024;
-                const usedRam = totalRam - data.freeHeap;
-                const ramPct = Math.round((usedRam / totalRam) * 100);
-                document.getElementById('ramFill').style.width = ramPct + '%';
-                document.getElementById('ramText').textContent = 
-                    Math.round(usedRam / 1024) + 'KB / 320KB (' + ramPct + '%)';
-                
-                // Update Flash bar
-                if (data.flashUsed && data.flashPartition) {
-                    const flashPct = Math.round((data.flashUsed / data.flashPartition) * 100);
-                    document.getElementById('storageFill').style.width = flashPct + '%';
-                    document.getElementById('storageText').textContent = 
-                        Math.round(data.flashUsed / 1024) + 'KB / ' + 
-                        Math.round(data.flashPartition / 1024) + 'KB (' + flashPct + '%)';
-                }
-                
-                // Update CPU Core 0 bar
-                if (data.cpuLoad0 !== undefined) {
-                    const cpu0Pct = Math.round(data.cpuLoad0);
-                    document.getElementById('cpu0Fill').style.width = cpu0Pct + '%';
-                    document.getElementById('cpu0Text').textContent = cpu0Pct + '%';
+        case WS_EVT_DISCONNECT:
+            portENTER_CRITICAL(&wsClientsLock);
+            for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+                if (wsClients[i].id == client->id()) {
+                    wsClients[i].id = 0;
                 }
-                
-                // Update CPU Core 1 bar
-                if (data.cpuLoad1 !== undefined) {
-                    const cpu1Pct = Math.round(data.cpuLoad1);
-                    document.getElementById('cpu1Fill').style.width = cpu1Pct + '%';
-                    document.getElementById('cpu1Text').textContent = cpu1Pct + '%';
-                }
-            } catch (error) {
-                console.error('Error updating status UI:', error);
-            }
-        }
-
-        // Load status
-        async function loadStatus() {
-            try {
-                const response = await fetch('/api/status');
-                const data = await response.json();
-                updateStatusFromData(data);
-                return data;
-            } catch (error) {
-                console.error('Error loading status:', error);
-            }
-        }
-
-        // Load outputs
-        async function loadOutputs() {
-            // Don't update if user is editing a name or interval
-            const activeElement = document.activeElement;
-            if (activeElement && activeElement.id && activeElement.id.startsWith('name-input-')) {
-                return;
-            }
-            if (activeElement && activeElement.className && activeElement.className.includes('interval-input')) {
-                return;
             }
-            
-            let data;
-            try {
-                const response = await fetch('/api/status');
-                data = await response.json();
-            } catch (err) {
-                console.error('[LOAD] Error:', err);
+            portEXIT_CRITICAL(&wsClientsLock);
+            Serial.printf("[WS] Client #%u disconnected\n", client->id());
+            break;
+        case WS_EVT_DATA: {
+            // Commands are small; fragmented or binary messages are not accepted
+            uint32_t receivedAtUs = traceNowUs();
+            AwsFrameInfo* info = (AwsFrameInfo*)arg;
+            if (!info->final || info->index != 0 || info->len != length || info->opcode != WS_TEXT) {
+                Serial.printf("[WS] Ignoring fragmented/binary message from client #%u\n", client->id());
                 return;
             }
-            
-            if (!data) return;
-            
-            try {
-                // Update master brightness to match first active output (if any)
-                const activeOutputs = data.outputs.filter(o => o.active);
-                if (activeOutputs.length > 0) {
-                    const avgBrightness = Math.round(
-                        activeOutputs.reduce((sum, o) => sum + o.brightness, 0) / activeOutputs.length
-                    );
-                    document.getElementById('masterBrightness').value = avgBrightness;
-                    document.getElementById('masterBrightnessValue').textContent = avgBrightness + '%';
-                }
-                
-                const grid = document.getElementById('outputsGrid');
-                grid.innerHTML = '';
-                
-                data.outputs.forEach((output, index) => {
-                    const t = translations[currentLang].outputs;
-                    // Use default name from current language if output name is empty
-                    const displayName = (output.name && output.name.trim() !== '') ? output.name : `${t.output} ${index + 1}`;
-                    // Store the actual value from server (empty string if no custom name)
-                    const inputValue = output.name || '';
-                    const card = document.createElement('div');
-                    card.className = 'output-card' + (output.active ? ' active' : '');
-                    card.innerHTML = `
-                        <div class="output-header">
-                            <div class="output-name" id="name-display-${output.pin}" onclick="editOutputName(${output.pin}, '${inputValue}', ${index})">${displayName}</div>
-                            <div class="output-name-edit" id="name-edit-${output.pin}" style="display: none;">
-                                <input type="text" id="name-input-${output.pin}" value="${inputValue}" placeholder="${t.output} ${index + 1}" maxlength="20" style="width: 130px; padding: 4px; background: var(--color-bg-tertiary); border: 1px solid var(--color-border); color: var(--color-text-primary); border-radius: 4px;">
-                                <button onclick="saveOutputName(${output.pin})" style="padding: 4px 8px; margin-left: 4px; background: var(--color-success); border: none; color: white; border-radius: 4px; cursor: pointer; font-size: 11px;">${t.saveName}</button>
-                                <button onclick="cancelEditName(${output.pin})" style="padding: 4px 8px; margin-left: 2px; background: var(--color-danger); border: none; color: white; border-radius: 4px; cursor: pointer; font-size: 11px;">${t.cancelEdit}</button>
-                            </div>
-                            <div class="output-status ${output.active ? 'on' : 'off'}" data-pin="${output.pin}">
-                                ${output.active ? t.on : t.off}
-                            </div>
-                        </div>
-                        <div class="output-info">
-                            <div><strong>${t.pin}:</strong> GPIO ${output.pin}</div>
-                            <div class="toggle-switch ${output.active ? 'active' : ''}" 
-                                 data-pin="${output.pin}" 
-                                 onclick="toggleOutput(${output.pin})">
-                            </div>
-                        </div>
-                        <div class="output-controls">
-                            <div class="control-inputs">
-                                <div class="brightness-control">
-                                    <span class="brightness-label">${t.brightness}</span>
-                                    <input type="range" 
-                                           class="brightness-slider" 
-                                           min="0" max="100" 
-                                           value="${output.brightness}" 
-                                           data-pin="${output.pin}"
-                                           onchange="setBrightness(${output.pin}, this.value)">
-                                    <span class="brightness-value">${output.brightness}%</span>
-                                </div>
-                                <div class="interval-control">
-                                    <span class="interval-label">${t.interval}:</span>
-                                    <input type="number" 
-                                           class="interval-input" 
-                                           min="0"
-                                           step="100"
-                                           placeholder="0" 
-                                           value="${output.interval || 0}" 
-                                           data-pin="${output.pin}"
-                                           onchange="setInterval(${output.pin}, this.value)">
-                                    <span class="interval-unit">ms</span>
-                                </div>
-                            </div>
-                        </div>
-                    `;
-                    grid.appendChild(card);
-                });
-            } catch (error) {
-                console.error('Error loading outputs:', error);
-            }
+            Serial.printf("[WS] Command from client #%u (%u bytes)\n", client->id(), (unsigned)length);
+            handleWebSocketCommand(client, data, length, receivedAtUs);
+            break;
         }
+        default:
+            break;
+    }
+}
 
-        // Toggle output
-        async function toggleOutput(pin) {
-            try {
-                const toggle = document.querySelector(`.toggle-switch[data-pin="${pin}"]`);
-                const isActive = toggle.classList.contains('active');
-                const brightness = document.querySelector(`.brightness-slider[data-pin="${pin}"]`).value;
-                
-                const response = await fetch('/api/control', {
-                    method: 'POST',
-                    headers: { 'Content-Type': 'application/json' },
-                    body: JSON.stringify({
-                        pin: pin,
-                        active: !isActive,
-                        brightness: parseInt(brightness)
-                    })
-                });
-                
-                if (response.ok) {
-                    await loadOutputs();
-                    // Clear All On/Off active states since individual control was used
-                    document.getElementById('btnAllOn').classList.remove('active');
-                    document.getElementById('btnAllOff').classList.remove('active');
-                }
-            } catch (error) {
-                console.error('Error toggling output:', error);
-            }
+// Flag a client for a snapshot from loop(); binary = 0/1 switches its format, -1 keeps it
+void requestSnapshot(uint32_t id, int binary) {
+    portENTER_CRITICAL(&wsClientsLock);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (wsClients[i].id == id) {
+            if (binary >= 0) wsClients[i].binary = binary == 1;
+            wsClients[i].needsSnapshot = true;
         }
+    }
+    portEXIT_CRITICAL(&wsClientsLock);
+}
 
-        // Set brightness
-        async function setBrightness(pin, brightness) {
-            try {
-                const toggle = document.querySelector(`.toggle-switch[data-pin="${pin}"]`);
-                const isActive = toggle.classList.contains('active');
-                
-                const response = await fetch('/api/control', {
-                    method: 'POST',
-                    headers: { 'Content-Type': 'application/json' },
-                    body: JSON.stringify({
-                        pin: pin,
-                        active: isActive,
-                        brightness: parseInt(brightness)
-                    })
-                });
-                
-                if (response.ok) {
-                    await loadOutputs();
-                    // Clear All On/Off active states since individual control was used
-                    document.getElementById('btnAllOn').classList.remove('active');
-                    document.getElementById('btnAllOff').classList.remove('active');
-                }
-            } catch (error) {
-                console.error('Error setting brightness:', error);
-            }
-        }
+// Ids of clients that are in sync and use the given format (-1 = any).
+// Clients whose queue is full are skipped and marked for a snapshot instead.
+uint8_t readyClients(uint32_t* ids, int binary) {
+    uint8_t count = 0;
+    portENTER_CRITICAL(&wsClientsLock);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        const WsClientState& state = wsClients[i];
+        if (state.id == 0 || state.needsSnapshot) continue;
+        if (binary >= 0 && state.binary != (binary == 1)) continue;
+        ids[count++] = state.id;
+    }
+    portEXIT_CRITICAL(&wsClientsLock);
+    
+    // Library calls stay outside the spinlock
+    uint8_t ready = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        AsyncWebSocketClient* client = ws->client(ids[i]);
+        if (!client) continue;
+        if (client->queueIsFull()) {
+            requestSnapshot(ids[i], -1);
+            continue;
+        }
+        ids[ready++] = ids[i];
+    }
+    return ready;
+}
 
-        // Set interval
-        async function setInterval(pin, interval) {
-            try {
-                const response = await fetch('/api/interval', {
-                    method: 'POST',
-                    headers: { 'Content-Type': 'application/json' },
-                    body: JSON.stringify({
-                        pin: pin,
-                        interval: parseInt(interval) || 0
-                    })
-                });
-                
-                if (response.ok) {
-                    console.log(`Interval set for pin ${pin}: ${interval}ms`);
-                }
-            } catch (error) {
-                console.error('Error setting interval:', error);
-            }
+// One copy of the message, referenced from the queue of every recipient. makeBuffer()
+// keeps the buffer in the socket's list, which only textAll()/binaryAll() drain, so
+// buffers whose messages have gone out are freed here.
+void sendToClients(const uint8_t* data, size_t length, bool binary, const uint32_t* ids, uint8_t count) {
+    if (count == 0) return;
+    
+    AsyncWebSocketMessageBuffer* buffer = ws->makeBuffer((uint8_t*)data, length);
+    if (!buffer) {
+        Serial.println("[ERROR] No memory for WebSocket message (" + String(length) + " bytes)");
+        return;
+    }
+    buffer->lock();
+    for (uint8_t i = 0; i < count; i++) {
+        AsyncWebSocketClient* client = ws->client(ids[i]);
+        if (!client) continue;
+        if (binary) {
+            client->binary(buffer);
+        } else {
+            client->text(buffer);
         }
+    }
+    buffer->unlock();
+    ws->_cleanBuffers();
+}
 
-        // All On with visual feedback
-        let isProcessing = false;
-        async function allOn() {
-            console.log('[DEBUG] allOn() called');
-            const btn = document.getElementById('btnAllOn');
-            console.log('[DEBUG] Button element:', btn);
-            if (isProcessing) {
-                console.log('[DEBUG] Already processing, returning');
-                return;
-            }
-            
-            isProcessing = true;
-            console.log('[DEBUG] Adding processing class');
-            btn.classList.add('processing');
-            btn.disabled = true;
-            console.log('[DEBUG] Button classes:', btn.className);
-            
-            try {
-                const response = await fetch('/api/status');
-                const data = await response.json();
-                
-                for (const output of data.outputs) {
-                    await fetch('/api/control', {
-                        method: 'POST',
-                        headers: { 'Content-Type': 'application/json' },
-                        body: JSON.stringify({
-                            pin: output.pin,
-                            active: true,
-                            brightness: 100
-                        })
-                    });
-                }
-                await loadOutputs();
-                // Mark All On as active, All Off as inactive
-                btn.classList.add('active');
-                document.getElementById('btnAllOff').classList.remove('active');
-            } catch (error) {
-                console.error('Error turning all on:', error);
-            } finally {
-                console.log('[DEBUG] Removing processing class after delay');
-                await new Promise(r => setTimeout(r, 2000));
-                btn.classList.remove('processing');
-                btn.disabled = false;
-                isProcessing = false;
-                console.log('[DEBUG] Processing complete, classes:', btn.className);
-            }
-        }
+void addOutputStatus(JsonWriter& json, int index) {
+    char name[OUTPUT_NAME_MAX_LEN + 1];
+    getOutputName(index, name);
+    json.beginObject();
+    json.add("pin", pinMap.pin(index));
+    json.add("active", outputCore.state[index]);
+    json.add("brightness", map(outputCore.duty[index], 0, 255, 0, 100));
+    json.add("name", name);
+    json.add("interval", outputCore.interval[index]);
+    json.endObject();
+}
 
-        // All Off with visual feedback
-        async function allOff() {
-            const btn = document.getElementById('btnAllOff');
-            if (isProcessing) return;
-            
-            isProcessing = true;
-            btn.classList.add('processing');
-            btn.disabled = true;
-            
-            try {
-                const response = await fetch('/api/status');
-                const data = await response.json();
-                
-                for (const output of data.outputs) {
-                    await fetch('/api/control', {
-                        method: 'POST',
-                        headers: { 'Content-Type': 'application/json' },
-                        body: JSON.stringify({
-                            pin: output.pin,
-                            active: false,
-                            brightness: 0
-                        })
-                    });
-                }
-                await loadOutputs();
-                // Mark All Off as active, All On as inactive
-                btn.classList.add('active');
-                document.getElementById('btnAllOn').classList.remove('active');
-            } catch (error) {
-                console.error('Error turning all off:', error);
-            } finally {
-                await new Promise(r => setTimeout(r, 2000));
-                btn.classList.remove('processing');
-                btn.disabled = false;
-                isProcessing = false;
-            }
-        }
+void addTelemetry() {
+    statusJson.add("seq", statusSeq);
+    statusJson.add("uptime", millis());
+    statusJson.add("freeHeap", ESP.getFreeHeap());
+    statusJson.add("apClients", WiFi.softAPgetStationNum());
+    statusJson.add("wsClients", ws ? ws->count() : 0);
+    statusJson.add("cpuLoad0", cpuLoad0, 1);
+    statusJson.add("cpuLoad1", cpuLoad1, 1);
+}
 
-        // Master Brightness Control (Status tab)
-        async function setMasterBrightness(val) {
-            const brightness = parseInt(val);
-            try {
-                const response = await fetch('/api/status');
-                const data = await response.json();
-                
-                // Update all active outputs with new brightness
-                for (const output of data.outputs) {
-                    if (output.active) {
-                        await fetch('/api/control', {
-                            method: 'POST',
-                            headers: { 'Content-Type': 'application/json' },
-                            body: JSON.stringify({
-                                pin: output.pin,
-                                active: true,
-                                brightness: brightness
-                            })
-                        });
-                    }
-                }
-                await loadOutputs();
-            } catch (error) {
-                console.error('Error setting master brightness:', error);
-            }
-        }
+// Message in statusJson to the given clients
+void sendStatusJson(const uint32_t* ids, uint8_t count) {
+    if (!statusJson.ok()) {
+        Serial.println("[ERROR] Status message exceeds " + String(STATUS_JSON_SIZE) + " bytes - not sent");
+        return;
+    }
+    sendToClients((const uint8_t*)statusBuffer, statusJson.length(), false, ids, count);
+}
 
-        // Output name editing functions
-        function editOutputName(pin, currentName, index) {
-            document.getElementById(`name-display-${pin}`).style.display = 'none';
-            document.getElementById(`name-edit-${pin}`).style.display = 'block';
-            const inputField = document.getElementById(`name-input-${pin}`);
-            inputField.focus();
-            inputField.select();
-        }
+// Fields that do not change while the firmware runs; sent once per connection
+void sendHello(uint32_t id) {
+    IPAddress ip = WiFi.localIP();
+    char ipText[16];
+    snprintf(ipText, sizeof(ipText), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    
+    statusJson.reset();
+    statusJson.beginObject();
+    statusJson.add("type", "hello");
+    statusJson.add("name", customDeviceName);
+    statusJson.add("ip", ipText);
+    statusJson.add("macAddress", macAddress.c_str());
+    statusJson.add("buildDate", __DATE__ " " __TIME__);
+    statusJson.add("flashUsed", ESP.getSketchSize());
+    statusJson.add("flashFree", ESP.getFreeSketchSpace());
+    statusJson.add("flashPartition", ESP.getSketchSize() + ESP.getFreeSketchSpace());
+    statusJson.add("maxOutputs", MAX_OUTPUTS);
+    statusJson.add("binaryStatus", STATUS_FRAME_VERSION);
+    
+    // Binary frames address outputs by index
+    statusJson.beginArray("pins");
+    for (int i = 0; i < MAX_OUTPUTS; i++) {
+        statusJson.add(nullptr, pinMap.pin(i));
+    }
+    statusJson.endArray();
+    statusJson.endObject();
+    sendStatusJson(&id, 1);
+}
 
-        function cancelEditName(pin) {
-            document.getElementById(`name-display-${pin}`).style.display = 'block';
-            document.getElementById(`name-edit-${pin}`).style.display = 'none';
-        }
+// Output state as the binary frame encoder reads it; the names are copied into names
+void fillStatusFrameOutputs(StatusFrameOutput* outputs, char (*names)[OUTPUT_NAME_MAX_LEN + 1]) {
+    for (int i = 0; i < MAX_OUTPUTS; i++) {
+        getOutputName(i, names[i]);
+        outputs[i].active = outputCore.state[i];
+        outputs[i].brightness = map(outputCore.duty[i], 0, 255, 0, 100);
+        outputs[i].interval = outputCore.interval[i];
+        outputs[i].name = names[i];
+    }
+}
 
-        async function saveOutputName(pin) {
-            const newName = document.getElementById(`name-input-${pin}`).value.trim();
-            try {
-                const response = await fetch('/api/name', {
-                    method: 'POST',
-                    headers: { 'Content-Type': 'application/json' },
-                    body: JSON.stringify({
-                        pin: pin,
-                        name: newName
-                    })
-                });
-                
-                if (response.ok) {
-                    await loadOutputs();
-                } else {
-                    alert('Failed to save name');
-                    cancelEditName(pin);
-                }
-            } catch (error) {
-                console.error('Error saving name:', error);
-                alert('Error saving name');
-                cancelEditName(pin);
-            }
-        }
+void writeTelemetryMessage() {
+    statusJson.reset();
+    statusJson.beginObject();
+    statusJson.add("type", "telemetry");
+    addTelemetry();
+    loopProfiler.write(statusJson, "loop", LOOP_SECTION_NAMES);
+    taskLoad.write(statusJson, "tasks");
+    statusJson.endObject();
+}
 
-        // WebSocket connection
-        let ws;
-        const wsUrl = `ws://${window.location.hostname}:81`;
+// Every output plus telemetry, at the current sequence number
+void sendSnapshot(uint32_t id, bool binary) {
+    if (binary) {
+        StatusFrameOutput outputs[MAX_OUTPUTS];
+        char names[MAX_OUTPUTS][OUTPUT_NAME_MAX_LEN + 1];
+        fillStatusFrameOutputs(outputs, names);
+        statusFrame.snapshot(statusSeq, outputs);
+        sendToClients(statusFrame.data(), statusFrame.length(), true, &id, 1);
         
-        function connectWebSocket() {
-            ws = new WebSocket(wsUrl);
-            
-            ws.onopen = () => {
-                console.log('[WS] Connected');
-            };
-            
-            ws.onmessage = (e) => {
-                try {
-                    const data = JSON.parse(e.data);
-                    // Don't update during bulk operations
-                    if (!isProcessing) {
-                        updateStatusFromData(data);
-                        if (document.getElementById('outputsContent').classList.contains('active')) {
-                            loadOutputs();
-                        }
-                    }
-                } catch (err) {
-                    console.error('[WS] Parse error:', err);
-                }
-            };
-            
-            ws.onerror = (error) => {
-                console.error('[WS] Error:', error);
-            };
-            
-            ws.onclose = () => {
-                console.log('[WS] Disconnected. Reconnecting in 3s...');
-                setTimeout(connectWebSocket, 3000);
-            };
-        }
+        // Telemetry is not part of the frame; don't leave it blank until the next heartbeat
+        writeTelemetryMessage();
+        sendStatusJson(&id, 1);
+        return;
+    }
+    
+    statusJson.reset();
+    statusJson.beginObject();
+    statusJson.add("type", "snapshot");
+    addTelemetry();
+    statusJson.beginArray("outputs");
+    for (int i = 0; i < MAX_OUTPUTS; i++) {
+        addOutputStatus(statusJson, i);
+    }
+    statusJson.endArray();
+    statusJson.endObject();
+    sendStatusJson(&id, 1);
+}
 
-        // Initial load
-        loadStatus();
-        if (savedTab === 'outputs') {
-            loadOutputs();
+// Hello and snapshot for clients flagged by onWebSocketEvent() or readyClients(),
+// as soon as their queue has room
+void serviceWebSocketClients() {
+    if (!ws) return;
+    
+    WsClientState pending[WS_MAX_CLIENTS];
+    uint8_t count = 0;
+    portENTER_CRITICAL(&wsClientsLock);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (wsClients[i].id != 0 && (wsClients[i].needsHello || wsClients[i].needsSnapshot)) {
+            pending[count++] = wsClients[i];
+        }
+    }
+    portEXIT_CRITICAL(&wsClientsLock);
+    
+    for (uint8_t i = 0; i < count; i++) {
+        AsyncWebSocketClient* client = ws->client(pending[i].id);
+        if (!client || client->queueIsFull()) continue;
+        
+        if (pending[i].needsHello) {
+            sendHello(pending[i].id);
         }
+        sendSnapshot(pending[i].id, pending[i].binary);
         
-        // Connect WebSocket
-        connectWebSocket();
-    </script>
-</body>
-</html>
-)rawliteral"));
+        // A format switch that arrived meanwhile still gets its own snapshot
+        portENTER_CRITICAL(&wsClientsLock);
+        for (int j = 0; j < WS_MAX_CLIENTS; j++) {
+            if (wsClients[j].id == pending[i].id) {
+                wsClients[j].needsHello = false;
+                if (wsClients[j].binary == pending[i].binary) wsClients[j].needsSnapshot = false;
             }
-            
-            // Send chunk
-            if (index >= fullHtml.length()) return 0;
-            
-            size_t len = fullHtml.length() - index;
-            if (len > maxLen) len = maxLen;
-            memcpy(buffer, fullHtml.c_str() + index, len);
-            return len;
+        }
+        portEXIT_CRITICAL(&wsClientsLock);
+    }
+}
+
+// Only the outputs in changedMask, tagged with the next sequence number;
+// each format is encoded once and only if a client uses it
+void broadcastDelta(uint32_t changedMask) {
+    if (!ws) return;
+    
+    statusSeq++;
+    
+    uint32_t ids[WS_MAX_CLIENTS];
+    uint8_t count = readyClients(ids, 1);
+    if (count > 0) {
+        uint32_t stageStartUs = traceNowUs();
+        StatusFrameOutput outputs[MAX_OUTPUTS];
+        char names[MAX_OUTPUTS][OUTPUT_NAME_MAX_LEN + 1];
+        fillStatusFrameOutputs(outputs, names);
+        statusFrame.delta(statusSeq, changedMask, outputs);
+        stageStartUs = traceSpan(0, TRACE_SERIALIZE, stageStartUs);
+        sendToClients(statusFrame.data(), statusFrame.length(), true, ids, count);
+        traceSpan(0, TRACE_SEND, stageStartUs);
+    }
+    
+    count = readyClients(ids, 0);
+    if (count > 0) {
+        uint32_t stageStartUs = traceNowUs();
+        statusJson.reset();
+        statusJson.beginObject();
+        statusJson.add("type", "delta");
+        statusJson.add("seq", statusSeq);
+        statusJson.beginArray("outputs");
+        for (int i = 0; i < MAX_OUTPUTS; i++) {
+            if (changedMask & (1UL << i)) {
+                addOutputStatus(statusJson, i);
+            }
+        }
+        statusJson.endArray();
+        statusJson.endObject();
+        stageStartUs = traceSpan(0, TRACE_SERIALIZE, stageStartUs);
+        sendStatusJson(ids, count);
+        traceSpan(0, TRACE_SEND, stageStartUs);
+    }
+}
+
+// Periodic heartbeat; its seq lets clients notice a missed delta
+void broadcastTelemetry() {
+    if (!ws) return;
+    
+    uint32_t ids[WS_MAX_CLIENTS];
+    uint8_t count = readyClients(ids, -1);
+    if (count == 0) return;
+    
+    writeTelemetryMessage();
+    sendStatusJson(ids, count);
+}
+
+// Body of a POST from its TCP pieces, assembled in a bodyPool slot. Returns the
+// complete, NUL-terminated body once all of it has arrived; nullptr while pieces
+// are missing or when the request has already been answered with an error.
+const char* requestBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total, size_t& length) {
+    const char* body = nullptr;
+    switch (bodyPool.append(request, data, len, index, total, millis(), body, length)) {
+        case BODY_COMPLETE:
+            return body;
+        case BODY_PENDING:
+        case BODY_IGNORED:
+            return nullptr;
+        case BODY_TOO_LARGE:
+            Serial.println("[WEB] Request body of " + String(total) + " bytes refused (max " + String(MAX_BODY_SIZE) + ")");
+            request->send(413, "application/json", "{\"error\":\"Body too large\"}");
+            return nullptr;
+        case BODY_POOL_FULL:
+            Serial.println("[WEB] All " + String(BODY_POOL_SLOTS) + " body buffers busy - request refused");
+            request->send(503, "application/json", "{\"error\":\"Server busy\"}");
+            return nullptr;
+        default:
+            Serial.println("[ERROR] Request body pieces out of order");
+            request->send(400, "application/json", "{\"error\":\"Invalid body\"}");
+            return nullptr;
+    }
+}
+
+// Answers a matching If-None-Match with 304, otherwise sends the gzip bytes from flash without copying
+void serveWebAsset(AsyncWebServerRequest *request, const WebAsset& asset) {
+    Serial.print("[WEB] GET ");
+    Serial.print(asset.path);
+    Serial.print(" from ");
+    Serial.println(request->client()->remoteIP());
+    
+    AsyncWebServerResponse *response;
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == asset.etag) {
+        response = request->beginResponse(304);
+    } else {
+        response = request->beginResponse_P(200, asset.contentType, asset.data, asset.length);
+        response->addHeader("Content-Encoding", "gzip");
+    }
+    response->addHeader("ETag", asset.etag);
+    response->addHeader("Cache-Control", asset.cacheControl);
+    request->send(response);
+}
+
+// Response of a traced request; building its body counts as serialize
+void sendTracedResponse(AsyncWebServerRequest *request, int status, const String& response, uint32_t traceId, uint32_t stageStartUs) {
+    stageStartUs = traceSpan(traceId, TRACE_SERIALIZE, stageStartUs);
+    request->send(status, "application/json", response);
+    traceSpan(traceId, TRACE_SEND, stageStartUs);
+}
+
+void initializeWebServer() {
+    if (!server) return;
+    
+    // Web UI: static, gzipped at build time (scripts/build_web.py), served straight from flash
+    for (size_t i = 0; i < WEB_ASSET_COUNT; i++) {
+        const WebAsset* asset = &WEB_ASSETS[i];
+        server->on(asset->path, HTTP_GET, [asset](AsyncWebServerRequest *request) {
+            serveWebAsset(request, *asset);
         });
-        
-        Serial.println("[WEB] Sending HTML page");
-        request->send(response);
-    });
+    }
     
     // API endpoint for status
     server->on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request) {
@@ -2151,42 +2130,93 @@ void initializeWebServer() {
         Serial.print("[WEB] GET /api/status from ");
         Serial.println(clientIP.toString());
         
-        DynamicJsonDocument doc(2048);
-        doc["macAddress"] = macAddress;
-        doc["name"] = customDeviceName;
-        doc["wifiMode"] = WiFi.getMode() == WIFI_AP ? "AP" : "STA";
-        doc["ip"] = WiFi.getMode() == WIFI_AP ? WiFi.softAPIP().toString() : WiFi.localIP().toString();
-        doc["ssid"] = WiFi.getMode() == WIFI_AP ? String(AP_SSID) : WiFi.SSID();
-        doc["apClients"] = WiFi.softAPgetStationNum();
-        doc["wsClients"] = ws ? ws->connectedClients() : 0;
-        doc["freeHeap"] = ESP.getFreeHeap();
-        doc["uptime"] = millis();
-        doc["buildDate"] = String(__DATE__) + " " + String(__TIME__);
-        doc["flashUsed"] = ESP.getSketchSize();
-        doc["flashFree"] = ESP.getFreeSketchSpace();
-        doc["flashPartition"] = ESP.getSketchSize() + ESP.getFreeSketchSpace();
+        if (statusApiBusy) {
+            request->send(503, "application/json", "{\"error\":\"Server busy\"}");
+            return;
+        }
+        statusApiBusy = true;
+        request->onDisconnect([]() { statusApiBusy = false; });
+        
+        bool apMode = WiFi.getMode() == WIFI_AP;
+        IPAddress ip = apMode ? WiFi.softAPIP() : WiFi.localIP();
+        char ipText[16];
+        snprintf(ipText, sizeof(ipText), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+        
+        JsonWriter json(statusApiBuffer, STATUS_API_JSON_SIZE);
+        json.beginObject();
+        json.add("macAddress", macAddress.c_str());
+        json.add("name", customDeviceName);
+        json.add("wifiMode", apMode ? "AP" : "STA");
+        json.add("ip", ipText);
+        json.add("ssid", apMode ? AP_SSID : WiFi.SSID().c_str());
+        json.add("apClients", WiFi.softAPgetStationNum());
+        json.add("wsClients", ws ? ws->count() : 0);
+        json.add("freeHeap", ESP.getFreeHeap());
+        json.add("uptime", millis());
+        json.add("buildDate", __DATE__ " " __TIME__);
+        json.add("flashUsed", ESP.getSketchSize());
+        json.add("flashFree", ESP.getFreeSketchSpace());
+        json.add("flashPartition", ESP.getSketchSize() + ESP.getFreeSketchSpace());
+        
+        json.beginObject("effectTick");
+        json.add("periodUs", effectJitter.nominalUs());
+        json.add("ticks", effectJitter.count());
+        json.add("jitterMaxUs", effectJitter.maxUs());
+        json.add("jitterAvgUs", effectJitter.avgUs());
+        json.endObject();
         
-        JsonArray outputs = doc.createNestedArray("outputs");
+        CommandLatency latency = commandLatencySnapshot();
+        json.beginObject("commandLatency");
+        json.add("applied", latency.applied);
+        json.add("dropped", commandQueue.droppedCount());
+        json.add("maxUs", latency.maxUs);
+        json.add("avgUs", latency.applied > 0 ? (uint32_t)(latency.totalUs / latency.applied) : 0);
+        json.endObject();
+        
+        json.beginObject("cpu");
+        json.add("measured", coreLoad.measured());
+        json.add("core0", cpuLoad0, 1);
+        json.add("core1", cpuLoad1, 1);
+        json.add("taskSource", configGENERATE_RUN_TIME_STATS ? "runTimeStats" : "firmwareTasks");
+        json.beginArray("tasks");
+        for (uint8_t i = 0; i < taskLoad.count(); i++) {
+            json.beginObject();
+            json.add("name", taskLoad.name(i));
+            json.add("core", (int)taskLoad.core(i));
+            json.add("load", taskLoad.load(i), 1);
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+        
+        json.beginObject("nvs");
+        json.add("flushes", nvsFlushes);
+        json.add("writes", nvsWrites);
+        json.add("writesAvoided", nvsWritesAvoided());
+        json.add("dirtyOutputs", __builtin_popcount(nvsWriteBehind.dirty()));
+        json.endObject();
+        
+        json.beginArray("outputs");
         for (int i = 0; i < MAX_OUTPUTS; i++) {
-            JsonObject output = outputs.createNestedObject();
-            output["pin"] = outputPins[i];
-            output["active"] = outputStates[i];
-            output["brightness"] = map(outputBrightness[i], 0, 255, 0, 100);
-            output["name"] = outputNames[i];
-            output["interval"] = outputIntervals[i];
+            addOutputStatus(json, i);
         }
+        json.endArray();
+        json.endObject();
         
-        String response;
-        serializeJson(doc, response);
+        if (!json.ok()) {
+            Serial.println("[ERROR] Status response exceeds " + String(STATUS_API_JSON_SIZE) + " bytes");
+            request->send(500, "application/json", "{\"error\":\"Status exceeds buffer\"}");
+            return;
+        }
         
         unsigned long duration = millis() - startTime;
         Serial.print("[WEB] Status response: ");
-        Serial.print(response.length());
+        Serial.print(json.length());
         Serial.print(" bytes, ");
         Serial.print(duration);
         Serial.println("ms");
         
-        request->send(200, "application/json", response);
+        sendStatusApiBuffer(request, json.length());
     });
     
     // Favicon handler - return 204 No Content to prevent errors
@@ -2197,139 +2227,275 @@ void initializeWebServer() {
     // API endpoint for updating output name
     server->on("/api/name", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
     [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
-        unsigned long startTime = millis();
+        uint32_t stageStartUs = traceNowUs();
+        size_t length = 0;
+        const char* body = requestBody(request, data, len, index, total, length);
+        if (!body) return;
+        
         IPAddress clientIP = request->client()->remoteIP();
         Serial.print("[WEB] POST /api/name from ");
         Serial.print(clientIP.toString());
         Serial.print(" (");
-        Serial.print(len);
+        Serial.print(length);
         Serial.println(" bytes)");
+        uint32_t traceId = requestTrace.nextId();
+        stageStartUs = traceSpan(traceId, TRACE_RECEIVE, stageStartUs);
         
-        DynamicJsonDocument doc(512);
-        DeserializationError error = deserializeJson(doc, (const char*)data);
+        CommandRequest req;
+        DeserializationError error = parseCommandRequest(body, length, req);
+        stageStartUs = traceSpan(traceId, TRACE_PARSE, stageStartUs);
         
         if (error) {
             Serial.print("[ERROR] JSON deserialization failed: ");
             Serial.println(error.c_str());
-            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            sendTracedResponse(request, 400, "{\"error\":\"Invalid JSON\"}", traceId, stageStartUs);
             return;
         }
         
-        int pin = doc["pin"];
-        String name = doc["name"].as<String>();
-        
-        Serial.print("[WEB] Name update request: GPIO ");
-        Serial.print(pin);
-        Serial.print(" -> '");
-        Serial.print(name);
-        Serial.println("'");
-        
-        // Find output index by pin
-        int outputIndex = -1;
-        for (int i = 0; i < MAX_OUTPUTS; i++) {
-            if (outputPins[i] == pin) {
-                outputIndex = i;
-                break;
-            }
-        }
-        
-        if (outputIndex >= 0) {
-            saveOutputName(outputIndex, name);
-            
-            // Broadcast update to all WebSocket clients
-            broadcastStatus();
-            
-            unsigned long duration = millis() - startTime;
-            Serial.print("[WEB] Name update complete (");
-            Serial.print(duration);
-            Serial.println("ms)");
-            request->send(200, "application/json", "{\"success\":true}");
-        } else {
-            Serial.print("[ERROR] GPIO pin not found: ");
-            Serial.println(pin);
-            request->send(404, "application/json", "{\"error\":\"Output not found\"}");
+        const char* reason = nullptr;
+        int status = nameCommand(req, reason);
+        stageStartUs = traceSpan(traceId, TRACE_VALIDATE, stageStartUs);
+        if (status != 200) {
+            sendTracedResponse(request, status, commandErrorJson(reason), traceId, stageStartUs);
+            return;
         }
+        sendTracedResponse(request, 200, "{\"success\":true}", traceId, stageStartUs);
     });
     
     // API endpoint for interval
     server->on("/api/interval", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
     [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
-        DynamicJsonDocument doc(512);
-        DeserializationError error = deserializeJson(doc, (const char*)data);
+        uint32_t stageStartUs = traceNowUs();
+        size_t length = 0;
+        const char* body = requestBody(request, data, len, index, total, length);
+        if (!body) return;
+        
+        uint32_t traceId = requestTrace.nextId();
+        stageStartUs = traceSpan(traceId, TRACE_RECEIVE, stageStartUs);
+        
+        CommandRequest req;
+        DeserializationError error = parseCommandRequest(body, length, req);
+        stageStartUs = traceSpan(traceId, TRACE_PARSE, stageStartUs);
         
         if (error) {
-            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            sendTracedResponse(request, 400, "{\"error\":\"Invalid JSON\"}", traceId, stageStartUs);
             return;
         }
         
-        int pin = doc["pin"];
-        unsigned int interval = doc["interval"];
+        const char* reason = nullptr;
+        int status = intervalCommand(req, reason, traceId);
+        stageStartUs = traceSpan(traceId, TRACE_VALIDATE, stageStartUs);
+        if (status != 200) {
+            sendTracedResponse(request, status, commandErrorJson(reason), traceId, stageStartUs);
+            return;
+        }
+        sendTracedResponse(request, 200, "{\"success\":true}", traceId, stageStartUs);
+    });
+    
+    // API endpoint for batch control (registered first: "/api/control" also matches its sub-paths)
+    // Body: {"outputs":[{"pin":..,"active":..,"brightness":..,"interval":..}, ...]}
+    //    or {"select":"all"|"active", "active":.., "brightness":.., "interval":..}
+    server->on("/api/control/batch", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+    [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        uint32_t stageStartUs = traceNowUs();
+        size_t length = 0;
+        const char* body = requestBody(request, data, len, index, total, length);
+        if (!body) return;
         
-        // Find output index by pin
-        int outputIndex = -1;
-        for (int i = 0; i < MAX_OUTPUTS; i++) {
-            if (outputPins[i] == pin) {
-                outputIndex = i;
-                break;
-            }
+        IPAddress clientIP = request->client()->remoteIP();
+        Serial.print("[WEB] POST /api/control/batch from ");
+        Serial.print(clientIP.toString());
+        Serial.print(" (");
+        Serial.print(length);
+        Serial.println(" bytes)");
+        uint32_t traceId = requestTrace.nextId();
+        stageStartUs = traceSpan(traceId, TRACE_RECEIVE, stageStartUs);
+        
+        CommandRequest req;
+        DeserializationError error = parseCommandRequest(body, length, req);
+        stageStartUs = traceSpan(traceId, TRACE_PARSE, stageStartUs);
+        
+        if (error) {
+            Serial.print("[ERROR] JSON deserialization failed: ");
+            Serial.println(error.c_str());
+            sendTracedResponse(request, 400, "{\"error\":\"Invalid JSON\"}", traceId, stageStartUs);
+            return;
         }
         
-        if (outputIndex >= 0) {
-            setOutputInterval(outputIndex, interval);
-            
-            // Broadcast update to all WebSocket clients
-            broadcastStatus();
-            
-            request->send(200, "application/json", "{\"success\":true}");
-        } else {
-            request->send(404, "application/json", "{\"error\":\"Output not found\"}");
+        const char* reason = nullptr;
+        uint8_t count = 0;
+        int status = batchCommand(req, reason, count, traceId);
+        stageStartUs = traceSpan(traceId, TRACE_VALIDATE, stageStartUs);
+        if (status != 200) {
+            sendTracedResponse(request, status, commandErrorJson(reason), traceId, stageStartUs);
+            return;
         }
+        sendTracedResponse(request, 200, "{\"status\":\"ok\",\"outputs\":" + String(count) + "}", traceId, stageStartUs);
     });
     
     // API endpoint for control
     server->on("/api/control", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
     [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
-        unsigned long startTime = millis();
+        uint32_t stageStartUs = traceNowUs();
+        size_t length = 0;
+        const char* body = requestBody(request, data, len, index, total, length);
+        if (!body) return;
+        
         IPAddress clientIP = request->client()->remoteIP();
         Serial.print("[WEB] POST /api/control from ");
         Serial.print(clientIP.toString());
         Serial.print(" (");
-        Serial.print(len);
+        Serial.print(length);
         Serial.println(" bytes)");
+        uint32_t traceId = requestTrace.nextId();
+        stageStartUs = traceSpan(traceId, TRACE_RECEIVE, stageStartUs);
         
-        DynamicJsonDocument doc(1024);
-        DeserializationError error = deserializeJson(doc, (const char*)data);
+        CommandRequest req;
+        DeserializationError error = parseCommandRequest(body, length, req);
+        stageStartUs = traceSpan(traceId, TRACE_PARSE, stageStartUs);
         
         if (error) {
             Serial.print("[ERROR] JSON deserialization failed: ");
             Serial.println(error.c_str());
-            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            sendTracedResponse(request, 400, "{\"error\":\"Invalid JSON\"}", traceId, stageStartUs);
+            return;
+        }
+        
+        // Applied, saved and broadcast once the effect task picks it up
+        const char* reason = nullptr;
+        int status = controlCommand(req, reason, traceId);
+        stageStartUs = traceSpan(traceId, TRACE_VALIDATE, stageStartUs);
+        if (status != 200) {
+            sendTracedResponse(request, status, commandErrorJson(reason), traceId, stageStartUs);
+            return;
+        }
+        sendTracedResponse(request, 200, "{\"status\":\"ok\"}", traceId, stageStartUs);
+    });
+    
+    // loop() profile: {"iterations":..,"rateHz":..,"longestUs":..,"sections":{"wifiManager":[calls,totalUs,maxUs], ...},
+    //                  "rateHistogram":[..],"longestHistogram":[..]}
+    server->on("/api/debug/loop", HTTP_GET, [](AsyncWebServerRequest *request) {
+        char buffer[LOOP_PROFILE_JSON_SIZE];
+        JsonWriter json(buffer, sizeof(buffer));
+        json.beginObject();
+        loopProfiler.write(json, "loop", LOOP_SECTION_NAMES);
+        json.endObject();
+        if (!json.ok()) {
+            request->send(500, "application/json", "{\"error\":\"Profile exceeds buffer\"}");
+            return;
+        }
+        request->send(200, "application/json", buffer);
+    });
+    
+    // Request trace, oldest span first; ?spans=0 leaves out the spans:
+    // {"recorded":n,"stages":{"receive":{"count":..,"p50Us":..,"p95Us":..,"p99Us":..,"maxUs":..}, ...},
+    //  "spans":[[id,"stage",startUs,durationUs], ...]}
+    server->on("/api/debug/trace", HTTP_GET, [](AsyncWebServerRequest *request) {
+        std::shared_ptr<TraceResponse> trace(new (std::nothrow) TraceResponse());
+        uint32_t* scratch = (uint32_t*)malloc(TRACE_RING_SIZE * sizeof(uint32_t));
+        if (trace) trace->spans = (TraceSpan*)malloc(TRACE_RING_SIZE * sizeof(TraceSpan));
+        if (!trace || !trace->spans || !scratch) {
+            free(scratch);
+            request->send(503, "application/json", "{\"error\":\"Out of memory\"}");
             return;
         }
+        trace->withSpans = !(request->hasParam("spans") && request->getParam("spans")->value() == "0");
+        trace->count = requestTrace.snapshot(trace->spans);
         
-        int pin = doc["pin"];
-        bool active = doc["active"];
-        int brightness = doc["brightness"] | 100;
+        // Statistics first; the spans array is left open for the filler
+        JsonWriter json(trace->piece, sizeof(trace->piece));
+        json.beginObject();
+        json.add("recorded", (unsigned long)requestTrace.recorded());
+        json.beginObject("stages");
+        for (uint8_t stage = 0; stage < TRACE_STAGES; stage++) {
+            TraceStageStats stats = traceStageStats(trace->spans, trace->count, stage, scratch);
+            json.beginObject(traceStageName(stage));
+            json.add("count", (unsigned int)stats.count);
+            json.add("p50Us", (unsigned long)stats.p50Us);
+            json.add("p95Us", (unsigned long)stats.p95Us);
+            json.add("p99Us", (unsigned long)stats.p99Us);
+            json.add("maxUs", (unsigned long)stats.maxUs);
+            json.endObject();
+        }
+        json.endObject();
+        if (trace->withSpans) {
+            json.beginArray("spans");
+        }
+        free(scratch);
+        if (!json.ok()) {
+            request->send(500, "application/json", "{\"error\":\"Trace exceeds buffer\"}");
+            return;
+        }
+        trace->pieceLength = json.length();
         
-        Serial.print("[WEB] Control request: GPIO ");
-        Serial.print(pin);
-        Serial.print(" -> ");
-        Serial.print(active ? "ON" : "OFF");
-        Serial.print(" @ ");
-        Serial.print(brightness);
-        Serial.println("%");
+        request->send(request->beginChunkedResponse("application/json", [trace](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            return trace->fill(buffer, maxLen);
+        }));
+    });
+    
+    // Output-to-GPIO map: {"pins":[GPIO of output 0, ...],"default":[LED_PINS]}
+    server->on("/api/pins", HTTP_GET, [](AsyncWebServerRequest *request) {
+        char buffer[192];
+        JsonWriter json(buffer, sizeof(buffer));
+        json.beginObject();
+        json.beginArray("pins");
+        for (int i = 0; i < MAX_OUTPUTS; i++) {
+            json.add(nullptr, pinMap.pin(i));
+        }
+        json.endArray();
+        json.beginArray("default");
+        for (int i = 0; i < MAX_OUTPUTS; i++) {
+            json.add(nullptr, DEFAULT_OUTPUT_PINS[i]);
+        }
+        json.endArray();
+        json.endObject();
+        request->send(200, "application/json", buffer);
+    });
+    
+    // Replace the pin map: {"outputs":[GPIO for output 0, 1, ...]} with one pin per output.
+    // Saved, then applied by a restart right after the response.
+    server->on("/api/pins", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+    [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        size_t length = 0;
+        const char* body = requestBody(request, data, len, index, total, length);
+        if (!body) return;
         
-        executeOutputCommand(pin, active, brightness);
+        IPAddress clientIP = request->client()->remoteIP();
+        Serial.print("[WEB] POST /api/pins from ");
+        Serial.println(clientIP.toString());
         
-        // Broadcast update to all WebSocket clients
-        broadcastStatus();
+        CommandRequest req;
+        DeserializationError error = parseCommandRequest(body, length, req);
+        if (error) {
+            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            return;
+        }
+        if (req.outputTotal != MAX_OUTPUTS) {
+            request->send(400, "application/json", commandErrorJson("Need one pin per output"));
+            return;
+        }
         
-        unsigned long duration = millis() - startTime;
-        Serial.print("[WEB] Control complete (");
-        Serial.print(duration);
-        Serial.println("ms)");
+        int pins[MAX_OUTPUTS];
+        for (int i = 0; i < MAX_OUTPUTS; i++) {
+            pins[i] = req.outputs[i].has(FIELD_VALUE) ? req.outputs[i].pin : -1;
+        }
+        uint8_t badIndex = 0;
+        PinCheck result = checkPinMap(pins, badIndex);
+        if (result != PIN_OK) {
+            char reason[64];
+            snprintf(reason, sizeof(reason), "Output %u: GPIO %d is a %s", badIndex, pins[badIndex], pinCheckText(result));
+            Serial.println(String("[ERROR] Pin map rejected - ") + reason);
+            request->send(400, "application/json", commandErrorJson(reason));
+            return;
+        }
+        if (!savePinMap(pins)) {
+            request->send(500, "application/json", commandErrorJson("Save failed"));
+            return;
+        }
         
-        request->send(200, "application/json", "{\"status\":\"ok\"}");
+        Serial.println("[NVRAM] Pin map saved, restarting to apply it");
+        pinMapRestartAt = millis() + 1000;
+        request->send(200, "application/json", "{\"status\":\"ok\",\"restart\":true}");
     });
     
     // API endpoint to reset saved states
@@ -2337,25 +2503,9 @@ void initializeWebServer() {
         IPAddress clientIP = request->client()->remoteIP();
         Serial.print("[WEB] POST /api/reset from ");
         Serial.println(clientIP.toString());
-        Serial.println("[NVRAM] Resetting all saved states...");
-        Serial.print("[NVRAM] Free heap before reset: ");
-        Serial.print(ESP.getFreeHeap());
-        Serial.println(" bytes");
-        
-        if (!preferences.begin("railhub32", false)) {
-            Serial.println("[ERROR] Failed to open preferences for reset");
-            request->send(500, "application/json", "{\"error\":\"Reset failed\"}");
-            return;
-        }
-        
-        preferences.clear(); // Clear all saved preferences
-        preferences.end();
-        
-        Serial.println("[NVRAM] All saved states cleared!");
-        Serial.print("[NVRAM] Free heap after reset: ");
-        Serial.print(ESP.getFreeHeap());
-        Serial.println(" bytes");
         
+        // Carried out by loop() on its next pass
+        resetRequested.store(true);
         request->send(200, "application/json", "{\"status\":\"reset_complete\"}");
     });
     
@@ -2365,6 +2515,11 @@ void initializeWebServer() {
     Serial.println("[WEB]   GET  /              - Main control interface");
     Serial.println("[WEB]   GET  /api/status    - System and output status");
     Serial.println("[WEB]   POST /api/control   - Control output state/brightness");
+    Serial.println("[WEB]   POST /api/control/batch - Control several outputs at once");
     Serial.println("[WEB]   POST /api/name      - Update output name");
+    Serial.println("[WEB]   GET/POST /api/pins  - Output-to-GPIO map (restarts on change)");
+    Serial.println("[WEB]   GET  /api/debug/trace - Per-stage command timing (p50/p95/p99)");
+    Serial.println("[WEB]   GET  /api/debug/loop  - Time spent per loop() subsystem");
     Serial.println("[WEB]   POST /api/reset     - Reset all saved preferences");
+    Serial.println("[WEB]   WS   /ws            - Status snapshot/deltas and commands");
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+/**
+ * @file test_body_pool.cpp
+ * @brief Tests for assembling POST bodies from their TCP pieces
+ *
+ * Feeds BodyPool the (data, len, index, total) pieces the async web server
+ * hands to a body handler and checks that a body is only released once it
+ * is complete, that oversized bodies are refused at their first piece, and
+ * that the fixed slots are shared and reclaimed correctly.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <string.h>
+#include <body_pool.h>
+
+typedef BodyPool<2, 65> TestPool;     // Two slots of 64 bytes
+
+static const char *BATCH = "{\"commands\":[{\"pin\":2,\"active\":true},{\"pin\":4,\"active\":false}]}";
+
+// Stand-ins for AsyncWebServerRequest pointers
+static int requestA;
+static int requestB;
+static int requestC;
+
+static BodyStatus feed(TestPool &pool, const void *owner, const char *text, size_t index, size_t len,
+                       uint32_t nowMs, const char *&body, size_t &length) {
+    return pool.append(owner, (const uint8_t *)text + index, len, index, strlen(text), nowMs, body, length);
+}
+
+// Test: A body split anywhere is only released once complete, intact and NUL-terminated
+void test_split_body_reassembles(void) {
+    size_t total = strlen(BATCH);
+    for (size_t split = 1; split < total; split++) {
+        TestPool pool;
+        const char *body = nullptr;
+        size_t length = 0;
+
+        TEST_ASSERT_EQUAL(BODY_PENDING, feed(pool, &requestA, BATCH, 0, split, 0, body, length));
+        TEST_ASSERT_NULL(body);
+        TEST_ASSERT_EQUAL(1, pool.inUse());
+
+        TEST_ASSERT_EQUAL(BODY_COMPLETE, feed(pool, &requestA, BATCH, split, total - split, 0, body, length));
+        TEST_ASSERT_EQUAL(total, length);
+        TEST_ASSERT_EQUAL_STRING(BATCH, body);
+        TEST_ASSERT_EQUAL(0, pool.inUse());
+    }
+}
+
+// Test: Two requests interleaving their pieces each get their own body
+void test_interleaved_requests(void) {
+    TestPool pool;
+    const char *other = "{\"pin\":2,\"name\":\"Platform 1\"}";
+    const char *body = nullptr;
+    size_t length = 0;
+
+    TEST_ASSERT_EQUAL(BODY_PENDING, feed(pool, &requestA, BATCH, 0, 10, 0, body, length));
+    TEST_ASSERT_EQUAL(BODY_PENDING, feed(pool, &requestB, other, 0, 5, 0, body, length));
+    TEST_ASSERT_EQUAL(BODY_COMPLETE, feed(pool, &requestB, other, 5, strlen(other) - 5, 0, body, length));
+    TEST_ASSERT_EQUAL_STRING(other, body);
+    TEST_ASSERT_EQUAL(BODY_COMPLETE, feed(pool, &requestA, BATCH, 10, strlen(BATCH) - 10, 0, body, length));
+    TEST_ASSERT_EQUAL_STRING(BATCH, body);
+}
+
+// Test: A body over the limit is refused at its first piece and nothing is buffered
+void test_oversized_body_refused_early(void) {
+    TestPool pool;
+    const char *body = nullptr;
+    size_t length = 0;
+    uint8_t piece[16] = {0};
+
+    TEST_ASSERT_EQUAL(64, TestPool::MAX_BODY);
+    TEST_ASSERT_EQUAL(BODY_TOO_LARGE, pool.append(&requestA, piece, sizeof(piece), 0, 65, 0, body, length));
+    TEST_ASSERT_EQUAL(0, pool.inUse());
+    // The rest of the refused body is dropped
+    TEST_ASSERT_EQUAL(BODY_IGNORED, pool.append(&requestA, piece, sizeof(piece), 16, 65, 0, body, length));
+
+    // Exactly at the limit is fine
+    char exact[65];
+    memset(exact, 'x', 64);
+    exact[64] = '\0';
+    TEST_ASSERT_EQUAL(BODY_COMPLETE, feed(pool, &requestA, exact, 0, 64, 0, body, length));
+    TEST_ASSERT_EQUAL(64, length);
+}
+
+// Test: With every slot busy a new request is refused until a slot frees or goes stale
+void test_pool_full_and_stale_slot(void) {
+    TestPool pool;
+    const char *body = nullptr;
+    size_t length = 0;
+
+    TEST_ASSERT_EQUAL(BODY_PENDING, feed(pool, &requestA, BATCH, 0, 4, 1000, body, length));
+    TEST_ASSERT_EQUAL(BODY_PENDING, feed(pool, &requestB, BATCH, 0, 4, 1000, body, length));
+    TEST_ASSERT_EQUAL(BODY_POOL_FULL, feed(pool, &requestC, BATCH, 0, 4, 2000, body, length));
+
+    // requestB keeps sending, requestA went silent and is reclaimed after STALE_MS
+    TEST_ASSERT_EQUAL(BODY_PENDING, feed(pool, &requestB, BATCH, 4, 4, 1000 + TestPool::STALE_MS, body, length));
+    TEST_ASSERT_EQUAL(BODY_PENDING, feed(pool, &requestC, BATCH, 0, 4, 1001 + TestPool::STALE_MS, body, length));
+    TEST_ASSERT_EQUAL(2, pool.inUse());
+    TEST_ASSERT_EQUAL(BODY_IGNORED, feed(pool, &requestA, BATCH, 4, 4, 1002 + TestPool::STALE_MS, body, length));
+
+    // release() frees a slot at once (client disconnected mid-body)
+    pool.release(&requestB);
+    TEST_ASSERT_EQUAL(1, pool.inUse());
+    TEST_ASSERT_EQUAL(BODY_PENDING, feed(pool, &requestA, BATCH, 0, 4, 1003 + TestPool::STALE_MS, body, length));
+}
+
+// Test: A missing or overlong piece discards the body instead of dispatching a corrupt one
+void test_out_of_order_piece_invalid(void) {
+    TestPool pool;
+    const char *body = nullptr;
+    size_t length = 0;
+    size_t total = strlen(BATCH);
+
+    TEST_ASSERT_EQUAL(BODY_PENDING, feed(pool, &requestA, BATCH, 0, 10, 0, body, length));
+    TEST_ASSERT_EQUAL(BODY_INVALID, feed(pool, &requestA, BATCH, 20, 10, 0, body, length));
+    TEST_ASSERT_EQUAL(0, pool.inUse());
+    TEST_ASSERT_EQUAL(BODY_IGNORED, feed(pool, &requestA, BATCH, 30, total - 30, 0, body, length));
+    TEST_ASSERT_NULL(body);
+
+    // More bytes than announced
+    TEST_ASSERT_EQUAL(BODY_PENDING, pool.append(&requestB, (const uint8_t *)BATCH, 10, 0, 12, 0, body, length));
+    TEST_ASSERT_EQUAL(BODY_INVALID, pool.append(&requestB, (const uint8_t *)BATCH + 10, 10, 10, 12, 0, body, length));
+    TEST_ASSERT_EQUAL(0, pool.inUse());
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_split_body_reassembles);
+    RUN_TEST(test_interleaved_requests);
+    RUN_TEST(test_oversized_body_refused_early);
+    RUN_TEST(test_pool_full_and_stale_slot);
+    RUN_TEST(test_out_of_order_piece_invalid);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
@@ -0,0 +1,329 @@
+/**
+ * @file test_command_parser.cpp
+ * @brief Tests and benchmark for the schema command parser against ArduinoJson
+ *
+ * Every command in the corpus below is one the web UI, the ESP8266 page or
+ * the README examples actually send. parseCommand() must fill exactly the
+ * fields the ArduinoJson path (deserializeJson + commandFromJson) fills, and
+ * hand everything it does not take to that fallback. The benchmark then
+ * parses the corpus both ways and reports time per command, heap (through
+ * a counting ArduinoJson allocator) and stack (high-water mark of a painted
+ * area below the caller).
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <command_json.h>
+#include <command_parser.h>
+
+#ifdef NATIVE_BUILD
+#include <chrono>
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#else
+static uint64_t nowNs() {
+    return (uint64_t)micros() * 1000;
+}
+#endif
+
+typedef CommandFields<16> TestCommand;
+
+static const char *CORPUS[] = {
+    "{\"pin\":2,\"active\":true,\"brightness\":75}",
+    "{\"id\":17,\"cmd\":\"control\",\"pin\":4,\"active\":false,\"brightness\":100}",
+    "{\"id\":18,\"cmd\":\"interval\",\"pin\":5,\"interval\":500}",
+    "{\"pin\":18,\"interval\":0}",
+    "{\"id\":19,\"cmd\":\"name\",\"pin\":19,\"name\":\"Platform 3 \\\"North\\\"\"}",
+    "{\"pin\":21,\"name\":\"\"}",
+    "{\"select\":\"all\",\"active\":false}",
+    "{\"id\":20,\"cmd\":\"batch\",\"select\":\"active\",\"brightness\":40}",
+    "{\"outputs\":[{\"pin\":2,\"active\":true,\"brightness\":80},{\"pin\":4,\"active\":true,\"brightness\":80},"
+    "{\"pin\":5,\"active\":false},{\"pin\":18,\"interval\":750}]}",
+    "{\"id\":21,\"cmd\":\"chasing.create\",\"groupId\":1,\"interval\":200,\"outputs\":[2,4,5,18],\"name\":\"Runway\"}",
+    "{\"id\":22,\"cmd\":\"chasing.delete\",\"groupId\":1}",
+    "{\"groupId\":1,\"name\":\"Runway 09\"}",
+    "{\"id\":23,\"cmd\":\"hello\",\"format\":\"binary\"}",
+    "{\"id\":24,\"cmd\":\"snapshot\"}",
+    "{ \"pin\": 2, \"active\": true, \"brightness\": 100 }",
+};
+static const size_t CORPUS_SIZE = sizeof(CORPUS) / sizeof(CORPUS[0]);
+
+// ArduinoJson allocator that counts what the document takes from the heap
+struct CountingAllocator : ArduinoJson::Allocator {
+    size_t allocations;
+    size_t current;
+    size_t peak;
+
+    CountingAllocator() : allocations(0), current(0), peak(0) {}
+
+    void *allocate(size_t size) override {
+        size_t *block = (size_t *)malloc(size + sizeof(size_t) * 2);
+        if (!block) return nullptr;
+        block[0] = size;
+        track(size);
+        return block + 2;
+    }
+
+    void deallocate(void *pointer) override {
+        size_t *block = (size_t *)pointer - 2;
+        current -= block[0];
+        free(block);
+    }
+
+    void *reallocate(void *pointer, size_t newSize) override {
+        size_t *block = (size_t *)pointer - 2;
+        current -= block[0];
+        block = (size_t *)realloc(block, newSize + sizeof(size_t) * 2);
+        if (!block) return nullptr;
+        block[0] = newSize;
+        track(newSize);
+        return block + 2;
+    }
+
+    void track(size_t size) {
+        allocations++;
+        current += size;
+        if (current > peak) peak = current;
+    }
+};
+
+static CountingAllocator referenceAllocator;
+
+static bool parseWithArduinoJson(const char *text, TestCommand &out, CountingAllocator *allocator) {
+    JsonDocument doc(allocator);
+    if (deserializeJson(doc, text, strlen(text))) return false;
+    commandFromJson(doc.as<JsonObjectConst>(), out);
+    return true;
+}
+
+static void assertSameEntry(const CommandEntry &a, const CommandEntry &b) {
+    TEST_ASSERT_EQUAL(a.fields, b.fields);
+    if (a.has(FIELD_PIN) || a.has(FIELD_VALUE)) TEST_ASSERT_EQUAL(a.pin, b.pin);
+    if (a.has(FIELD_ACTIVE)) TEST_ASSERT_EQUAL(a.active, b.active);
+    if (a.has(FIELD_BRIGHTNESS)) TEST_ASSERT_EQUAL(a.brightness, b.brightness);
+    if (a.has(FIELD_INTERVAL)) TEST_ASSERT_EQUAL(a.interval, b.interval);
+}
+
+static void assertSameCommand(const TestCommand &a, const TestCommand &b) {
+    TEST_ASSERT_EQUAL(a.fields, b.fields);
+    TEST_ASSERT_EQUAL(a.id, b.id);
+    TEST_ASSERT_EQUAL_STRING(a.cmd, b.cmd);
+    TEST_ASSERT_EQUAL(a.pin, b.pin);
+    TEST_ASSERT_EQUAL(a.active, b.active);
+    TEST_ASSERT_EQUAL(a.brightness, b.brightness);
+    TEST_ASSERT_EQUAL(a.interval, b.interval);
+    TEST_ASSERT_EQUAL(a.group, b.group);
+    TEST_ASSERT_EQUAL(a.groupId, b.groupId);
+    TEST_ASSERT_EQUAL_STRING(a.select, b.select);
+    TEST_ASSERT_EQUAL_STRING(a.format, b.format);
+    TEST_ASSERT_EQUAL_STRING(a.name, b.name);
+    TEST_ASSERT_EQUAL(a.outputTotal, b.outputTotal);
+    for (uint16_t i = 0; i < a.outputTotal && i < 16; i++) {
+        assertSameEntry(a.outputs[i], b.outputs[i]);
+    }
+}
+
+// Test: Every corpus command is taken by the parser and matches the ArduinoJson path
+void test_corpus_matches_arduinojson(void) {
+    for (size_t i = 0; i < CORPUS_SIZE; i++) {
+        TestCommand fast;
+        TestCommand reference;
+        TEST_ASSERT_TRUE(parseCommand(CORPUS[i], strlen(CORPUS[i]), fast));
+        TEST_ASSERT_TRUE(parseWithArduinoJson(CORPUS[i], reference, &referenceAllocator));
+        assertSameCommand(fast, reference);
+    }
+}
+
+// Test: Fields land where the handlers read them
+void test_command_fields(void) {
+    TestCommand cmd;
+    const char *name = CORPUS[4];
+    TEST_ASSERT_TRUE(parseCommand(name, strlen(name), cmd));
+    TEST_ASSERT_EQUAL(19, cmd.id);
+    TEST_ASSERT_EQUAL_STRING("name", cmd.cmd);
+    TEST_ASSERT_EQUAL_STRING("Platform 3 \"North\"", cmd.name);
+    TEST_ASSERT_FALSE(cmd.has(FIELD_ACTIVE));
+
+    const char *batch = CORPUS[8];
+    TEST_ASSERT_TRUE(parseCommand(batch, strlen(batch), cmd));
+    TEST_ASSERT_EQUAL(4, cmd.outputTotal);
+    TEST_ASSERT_EQUAL(18, cmd.outputs[3].pin);
+    TEST_ASSERT_TRUE(cmd.outputs[3].has(FIELD_INTERVAL));
+    TEST_ASSERT_FALSE(cmd.outputs[3].has(FIELD_ACTIVE));
+    TEST_ASSERT_EQUAL(750, cmd.outputs[3].interval);
+
+    const char *chasing = CORPUS[9];
+    TEST_ASSERT_TRUE(parseCommand(chasing, strlen(chasing), cmd));
+    TEST_ASSERT_EQUAL(1, cmd.groupId);
+    TEST_ASSERT_TRUE(cmd.outputs[2].has(FIELD_VALUE));
+    TEST_ASSERT_EQUAL(5, cmd.outputs[2].pin);
+
+    // Unknown keys are skipped, nested or not; the top-level "select" entry carries its fields
+    const char *extra = "{\"select\":\"all\",\"meta\":{\"ui\":[1,{\"a\":\"}\"}],\"v\":-1.5e3},\"note\":null,\"interval\":250}";
+    TEST_ASSERT_TRUE(parseCommand(extra, strlen(extra), cmd));
+    TEST_ASSERT_EQUAL_STRING("all", cmd.select);
+    CommandEntry fields = cmd.entry();
+    TEST_ASSERT_EQUAL(FIELD_INTERVAL, fields.fields);
+    TEST_ASSERT_EQUAL(250, fields.interval);
+}
+
+// Test: More outputs than fit are counted, so handlers can still reject the batch
+void test_outputs_overflow_counted(void) {
+    CommandFields<2> cmd;
+    const char *text = "{\"outputs\":[{\"pin\":2},{\"pin\":4},{\"pin\":5}]}";
+    TEST_ASSERT_TRUE(parseCommand(text, strlen(text), cmd));
+    TEST_ASSERT_EQUAL(3, cmd.outputTotal);
+    TEST_ASSERT_EQUAL(4, cmd.outputs[1].pin);
+}
+
+// Test: Shapes the parser does not represent exactly go to ArduinoJson, which reads them as before
+void test_fallback_shapes(void) {
+    static const char *fallback[] = {
+        "{\"pin\":2,\"active\":true,\"brightness\":null}",         // null
+        "{\"pin\":2,\"active\":true,\"brightness\":50.5}",         // float
+        "{\"pin\":2,\"active\":1}",                                // number for a boolean
+        "{\"pin\":\"2\",\"active\":true}",                         // string for a number
+        "{\"pin\":2,\"name\":\"Gleis \\u00dcberholung\"}",         // \u escape
+        "{\"pin\":2,\"name\":\"A name far longer than thirty-two characters\"}",
+        "{\"groupId\":300}",                                       // out of range
+        "{\"pin\":2,\"active\":true",                              // malformed
+        "[{\"pin\":2}]",                                           // not an object
+        "{\"pin\":2} trailing",
+    };
+    TestCommand cmd;
+    for (size_t i = 0; i < sizeof(fallback) / sizeof(fallback[0]); i++) {
+        TEST_ASSERT_FALSE(parseCommand(fallback[i], strlen(fallback[i]), cmd));
+    }
+
+    // The ArduinoJson path then fills the struct with its usual conversions
+    TEST_ASSERT_TRUE(parseWithArduinoJson(fallback[1], cmd, &referenceAllocator));
+    TEST_ASSERT_TRUE(cmd.has(FIELD_BRIGHTNESS));
+    TEST_ASSERT_EQUAL(50, cmd.brightness);
+    TEST_ASSERT_TRUE(parseWithArduinoJson(fallback[0], cmd, &referenceAllocator));
+    TEST_ASSERT_FALSE(cmd.has(FIELD_BRIGHTNESS));
+    TEST_ASSERT_TRUE(parseWithArduinoJson(fallback[5], cmd, &referenceAllocator));
+    TEST_ASSERT_EQUAL(TestCommand::NAME_SIZE - 1, strlen(cmd.name));
+    TEST_ASSERT_FALSE(parseWithArduinoJson(fallback[7], cmd, &referenceAllocator));
+}
+
+// Stack high-water mark: paint an area below the caller, run the parser, see how deep it wrote
+#define STACK_PROBE 4096
+#define STACK_PAINT 0xA5
+
+__attribute__((noinline)) static void paintStack() {
+    volatile uint8_t area[STACK_PROBE];
+    for (size_t i = 0; i < STACK_PROBE; i++) area[i] = STACK_PAINT;
+}
+
+__attribute__((noinline)) static size_t stackUsed() {
+    volatile uint8_t area[STACK_PROBE];
+    size_t untouched = 0;
+    while (untouched < STACK_PROBE && area[untouched] == STACK_PAINT) untouched++;
+    return STACK_PROBE - untouched;
+}
+
+static volatile int32_t sink;
+
+__attribute__((noinline)) static void parseOnceFast(const char *text) {
+    TestCommand cmd;
+    parseCommand(text, strlen(text), cmd);
+    sink = cmd.pin;
+}
+
+__attribute__((noinline)) static void parseOnceArduinoJson(const char *text, CountingAllocator *allocator) {
+    TestCommand cmd;
+    parseWithArduinoJson(text, cmd, allocator);
+    sink = cmd.pin;
+}
+
+#define BENCH_ROUNDS 2000
+
+// Test: Over the corpus the schema parser is faster, never touches the heap, and the report shows by how much
+void test_benchmark_against_arduinojson(void) {
+    CountingAllocator allocator;
+    size_t fastStack = 0;
+    size_t jsonStack = 0;
+    size_t jsonPeakHeap = 0;
+
+    // Warm-up, so lazy symbol binding on the first calls does not count as parser stack
+    for (size_t i = 0; i < CORPUS_SIZE; i++) {
+        parseOnceFast(CORPUS[i]);
+        parseOnceArduinoJson(CORPUS[i], &allocator);
+    }
+    allocator.allocations = 0;
+
+    for (size_t i = 0; i < CORPUS_SIZE; i++) {
+        paintStack();
+        parseOnceFast(CORPUS[i]);
+        size_t used = stackUsed();
+        if (used > fastStack) fastStack = used;
+
+        allocator.peak = 0;
+        paintStack();
+        parseOnceArduinoJson(CORPUS[i], &allocator);
+        used = stackUsed();
+        if (used > jsonStack) jsonStack = used;
+        if (allocator.peak > jsonPeakHeap) jsonPeakHeap = allocator.peak;
+    }
+    size_t jsonAllocations = allocator.allocations;
+    TEST_ASSERT_EQUAL(0, allocator.current);
+
+    uint64_t start = nowNs();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (size_t i = 0; i < CORPUS_SIZE; i++) parseOnceFast(CORPUS[i]);
+    }
+    uint64_t fastNs = nowNs() - start;
+
+    start = nowNs();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (size_t i = 0; i < CORPUS_SIZE; i++) parseOnceArduinoJson(CORPUS[i], &allocator);
+    }
+    uint64_t jsonNs = nowNs() - start;
+
+    double commands = (double)BENCH_ROUNDS * CORPUS_SIZE;
+    char line[200];
+    snprintf(line, sizeof(line), "schema parser: %.0f ns/command, no heap, stack %lu bytes",
+             fastNs / commands, (unsigned long)fastStack);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "ArduinoJson:   %.0f ns/command, heap peak %lu bytes (%.1f allocations/command), stack %lu bytes",
+             jsonNs / commands, (unsigned long)jsonPeakHeap, (double)jsonAllocations / CORPUS_SIZE, (unsigned long)jsonStack);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_TRUE(jsonAllocations > 0);
+    TEST_ASSERT_TRUE(fastNs < jsonNs);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_corpus_matches_arduinojson);
+    RUN_TEST(test_command_fields);
+    RUN_TEST(test_outputs_overflow_counted);
+    RUN_TEST(test_fallback_shapes);
+    RUN_TEST(test_benchmark_against_arduinojson);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
@@ -0,0 +1,145 @@
+/**
+ * @file test_command_queue.cpp
+ * @brief Unit tests for the lock-free effect command queue
+ *
+ * Tests FIFO order, full-queue rejection, sequence wrap-around and
+ * all-or-nothing batches.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <command_queue.h>
+
+struct TestCommand {
+    uint8_t index;
+    uint32_t value;
+};
+
+// Test: Commands come out in the order they were pushed
+void test_queue_fifo_order(void) {
+    CommandQueue<TestCommand, 8> queue;
+    for (uint8_t i = 0; i < 5; i++) {
+        TestCommand cmd = {i, (uint32_t)(i * 100)};
+        TEST_ASSERT_TRUE(queue.push(cmd));
+    }
+
+    TestCommand out;
+    for (uint8_t i = 0; i < 5; i++) {
+        TEST_ASSERT_TRUE(queue.pop(out));
+        TEST_ASSERT_EQUAL(i, out.index);
+        TEST_ASSERT_EQUAL(i * 100, out.value);
+    }
+    TEST_ASSERT_FALSE(queue.pop(out));
+}
+
+// Test: A full queue rejects pushes and counts the drops
+void test_queue_full_rejects(void) {
+    CommandQueue<TestCommand, 4> queue;
+    TestCommand cmd = {1, 1};
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(queue.push(cmd));
+    }
+    TEST_ASSERT_FALSE(queue.push(cmd));
+    TEST_ASSERT_FALSE(queue.push(cmd));
+    TEST_ASSERT_EQUAL(2, queue.droppedCount());
+
+    // Draining one slot makes room for exactly one more
+    TestCommand out;
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_TRUE(queue.push(cmd));
+    TEST_ASSERT_FALSE(queue.push(cmd));
+}
+
+// Test: Slots are reused correctly over many laps of the ring
+void test_queue_wraps_around(void) {
+    CommandQueue<TestCommand, 4> queue;
+    TestCommand out;
+    for (uint32_t i = 0; i < 1000; i++) {
+        TestCommand cmd = {(uint8_t)(i & 0xFF), i};
+        TEST_ASSERT_TRUE(queue.push(cmd));
+        if (i % 3 == 2) {
+            // Let a small backlog build up, then drain it
+            while (queue.pop(out)) {}
+        }
+    }
+    TEST_ASSERT_EQUAL(0, queue.droppedCount());
+
+    // Item 999 is still pending; order is kept across the wrap
+    TestCommand last = {0, 0xFFFFFFFFUL};
+    TEST_ASSERT_TRUE(queue.push(last));
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL(999UL, out.value);
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL(0xFFFFFFFFUL, out.value);
+    TEST_ASSERT_FALSE(queue.pop(out));
+}
+
+// Test: A batch is queued whole, in order, or rejected whole when it does not fit
+void test_queue_batch_all_or_nothing(void) {
+    CommandQueue<TestCommand, 8> queue;
+    TestCommand batch[5];
+    for (uint8_t i = 0; i < 5; i++) {
+        batch[i].index = i;
+        batch[i].value = (uint32_t)(i + 10);
+    }
+
+    TestCommand single = {9, 9};
+    TEST_ASSERT_TRUE(queue.push(single));
+    TEST_ASSERT_TRUE(queue.pushBatch(batch, 5));
+
+    // 6 of 8 cells used: another batch of 5 is refused and leaves no partial entries
+    TEST_ASSERT_FALSE(queue.pushBatch(batch, 5));
+    TEST_ASSERT_EQUAL(5, queue.droppedCount());
+    TEST_ASSERT_FALSE(queue.pushBatch(batch, 9)); // Larger than the ring
+    TEST_ASSERT_EQUAL(14, queue.droppedCount());
+
+    TestCommand out;
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL(9, out.index);
+    for (uint8_t i = 0; i < 5; i++) {
+        TEST_ASSERT_TRUE(queue.pop(out));
+        TEST_ASSERT_EQUAL(i, out.index);
+        TEST_ASSERT_EQUAL(i + 10, out.value);
+    }
+    TEST_ASSERT_FALSE(queue.pop(out));
+
+    // Batches crossing the end of the ring keep their order
+    for (int lap = 0; lap < 10; lap++) {
+        TEST_ASSERT_TRUE(queue.pushBatch(batch, 5));
+        for (uint8_t i = 0; i < 5; i++) {
+            TEST_ASSERT_TRUE(queue.pop(out));
+            TEST_ASSERT_EQUAL(i, out.index);
+        }
+    }
+    TEST_ASSERT_TRUE(queue.pushBatch(batch, 0));
+    TEST_ASSERT_FALSE(queue.pop(out));
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_queue_fifo_order);
+    RUN_TEST(test_queue_full_rejects);
+    RUN_TEST(test_queue_wraps_around);
+    RUN_TEST(test_queue_batch_all_or_nothing);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
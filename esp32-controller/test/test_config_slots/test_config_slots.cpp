@@ -0,0 +1,184 @@
+/**
+ * @file test_config_slots.cpp
+ * @brief Unit tests for the A/B configuration slots
+ *
+ * Tests slot alternation, newest-generation selection and power loss at
+ * every byte offset of a save.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <string.h>
+#include <config_slots.h>
+
+// Shaped like the packed output state: state bits, brightness, intervals
+struct TestConfig {
+    uint32_t stateBits;
+    uint8_t brightness[16];
+    uint32_t intervals[16];
+    char name[21];
+};
+
+typedef ConfigSlots<class SimSlotStore, TestConfig> TestSlots;
+
+// Two raw slots; writes stop after writeBudget bytes to simulate a power cut
+class SimSlotStore {
+public:
+    SimSlotStore() : writeBudget(-1) {
+        memset(data, 0xFF, sizeof(data));
+        present[0] = present[1] = false;
+    }
+
+    bool read(uint8_t slot, void *dst, size_t length) {
+        if (!present[slot] || length != sizeof(TestSlots::Slot)) return false;
+        memcpy(dst, data[slot], length);
+        return true;
+    }
+
+    bool write(uint8_t slot, const void *src, size_t length) {
+        const uint8_t *bytes = (const uint8_t *)src;
+        present[slot] = true;
+        for (size_t i = 0; i < length; i++) {
+            if (writeBudget == 0) return false;
+            if (writeBudget > 0) writeBudget--;
+            data[slot][i] = bytes[i];
+        }
+        return true;
+    }
+
+    uint8_t data[2][sizeof(TestSlots::Slot)];
+    bool present[2];
+    long writeBudget;
+};
+
+static TestConfig makeConfig(uint32_t seed) {
+    TestConfig config;
+    memset(&config, 0, sizeof(config));
+    config.stateBits = seed * 0x9E3779B9UL;
+    for (int i = 0; i < 16; i++) {
+        config.brightness[i] = (uint8_t)(seed + i);
+        config.intervals[i] = seed * 100 + i;
+    }
+    strcpy(config.name, seed % 2 ? "Station" : "Yard");
+    return config;
+}
+
+// Test: Empty store has no config; a save loads back as generation 1
+void test_slots_empty_then_saved(void) {
+    SimSlotStore store;
+    TestSlots slots(store);
+    TestConfig loaded;
+    TEST_ASSERT_FALSE(slots.load(loaded));
+
+    TestConfig config = makeConfig(1);
+    TEST_ASSERT_TRUE(slots.save(config));
+
+    TestSlots reboot(store);
+    TEST_ASSERT_TRUE(reboot.load(loaded));
+    TEST_ASSERT_EQUAL(0, memcmp(&config, &loaded, sizeof(config)));
+    TEST_ASSERT_EQUAL(1, reboot.generation());
+}
+
+// Test: Saves alternate between slots and boot picks the newest
+void test_slots_alternate_and_pick_newest(void) {
+    SimSlotStore store;
+    TestSlots slots(store);
+    for (uint32_t i = 1; i <= 5; i++) {
+        TestConfig config = makeConfig(i);
+        TEST_ASSERT_TRUE(slots.save(config));
+        TEST_ASSERT_EQUAL((i - 1) % 2, slots.activeSlot());
+    }
+
+    TestSlots reboot(store);
+    TestConfig loaded;
+    TEST_ASSERT_TRUE(reboot.load(loaded));
+    TestConfig newest = makeConfig(5);
+    TEST_ASSERT_EQUAL(0, memcmp(&newest, &loaded, sizeof(loaded)));
+    TEST_ASSERT_EQUAL(5, reboot.generation());
+
+    // The next save overwrites the older slot, not the active one
+    TEST_ASSERT_TRUE(reboot.save(makeConfig(6)));
+    TEST_ASSERT_EQUAL(1, reboot.activeSlot());
+}
+
+// Test: Power lost at every byte offset of a save leaves the old or the new config, never a mix
+void test_slots_power_cut_at_every_byte(void) {
+    TestConfig v2 = makeConfig(2);
+    TestConfig v3 = makeConfig(3);
+
+    for (long cut = 0; cut <= (long)sizeof(TestSlots::Slot); cut++) {
+        SimSlotStore store;
+        TestSlots slots(store);
+        TEST_ASSERT_TRUE(slots.save(makeConfig(1)));
+        TEST_ASSERT_TRUE(slots.save(v2));
+
+        // v3 overwrites the slot still holding v1
+        store.writeBudget = cut;
+        bool saved = slots.save(v3);
+        store.writeBudget = -1;
+
+        TestSlots reboot(store);
+        TestConfig loaded;
+        TEST_ASSERT_TRUE(reboot.load(loaded));
+        if (saved) {
+            TEST_ASSERT_EQUAL(0, memcmp(&v3, &loaded, sizeof(loaded)));
+        } else {
+            TEST_ASSERT_EQUAL(0, memcmp(&v2, &loaded, sizeof(loaded)));
+            TEST_ASSERT_EQUAL(2, reboot.generation());
+        }
+    }
+}
+
+// Test: Generation comparison survives the 32-bit wrap
+void test_slots_generation_wraps(void) {
+    SimSlotStore store;
+    TestSlots slots(store);
+    TEST_ASSERT_TRUE(slots.save(makeConfig(1)));
+
+    // Forge slot 0 at generation 0xFFFFFFFF, then let the next save wrap to 0
+    TestSlots::Slot forged;
+    memcpy(&forged, store.data[0], sizeof(forged));
+    forged.generation = 0xFFFFFFFFUL;
+    forged.crc = crc32(&forged, offsetof(TestSlots::Slot, crc));
+    memcpy(store.data[0], &forged, sizeof(forged));
+
+    TestSlots reboot(store);
+    TestConfig loaded;
+    TEST_ASSERT_TRUE(reboot.load(loaded));
+    TEST_ASSERT_TRUE(reboot.save(makeConfig(7)));
+    TEST_ASSERT_EQUAL(0, reboot.generation());
+
+    TestSlots again(store);
+    TEST_ASSERT_TRUE(again.load(loaded));
+    TestConfig expected = makeConfig(7);
+    TEST_ASSERT_EQUAL(0, memcmp(&expected, &loaded, sizeof(loaded)));
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_slots_empty_then_saved);
+    RUN_TEST(test_slots_alternate_and_pick_newest);
+    RUN_TEST(test_slots_power_cut_at_every_byte);
+    RUN_TEST(test_slots_generation_wraps);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
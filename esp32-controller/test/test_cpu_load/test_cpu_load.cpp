@@ -0,0 +1,134 @@
+/**
+ * @file test_cpu_load.cpp
+ * @brief Unit tests for per-core CPU load and per-task CPU share
+ *
+ * Feeds made-up idle and run time counters: load per window, counter
+ * wrap-around, tasks appearing and disappearing, and the JSON for the
+ * telemetry stream.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <string.h>
+#include <cpu_load.h>
+
+#define WINDOW 1000000UL
+
+// Test: Load is the part of the window each core was not idle
+void test_core_load_per_window(void) {
+    CoreLoad<2> cores;
+    TEST_ASSERT_FALSE(cores.measured());
+
+    cores.addIdle(0, 750000);
+    cores.addIdle(1, 100000);
+    cores.addIdle(1, 100000);
+    cores.sample(WINDOW);
+    TEST_ASSERT_TRUE(cores.measured());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 25.0f, cores.load(0));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 80.0f, cores.load(1));
+
+    // Only the new idle time counts in the next window; more idle than window clamps to 0 %
+    cores.addIdle(0, 2 * WINDOW);
+    cores.sample(WINDOW);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, cores.load(0));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 100.0f, cores.load(1));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, cores.load(2));
+}
+
+// Test: Idle counters that wrap between samples give the right load
+void test_core_load_counter_wrap(void) {
+    CoreLoad<1> cores;
+    cores.addIdle(0, 0xFFFFFFFFUL - 100);
+    cores.sample(0xFFFFFFFFUL);
+    cores.addIdle(0, 600000); // Wraps
+    cores.sample(WINDOW);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 40.0f, cores.load(0));
+}
+
+// Test: Task shares come from run time deltas; new tasks start at 0, gone tasks are dropped
+void test_task_load_shares(void) {
+    TaskLoad<4> tasks;
+    TaskRunTime first[] = {
+        {1, "loopTask", 1, 5000000},
+        {2, "async_tcp", -1, 0xFFFFFFF0UL},
+        {3, "wifi", 0, 100},
+    };
+    tasks.sample(first, 3, WINDOW);
+    TEST_ASSERT_EQUAL(3, tasks.count());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, tasks.load(0));
+
+    TaskRunTime second[] = {
+        {1, "loopTask", 1, 5900000},
+        {2, "async_tcp", -1, 49984},      // Wrapped: 50000 us
+        {4, "effects", 1, 300000},
+    };
+    tasks.sample(second, 3, WINDOW);
+    TEST_ASSERT_EQUAL(3, tasks.count());
+    TEST_ASSERT_EQUAL_STRING("loopTask", tasks.name(0));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 90.0f, tasks.load(0));
+    TEST_ASSERT_EQUAL_STRING("async_tcp", tasks.name(1));
+    TEST_ASSERT_EQUAL(-1, tasks.core(1));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 5.0f, tasks.load(1));
+    TEST_ASSERT_EQUAL_STRING("effects", tasks.name(2));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, tasks.load(2));
+
+    TaskRunTime third[] = {
+        {4, "effects", 1, 320000},
+    };
+    tasks.sample(third, 1, WINDOW);
+    TEST_ASSERT_EQUAL(1, tasks.count());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 2.0f, tasks.load(0));
+}
+
+// Test: More tasks than room keeps the first ones; long names are cut; JSON lists every kept task
+void test_task_load_limits_and_json(void) {
+    TaskLoad<2> tasks;
+    TaskRunTime list[] = {
+        {1, "a_task_name_longer_than_fifteen", 0, 0},
+        {2, "IDLE1", 1, 0},
+        {3, "dropped", 0, 0},
+    };
+    tasks.sample(list, 3, WINDOW);
+    list[0].runTime = 125000;
+    list[1].runTime = 875000;
+    tasks.sample(list, 3, WINDOW);
+    TEST_ASSERT_EQUAL(2, tasks.count());
+    TEST_ASSERT_EQUAL(TASK_LOAD_NAME_LEN - 1, strlen(tasks.name(0)));
+
+    char buffer[256];
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject();
+    tasks.write(json, "tasks");
+    json.endObject();
+    TEST_ASSERT_TRUE(json.ok());
+    TEST_ASSERT_EQUAL_STRING("{\"tasks\":[[\"a_task_name_lon\",0,12.5],[\"IDLE1\",1,87.5]]}", buffer);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_core_load_per_window);
+    RUN_TEST(test_core_load_counter_wrap);
+    RUN_TEST(test_task_load_shares);
+    RUN_TEST(test_task_load_limits_and_json);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
@@ -0,0 +1,354 @@
+/**
+ * @file test_effect_scaling.cpp
+ * @brief Scaling benchmark: effect engine and status messages at 16-1024 outputs
+ *
+ * Sweeps the output count from 16 to 1024 for four effect mixes (solid,
+ * blink, chase in groups of 8, and a third of each) and measures per size:
+ *
+ *   tick      host time of one OutputCore::step() at a 1 ms tick (avg/max
+ *             over SCALING_SECONDS of virtual time) and PWM writes per second
+ *   status    time and bytes of a JSON snapshot as the ESP32 sends it
+ *             (JsonWriter, same fields as addOutputStatus()), of a JSON delta
+ *             for one output, and of a binary snapshot (status_frame.h, only
+ *             up to its 32 outputs)
+ *
+ * Rows go to SCALING_CSV natively and to the test log on the board:
+ *
+ *   outputs,mix,tick_avg_ns,tick_max_ns,writes_per_s,snapshot_json_ns,snapshot_json_bytes,
+ *   delta_json_bytes,snapshot_binary_ns,snapshot_binary_bytes
+ *
+ * Timings are host numbers; compare sizes and mixes against each other.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <json_writer.h>
+#include <output_core.h>
+#include <status_frame.h>
+
+#ifdef NATIVE_BUILD
+#include <chrono>
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#else
+static uint64_t nowNs() {
+    return (uint64_t)micros() * 1000;
+}
+#endif
+
+#ifndef SCALING_SECONDS
+#define SCALING_SECONDS 10                  // Virtual run time per size and mix
+#endif
+#ifndef SCALING_CSV
+#define SCALING_CSV "effect_scaling.csv"
+#endif
+
+#define SCALING_MAX_OUTPUTS 1024
+#define CHASE_MEMBERS 8                     // Outputs per chasing group
+#define NAME_LENGTH 20                      // OUTPUT_NAME_MAX_LEN
+#define SERIALIZE_ROUNDS 200
+#define JSON_BYTES_PER_OUTPUT 96            // Generous upper bound for one output object
+
+enum ScalingMix {
+    MIX_SOLID,
+    MIX_BLINK,
+    MIX_CHASE,
+    MIX_MIXED
+};
+
+static const char *MIX_NAMES[] = {"solid", "blink", "chase", "mixed"};
+
+struct ScalingRow {
+    uint16_t outputs;
+    ScalingMix mix;
+    uint64_t tickAvgNs;
+    uint64_t tickMaxNs;
+    uint32_t writesPerSecond;
+    uint64_t snapshotJsonNs;
+    size_t snapshotJsonBytes;
+    size_t deltaJsonBytes;
+    uint64_t snapshotBinaryNs;      // 0 = not encodable
+    size_t snapshotBinaryBytes;
+};
+
+// PWM sink; chase steps move the lit output within the group, as on the ESP8266
+struct ScalingPlatform {
+    static uint8_t level[SCALING_MAX_OUTPUTS];
+    static uint8_t chaseStep[SCALING_MAX_OUTPUTS / CHASE_MEMBERS];
+    static uint32_t groupInterval[SCALING_MAX_OUTPUTS / CHASE_MEMBERS];
+    static uint32_t writes;
+
+    static void writeOutput(uint16_t index, uint8_t duty) {
+        level[index] = duty;
+        writes++;
+    }
+
+    static uint32_t stepGroup(uint8_t slot) {
+        uint16_t base = slot * CHASE_MEMBERS;
+        writeOutput(base + chaseStep[slot], 0);
+        chaseStep[slot] = (chaseStep[slot] + 1) % CHASE_MEMBERS;
+        writeOutput(base + chaseStep[slot], 255);
+        return groupInterval[slot];
+    }
+};
+
+uint8_t ScalingPlatform::level[SCALING_MAX_OUTPUTS];
+uint8_t ScalingPlatform::chaseStep[SCALING_MAX_OUTPUTS / CHASE_MEMBERS];
+uint32_t ScalingPlatform::groupInterval[SCALING_MAX_OUTPUTS / CHASE_MEMBERS];
+uint32_t ScalingPlatform::writes;
+
+static char names[SCALING_MAX_OUTPUTS][NAME_LENGTH + 1];
+static char jsonBuffer[SCALING_MAX_OUTPUTS * JSON_BYTES_PER_OUTPUT + 256];
+static FILE *csv = nullptr;
+
+static uint32_t blinkIntervalMs(uint16_t index) {
+    return 20 + (index * 37u) % 480;
+}
+
+// Which effect an output runs in a mix: 0 solid, 1 blink, 2 chase
+static uint8_t effectOf(ScalingMix mix, uint16_t index) {
+    switch (mix) {
+        case MIX_SOLID: return 0;
+        case MIX_BLINK: return 1;
+        case MIX_CHASE: return 2;
+        default: return (index / CHASE_MEMBERS) % 3; // Thirds, in whole groups
+    }
+}
+
+// Snapshot as sendSnapshot() writes it for JSON clients
+template <class Core>
+static size_t writeSnapshot(JsonWriter &json, const Core &core, uint16_t outputs) {
+    json.reset();
+    json.beginObject();
+    json.add("type", "snapshot");
+    json.add("seq", 1234UL);
+    json.add("uptime", 3600000UL);
+    json.add("freeHeap", 180000UL);
+    json.add("apClients", 0);
+    json.add("wsClients", 2);
+    json.add("cpuLoad0", 12.5f, 1);
+    json.add("cpuLoad1", 3.0f, 1);
+    json.beginArray("outputs");
+    for (uint16_t i = 0; i < outputs; i++) {
+        json.beginObject();
+        json.add("pin", (int)i);
+        json.add("active", core.state[i]);
+        json.add("brightness", (int)(core.duty[i] * 100 / 255));
+        json.add("name", names[i]);
+        json.add("interval", (unsigned long)core.interval[i]);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    return json.ok() ? json.length() : 0;
+}
+
+template <class Core>
+static size_t writeDelta(JsonWriter &json, const Core &core, uint16_t index) {
+    json.reset();
+    json.beginObject();
+    json.add("type", "delta");
+    json.add("seq", 1235UL);
+    json.beginArray("outputs");
+    json.beginObject();
+    json.add("pin", (int)index);
+    json.add("active", core.state[index]);
+    json.add("brightness", (int)(core.duty[index] * 100 / 255));
+    json.add("name", names[index]);
+    json.add("interval", (unsigned long)core.interval[index]);
+    json.endObject();
+    json.endArray();
+    json.endObject();
+    return json.ok() ? json.length() : 0;
+}
+
+// Binary snapshot where the frame can address every output (outputMask is 32 bits)
+template <uint16_t Outputs, bool Encodable = (Outputs <= 32)>
+struct BinarySnapshot {
+    template <class Core>
+    static void measure(const Core &, ScalingRow &) {}
+};
+
+template <uint16_t Outputs>
+struct BinarySnapshot<Outputs, true> {
+    template <class Core>
+    static void measure(const Core &core, ScalingRow &row) {
+        static StatusFrameWriter<(Outputs <= 32 ? Outputs : 32), NAME_LENGTH> frame;
+        StatusFrameOutput frameOutputs[Outputs];
+        uint64_t start = nowNs();
+        for (int round = 0; round < SERIALIZE_ROUNDS; round++) {
+            for (uint16_t i = 0; i < Outputs; i++) {
+                frameOutputs[i].active = core.state[i];
+                frameOutputs[i].brightness = core.duty[i] * 100 / 255;
+                frameOutputs[i].interval = core.interval[i];
+                frameOutputs[i].name = names[i];
+            }
+            row.snapshotBinaryBytes = frame.snapshot(1234, frameOutputs);
+        }
+        row.snapshotBinaryNs = (nowNs() - start) / SERIALIZE_ROUNDS;
+        if (row.snapshotBinaryNs == 0) row.snapshotBinaryNs = 1;
+    }
+};
+
+template <uint16_t Outputs>
+ScalingRow runScaling(ScalingMix mix) {
+    const uint8_t Groups = Outputs / CHASE_MEMBERS;
+    typedef OutputCore<Outputs, Outputs / CHASE_MEMBERS, ScalingPlatform> Core;
+    static Core core;
+    core.reset();
+
+    ScalingRow row;
+    memset(&row, 0, sizeof(row));
+    row.outputs = Outputs;
+    row.mix = mix;
+
+    for (uint16_t i = 0; i < Outputs; i++) {
+        snprintf(names[i], sizeof(names[i]), "Signal %u", i);
+        core.set(i, true, 255, 0);
+        uint8_t effect = effectOf(mix, i);
+        if (effect == 1) {
+            core.setInterval(i, blinkIntervalMs(i), 0);
+        } else if (effect == 2) {
+            core.group[i] = (int8_t)(i / CHASE_MEMBERS);
+        }
+    }
+    for (uint8_t slot = 0; slot < Groups; slot++) {
+        ScalingPlatform::chaseStep[slot] = 0;
+        ScalingPlatform::groupInterval[slot] = 80 + (slot * 45u) % 400;
+        if (effectOf(mix, slot * CHASE_MEMBERS) == 2) {
+            core.scheduleGroup(slot, ScalingPlatform::groupInterval[slot]);
+        }
+    }
+
+    // Effect ticks
+    ScalingPlatform::writes = 0;
+    uint64_t totalNs = 0;
+    const uint32_t ticks = SCALING_SECONDS * 1000;
+    for (uint32_t ms = 1; ms <= ticks; ms++) {
+        uint64_t start = nowNs();
+        core.step(ms);
+        uint64_t elapsed = nowNs() - start;
+        totalNs += elapsed;
+        if (elapsed > row.tickMaxNs) row.tickMaxNs = elapsed;
+    }
+    row.tickAvgNs = totalNs / ticks;
+    row.writesPerSecond = ScalingPlatform::writes / SCALING_SECONDS;
+
+    // Status messages
+    JsonWriter json(jsonBuffer, sizeof(jsonBuffer));
+    uint64_t start = nowNs();
+    for (int round = 0; round < SERIALIZE_ROUNDS; round++) {
+        row.snapshotJsonBytes = writeSnapshot(json, core, Outputs);
+    }
+    row.snapshotJsonNs = (nowNs() - start) / SERIALIZE_ROUNDS;
+    row.deltaJsonBytes = writeDelta(json, core, Outputs - 1);
+    BinarySnapshot<Outputs>::measure(core, row);
+    return row;
+}
+
+static void reportRow(const ScalingRow &row) {
+    char line[200];
+    char binaryNs[24] = "";
+    char binaryBytes[24] = "";
+    if (row.snapshotBinaryNs > 0) {
+        snprintf(binaryNs, sizeof(binaryNs), "%llu", (unsigned long long)row.snapshotBinaryNs);
+        snprintf(binaryBytes, sizeof(binaryBytes), "%lu", (unsigned long)row.snapshotBinaryBytes);
+    }
+    snprintf(line, sizeof(line), "%u,%s,%llu,%llu,%lu,%llu,%lu,%lu,%s,%s", row.outputs, MIX_NAMES[row.mix],
+             (unsigned long long)row.tickAvgNs, (unsigned long long)row.tickMaxNs, (unsigned long)row.writesPerSecond,
+             (unsigned long long)row.snapshotJsonNs, (unsigned long)row.snapshotJsonBytes,
+             (unsigned long)row.deltaJsonBytes, binaryNs, binaryBytes);
+    TEST_MESSAGE(line);
+    if (csv) fprintf(csv, "%s\n", line);
+}
+
+// One row per size; checks what does not depend on the host
+static void sweep(ScalingMix mix) {
+    ScalingRow rows[] = {
+        runScaling<16>(mix), runScaling<32>(mix), runScaling<64>(mix), runScaling<128>(mix),
+        runScaling<256>(mix), runScaling<512>(mix), runScaling<1024>(mix),
+    };
+    for (size_t r = 0; r < sizeof(rows) / sizeof(rows[0]); r++) {
+        const ScalingRow &row = rows[r];
+        reportRow(row);
+
+        // Every snapshot fits and grows linearly with the output count
+        TEST_ASSERT_TRUE(row.snapshotJsonBytes > 0);
+        TEST_ASSERT_TRUE(row.snapshotJsonBytes <= (size_t)row.outputs * JSON_BYTES_PER_OUTPUT + 256);
+        TEST_ASSERT_TRUE(row.deltaJsonBytes > 0 && row.deltaJsonBytes < 160);
+        TEST_ASSERT_EQUAL(row.outputs <= 32, row.snapshotBinaryNs > 0);
+        if (r > 0) {
+            TEST_ASSERT_TRUE(row.snapshotJsonBytes > rows[r - 1].snapshotJsonBytes);
+        }
+
+        // Solid outputs are never stepped; effects write in proportion to their count
+        if (mix == MIX_SOLID) {
+            TEST_ASSERT_EQUAL(0, row.writesPerSecond);
+        } else if (r > 0) {
+            TEST_ASSERT_TRUE(row.writesPerSecond > rows[r - 1].writesPerSecond);
+        }
+    }
+}
+
+// Test: All outputs on and steady
+void test_scaling_solid(void) {
+    sweep(MIX_SOLID);
+}
+
+// Test: All outputs blinking at 20-499 ms
+void test_scaling_blink(void) {
+    sweep(MIX_BLINK);
+}
+
+// Test: All outputs in chasing groups of 8
+void test_scaling_chase(void) {
+    sweep(MIX_CHASE);
+}
+
+// Test: A third of the outputs of each kind
+void test_scaling_mixed(void) {
+    sweep(MIX_MIXED);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+#ifdef NATIVE_BUILD
+    csv = fopen(SCALING_CSV, "w");
+#endif
+    if (csv) {
+        fprintf(csv, "outputs,mix,tick_avg_ns,tick_max_ns,writes_per_s,snapshot_json_ns,snapshot_json_bytes,"
+                     "delta_json_bytes,snapshot_binary_ns,snapshot_binary_bytes\n");
+    }
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_scaling_solid);
+    RUN_TEST(test_scaling_blink);
+    RUN_TEST(test_scaling_chase);
+    RUN_TEST(test_scaling_mixed);
+
+    int failures = UNITY_END();
+    if (csv) fclose(csv);
+    return failures;
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
@@ -0,0 +1,360 @@
+/**
+ * @file test_effect_timing.cpp
+ * @brief Virtual-time timing benchmark for the blink and chase engine
+ *
+ * Runs OutputCore against a virtual microsecond clock for an hour of
+ * simulated time and records when every blink toggle and chase step is
+ * written. Two schedulers drive the ticks:
+ *
+ *   task      ESP32 effect task: wakes every tick with some latency; the
+ *             network runs on the other core and cannot delay it
+ *   between   ESP8266 Ticker: the tick runs between loop() passes, so
+ *             network work inside a pass delays it
+ *
+ * Per scenario it reports the period error (time between two toggles of
+ * an output minus its interval), phase drift after the hour (last toggle
+ * against first toggle plus whole periods), worst and p99 step latency
+ * (tick due to step finished) and periods missed by more than a full
+ * interval, and asserts the bounds the engine guarantees. Extra load can
+ * be benchmarked without editing the file:
+ *
+ *   PLATFORMIO_BUILD_FLAGS="-DTIMING_OUTPUTS=256 -DTIMING_GROUPS=16 -DTIMING_REQUEST_US=8000" \
+ *       pio test -e native -f test_effect_timing
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <output_core.h>
+
+#ifndef TIMING_SECONDS
+#ifdef NATIVE_BUILD
+#define TIMING_SECONDS 3600                 // One hour of virtual time per scenario
+#else
+#define TIMING_SECONDS 60
+#endif
+#endif
+
+#define TIMING_MAX_OUTPUTS 1024
+#define TIMING_MAX_GROUPS 64
+#define GROUP_MEMBERS 4                     // Outputs per chasing group
+#define LATENCY_BUCKET_US 10                // Step latency histogram resolution
+#define LATENCY_BUCKETS 20000               // ...up to 200 ms
+
+struct TimingLoad {
+    const char *name;
+    bool task;                  // Effect task (ESP32) or tick between loop passes (ESP8266)
+    uint32_t tickUs;            // Effect tick period
+    uint32_t wakeJitterUs;      // task: wake-up latency, uniform 0..n
+    uint32_t passUs;            // between: loop() pass without network work
+    uint32_t requestEvery;      // between: one pass in this many (on average) serves a request
+    uint32_t requestUs;         // ...costing up to this long (uniform)
+    uint32_t writeUs;           // One PWM write
+};
+
+// Toggle times of one output or group
+struct ToggleTrack {
+    uint32_t periodUs;
+    uint32_t count;
+    uint64_t firstUs;
+    uint64_t lastUs;
+    int64_t maxErrorUs;         // Largest |period error|
+    int64_t minErrorUs;         // Most negative period error (a catch-up burst)
+    int64_t errorSumUs;
+    uint32_t missed;            // Periods late by a full interval or more
+
+    void reset(uint32_t ms) {
+        memset(this, 0, sizeof(*this));
+        periodUs = ms * 1000;
+    }
+
+    void record(uint64_t nowUs) {
+        if (count > 0) {
+            int64_t error = (int64_t)(nowUs - lastUs) - periodUs;
+            errorSumUs += error;
+            if (llabs(error) > maxErrorUs) maxErrorUs = llabs(error);
+            if (error < minErrorUs) minErrorUs = error;
+            if (error >= (int64_t)periodUs) missed++;
+        } else {
+            firstUs = nowUs;
+        }
+        lastUs = nowUs;
+        count++;
+    }
+
+    // Last toggle against the first plus whole periods
+    int64_t driftUs() const {
+        return count > 1 ? (int64_t)(lastUs - firstUs) - (int64_t)(count - 1) * periodUs : 0;
+    }
+};
+
+// Virtual clock and PWM: every write costs writeUs and is timestamped
+struct TimingPlatform {
+    static uint64_t nowUs;
+    static uint32_t writeUs;
+    static bool recording;
+    static ToggleTrack outputs[TIMING_MAX_OUTPUTS];
+    static ToggleTrack groups[TIMING_MAX_GROUPS];
+    static uint8_t groupStep[TIMING_MAX_GROUPS];
+
+    static void writeOutput(uint16_t index, uint8_t duty) {
+        nowUs += writeUs;
+        if (recording) outputs[index].record(nowUs);
+    }
+
+    // Chase: previous member off, next member on, like the ESP8266 groups
+    static uint32_t stepGroup(uint8_t slot) {
+        groupStep[slot] = (groupStep[slot] + 1) % GROUP_MEMBERS;
+        nowUs += 2 * writeUs;
+        groups[slot].record(nowUs);
+        return groups[slot].periodUs / 1000;
+    }
+};
+
+uint64_t TimingPlatform::nowUs;
+uint32_t TimingPlatform::writeUs;
+bool TimingPlatform::recording;
+ToggleTrack TimingPlatform::outputs[TIMING_MAX_OUTPUTS];
+ToggleTrack TimingPlatform::groups[TIMING_MAX_GROUPS];
+uint8_t TimingPlatform::groupStep[TIMING_MAX_GROUPS];
+
+// Deterministic load: the same run every time
+static uint32_t rngState;
+
+static uint32_t nextRandom(uint32_t bound) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return bound > 0 ? rngState % bound : 0;
+}
+
+struct TimingReport {
+    uint16_t outputs;
+    uint32_t toggles;
+    double meanErrorUs;
+    int64_t maxErrorUs;
+    int64_t minErrorUs;
+    int64_t maxDriftUs;
+    uint32_t stepP99Us;
+    uint32_t stepMaxUs;
+    uint32_t missed;
+};
+
+static uint32_t latencyHistogram[LATENCY_BUCKETS];
+
+static void recordStepLatency(uint64_t latencyUs, uint32_t &maxUs) {
+    if (latencyUs > maxUs) maxUs = (uint32_t)latencyUs;
+    uint64_t bucket = latencyUs / LATENCY_BUCKET_US;
+    latencyHistogram[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+}
+
+static uint32_t latencyPercentile(uint64_t steps, double fraction) {
+    uint64_t target = (uint64_t)(steps * fraction);
+    uint64_t seen = 0;
+    for (uint32_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        seen += latencyHistogram[bucket];
+        if (seen > target) return (bucket + 1) * LATENCY_BUCKET_US;
+    }
+    return LATENCY_BUCKETS * LATENCY_BUCKET_US;
+}
+
+// Blink intervals 20-499 ms, spread so outputs rarely share a deadline
+static uint32_t blinkIntervalMs(uint16_t index) {
+    return 20 + (index * 37u) % 480;
+}
+
+static uint32_t groupIntervalMs(uint16_t slot) {
+    return 80 + (slot * 45u) % 400;
+}
+
+template <uint16_t Outputs, uint8_t Groups>
+TimingReport runTiming(const TimingLoad &load) {
+    typedef OutputCore<Outputs, Groups, TimingPlatform> Core;
+    static Core core;
+    core.reset();
+    rngState = 0x52483332;
+    memset(latencyHistogram, 0, sizeof(latencyHistogram));
+
+    TimingPlatform::nowUs = 0;
+    TimingPlatform::writeUs = load.writeUs;
+    TimingPlatform::recording = false;
+
+    // The first groups * GROUP_MEMBERS outputs chase, the rest blink on their own
+    uint16_t members = (uint16_t)(Groups * GROUP_MEMBERS < Outputs ? Groups * GROUP_MEMBERS : Outputs);
+    for (uint16_t i = 0; i < Outputs; i++) {
+        TimingPlatform::outputs[i].reset(blinkIntervalMs(i));
+        core.set(i, true, 255, 0);
+        if (i < members) {
+            core.group[i] = (int8_t)(i / GROUP_MEMBERS);
+            core.cancel(i);
+        } else {
+            core.setInterval(i, blinkIntervalMs(i), 0);
+        }
+    }
+    for (uint8_t slot = 0; slot < Groups; slot++) {
+        TimingPlatform::groups[slot].reset(groupIntervalMs(slot));
+        TimingPlatform::groupStep[slot] = 0;
+        core.scheduleGroup(slot, groupIntervalMs(slot));
+    }
+    TimingPlatform::nowUs = 0;
+    TimingPlatform::recording = true;
+
+    const uint64_t endUs = (uint64_t)TIMING_SECONDS * 1000000ULL;
+    uint64_t steps = 0;
+    uint32_t stepMaxUs = 0;
+
+    if (load.task) {
+        // vTaskDelayUntil: a late wake-up is followed by back-to-back catch-up ticks
+        uint64_t finishedUs = 0;
+        for (uint64_t dueUs = load.tickUs; dueUs < endUs; dueUs += load.tickUs) {
+            uint64_t wakeUs = dueUs + nextRandom(load.wakeJitterUs + 1);
+            TimingPlatform::nowUs = wakeUs > finishedUs ? wakeUs : finishedUs;
+            core.step((uint32_t)(TimingPlatform::nowUs / 1000));
+            finishedUs = TimingPlatform::nowUs;
+            recordStepLatency(finishedUs - dueUs, stepMaxUs);
+            steps++;
+        }
+    } else {
+        // Ticker: fires once after the pass it fell into, missed periods are skipped
+        uint64_t dueUs = load.tickUs;
+        while (TimingPlatform::nowUs < endUs) {
+            TimingPlatform::nowUs += load.passUs;
+            if (load.requestEvery > 0 && nextRandom(load.requestEvery) == 0) {
+                TimingPlatform::nowUs += nextRandom(load.requestUs + 1);
+            }
+            if (TimingPlatform::nowUs < dueUs) continue;
+
+            core.step((uint32_t)(TimingPlatform::nowUs / 1000));
+            recordStepLatency(TimingPlatform::nowUs - dueUs, stepMaxUs);
+            steps++;
+            while (dueUs <= TimingPlatform::nowUs) dueUs += load.tickUs;
+        }
+    }
+
+    TimingReport report;
+    memset(&report, 0, sizeof(report));
+    report.outputs = Outputs;
+    report.stepMaxUs = stepMaxUs;
+    report.stepP99Us = latencyPercentile(steps, 0.99);
+    report.minErrorUs = 0;
+
+    int64_t errorSum = 0;
+    uint32_t periods = 0;
+    for (uint16_t n = 0; n < Outputs + Groups; n++) {
+        const ToggleTrack &track = n < Outputs ? TimingPlatform::outputs[n] : TimingPlatform::groups[n - Outputs];
+        if (n < members) continue; // Written by their group, tracked there
+        report.toggles += track.count;
+        errorSum += track.errorSumUs;
+        periods += track.count > 0 ? track.count - 1 : 0;
+        if (track.maxErrorUs > report.maxErrorUs) report.maxErrorUs = track.maxErrorUs;
+        if (track.minErrorUs < report.minErrorUs) report.minErrorUs = track.minErrorUs;
+        if (llabs(track.driftUs()) > report.maxDriftUs) report.maxDriftUs = llabs(track.driftUs());
+        report.missed += track.missed;
+    }
+    report.meanErrorUs = periods > 0 ? (double)errorSum / periods : 0;
+
+    char line[220];
+    snprintf(line, sizeof(line),
+             "%-22s %4u out %2u grp %2lums tick: %9lu toggles | period err mean %+6.2f max %6ld us"
+             " | drift max %6ld us | step p99 %6lu max %6lu us | missed %lu",
+             load.name, Outputs, Groups, (unsigned long)(load.tickUs / 1000), (unsigned long)report.toggles, report.meanErrorUs,
+             (long)report.maxErrorUs, (long)report.maxDriftUs, (unsigned long)report.stepP99Us,
+             (unsigned long)report.stepMaxUs, (unsigned long)report.missed);
+    TEST_MESSAGE(line);
+    return report;
+}
+
+// What the engine guarantees whatever the load: toggles stay on their
+// deadline grid, so period error and drift never exceed one tick plus the
+// worst step latency, and a late toggle is never followed by a catch-up burst
+static void assertPhaseLocked(const TimingReport &report, const TimingLoad &load) {
+    int64_t bound = (int64_t)report.stepMaxUs + load.tickUs;
+    TEST_ASSERT_TRUE(report.toggles > 0);
+    TEST_ASSERT_TRUE(report.minErrorUs >= -bound);
+    if (report.missed == 0) {
+        TEST_ASSERT_TRUE(report.maxErrorUs <= bound);
+        TEST_ASSERT_TRUE(report.maxDriftUs <= bound);
+    }
+}
+
+// Test: ESP32 layout, effect task with wake-up jitter; every step finishes within its tick
+void test_esp32_effect_task(void) {
+    TimingLoad load = {"esp32 effect task", true, 1000, 80, 0, 0, 0, 2};
+    TimingReport report = runTiming<16, 0>(load);
+    assertPhaseLocked(report, load);
+    TEST_ASSERT_EQUAL(0, report.missed);
+    TEST_ASSERT_TRUE(report.stepMaxUs < load.tickUs);
+}
+
+// Test: ESP8266 layout, tick between loop passes that serve requests of up to 5 ms
+void test_esp8266_between_passes(void) {
+    TimingLoad load = {"esp8266 ticker", false, 1000, 0, 150, 20, 5000, 4};
+    TimingReport report = runTiming<7, 4>(load);
+    assertPhaseLocked(report, load);
+    TEST_ASSERT_EQUAL(0, report.missed);
+    TEST_ASSERT_TRUE(report.stepMaxUs <= load.passUs + load.requestUs + load.tickUs);
+}
+
+// Test: Many outputs and groups; simultaneous deadlines stretch one step, not the grid
+void test_scaled_outputs(void) {
+    TimingLoad load = {"scaled effect task", true, 1000, 80, 0, 0, 0, 2};
+    TimingReport report = runTiming<256, 8>(load);
+    assertPhaseLocked(report, load);
+    TEST_ASSERT_EQUAL(0, report.missed);
+}
+
+// Test: Network stalls longer than a blink interval miss periods and resync without a burst
+void test_stalls_resync(void) {
+    TimingLoad load = {"esp8266 stalls", false, 1000, 0, 150, 5000, 120000, 4};
+    TimingReport report = runTiming<7, 4>(load);
+    assertPhaseLocked(report, load);
+    TEST_ASSERT_TRUE(report.missed > 0);
+}
+
+#ifdef TIMING_OUTPUTS
+#ifndef TIMING_GROUPS
+#define TIMING_GROUPS 0
+#endif
+#ifndef TIMING_REQUEST_US
+#define TIMING_REQUEST_US 5000
+#endif
+// Test: Load given with -D on the command line (see the file header)
+void test_custom_load(void) {
+    TimingLoad load = {"custom between passes", false, 1000, 0, 150, 20, TIMING_REQUEST_US, 4};
+    assertPhaseLocked(runTiming<TIMING_OUTPUTS, TIMING_GROUPS>(load), load);
+}
+#endif
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_esp32_effect_task);
+    RUN_TEST(test_esp8266_between_passes);
+    RUN_TEST(test_scaled_outputs);
+    RUN_TEST(test_stalls_resync);
+#ifdef TIMING_OUTPUTS
+    RUN_TEST(test_custom_load);
+#endif
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
@@ -0,0 +1,135 @@
+/**
+ * @file test_effect_scheduler.cpp
+ * @brief Unit tests for the deadline-ordered effect scheduler
+ *
+ * Tests heap ordering, rescheduling, cancellation and millis() rollover.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <effect_scheduler.h>
+
+// Test: Entries come out in deadline order, only once due
+void test_scheduler_pops_in_deadline_order(void) {
+    EffectScheduler<16> scheduler;
+    scheduler.schedule(3, 300);
+    scheduler.schedule(1, 100);
+    scheduler.schedule(2, 200);
+
+    uint16_t id;
+    uint32_t deadline;
+
+    // Nothing is due yet
+    TEST_ASSERT_FALSE(scheduler.popDue(99, id, deadline));
+    TEST_ASSERT_EQUAL(1, scheduler.timeUntilNext(99));
+
+    // Everything is due at 300
+    TEST_ASSERT_TRUE(scheduler.popDue(300, id, deadline));
+    TEST_ASSERT_EQUAL(1, id);
+    TEST_ASSERT_EQUAL(100, deadline);
+    TEST_ASSERT_TRUE(scheduler.popDue(300, id, deadline));
+    TEST_ASSERT_EQUAL(2, id);
+    TEST_ASSERT_TRUE(scheduler.popDue(300, id, deadline));
+    TEST_ASSERT_EQUAL(3, id);
+    TEST_ASSERT_FALSE(scheduler.popDue(300, id, deadline));
+    TEST_ASSERT_EQUAL(0, scheduler.size());
+}
+
+// Test: Rescheduling an id moves it instead of queueing a duplicate
+void test_scheduler_reschedule_moves_entry(void) {
+    EffectScheduler<16> scheduler;
+    scheduler.schedule(5, 500);
+    scheduler.schedule(6, 600);
+    scheduler.schedule(5, 700);
+
+    TEST_ASSERT_EQUAL(2, scheduler.size());
+
+    uint16_t id;
+    uint32_t deadline;
+    TEST_ASSERT_TRUE(scheduler.popDue(700, id, deadline));
+    TEST_ASSERT_EQUAL(6, id);
+    TEST_ASSERT_TRUE(scheduler.popDue(700, id, deadline));
+    TEST_ASSERT_EQUAL(5, id);
+    TEST_ASSERT_EQUAL(700, deadline);
+}
+
+// Test: Cancelled entries are never returned
+void test_scheduler_cancel(void) {
+    EffectScheduler<16> scheduler;
+    for (uint16_t i = 0; i < 16; i++) {
+        scheduler.schedule(i, 1000 - i * 10);
+    }
+    scheduler.cancel(15);  // Earliest
+    scheduler.cancel(7);   // Somewhere in the middle
+    scheduler.cancel(7);   // Cancelling twice is harmless
+
+    TEST_ASSERT_FALSE(scheduler.isScheduled(7));
+    TEST_ASSERT_EQUAL(14, scheduler.size());
+
+    uint16_t id;
+    uint32_t deadline;
+    uint32_t last = 0;
+    int popped = 0;
+    while (scheduler.popDue(2000, id, deadline)) {
+        TEST_ASSERT_TRUE(id != 7 && id != 15);
+        TEST_ASSERT_TRUE(deadline >= last);
+        last = deadline;
+        popped++;
+    }
+    TEST_ASSERT_EQUAL(14, popped);
+}
+
+// Test: Ordering survives the 32-bit millis() rollover
+void test_scheduler_millis_rollover(void) {
+    EffectScheduler<4> scheduler;
+    scheduler.schedule(0, 0x00000010UL);  // After rollover
+    scheduler.schedule(1, 0xFFFFFFF0UL);  // Before rollover
+
+    uint16_t id;
+    uint32_t deadline;
+    TEST_ASSERT_EQUAL(0, scheduler.timeUntilNext(0xFFFFFFF8UL));
+    TEST_ASSERT_TRUE(scheduler.popDue(0xFFFFFFF8UL, id, deadline));
+    TEST_ASSERT_EQUAL(1, id);
+    TEST_ASSERT_FALSE(scheduler.popDue(0xFFFFFFF8UL, id, deadline));
+    TEST_ASSERT_EQUAL(0x18, scheduler.timeUntilNext(0xFFFFFFF8UL));
+}
+
+// Test: Idle scheduler reports no deadline
+void test_scheduler_idle(void) {
+    EffectScheduler<4> scheduler;
+    TEST_ASSERT_EQUAL(EffectScheduler<4>::NO_DEADLINE, scheduler.timeUntilNext(1234));
+
+    // Out-of-range ids are ignored
+    scheduler.schedule(4, 10);
+    TEST_ASSERT_EQUAL(0, scheduler.size());
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_scheduler_pops_in_deadline_order);
+    RUN_TEST(test_scheduler_reschedule_moves_entry);
+    RUN_TEST(test_scheduler_cancel);
+    RUN_TEST(test_scheduler_millis_rollover);
+    RUN_TEST(test_scheduler_idle);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
@@ -0,0 +1,138 @@
+/**
+ * @file test_loop_profiler.cpp
+ * @brief Unit tests for the loop() subsystem profiler
+ *
+ * Drives the profiler with made-up cycle counter readings: laps per
+ * section, per-second rate and longest-iteration histograms, counter
+ * wrap-around and the JSON it writes for the API and telemetry.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <string.h>
+#include <loop_profiler.h>
+
+#define CYCLES_PER_US 80
+
+enum TestSection { SECTION_NETWORK, SECTION_STATUS, TEST_SECTIONS };
+static const char *const SECTION_NAMES[TEST_SECTIONS] = {"network", "status"};
+
+// One iteration: network takes networkUs, status statusUs; returns the next start
+static uint32_t iterate(LoopProfiler<TEST_SECTIONS> &profiler, uint32_t start, uint32_t networkUs, uint32_t statusUs) {
+    uint32_t now = profiler.beginIteration(start);
+    now = profiler.lap(SECTION_NETWORK, now, now + networkUs * CYCLES_PER_US);
+    now = profiler.lap(SECTION_STATUS, now, now + statusUs * CYCLES_PER_US);
+    profiler.endIteration(now);
+    return now;
+}
+
+// Test: Each lap is charged to its section with calls, total and longest call
+void test_profiler_sections(void) {
+    LoopProfiler<TEST_SECTIONS> profiler(CYCLES_PER_US);
+    uint32_t now = 0;
+    now = iterate(profiler, now, 100, 10);
+    now = iterate(profiler, now, 300, 20);
+    now = iterate(profiler, now, 200, 30);
+
+    TEST_ASSERT_EQUAL(3, profiler.iterations());
+    TEST_ASSERT_EQUAL(3, profiler.calls(SECTION_NETWORK));
+    TEST_ASSERT_EQUAL(600, (uint32_t)profiler.totalUs(SECTION_NETWORK));
+    TEST_ASSERT_EQUAL(300, profiler.maxUs(SECTION_NETWORK));
+    TEST_ASSERT_EQUAL(60, (uint32_t)profiler.totalUs(SECTION_STATUS));
+    TEST_ASSERT_EQUAL(30, profiler.maxUs(SECTION_STATUS));
+    TEST_ASSERT_EQUAL(320, profiler.longestUs());
+    TEST_ASSERT_EQUAL(660 * CYCLES_PER_US, profiler.busyCycles());
+}
+
+// Test: Every full second adds its loop rate and longest iteration to the histograms
+void test_profiler_histograms(void) {
+    LoopProfiler<TEST_SECTIONS> profiler(CYCLES_PER_US);
+    uint32_t now = 0;
+
+    // First second: 1000 iterations of 1 ms
+    for (int i = 0; i < 1000; i++) now = iterate(profiler, now, 900, 100);
+    // Second second: one 600 ms hiccup, then 400 iterations of 1 ms
+    now = iterate(profiler, now, 600000, 0);
+    for (int i = 0; i < 400; i++) now = iterate(profiler, now, 900, 100);
+    now = iterate(profiler, now, 1, 0); // Starts the next second
+
+    TEST_ASSERT_EQUAL(401, profiler.loopRate());
+    TEST_ASSERT_EQUAL(1, profiler.rateHistogram(LoopProfiler<TEST_SECTIONS>::bucket(1000)));
+    TEST_ASSERT_EQUAL(1, profiler.rateHistogram(LoopProfiler<TEST_SECTIONS>::bucket(401)));
+    TEST_ASSERT_EQUAL(1, profiler.longestHistogram(LoopProfiler<TEST_SECTIONS>::bucket(1000)));
+    TEST_ASSERT_EQUAL(1, profiler.longestHistogram(LoopProfiler<TEST_SECTIONS>::bucket(600000)));
+    TEST_ASSERT_EQUAL(600000, profiler.maxUs(SECTION_NETWORK));
+}
+
+// Test: Log2 buckets, with everything large in the last one
+void test_profiler_buckets(void) {
+    TEST_ASSERT_EQUAL(0, LoopProfiler<1>::bucket(0));
+    TEST_ASSERT_EQUAL(1, LoopProfiler<1>::bucket(1));
+    TEST_ASSERT_EQUAL(2, LoopProfiler<1>::bucket(2));
+    TEST_ASSERT_EQUAL(2, LoopProfiler<1>::bucket(3));
+    TEST_ASSERT_EQUAL(11, LoopProfiler<1>::bucket(1024));
+    TEST_ASSERT_EQUAL(LOOP_HISTOGRAM_BUCKETS - 1, LoopProfiler<1>::bucket(0xFFFFFFFFUL));
+}
+
+// Test: Laps across a cycle counter wrap are measured correctly
+void test_profiler_counter_wrap(void) {
+    LoopProfiler<TEST_SECTIONS> profiler(CYCLES_PER_US);
+    uint32_t start = 0xFFFFFFFFUL - 50 * CYCLES_PER_US;
+    iterate(profiler, start, 100, 0);
+    TEST_ASSERT_EQUAL(100, profiler.maxUs(SECTION_NETWORK));
+    TEST_ASSERT_EQUAL(100, profiler.longestUs());
+}
+
+// Test: JSON for the API and telemetry, including 64-bit section totals
+void test_profiler_json(void) {
+    LoopProfiler<TEST_SECTIONS> profiler(1);
+    uint32_t now = 0;
+    for (int i = 0; i < 2000; i++) {
+        now = profiler.beginIteration(now);
+        now = profiler.lap(SECTION_NETWORK, now, now + 0xF0000000UL);
+        now = profiler.lap(SECTION_STATUS, now, now + 5);
+        profiler.endIteration(now);
+    }
+
+    char buffer[768];
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject();
+    profiler.write(json, "loop", SECTION_NAMES);
+    json.endObject();
+    TEST_ASSERT_TRUE(json.ok());
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "{\"loop\":{\"iterations\":2000,"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "\"network\":[2000,8053063680000,4026531840]"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "\"status\":[2000,10000,5]"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "\"rateHistogram\":[0,"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "\"longestHistogram\":[0,"));
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_profiler_sections);
+    RUN_TEST(test_profiler_histograms);
+    RUN_TEST(test_profiler_buckets);
+    RUN_TEST(test_profiler_counter_wrap);
+    RUN_TEST(test_profiler_json);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
@@ -0,0 +1,224 @@
+/**
+ * @file test_output_core.cpp
+ * @brief Tests for the output model and blink engine shared by both boards
+ *
+ * Drives OutputCore through a recording platform in place of LEDC or
+ * analogWrite, with explicit timestamps, and checks the duties written,
+ * blink timing, chasing group hand-off and batch target resolution.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <string.h>
+#include <command_parser.h>
+#include <output_core.h>
+#include <pin_map.h>
+
+// Last duty written per output, and how often each hook ran
+struct RecordingPlatform {
+    static int16_t level[1024];
+    static uint32_t writes;
+    static uint32_t groupSteps;
+    static uint32_t groupInterval;
+
+    static void writeOutput(uint16_t index, uint8_t duty) {
+        level[index] = duty;
+        writes++;
+    }
+
+    static uint32_t stepGroup(uint8_t slot) {
+        groupSteps++;
+        return groupInterval;
+    }
+};
+
+int16_t RecordingPlatform::level[1024];
+uint32_t RecordingPlatform::writes;
+uint32_t RecordingPlatform::groupSteps;
+uint32_t RecordingPlatform::groupInterval;
+
+typedef OutputCore<16, 0, RecordingPlatform> Esp32Core;
+typedef OutputCore<7, 4, RecordingPlatform> Esp8266Core;
+
+static CommandEntry entry(uint16_t fields, bool active, int32_t brightness, uint32_t interval) {
+    CommandEntry e;
+    memset(&e, 0, sizeof(e));
+    e.fields = fields;
+    e.active = active;
+    e.brightness = brightness;
+    e.interval = interval;
+    return e;
+}
+
+// Test: Index type and arrays follow the output count
+void test_sized_by_output_count(void) {
+    TEST_ASSERT_EQUAL(1, sizeof(Esp32Core::Index));
+    TEST_ASSERT_EQUAL(2, sizeof(OutputCore<1024, 0, RecordingPlatform>::Index));
+    TEST_ASSERT_EQUAL(7, sizeof(((Esp8266Core *)0)->state));
+    TEST_ASSERT_EQUAL(16, sizeof(((Esp32Core *)0)->duty));
+
+    Esp8266Core core;
+    for (int i = 0; i < 7; i++) {
+        TEST_ASSERT_EQUAL(-1, core.group[i]);
+        TEST_ASSERT_EQUAL(255, core.duty[i]);
+        TEST_ASSERT_FALSE(core.state[i]);
+    }
+}
+
+// Test: set/apply write the duty, and unspecified entry fields keep their value
+void test_set_apply_and_resolve(void) {
+    Esp32Core core;
+    core.set(3, true, dutyFromPercent(50), 0);
+    TEST_ASSERT_EQUAL(127, RecordingPlatform::level[3]);
+    TEST_ASSERT_EQUAL(0, core.pendingEffects());
+
+    bool active;
+    uint8_t duty;
+    uint32_t interval;
+    core.resolve(3, entry(FIELD_INTERVAL, false, 0, 400), active, duty, interval);
+    TEST_ASSERT_TRUE(active);
+    TEST_ASSERT_EQUAL(127, duty);
+    TEST_ASSERT_EQUAL(400, interval);
+
+    core.apply(3, active, duty, interval, 1000);
+    TEST_ASSERT_EQUAL(1, core.pendingEffects());
+
+    core.resolve(3, entry(FIELD_ACTIVE | FIELD_BRIGHTNESS, false, 150, 0), active, duty, interval);
+    TEST_ASSERT_FALSE(active);
+    TEST_ASSERT_EQUAL(255, duty); // Clamped to 100 %
+    core.apply(3, active, duty, interval, 1100);
+    TEST_ASSERT_EQUAL(0, RecordingPlatform::level[3]);
+    TEST_ASSERT_EQUAL(0, core.pendingEffects());
+}
+
+// Test: Blinking stays on its deadline grid and resyncs after a missed interval
+void test_blink_phase_locked(void) {
+    Esp32Core core;
+    core.set(0, true, 200, 0);
+    core.setInterval(0, 100, 0);
+    TEST_ASSERT_EQUAL(200, RecordingPlatform::level[0]);
+
+    core.step(99);
+    TEST_ASSERT_EQUAL(200, RecordingPlatform::level[0]);
+    core.step(130); // Late tick: next deadline stays at 200, not 230
+    TEST_ASSERT_EQUAL(0, RecordingPlatform::level[0]);
+    core.step(199);
+    TEST_ASSERT_EQUAL(0, RecordingPlatform::level[0]);
+    core.step(200);
+    TEST_ASSERT_EQUAL(200, RecordingPlatform::level[0]);
+
+    // More than a full interval late: toggle once and restart from now
+    uint32_t writes = RecordingPlatform::writes;
+    core.step(1000);
+    TEST_ASSERT_EQUAL(writes + 1, RecordingPlatform::writes);
+    core.step(1099);
+    TEST_ASSERT_EQUAL(writes + 1, RecordingPlatform::writes);
+    core.step(1100);
+    TEST_ASSERT_EQUAL(writes + 2, RecordingPlatform::writes);
+
+    // Solid again
+    core.setInterval(0, 0, 1100);
+    TEST_ASSERT_EQUAL(0, core.pendingEffects());
+}
+
+// Test: Chasing groups step through the platform hook and own their outputs
+void test_groups_through_platform(void) {
+    Esp8266Core core;
+    RecordingPlatform::groupSteps = 0;
+    RecordingPlatform::groupInterval = 250;
+
+    core.set(2, true, 255, 0);
+    core.setInterval(2, 100, 0);
+    core.group[2] = 1;
+    core.cancel(2);
+    core.schedule(2, 0); // Group members do not blink on their own
+    core.scheduleGroup(1, 250);
+    TEST_ASSERT_EQUAL(1, core.pendingEffects());
+
+    core.step(250);
+    core.step(500);
+    TEST_ASSERT_EQUAL(2, RecordingPlatform::groupSteps);
+
+    // A group that is gone (hook returns 0) is not re-queued
+    RecordingPlatform::groupInterval = 0;
+    core.step(750);
+    TEST_ASSERT_EQUAL(3, RecordingPlatform::groupSteps);
+    TEST_ASSERT_EQUAL(0, core.pendingEffects());
+}
+
+// Test: Batch targets resolve pins through the map and leave unknown selectors to the board
+void test_batch_targets(void) {
+    static const int PINS[7] = {4, 5, 12, 13, 14, 16, 2};
+    PinMap<7, 17> pins;
+    pins.set(PINS);
+    Esp8266Core core;
+    core.state[1] = true;
+    core.state[5] = true;
+
+    CommandFields<7> req;
+    Esp8266Core::Index targets[7];
+    Esp8266Core::Index count = 0;
+    const char *error = nullptr;
+
+    const char *pair = "{\"outputs\":[{\"pin\":16},{\"pin\":4}]}";
+    TEST_ASSERT_TRUE(parseCommand(pair, strlen(pair), req));
+    TEST_ASSERT_EQUAL(200, core.batchTargets(req, pins, targets, count, error));
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL(5, targets[0]);
+    TEST_ASSERT_EQUAL(0, targets[1]);
+
+    const char *bad = "{\"outputs\":[{\"pin\":4},{\"pin\":3}]}";
+    TEST_ASSERT_TRUE(parseCommand(bad, strlen(bad), req));
+    TEST_ASSERT_EQUAL(404, core.batchTargets(req, pins, targets, count, error));
+    TEST_ASSERT_EQUAL_STRING("Output not found", error);
+
+    const char *active = "{\"select\":\"active\",\"active\":false}";
+    TEST_ASSERT_TRUE(parseCommand(active, strlen(active), req));
+    TEST_ASSERT_EQUAL(200, core.batchTargets(req, pins, targets, count, error));
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL(1, targets[0]);
+    TEST_ASSERT_EQUAL(5, targets[1]);
+
+    const char *all = "{\"select\":\"all\"}";
+    TEST_ASSERT_TRUE(parseCommand(all, strlen(all), req));
+    TEST_ASSERT_EQUAL(200, core.batchTargets(req, pins, targets, count, error));
+    TEST_ASSERT_EQUAL(7, count);
+
+    const char *group = "{\"select\":\"group\",\"group\":1}";
+    TEST_ASSERT_TRUE(parseCommand(group, strlen(group), req));
+    TEST_ASSERT_EQUAL(0, core.batchTargets(req, pins, targets, count, error));
+}
+
+void setUp(void) {
+    memset(RecordingPlatform::level, 0, sizeof(RecordingPlatform::level));
+    RecordingPlatform::writes = 0;
+}
+
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_sized_by_output_count);
+    RUN_TEST(test_set_apply_and_resolve);
+    RUN_TEST(test_blink_phase_locked);
+    RUN_TEST(test_groups_through_platform);
+    RUN_TEST(test_batch_targets);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
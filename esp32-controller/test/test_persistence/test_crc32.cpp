@@ -0,0 +1,70 @@
+/**
+ * @file test_crc32.cpp
+ * @brief Unit tests for the CRC-32 used to validate persisted blobs
+ *
+ * Tests the standard check value, incremental use and corruption detection.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <string.h>
+#include <crc32.h>
+
+// Test: Standard CRC-32 check value
+void test_crc32_check_value(void) {
+    const char *input = "123456789";
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926UL, crc32(input, strlen(input)));
+    TEST_ASSERT_EQUAL_HEX32(0x00000000UL, crc32(input, 0));
+}
+
+// Test: Checksumming in pieces matches a single pass
+void test_crc32_incremental(void) {
+    const char *input = "RailHub32 output state";
+    size_t length = strlen(input);
+    uint32_t whole = crc32(input, length);
+    uint32_t pieces = crc32(input + 9, length - 9, crc32(input, 9));
+    TEST_ASSERT_EQUAL_HEX32(whole, pieces);
+}
+
+// Test: Any single flipped bit changes the checksum
+void test_crc32_detects_bit_flip(void) {
+    uint8_t blob[64];
+    for (int i = 0; i < 64; i++) {
+        blob[i] = (uint8_t)(i * 7);
+    }
+    uint32_t original = crc32(blob, sizeof(blob));
+
+    for (int bit = 0; bit < 64 * 8; bit++) {
+        blob[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+        TEST_ASSERT_TRUE(crc32(blob, sizeof(blob)) != original);
+        blob[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+    }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_crc32_check_value);
+    RUN_TEST(test_crc32_incremental);
+    RUN_TEST(test_crc32_detects_bit_flip);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
@@ -0,0 +1,134 @@
+/**
+ * @file test_pin_map.cpp
+ * @brief Tests for the runtime output-to-GPIO map
+ *
+ * Checks that the stock maps of both boards pass their chip rules, that
+ * each kind of unusable pin is refused with the offending output named,
+ * and that the reverse table follows every accepted map while a refused
+ * one leaves the previous map in place.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <pin_map.h>
+
+typedef PinMap<16, 40> Esp32Map;
+typedef PinMap<7, 17> Esp8266Map;
+
+// Stock LED_PINS of each build
+static const int ESP32_PINS[16] = {2, 4, 5, 18, 19, 21, 22, 23, 25, 26, 27, 32, 33, 12, 13, 14};
+static const int ESP8266_PINS[7] = {4, 5, 12, 13, 14, 16, 2};
+
+// Test: The stock maps pass with their own strapping pins allowed, and only then
+void test_stock_maps_pass(void) {
+    uint8_t badIndex = 0;
+    uint64_t allowed32 = Esp32Map::mask(ESP32_PINS, 16);
+    uint64_t allowed8266 = Esp8266Map::mask(ESP8266_PINS, 7);
+
+    TEST_ASSERT_EQUAL(PIN_OK, Esp32Map::check(ESP32_PIN_RULES, allowed32, ESP32_PINS, badIndex));
+    TEST_ASSERT_EQUAL(PIN_OK, Esp8266Map::check(ESP8266_PIN_RULES, allowed8266, ESP8266_PINS, badIndex));
+
+    // Without the allowance GPIO 2 (output 0) is the first strapping pin
+    TEST_ASSERT_EQUAL(PIN_STRAPPING, Esp32Map::check(ESP32_PIN_RULES, 0, ESP32_PINS, badIndex));
+    TEST_ASSERT_EQUAL(0, badIndex);
+}
+
+static PinCheck checkWith(int pin, uint8_t at, uint8_t &badIndex) {
+    int pins[16];
+    for (int i = 0; i < 16; i++) pins[i] = ESP32_PINS[i];
+    pins[at] = pin;
+    return Esp32Map::check(ESP32_PIN_RULES, Esp32Map::mask(ESP32_PINS, 16), pins, badIndex);
+}
+
+// Test: Each kind of unusable pin is refused and the offending output is reported
+void test_unusable_pins_refused(void) {
+    uint8_t badIndex = 0;
+
+    TEST_ASSERT_EQUAL(PIN_FLASH, checkWith(7, 3, badIndex));
+    TEST_ASSERT_EQUAL(3, badIndex);
+    TEST_ASSERT_EQUAL(PIN_INPUT_ONLY, checkWith(34, 9, badIndex));
+    TEST_ASSERT_EQUAL(9, badIndex);
+    TEST_ASSERT_EQUAL(PIN_STRAPPING, checkWith(15, 10, badIndex));
+    TEST_ASSERT_EQUAL(10, badIndex);
+    TEST_ASSERT_EQUAL(PIN_RESERVED, checkWith(1, 4, badIndex));
+    TEST_ASSERT_EQUAL(PIN_NOT_GPIO, checkWith(20, 4, badIndex));
+    TEST_ASSERT_EQUAL(PIN_NOT_GPIO, checkWith(40, 4, badIndex));
+    TEST_ASSERT_EQUAL(PIN_NOT_GPIO, checkWith(-1, 4, badIndex));
+
+    // The second use of a pin is the one reported
+    TEST_ASSERT_EQUAL(PIN_DUPLICATE, checkWith(4, 12, badIndex));
+    TEST_ASSERT_EQUAL(12, badIndex);
+
+    // GPIO 17 exists on the ESP32 but not on the ESP8266
+    int pins8266[7] = {4, 5, 12, 13, 14, 17, 2};
+    TEST_ASSERT_EQUAL(PIN_NOT_GPIO, Esp8266Map::check(ESP8266_PIN_RULES, 0, pins8266, badIndex));
+    TEST_ASSERT_EQUAL(5, badIndex);
+}
+
+// Test: indexOf follows the map that was assigned last
+void test_reverse_lookup_rebuilt(void) {
+    Esp32Map map;
+    uint8_t badIndex = 0;
+    TEST_ASSERT_EQUAL(-1, map.indexOf(2));
+
+    map.set(ESP32_PINS);
+    for (int i = 0; i < 16; i++) {
+        TEST_ASSERT_EQUAL(i, map.indexOf(ESP32_PINS[i]));
+    }
+    TEST_ASSERT_EQUAL(-1, map.indexOf(16));
+    TEST_ASSERT_EQUAL(-1, map.indexOf(-5));
+    TEST_ASSERT_EQUAL(-1, map.indexOf(200));
+
+    // Output 0 moves from GPIO 2 to GPIO 16
+    int moved[16];
+    for (int i = 0; i < 16; i++) moved[i] = ESP32_PINS[i];
+    moved[0] = 16;
+    TEST_ASSERT_EQUAL(PIN_OK, map.assign(ESP32_PIN_RULES, Esp32Map::mask(ESP32_PINS, 16), moved, badIndex));
+    TEST_ASSERT_EQUAL(0, map.indexOf(16));
+    TEST_ASSERT_EQUAL(-1, map.indexOf(2));
+    TEST_ASSERT_EQUAL(16, map.pin(0));
+    TEST_ASSERT_EQUAL(13, map.indexOf(12));
+}
+
+// Test: A refused map leaves the previous map and its lookup untouched
+void test_refused_map_keeps_previous(void) {
+    Esp8266Map map;
+    uint8_t badIndex = 0;
+    map.set(ESP8266_PINS);
+
+    int bad[7] = {4, 5, 12, 13, 14, 16, 9};
+    TEST_ASSERT_EQUAL(PIN_FLASH, map.assign(ESP8266_PIN_RULES, Esp8266Map::mask(ESP8266_PINS, 7), bad, badIndex));
+    TEST_ASSERT_EQUAL(6, badIndex);
+    TEST_ASSERT_EQUAL(2, map.pin(6));
+    TEST_ASSERT_EQUAL(6, map.indexOf(2));
+    TEST_ASSERT_EQUAL(-1, map.indexOf(9));
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_stock_maps_pass);
+    RUN_TEST(test_unusable_pins_refused);
+    RUN_TEST(test_reverse_lookup_rebuilt);
+    RUN_TEST(test_refused_map_keeps_previous);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
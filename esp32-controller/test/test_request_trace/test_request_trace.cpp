@@ -0,0 +1,120 @@
+/**
+ * @file test_request_trace.cpp
+ * @brief Unit tests for the request trace ring and its per-stage percentiles
+ *
+ * Tests span recording, keeping the newest spans across wrap-around,
+ * nearest-rank percentiles and ids.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <request_trace.h>
+
+// Test: Spans come back in recording order with their durations
+void test_trace_records_spans(void) {
+    TraceRing<8> trace;
+    TraceSpan spans[8];
+    TEST_ASSERT_EQUAL(0, trace.snapshot(spans));
+
+    trace.record(7, TRACE_RECEIVE, 1000, 1040);
+    trace.record(7, TRACE_PARSE, 1040, 1100);
+    trace.record(0, TRACE_PERSIST, 5000, 17000);
+
+    TEST_ASSERT_EQUAL(3, trace.snapshot(spans));
+    TEST_ASSERT_EQUAL(7, spans[0].id);
+    TEST_ASSERT_EQUAL(TRACE_RECEIVE, spans[0].stage);
+    TEST_ASSERT_EQUAL(1000, spans[0].startUs);
+    TEST_ASSERT_EQUAL(40, spans[0].durationUs);
+    TEST_ASSERT_EQUAL(60, spans[1].durationUs);
+    TEST_ASSERT_EQUAL(0, spans[2].id);
+    TEST_ASSERT_EQUAL(12000, spans[2].durationUs);
+}
+
+// Test: A full ring keeps the newest spans, oldest first; durations survive clock wrap
+void test_trace_wraps(void) {
+    TraceRing<4> trace;
+    for (uint32_t i = 1; i <= 10; i++) {
+        trace.record(i, TRACE_SEND, 0xFFFFFFF0UL + i, i * 2);
+    }
+
+    TraceSpan spans[4];
+    TEST_ASSERT_EQUAL(4, trace.snapshot(spans));
+    TEST_ASSERT_EQUAL(10, trace.recorded());
+    for (uint16_t i = 0; i < 4; i++) {
+        uint32_t id = 7 + i;
+        TEST_ASSERT_EQUAL(id, spans[i].id);
+        TEST_ASSERT_EQUAL(id + 16, spans[i].durationUs); // From 0xFFFFFFF0 + id to id * 2
+    }
+}
+
+// Test: Percentiles per stage use the nearest rank and ignore other stages
+void test_trace_stage_percentiles(void) {
+    TraceRing<256> trace;
+    for (uint32_t d = 1; d <= 200; d++) {
+        trace.record(d, TRACE_APPLY, 0, 201 - d); // Out of order on purpose
+    }
+    trace.record(0, TRACE_PERSIST, 0, 50000);
+
+    TraceSpan spans[256];
+    uint32_t scratch[256];
+    uint16_t count = trace.snapshot(spans);
+    TEST_ASSERT_EQUAL(201, count);
+
+    TraceStageStats apply = traceStageStats(spans, count, TRACE_APPLY, scratch);
+    TEST_ASSERT_EQUAL(200, apply.count);
+    TEST_ASSERT_EQUAL(100, apply.p50Us);
+    TEST_ASSERT_EQUAL(190, apply.p95Us);
+    TEST_ASSERT_EQUAL(198, apply.p99Us);
+    TEST_ASSERT_EQUAL(200, apply.maxUs);
+
+    TraceStageStats persist = traceStageStats(spans, count, TRACE_PERSIST, scratch);
+    TEST_ASSERT_EQUAL(1, persist.count);
+    TEST_ASSERT_EQUAL(50000, persist.p50Us);
+    TEST_ASSERT_EQUAL(50000, persist.p99Us);
+
+    TraceStageStats send = traceStageStats(spans, count, TRACE_SEND, scratch);
+    TEST_ASSERT_EQUAL(0, send.count);
+    TEST_ASSERT_EQUAL(0, send.p99Us);
+}
+
+// Test: Ids are unique, non-zero and stage names cover every stage
+void test_trace_ids_and_names(void) {
+    TraceRing<4> trace;
+    uint32_t first = trace.nextId();
+    TEST_ASSERT_TRUE(first != 0);
+    TEST_ASSERT_EQUAL(first + 1, trace.nextId());
+
+    TEST_ASSERT_EQUAL_STRING("receive", traceStageName(TRACE_RECEIVE));
+    TEST_ASSERT_EQUAL_STRING("apply", traceStageName(TRACE_APPLY));
+    TEST_ASSERT_EQUAL_STRING("send", traceStageName(TRACE_SEND));
+    TEST_ASSERT_EQUAL_STRING("unknown", traceStageName(TRACE_STAGES));
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_trace_records_spans);
+    RUN_TEST(test_trace_wraps);
+    RUN_TEST(test_trace_stage_percentiles);
+    RUN_TEST(test_trace_ids_and_names);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
@@ -0,0 +1,245 @@
+/**
+ * @file test_status_frame.cpp
+ * @brief Unit tests for the binary WebSocket status frame
+ *
+ * Decodes frames the way the web UI's DataView decoder does and compares
+ * their size with the equivalent JSON messages.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <status_frame.h>
+
+#define TEST_OUTPUTS 16
+#define TEST_NAME_LEN 20
+
+typedef StatusFrameWriter<TEST_OUTPUTS, TEST_NAME_LEN> TestWriter;
+
+static const int testPins[TEST_OUTPUTS] = {2, 4, 5, 12, 13, 14, 15, 16, 17, 18, 19, 21, 22, 23, 25, 26};
+
+struct DecodedOutput {
+    bool present;
+    bool active;
+    uint8_t brightness;
+    uint32_t interval;
+    bool hasName;
+    char name[TEST_NAME_LEN + 1];
+};
+
+struct DecodedFrame {
+    uint8_t type;
+    uint32_t seq;
+    uint32_t mask;
+    DecodedOutput outputs[TEST_OUTPUTS];
+};
+
+static uint32_t getU32(const uint8_t *p) {
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Mirror of decodeStatusFrame() in the web UI
+static void decode(const uint8_t *data, size_t length, DecodedFrame &frame) {
+    memset(&frame, 0, sizeof(frame));
+    TEST_ASSERT_TRUE(length >= 12);
+    TEST_ASSERT_EQUAL(STATUS_FRAME_VERSION, data[1]);
+    frame.type = data[0];
+    uint8_t count = data[2];
+    uint8_t nameCount = data[3];
+    frame.seq = getU32(data + 4);
+    frame.mask = getU32(data + 8);
+
+    const uint8_t *bits = data + 12;
+    const uint8_t *brightness = bits + (count + 7) / 8;
+    const uint8_t *p = brightness + count;
+    uint8_t k = 0;
+    for (uint8_t i = 0; i < TEST_OUTPUTS; i++) {
+        if (!(frame.mask & (1UL << i))) continue;
+        DecodedOutput &out = frame.outputs[i];
+        out.present = true;
+        out.active = (bits[k >> 3] >> (k & 7)) & 1;
+        out.brightness = brightness[k];
+        k++;
+        for (uint8_t shift = 0;; shift += 7) {
+            out.interval |= (uint32_t)(*p & 0x7F) << shift;
+            if (!(*p++ & 0x80)) break;
+        }
+    }
+    TEST_ASSERT_EQUAL(count, k);
+
+    for (uint8_t n = 0; n < nameCount; n++) {
+        uint8_t index = *p++;
+        uint8_t len = *p++;
+        TEST_ASSERT_TRUE(index < TEST_OUTPUTS);
+        frame.outputs[index].hasName = true;
+        memcpy(frame.outputs[index].name, p, len);
+        frame.outputs[index].name[len] = '\0';
+        p += len;
+    }
+    TEST_ASSERT_EQUAL(length, (size_t)(p - data));
+}
+
+static char names[TEST_OUTPUTS][TEST_NAME_LEN + 1];
+
+static void defaultOutputs(StatusFrameOutput *outputs) {
+    for (int i = 0; i < TEST_OUTPUTS; i++) {
+        snprintf(names[i], sizeof(names[i]), "Output %d", i + 1);
+        outputs[i].active = i % 3 == 0;
+        outputs[i].brightness = (uint8_t)(i * 6);
+        outputs[i].interval = i % 4 == 0 ? 500 : 0;
+        outputs[i].name = names[i];
+    }
+}
+
+// Same message the JSON path sends for these outputs
+static size_t jsonLength(const char *type, uint32_t seq, uint32_t mask, const StatusFrameOutput *outputs) {
+    char json[4096];
+    int len = snprintf(json, sizeof(json), "{\"type\":\"%s\",\"seq\":%lu,\"outputs\":[", type, (unsigned long)seq);
+    bool first = true;
+    for (int i = 0; i < TEST_OUTPUTS; i++) {
+        if (!(mask & (1UL << i))) continue;
+        len += snprintf(json + len, sizeof(json) - len,
+                        "%s{\"pin\":%d,\"active\":%s,\"brightness\":%u,\"name\":\"%s\",\"interval\":%lu}",
+                        first ? "" : ",", testPins[i], outputs[i].active ? "true" : "false",
+                        outputs[i].brightness, outputs[i].name, (unsigned long)outputs[i].interval);
+        first = false;
+    }
+    len += snprintf(json + len, sizeof(json) - len, "]}");
+    return (size_t)len;
+}
+
+// Test: A snapshot carries every output with state, brightness, interval and name
+void test_frame_snapshot_round_trip(void) {
+    StatusFrameOutput outputs[TEST_OUTPUTS];
+    defaultOutputs(outputs);
+    TestWriter writer;
+
+    size_t length = writer.snapshot(42, outputs);
+    TEST_ASSERT_EQUAL(length, writer.length());
+    TEST_ASSERT_TRUE(length <= TestWriter::CAPACITY);
+
+    DecodedFrame frame;
+    decode(writer.data(), length, frame);
+    TEST_ASSERT_EQUAL(STATUS_FRAME_SNAPSHOT, frame.type);
+    TEST_ASSERT_EQUAL(42, frame.seq);
+    TEST_ASSERT_EQUAL_HEX32(0xFFFF, frame.mask);
+    for (int i = 0; i < TEST_OUTPUTS; i++) {
+        TEST_ASSERT_TRUE(frame.outputs[i].present);
+        TEST_ASSERT_EQUAL(outputs[i].active, frame.outputs[i].active);
+        TEST_ASSERT_EQUAL(outputs[i].brightness, frame.outputs[i].brightness);
+        TEST_ASSERT_EQUAL(outputs[i].interval, frame.outputs[i].interval);
+        TEST_ASSERT_TRUE(frame.outputs[i].hasName);
+        TEST_ASSERT_EQUAL_STRING(outputs[i].name, frame.outputs[i].name);
+    }
+}
+
+// Test: Deltas hold only the masked outputs and only names that changed
+void test_frame_delta_names_only_on_change(void) {
+    StatusFrameOutput outputs[TEST_OUTPUTS];
+    defaultOutputs(outputs);
+    TestWriter writer;
+    DecodedFrame frame;
+
+    // First delta after boot: the writer has not sent any names yet
+    decode(writer.data(), writer.delta(1, 1UL << 3, outputs), frame);
+    TEST_ASSERT_TRUE(frame.outputs[3].hasName);
+
+    outputs[3].active = !outputs[3].active;
+    decode(writer.data(), writer.delta(2, 1UL << 3, outputs), frame);
+    TEST_ASSERT_EQUAL(STATUS_FRAME_DELTA, frame.type);
+    TEST_ASSERT_EQUAL(2, frame.seq);
+    TEST_ASSERT_EQUAL_HEX32(1UL << 3, frame.mask);
+    TEST_ASSERT_FALSE(frame.outputs[2].present);
+    TEST_ASSERT_EQUAL(outputs[3].active, frame.outputs[3].active);
+    TEST_ASSERT_FALSE(frame.outputs[3].hasName);
+    TEST_ASSERT_EQUAL(12 + 1 + 1 + 1, writer.length());
+
+    // A snapshot to one new client does not hide a rename from the others
+    strcpy(names[3], "Signal A");
+    writer.snapshot(2, outputs);
+    decode(writer.data(), writer.delta(3, (1UL << 3) | (1UL << 9), outputs), frame);
+    TEST_ASSERT_TRUE(frame.outputs[3].hasName);
+    TEST_ASSERT_EQUAL_STRING("Signal A", frame.outputs[3].name);
+    TEST_ASSERT_TRUE(frame.outputs[9].hasName);
+    TEST_ASSERT_TRUE(frame.outputs[9].present);
+
+    decode(writer.data(), writer.delta(4, (1UL << 3) | (1UL << 9), outputs), frame);
+    TEST_ASSERT_FALSE(frame.outputs[3].hasName);
+    TEST_ASSERT_FALSE(frame.outputs[9].hasName);
+}
+
+// Test: Intervals are LEB128 varints across their full range
+void test_frame_varint_intervals(void) {
+    static const uint32_t intervals[] = {0, 1, 127, 128, 500, 16383, 16384, 65535, 0xFFFFFFFFUL};
+    const int count = sizeof(intervals) / sizeof(intervals[0]);
+
+    StatusFrameOutput outputs[TEST_OUTPUTS];
+    defaultOutputs(outputs);
+    for (int i = 0; i < count; i++) {
+        outputs[i].interval = intervals[i];
+    }
+
+    TestWriter writer;
+    DecodedFrame frame;
+    decode(writer.data(), writer.snapshot(7, outputs), frame);
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL_UINT32(intervals[i], frame.outputs[i].interval);
+    }
+}
+
+// Test: Binary frames are an order of magnitude smaller than the JSON messages
+void test_frame_size_vs_json(void) {
+    StatusFrameOutput outputs[TEST_OUTPUTS];
+    defaultOutputs(outputs);
+    TestWriter writer;
+    writer.delta(0, 0xFFFF, outputs); // Names already known to clients
+
+    size_t snapshotBinary = writer.snapshot(1000, outputs);
+    size_t snapshotJson = jsonLength("snapshot", 1000, 0xFFFF, outputs);
+    size_t allBinary = writer.delta(1001, 0xFFFF, outputs);
+    size_t allJson = jsonLength("delta", 1001, 0xFFFF, outputs);
+    size_t oneBinary = writer.delta(1002, 1UL << 5, outputs);
+    size_t oneJson = jsonLength("delta", 1002, 1UL << 5, outputs);
+
+    char line[96];
+    snprintf(line, sizeof(line), "snapshot: %u bytes binary vs %u JSON", (unsigned)snapshotBinary, (unsigned)snapshotJson);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "16-output delta: %u bytes binary vs %u JSON", (unsigned)allBinary, (unsigned)allJson);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "1-output delta: %u bytes binary vs %u JSON", (unsigned)oneBinary, (unsigned)oneJson);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_TRUE(allBinary * 10 <= allJson);
+    TEST_ASSERT_TRUE(snapshotBinary * 4 <= snapshotJson);
+    TEST_ASSERT_TRUE(oneBinary * 4 <= oneJson);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_frame_snapshot_round_trip);
+    RUN_TEST(test_frame_delta_names_only_on_change);
+    RUN_TEST(test_frame_varint_intervals);
+    RUN_TEST(test_frame_size_vs_json);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
@@ -0,0 +1,170 @@
+/**
+ * @file test_write_behind.cpp
+ * @brief Unit tests for the write-behind flush timing of the output blob
+ *
+ * Replays loop() on a virtual millisecond clock the way
+ * persistAndBroadcastChanges() drives it: quiet period, maximum delay
+ * during a drag, and a store whose write() fails, which must be retried
+ * once per quiet period rather than on every pass.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <string.h>
+#include <config_slots.h>
+#include <write_behind.h>
+
+#define QUIET_MS 2000           // NVS_FLUSH_QUIET_MS
+#define MAX_DELAY_MS 10000      // NVS_FLUSH_MAX_DELAY_MS
+
+struct TestBlob {
+    uint32_t stateBits;
+    uint8_t brightness[16];
+};
+
+// Counts writes and fails them while failing is set (full partition, write error)
+class FailingStore {
+public:
+    FailingStore() : failing(false), attempts(0), written(0) {}
+
+    bool read(uint8_t slot, void *data, size_t length) { return false; }
+
+    bool write(uint8_t slot, const void *data, size_t length) {
+        attempts++;
+        if (failing) return false;
+        written++;
+        return true;
+    }
+
+    bool failing;
+    uint32_t attempts;
+    uint32_t written;
+};
+
+// loop() on a virtual clock: the first timestamp of each attempt and the gaps between attempts
+struct FlushRun {
+    FailingStore store;
+    ConfigSlots<FailingStore, TestBlob> slots;
+    WriteBehind writeBehind;
+    TestBlob blob;
+    uint32_t lastAttemptMs;
+    uint32_t minGapMs;
+
+    FlushRun() : slots(store), writeBehind(QUIET_MS, MAX_DELAY_MS), lastAttemptMs(0), minGapMs(0xFFFFFFFFUL) {
+        memset(&blob, 0, sizeof(blob));
+    }
+
+    // One loop() pass at now
+    void pass(uint32_t now) {
+        if (!writeBehind.due(now)) return;
+        if (store.attempts > 0 && now - lastAttemptMs < minGapMs) minGapMs = now - lastAttemptMs;
+        lastAttemptMs = now;
+        if (slots.save(blob)) {
+            writeBehind.clear();
+        } else {
+            writeBehind.failed(now);
+        }
+    }
+
+    // Passes every millisecond in [from, to); a change every changeEveryMs if non-zero
+    void run(uint32_t from, uint32_t to, uint32_t changeEveryMs) {
+        for (uint32_t now = from; now < to; now++) {
+            if (changeEveryMs && (now - from) % changeEveryMs == 0) {
+                blob.stateBits ^= 1;
+                writeBehind.mark(1, now);
+            }
+            pass(now);
+        }
+    }
+};
+
+// Test: One change is written once, a quiet period later
+void test_flush_after_quiet_period(void) {
+    FlushRun run;
+    run.writeBehind.mark(0x5, 100);
+    run.run(100, 100 + QUIET_MS - 1, 0);
+    TEST_ASSERT_EQUAL(0, run.store.attempts);
+    run.run(100 + QUIET_MS - 1, 20000, 0);
+    TEST_ASSERT_EQUAL(1, run.store.written);
+    TEST_ASSERT_EQUAL(100 + QUIET_MS, run.lastAttemptMs);
+    TEST_ASSERT_EQUAL(0, run.writeBehind.dirty());
+}
+
+// Test: A drag that never goes quiet is still written every maximum delay
+void test_flush_during_drag(void) {
+    FlushRun run;
+    run.run(0, 35000, 100);
+    TEST_ASSERT_EQUAL(3, run.store.written);
+    TEST_ASSERT_TRUE(run.minGapMs >= MAX_DELAY_MS);
+}
+
+// Test: A failing store is retried once per quiet period, not on every loop() pass
+void test_failed_write_backs_off(void) {
+    FlushRun run;
+    run.store.failing = true;
+    run.writeBehind.mark(0x1, 0);
+    run.run(0, 30000, 0);
+
+    // Attempts at 2 s, 4 s, .. 28 s, well past the maximum delay
+    TEST_ASSERT_EQUAL(14, run.store.attempts);
+    TEST_ASSERT_EQUAL(QUIET_MS, run.minGapMs);
+    TEST_ASSERT_EQUAL(0x1, run.writeBehind.dirty());
+
+    // The store recovers: the next retry writes and the mask clears
+    run.store.failing = false;
+    run.run(30000, 30000 + QUIET_MS, 0);
+    TEST_ASSERT_EQUAL(1, run.store.written);
+    TEST_ASSERT_EQUAL(0, run.writeBehind.dirty());
+}
+
+// Test: Failures during a drag keep at least a quiet period between attempts
+void test_failed_write_during_drag(void) {
+    FlushRun run;
+    run.store.failing = true;
+    run.run(0, 60000, 100);
+    TEST_ASSERT_TRUE(run.store.attempts > 0);
+    TEST_ASSERT_TRUE(run.store.attempts <= 60000 / MAX_DELAY_MS);
+    TEST_ASSERT_TRUE(run.minGapMs >= QUIET_MS);
+}
+
+// Test: Timers survive a millis() wrap
+void test_millis_wrap(void) {
+    WriteBehind writeBehind(QUIET_MS, MAX_DELAY_MS);
+    uint32_t start = 0xFFFFFFFFUL - 500;
+    writeBehind.mark(0x2, start);
+    TEST_ASSERT_FALSE(writeBehind.due(start + QUIET_MS - 1));
+    TEST_ASSERT_TRUE(writeBehind.due(start + QUIET_MS));
+    writeBehind.failed(start + QUIET_MS);
+    TEST_ASSERT_FALSE(writeBehind.due(start + 2 * QUIET_MS - 1));
+    TEST_ASSERT_TRUE(writeBehind.due(start + 2 * QUIET_MS));
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_flush_after_quiet_period);
+    RUN_TEST(test_flush_during_drag);
+    RUN_TEST(test_failed_write_backs_off);
+    RUN_TEST(test_failed_write_during_drag);
+    RUN_TEST(test_millis_wrap);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
@@ -0,0 +1,621 @@
+// Translations
+const translations = {
+    en: {
+        nav: { status: 'Status', outputs: 'Outputs' },
+        buttons: { refresh: '🔄 Refresh', allOn: '💡 All On', allOff: '⚫ All Off' },
+        status: { deviceInfo: 'Device Information', apIp: 'AP IP Address', clients: 'Connected Clients', uptime: 'Uptime', freeHeap: 'Free Heap', macAddr: 'MAC Address', apSsid: 'AP SSID', buildDate: 'Build Date', memoryStorage: 'Memory & Storage', ram: 'RAM', programFlash: 'Program Flash', cpuCore0: 'CPU Core 0', cpuCore1: 'CPU Core 1' },
+        outputs: { master: 'Master Brightness Control', masterBrightness: 'Master Brightness', masterDesc: 'Adjusts brightness for all active outputs simultaneously', individual: 'Individual Output Control', output: 'Output', pin: 'Pin', brightness: 'Brightness', interval: 'Interval', all: 'ALL', on: 'ON', off: 'OFF', editName: 'Edit Name', saveName: 'Save', cancelEdit: 'Cancel', controls: 'Controls' }
+    },
+    de: {
+        nav: { status: 'Status', outputs: 'Ausgänge' },
+        buttons: { refresh: '🔄 Aktualisieren', allOn: '💡 Alle Ein', allOff: '⚫ Alle Aus' },
+        status: { deviceInfo: 'Geräteinformationen', apIp: 'AP IP-Adresse', clients: 'Verbundene Clients', uptime: 'Laufzeit', freeHeap: 'Freier Speicher', macAddr: 'MAC-Adresse', apSsid: 'AP SSID', buildDate: 'Build-Datum', memoryStorage: 'Speicher & Storage', ram: 'RAM', programFlash: 'Programm-Flash', cpuCore0: 'CPU-Kern 0', cpuCore1: 'CPU-Kern 1' },
+        outputs: { master: 'Master-Helligkeitssteuerung', masterBrightness: 'Master-Helligkeit', masterDesc: 'Passt die Helligkeit aller aktiven Ausgänge gleichzeitig an', individual: 'Individuelle Ausgangssteuerung', output: 'Ausgang', pin: 'Pin', brightness: 'Helligkeit', interval: 'Intervall', all: 'ALLE', on: 'EIN', off: 'AUS', editName: 'Name bearbeiten', saveName: 'Speichern', cancelEdit: 'Abbrechen', controls: 'Steuerung' }
+    },
+    fr: {
+        nav: { status: 'Statut', outputs: 'Sorties' },
+        buttons: { refresh: '🔄 Actualiser', allOn: '💡 Tous Allumés', allOff: '⚫ Tous Éteints' },
+        status: { deviceInfo: 'Informations sur l\'appareil', apIp: 'Adresse IP AP', clients: 'Clients connectés', uptime: 'Temps de fonctionnement', freeHeap: 'Mémoire libre', macAddr: 'Adresse MAC', apSsid: 'AP SSID', buildDate: 'Date de compilation', memoryStorage: 'Mémoire & Stockage', ram: 'RAM', programFlash: 'Flash programme', cpuCore0: 'Cœur CPU 0', cpuCore1: 'Cœur CPU 1' },
+        outputs: { master: 'Contrôle principal de la luminosité', masterBrightness: 'Luminosité principale', masterDesc: 'Ajuste la luminosité de toutes les sorties actives simultanément', individual: 'Contrôle individuel des sorties', output: 'Sortie', pin: 'Broche', brightness: 'Luminosité', interval: 'Intervalle', all: 'TOUS', on: 'ALLUMÉ', off: 'ÉTEINT', editName: 'Modifier le nom', saveName: 'Enregistrer', cancelEdit: 'Annuler', controls: 'Contrôles' }
+    },
+    it: {
+        nav: { status: 'Stato', outputs: 'Uscite' },
+        buttons: { refresh: '🔄 Aggiorna', allOn: '💡 Tutti Accesi', allOff: '⚫ Tutti Spenti' },
+        status: { deviceInfo: 'Informazioni dispositivo', apIp: 'Indirizzo IP AP', clients: 'Client connessi', uptime: 'Tempo di attività', freeHeap: 'Memoria libera', macAddr: 'Indirizzo MAC', apSsid: 'AP SSID', buildDate: 'Data compilazione', memoryStorage: 'Memoria & Archiviazione', ram: 'RAM', programFlash: 'Flash programma', cpuCore0: 'Core CPU 0', cpuCore1: 'Core CPU 1' },
+        outputs: { master: 'Controllo luminosità principale', masterBrightness: 'Luminosità principale', masterDesc: 'Regola la luminosità di tutte le uscite attive simultaneamente', individual: 'Controllo uscite individuali', output: 'Uscita', pin: 'Pin', brightness: 'Luminosità', interval: 'Intervallo', all: 'TUTTI', on: 'ACCESO', off: 'SPENTO', editName: 'Modifica nome', saveName: 'Salva', cancelEdit: 'Annulla', controls: 'Controlli' }
+    },
+    zh: {
+        nav: { status: '状态', outputs: '输出' },
+        buttons: { refresh: '🔄 刷新', allOn: '💡 全部开启', allOff: '⚫ 全部关闭' },
+        status: { deviceInfo: '设备信息', apIp: 'AP IP地址', clients: '已连接客户端', uptime: '运行时间', freeHeap: '可用内存', macAddr: 'MAC地址', apSsid: 'AP SSID', buildDate: '构建日期', memoryStorage: '内存与存储', ram: '内存', programFlash: '程序闪存', cpuCore0: 'CPU核心0', cpuCore1: 'CPU核心1' },
+        outputs: { master: '主亮度控制', masterBrightness: '主亮度', masterDesc: '同时调整所有活动输出的亮度', individual: '单独输出控制', output: '输出', pin: '引脚', brightness: '亮度', interval: '间隔', all: '全部', on: '开启', off: '关闭', editName: '编辑名称', saveName: '保存', cancelEdit: '取消', controls: '控制' }
+    },
+    hi: {
+        nav: { status: 'स्थिति', outputs: 'आउटपुट' },
+        buttons: { refresh: '🔄 रिफ्रेश', allOn: '💡 सभी चालू', allOff: '⚫ सभी बंद' },
+        status: { deviceInfo: 'डिवाइस जानकारी', apIp: 'AP IP पता', clients: 'कनेक्टेड क्लाइंट', uptime: 'अपटाइम', freeHeap: 'खाली मेमोरी', macAddr: 'MAC पता', apSsid: 'AP SSID', buildDate: 'बिल्ड तिथि', memoryStorage: 'मेमोरी और स्टोरेज', ram: 'रैम', programFlash: 'प्रोग्राम फ्लैश', cpuCore0: 'सीपीयू कोर 0', cpuCore1: 'सीपीयू कोर 1' },
+        outputs: { master: 'मास्टर चमक नियंत्रण', masterBrightness: 'मास्टर चमक', masterDesc: 'सभी सक्रिय आउटपुट की चमक एक साथ समायोजित करता है', individual: 'व्यक्तिगत आउटपुट नियंत्रण', output: 'आउटपुट', pin: 'पिन', brightness: 'चमक', interval: 'अंतराल', all: 'सभी', on: 'चालू', off: 'बंद', editName: 'नाम संपादित करें', saveName: 'सहेजें', cancelEdit: 'रद्द करें', controls: 'नियंत्रण' }
+    }
+};
+
+// Language management
+let currentLang = localStorage.getItem('railhub32_lang') || 'en';
+
+// Output/telemetry model maintained by the WebSocket (null until the first snapshot)
+let deviceInfo = {};
+let deviceStatus = null;
+let statusSeq = 0;
+
+function updateLanguage(lang) {
+    currentLang = lang;
+    localStorage.setItem('railhub32_lang', lang);
+
+    // Update all elements with data-i18n
+    document.querySelectorAll('[data-i18n]').forEach(elem => {
+        const key = elem.getAttribute('data-i18n');
+        const keys = key.split('.');
+        let value = translations[lang];
+        for (const k of keys) {
+            value = value[k];
+        }
+        elem.textContent = value;
+    });
+
+    // Update language buttons
+    document.querySelectorAll('.lang-btn').forEach(btn => {
+        btn.classList.toggle('active', btn.getAttribute('data-lang') === lang);
+    });
+
+    // Reload outputs to update labels
+    if (document.getElementById('outputsContent').classList.contains('active')) {
+        loadOutputs();
+    }
+}
+
+// Language button handlers
+document.querySelectorAll('.lang-btn').forEach(btn => {
+    btn.addEventListener('click', () => {
+        updateLanguage(btn.getAttribute('data-lang'));
+    });
+});
+
+// Initialize language on page load
+updateLanguage(currentLang);
+
+// Tab switching with persistence
+function switchTab(tabName) {
+    document.querySelectorAll('.tab-button').forEach(b => b.classList.remove('active'));
+    document.querySelectorAll('.tab-content').forEach(c => c.classList.remove('active'));
+    document.getElementById(tabName + 'Tab').classList.add('active');
+    document.getElementById(tabName + 'Content').classList.add('active');
+    localStorage.setItem('railhub32_tab', tabName);
+
+    // Load outputs when switching to outputs tab
+    if (tabName === 'outputs') {
+        loadOutputs();
+    }
+}
+
+document.querySelectorAll('.tab-button').forEach(button => {
+    button.addEventListener('click', function() {
+        const tabName = this.id.replace('Tab', '');
+        switchTab(tabName);
+    });
+});
+
+// Restore last selected tab
+const savedTab = localStorage.getItem('railhub32_tab') || 'status';
+switchTab(savedTab);
+
+// Helper function to update status UI from data
+function updateStatusFromData(data) {
+    try {
+        // The page is static; the device name comes with the status
+        if (data.name) {
+            document.getElementById('deviceName').textContent = data.name;
+            document.title = `RailHub32 - ${data.name}`;
+        }
+        
+        // Update uptime
+        const uptimeSeconds = Math.floor(data.uptime / 1000);
+        const hours = Math.floor(uptimeSeconds / 3600);
+        const minutes = Math.floor((uptimeSeconds % 3600) / 60);
+        const seconds = uptimeSeconds % 60;
+        document.getElementById('uptime').textContent = 
+            hours > 0 ? `${hours}h ${minutes}m` : minutes > 0 ? `${minutes}m ${seconds}s` : `${seconds}s`;
+
+        // Update build date
+        if (data.buildDate) {
+            document.getElementById('buildDate').textContent = data.buildDate;
+        }
+
+        // Update RAM bar
+        const totalRam = 320 * 1024;
+        const usedRam = totalRam - data.freeHeap;
+        const ramPct = Math.round((usedRam / totalRam) * 100);
+        document.getElementById('ramFill').style.width = ramPct + '%';
+        document.getElementById('ramText').textContent = 
+            Math.round(usedRam / 1024) + 'KB / 320KB (' + ramPct + '%)';
+
+        // Update Flash bar
+        if (data.flashUsed && data.flashPartition) {
+            const flashPct = Math.round((data.flashUsed / data.flashPartition) * 100);
+            document.getElementById('storageFill').style.width = flashPct + '%';
+            document.getElementById('storageText').textContent = 
+                Math.round(data.flashUsed / 1024) + 'KB / ' + 
+                Math.round(data.flashPartition / 1024) + 'KB (' + flashPct + '%)';
+        }
+
+        // Update CPU Core 0 bar
+        if (data.cpuLoad0 !== undefined) {
+            const cpu0Pct = Math.round(data.cpuLoad0);
+            document.getElementById('cpu0Fill').style.width = cpu0Pct + '%';
+            document.getElementById('cpu0Text').textContent = cpu0Pct + '%';
+        }
+
+        // Update CPU Core 1 bar
+        if (data.cpuLoad1 !== undefined) {
+            const cpu1Pct = Math.round(data.cpuLoad1);
+            document.getElementById('cpu1Fill').style.width = cpu1Pct + '%';
+            document.getElementById('cpu1Text').textContent = cpu1Pct + '%';
+        }
+    } catch (error) {
+        console.error('Error updating status UI:', error);
+    }
+}
+
+// Load status
+async function loadStatus() {
+    try {
+        const response = await fetch('/api/status');
+        const data = await response.json();
+        updateStatusFromData(data);
+        return data;
+    } catch (error) {
+        console.error('Error loading status:', error);
+    }
+}
+
+// Load outputs
+async function loadOutputs() {
+    // Don't update if user is editing a name or interval
+    const activeElement = document.activeElement;
+    if (activeElement && activeElement.id && activeElement.id.startsWith('name-input-')) {
+        return;
+    }
+    if (activeElement && activeElement.className && activeElement.className.includes('interval-input')) {
+        return;
+    }
+
+    // The WebSocket keeps deviceStatus current; HTTP only while it is down
+    let data = deviceStatus;
+    if (!data) {
+        try {
+            const response = await fetch('/api/status');
+            data = await response.json();
+        } catch (err) {
+            console.error('[LOAD] Error:', err);
+            return;
+        }
+    }
+
+    if (!data) return;
+
+    try {
+        // Update master brightness to match first active output (if any)
+        const activeOutputs = data.outputs.filter(o => o.active);
+        if (activeOutputs.length > 0) {
+            const avgBrightness = Math.round(
+                activeOutputs.reduce((sum, o) => sum + o.brightness, 0) / activeOutputs.length
+            );
+            document.getElementById('masterBrightness').value = avgBrightness;
+            document.getElementById('masterBrightnessValue').textContent = avgBrightness + '%';
+        }
+
+        const grid = document.getElementById('outputsGrid');
+        grid.innerHTML = '';
+
+        data.outputs.forEach((output, index) => {
+            const t = translations[currentLang].outputs;
+            // Use default name from current language if output name is empty
+            const displayName = (output.name && output.name.trim() !== '') ? output.name : `${t.output} ${index + 1}`;
+            // Store the actual value from server (empty string if no custom name)
+            const inputValue = output.name || '';
+            const card = document.createElement('div');
+            card.className = 'output-card' + (output.active ? ' active' : '');
+            card.innerHTML = `
+                <div class="output-header">
+                    <div class="output-name" id="name-display-${output.pin}" onclick="editOutputName(${output.pin}, '${inputValue}', ${index})">${displayName}</div>
+                    <div class="output-name-edit" id="name-edit-${output.pin}" style="display: none;">
+                        <input type="text" id="name-input-${output.pin}" value="${inputValue}" placeholder="${t.output} ${index + 1}" maxlength="20" style="width: 130px; padding: 4px; background: var(--color-bg-tertiary); border: 1px solid var(--color-border); color: var(--color-text-primary); border-radius: 4px;">
+                        <button onclick="saveOutputName(${output.pin})" style="padding: 4px 8px; margin-left: 4px; background: var(--color-success); border: none; color: white; border-radius: 4px; cursor: pointer; font-size: 11px;">${t.saveName}</button>
+                        <button onclick="cancelEditName(${output.pin})" style="padding: 4px 8px; margin-left: 2px; background: var(--color-danger); border: none; color: white; border-radius: 4px; cursor: pointer; font-size: 11px;">${t.cancelEdit}</button>
+                    </div>
+                    <div class="output-status ${output.active ? 'on' : 'off'}" data-pin="${output.pin}">
+                        ${output.active ? t.on : t.off}
+                    </div>
+                </div>
+                <div class="output-info">
+                    <div><strong>${t.pin}:</strong> GPIO ${output.pin}</div>
+                    <div class="toggle-switch ${output.active ? 'active' : ''}" 
+                         data-pin="${output.pin}" 
+                         onclick="toggleOutput(${output.pin})">
+                    </div>
+                </div>
+                <div class="output-controls">
+                    <div class="control-inputs">
+                        <div class="brightness-control">
+                            <span class="brightness-label">${t.brightness}</span>
+                            <input type="range" 
+                                   class="brightness-slider" 
+                                   min="0" max="100" 
+                                   value="${output.brightness}" 
+                                   data-pin="${output.pin}"
+                                   onchange="setBrightness(${output.pin}, this.value)">
+                            <span class="brightness-value">${output.brightness}%</span>
+                        </div>
+                        <div class="interval-control">
+                            <span class="interval-label">${t.interval}:</span>
+                            <input type="number" 
+                                   class="interval-input" 
+                                   min="0"
+                                   step="100"
+                                   placeholder="0" 
+                                   value="${output.interval || 0}" 
+                                   data-pin="${output.pin}"
+                                   onchange="setInterval(${output.pin}, this.value)">
+                            <span class="interval-unit">ms</span>
+                        </div>
+                    </div>
+                </div>
+            `;
+            grid.appendChild(card);
+        });
+    } catch (error) {
+        console.error('Error loading outputs:', error);
+    }
+}
+
+// Toggle output
+async function toggleOutput(pin) {
+    try {
+        const toggle = document.querySelector(`.toggle-switch[data-pin="${pin}"]`);
+        const isActive = toggle.classList.contains('active');
+        const brightness = document.querySelector(`.brightness-slider[data-pin="${pin}"]`).value;
+
+        const response = await sendCommand('control', {
+            pin: pin,
+            active: !isActive,
+            brightness: parseInt(brightness)
+        });
+
+        if (response.ok) {
+            await loadOutputs();
+            // Clear All On/Off active states since individual control was used
+            document.getElementById('btnAllOn').classList.remove('active');
+            document.getElementById('btnAllOff').classList.remove('active');
+        }
+    } catch (error) {
+        console.error('Error toggling output:', error);
+    }
+}
+
+// Set brightness
+async function setBrightness(pin, brightness) {
+    try {
+        const toggle = document.querySelector(`.toggle-switch[data-pin="${pin}"]`);
+        const isActive = toggle.classList.contains('active');
+
+        const response = await sendCommand('control', {
+            pin: pin,
+            active: isActive,
+            brightness: parseInt(brightness)
+        });
+
+        if (response.ok) {
+            await loadOutputs();
+            // Clear All On/Off active states since individual control was used
+            document.getElementById('btnAllOn').classList.remove('active');
+            document.getElementById('btnAllOff').classList.remove('active');
+        }
+    } catch (error) {
+        console.error('Error setting brightness:', error);
+    }
+}
+
+// Set interval
+async function setInterval(pin, interval) {
+    try {
+        const response = await sendCommand('interval', {
+            pin: pin,
+            interval: parseInt(interval) || 0
+        });
+
+        if (response.ok) {
+            console.log(`Interval set for pin ${pin}: ${interval}ms`);
+        }
+    } catch (error) {
+        console.error('Error setting interval:', error);
+    }
+}
+
+// Send one batch command for many outputs; applied, saved and broadcast once
+async function controlBatch(command) {
+    const response = await sendCommand('batch', command);
+    if (!response.ok) {
+        throw new Error(`Batch control failed: ${response.status}`);
+    }
+}
+
+// All On with visual feedback
+let isProcessing = false;
+async function allOn() {
+    const btn = document.getElementById('btnAllOn');
+    if (isProcessing) return;
+
+    isProcessing = true;
+    btn.classList.add('processing');
+    btn.disabled = true;
+
+    try {
+        await controlBatch({ select: 'all', active: true, brightness: 100 });
+        await loadOutputs();
+        // Mark All On as active, All Off as inactive
+        btn.classList.add('active');
+        document.getElementById('btnAllOff').classList.remove('active');
+    } catch (error) {
+        console.error('Error turning all on:', error);
+    } finally {
+        btn.classList.remove('processing');
+        btn.disabled = false;
+        isProcessing = false;
+    }
+}
+
+// All Off with visual feedback
+async function allOff() {
+    const btn = document.getElementById('btnAllOff');
+    if (isProcessing) return;
+
+    isProcessing = true;
+    btn.classList.add('processing');
+    btn.disabled = true;
+
+    try {
+        await controlBatch({ select: 'all', active: false, brightness: 0 });
+        await loadOutputs();
+        // Mark All Off as active, All On as inactive
+        btn.classList.add('active');
+        document.getElementById('btnAllOn').classList.remove('active');
+    } catch (error) {
+        console.error('Error turning all off:', error);
+    } finally {
+        btn.classList.remove('processing');
+        btn.disabled = false;
+        isProcessing = false;
+    }
+}
+
+// Master Brightness Control (Status tab)
+async function setMasterBrightness(val) {
+    try {
+        // Only outputs that are on get the new brightness
+        await controlBatch({ select: 'active', brightness: parseInt(val) });
+        await loadOutputs();
+    } catch (error) {
+        console.error('Error setting master brightness:', error);
+    }
+}
+
+// Output name editing functions
+function editOutputName(pin, currentName, index) {
+    document.getElementById(`name-display-${pin}`).style.display = 'none';
+    document.getElementById(`name-edit-${pin}`).style.display = 'block';
+    const inputField = document.getElementById(`name-input-${pin}`);
+    inputField.focus();
+    inputField.select();
+}
+
+function cancelEditName(pin) {
+    document.getElementById(`name-display-${pin}`).style.display = 'block';
+    document.getElementById(`name-edit-${pin}`).style.display = 'none';
+}
+
+async function saveOutputName(pin) {
+    const newName = document.getElementById(`name-input-${pin}`).value.trim();
+    try {
+        const response = await sendCommand('name', {
+            pin: pin,
+            name: newName
+        });
+
+        if (response.ok) {
+            await loadOutputs();
+        } else {
+            alert('Failed to save name');
+            cancelEditName(pin);
+        }
+    } catch (error) {
+        console.error('Error saving name:', error);
+        alert('Error saving name');
+        cancelEditName(pin);
+    }
+}
+
+// WebSocket connection, also used as the command channel
+let ws;
+const wsUrl = `ws://${window.location.host}/ws`;
+
+// Status model kept in sync by the socket: "hello" (static info) and
+// "snapshot" on connect, then "delta" messages with only the changed
+// outputs and "telemetry" heartbeats. A sequence gap triggers a resync.
+function applyStatusMessage(msg) {
+    switch (msg.type) {
+        case 'hello':
+            deviceInfo = msg;
+            // Switch snapshots and deltas to binary frames if the firmware has them
+            if (msg.binaryStatus === 1) {
+                sendCommand('hello', { format: 'binary' }).catch(() => {});
+            }
+            return false;
+        case 'snapshot':
+            deviceStatus = Object.assign({}, deviceInfo, msg);
+            statusSeq = msg.seq;
+            return true;
+        case 'delta':
+            if (!deviceStatus || msg.seq !== statusSeq + 1) {
+                sendCommand('snapshot', {}).catch(() => {});
+                return false;
+            }
+            statusSeq = msg.seq;
+            msg.outputs.forEach(changed => {
+                const i = deviceStatus.outputs.findIndex(o => o.pin === changed.pin);
+                // Binary deltas leave out unchanged names
+                if (i >= 0) Object.assign(deviceStatus.outputs[i], changed);
+            });
+            return true;
+        case 'telemetry':
+            if (!deviceStatus) return false;
+            if (msg.seq !== statusSeq) {
+                sendCommand('snapshot', {}).catch(() => {});
+            }
+            Object.assign(deviceStatus, msg);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Binary snapshot/delta frame (lib/RailHubCore/status_frame.h) in the JSON message shape
+function decodeStatusFrame(buffer) {
+    const view = new DataView(buffer);
+    const bytes = new Uint8Array(buffer);
+    const count = view.getUint8(2);
+    const nameCount = view.getUint8(3);
+    const mask = view.getUint32(8, true);
+    const msg = {
+        type: view.getUint8(0) === 1 ? 'snapshot' : 'delta',
+        seq: view.getUint32(4, true),
+        outputs: []
+    };
+
+    const byIndex = {};
+    const bits = 12;
+    const brightness = bits + ((count + 7) >> 3);
+    let p = brightness + count;
+    for (let i = 0, k = 0; i < 32; i++) {
+        if (!(mask & (1 << i))) continue;
+        let interval = 0;
+        for (let shift = 0; ; shift += 7) {
+            const b = bytes[p++];
+            interval += (b & 0x7F) * Math.pow(2, shift);
+            if (!(b & 0x80)) break;
+        }
+        const output = {
+            pin: deviceInfo.pins[i],
+            active: ((bytes[bits + (k >> 3)] >> (k & 7)) & 1) === 1,
+            brightness: bytes[brightness + k],
+            interval: interval
+        };
+        byIndex[i] = output;
+        msg.outputs.push(output);
+        k++;
+    }
+
+    const utf8 = new TextDecoder();
+    for (let n = 0; n < nameCount; n++) {
+        const index = bytes[p];
+        const length = bytes[p + 1];
+        byIndex[index].name = utf8.decode(bytes.subarray(p + 2, p + 2 + length));
+        p += 2 + length;
+    }
+    return msg;
+}
+
+// Commands go over the open socket and resolve on the matching ack;
+// while the socket is down they fall back to the HTTP endpoints
+const commandEndpoints = {
+    control: '/api/control',
+    interval: '/api/interval',
+    name: '/api/name',
+    batch: '/api/control/batch'
+};
+const pendingCommands = new Map();
+let nextCommandId = 1;
+
+function sendCommand(cmd, fields) {
+    if (!ws || ws.readyState !== WebSocket.OPEN) {
+        return fetch(commandEndpoints[cmd], {
+            method: 'POST',
+            headers: { 'Content-Type': 'application/json' },
+            body: JSON.stringify(fields)
+        });
+    }
+
+    const id = nextCommandId++;
+    return new Promise((resolve, reject) => {
+        const timer = setTimeout(() => {
+            pendingCommands.delete(id);
+            reject(new Error(`No ack for ${cmd} #${id}`));
+        }, 3000);
+        pendingCommands.set(id, { resolve, timer });
+        ws.send(JSON.stringify({ id: id, cmd: cmd, ...fields }));
+    });
+}
+
+function handleCommandAck(ack) {
+    const pending = pendingCommands.get(ack.id);
+    if (!pending) return;
+    pendingCommands.delete(ack.id);
+    clearTimeout(pending.timer);
+    pending.resolve({ ok: ack.status === 200, status: ack.status, error: ack.error });
+}
+
+function connectWebSocket() {
+    ws = new WebSocket(wsUrl);
+    ws.binaryType = 'arraybuffer';
+
+    ws.onopen = () => {
+        console.log('[WS] Connected');
+    };
+
+    ws.onmessage = (e) => {
+        try {
+            const data = e.data instanceof ArrayBuffer ? decodeStatusFrame(e.data) : JSON.parse(e.data);
+            if (data.type === 'ack') {
+                handleCommandAck(data);
+                return;
+            }
+            if (!applyStatusMessage(data)) return;
+            // Don't update during bulk operations
+            if (!isProcessing) {
+                updateStatusFromData(deviceStatus);
+                if (data.type !== 'telemetry' && document.getElementById('outputsContent').classList.contains('active')) {
+                    loadOutputs();
+                }
+            }
+        } catch (err) {
+            console.error('[WS] Parse error:', err);
+        }
+    };
+
+    ws.onerror = (error) => {
+        console.error('[WS] Error:', error);
+    };
+
+    ws.onclose = () => {
+        // Stale until the next snapshot
+        deviceStatus = null;
+        console.log('[WS] Disconnected. Reconnecting in 3s...');
+        setTimeout(connectWebSocket, 3000);
+    };
+}
+
+// Initial load
+loadStatus();
+if (savedTab === 'outputs') {
+    loadOutputs();
+}
+
+// Connect WebSocket
+connectWebSocket();
@@ -17,6 +17,14 @@
 #define DEVICE_NAME "ESP8266-Controller-01"
 #define MAX_OUTPUTS 7                    // ESP8266 - using 7 outputs (GPIO 0 reserved for boot button)
 
+// Web Server Configuration
+#define MAX_HTTP_CONNECTIONS 4                  // Concurrent HTTP requests; more are answered with 503
+#define BODY_POOL_SLOTS 2                       // POST bodies assembled at the same time
+#define MAX_BODY_SIZE 1024                      // Larger bodies are refused with 413
+
+// Effect Engine Configuration
+#define EFFECT_TICK_MS 1                        // Period of the Ticker effect tick (blink/chase stepping)
+
 // WiFiManager Configuration
 #define WIFIMANAGER_AP_SSID "RailHub8266-Setup"  // Configuration portal AP name
 #define WIFIMANAGER_AP_PASSWORD "12345678"       // AP password (min 8 characters)
@@ -34,6 +42,7 @@
 #define STATUS_LED_PIN 2  // D4 on NodeMCU (built-in LED, active LOW)
 
 // EEPROM Configuration
-#define EEPROM_SIZE 512   // Allocate 512 bytes for configuration storage
+#define EEPROM_SIZE 512   // Legacy emulated EEPROM, read once to migrate into the journal
+#define JOURNAL_SECTORS 4 // Flash sectors (4 KB each) used round-robin by the settings journal
 
 #endif
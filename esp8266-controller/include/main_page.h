@@ -0,0 +1,328 @@
+/**
+ * @file main_page.h
+ * @brief The web UI page, split around the device name for fillPage()
+ *
+ * Kept out of main.cpp so the native page test streams the page the
+ * firmware serves.
+ */
+
+#ifndef MAIN_PAGE_H
+#define MAIN_PAGE_H
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#include <page_stream.h>
+
+// Main page, stored in flash and streamed by fillPage() in pieces the size the
+// connection asks for; the device name goes between the two parts
+static const char PAGE_HEAD[] PROGMEM =
+    // Header chunk
+    "<!DOCTYPE html><html><head><meta charset='UTF-8'><meta name='viewport' content='width=device-width,initial-scale=1,maximum-scale=1,user-scalable=no'>"
+    "<title>RailHub8266</title><style>*{margin:0;padding:0;box-sizing:border-box}body{font-family:-apple-system,BlinkMacSystemFont,'Segoe UI',Arial,sans-serif;background:#1a1a1a;color:#e0e0e0;padding:15px;max-width:1200px;margin:0 auto}"
+    ".card{background:#2a2a2a;border:1px solid #3a3a3a;padding:15px;margin-bottom:15px;border-radius:8px}h1{font-size:1.5rem;margin-bottom:10px}h2{font-size:1.2rem;margin-bottom:10px}"
+    ".status{display:grid;grid-template-columns:repeat(auto-fit,minmax(140px,1fr));gap:10px;margin-bottom:20px}.stat{background:#333;padding:12px;text-align:center;border-radius:6px}"
+    ".value{font-size:1.5rem;color:#6c9bcf}.label{font-size:0.8rem;color:#999;margin-top:5px}"
+    ".outputs{display:grid;grid-template-columns:repeat(auto-fit,minmax(280px,1fr));gap:10px}.output{background:#333;padding:12px;display:flex;flex-direction:column;gap:10px;border-radius:6px}"
+    ".output-header{display:flex;justify-content:space-between;align-items:center;gap:10px}"
+    ".output-controls{display:flex;flex-direction:column;gap:8px;width:100%}"
+    ".output.on{border-left:4px solid #4a9b6f}.output.blinking{border-left:4px solid #f39c12}.toggle{width:60px;height:32px;background:#555;cursor:pointer;position:relative;border-radius:16px;flex-shrink:0}"
+    ".toggle.on{background:#4a9b6f}.toggle::after{content:'';position:absolute;width:28px;height:28px;background:#fff;top:2px;left:2px;transition:0.2s;border-radius:50%}"
+    ".toggle.on::after{left:30px}.brightness{display:flex;align-items:center;gap:10px}"
+    ".brightness input{flex:1;height:8px;border-radius:4px;background:#555;outline:none;-webkit-appearance:none;min-width:0}"
+    ".brightness input::-webkit-slider-thumb{-webkit-appearance:none;width:20px;height:20px;border-radius:50%;background:#6c9bcf;cursor:pointer;box-shadow:0 2px 4px rgba(0,0,0,0.3)}"
+    ".brightness input::-moz-range-thumb{width:20px;height:20px;border-radius:50%;background:#6c9bcf;cursor:pointer;border:none;box-shadow:0 2px 4px rgba(0,0,0,0.3)}"
+    ".brightness span{min-width:45px;text-align:right;font-size:0.9rem;color:#999}"
+    ".interval{display:flex;align-items:center;gap:8px;flex-wrap:wrap}"
+    ".interval input{width:80px;padding:6px 8px;background:#555;border:1px solid #666;color:#fff;border-radius:4px;font-size:0.9rem}"
+    ".interval span{font-size:0.85rem;color:#999}"
+    ".output.chasing{border-left:4px solid #9b59b6}"
+    ".chasing-group{background:#3a2a4a;padding:12px;margin-bottom:10px;border-left:4px solid #9b59b6;border-radius:6px}"
+    ".chasing-group h3{font-size:1rem;margin-bottom:8px;color:#bb79d6;cursor:pointer;word-break:break-word;display:flex;align-items:center;gap:8px}"
+    ".chasing-group h3:hover{color:#d699f0}"
+    ".chasing-group h3::before{content:'⚡';font-size:1.1rem}"
+    ".group-info{font-size:0.85rem;color:#b8b8b8;word-break:break-word;margin-bottom:10px;line-height:1.4}"
+    ".group-controls{display:flex;gap:8px;flex-wrap:wrap;margin-top:10px}"
+    ".output-name{cursor:pointer;font-weight:bold;color:#6c9bcf;word-break:break-word;flex:1}"
+    ".output-name:hover{color:#8bb5e0;text-decoration:underline}"
+    "button{background:#6c9bcf;color:#fff;border:none;padding:10px 20px;cursor:pointer;margin:5px 5px 5px 0;border-radius:6px;font-size:0.95rem;touch-action:manipulation;transition:background 0.3s,transform 0.1s}"
+    "button:hover{background:#5a8bc0}button:active{transform:scale(0.98)}button.processing{background:#4caf50!important;cursor:wait;transform:scale(1)!important}button.processing::before{content:'✓ ';font-size:1.3rem;font-weight:bold}"
+    "button.state-match{background:#4caf50!important;color:#fff;box-shadow:0 0 0 2px rgba(255,255,255,0.15) inset}"
+    "button:disabled{opacity:0.8;cursor:wait}button.delete{background:#e74c3c}button.delete:hover{background:#c0392b}"
+    ".info{font-size:0.9rem;color:#999}"
+    ".tabs{display:flex;gap:5px;margin-bottom:15px;overflow-x:auto;-webkit-overflow-scrolling:touch}.tab{background:#333;padding:12px 20px;cursor:pointer;border:none;color:#999;white-space:nowrap;border-radius:6px 6px 0 0;touch-action:manipulation}"
+    ".tab.active{background:#6c9bcf;color:#fff}.tab-content{display:none}.tab-content.active{display:block}"
+    ".storage-bar{background:#333;height:24px;border-radius:4px;overflow:hidden;margin-top:5px;position:relative}"
+    ".storage-fill{background:linear-gradient(90deg,#4a9b6f,#f39c12);height:100%;transition:width 0.3s}"
+    ".storage-text{position:absolute;top:4px;left:0;right:0;text-align:center;font-size:0.75rem;color:#fff;text-shadow:1px 1px 2px rgba(0,0,0,0.8)}"
+    ".modal{display:none;position:fixed;top:0;left:0;width:100%;height:100%;background:rgba(0,0,0,0.8);z-index:1000;align-items:center;justify-content:center;padding:20px}"
+    ".modal.show{display:flex}"
+    ".modal-content{background:#2a2a3a;padding:20px;border-radius:12px;width:100%;max-width:400px;box-shadow:0 4px 20px rgba(0,0,0,0.5)}"
+    ".modal-header{font-size:1.2rem;font-weight:bold;margin-bottom:15px;color:#6c9bcf}"
+    ".modal-input{width:100%;padding:12px;background:#555;border:1px solid #666;color:#fff;border-radius:6px;font-size:1rem;margin-bottom:15px}"
+    ".modal-input:focus{outline:none;border-color:#6c9bcf}"
+    ".modal-buttons{display:flex;gap:10px;justify-content:flex-end;flex-wrap:wrap}"
+    ".modal-buttons button{min-width:80px;flex:1}"
+    ".modal-buttons .cancel{background:#666}"
+    ".modal-buttons .cancel:hover{background:#555}"
+    ".control-buttons{display:flex;flex-wrap:wrap;gap:5px}"
+    ".form-group{margin-bottom:15px}"
+    ".form-group label{display:block;margin-bottom:5px;color:#999;font-size:0.9rem}"
+    ".form-group input[type=number],.form-group input[type=text]{width:100%;max-width:200px;padding:8px;background:#555;border:1px solid #666;color:#fff;border-radius:4px;font-size:0.95rem}"
+    ".checkbox-grid{display:grid;grid-template-columns:repeat(auto-fill,minmax(120px,1fr));gap:8px;padding:8px;background:#333;border-radius:4px}"
+    ".checkbox-label{display:flex;align-items:center;gap:10px;padding:10px 12px;background:#444;border-radius:4px;cursor:pointer;transition:background 0.2s}"
+    ".checkbox-label:hover:not(.disabled){background:#505050}"
+    ".checkbox-label input[type=checkbox]{appearance:none;-webkit-appearance:none;cursor:pointer;width:20px;height:20px;margin:0;flex-shrink:0;background:#555;border:2px solid #666;border-radius:4px;transition:all 0.2s;display:flex;align-items:center;justify-content:center}"
+    ".checkbox-label input[type=checkbox]:checked{background:#6c9bcf;border-color:#6c9bcf}"
+    ".checkbox-label input[type=checkbox]:checked::before{content:'✓';color:#fff;font-size:14px;font-weight:bold;line-height:1}"
+    ".checkbox-label input[type=checkbox]:disabled{opacity:0.4;cursor:not-allowed}"
+    ".checkbox-label.disabled{opacity:0.5;cursor:not-allowed}"
+    ".checkbox-label span{line-height:1.3;word-break:break-word;font-size:0.9rem}"
+    ".no-groups{text-align:center;padding:20px;color:#666;font-style:italic}"
+    "@media(min-width:768px){.output{flex-direction:row}.output-header{flex:0 0 auto}.output-controls{width:auto;flex:1}}"
+    "@media(max-width:480px){body{padding:10px}.card{padding:12px}h1{font-size:1.3rem}h2{font-size:1.1rem}button{padding:8px 16px;font-size:0.9rem}.toggle{width:50px;height:28px}.toggle::after{width:24px;height:24px}.toggle.on::after{left:24px}.stat{padding:10px}.value{font-size:1.3rem}}"
+    "</style></head><body>"
+    
+    // Modal dialog for name editing
+    "<div id='nameModal' class='modal'><div class='modal-content'>"
+    "<div class='modal-header' id='modalTitle'>Edit Name</div>"
+    "<input type='text' id='modalInput' class='modal-input' maxlength='20' placeholder='Enter name...'>"
+    "<div class='modal-buttons'>"
+    "<button class='cancel' onclick='closeModal()'>Cancel</button>"
+    "<button onclick='saveModalName()'>Save</button>"
+    "</div></div></div>"
+    
+    // Confirmation modal
+    "<div id='confirmModal' class='modal'><div class='modal-content'>"
+    "<div class='modal-header' id='confirmTitle'>Confirm</div>"
+    "<div id='confirmMessage' style='margin-bottom:20px;color:#ccc'></div>"
+    "<div class='modal-buttons'>"
+    "<button class='cancel' onclick='closeConfirm()'>Cancel</button>"
+    "<button class='delete' onclick='confirmYes()'>Delete</button>"
+    "</div></div></div>"
+    
+    // Alert modal
+    "<div id='alertModal' class='modal'><div class='modal-content'>"
+    "<div class='modal-header' id='alertTitle'>Alert</div>"
+    "<div id='alertMessage' style='margin-bottom:20px;color:#ccc'></div>"
+    "<div class='modal-buttons'>"
+    "<button onclick='closeAlert()'>OK</button>"
+    "</div></div></div>"
+    
+    // Body start
+    "<div class='card'><h1>🚂 RailHub8266</h1><p class='info'>";
+
+static const char PAGE_TAIL[] PROGMEM =
+    "</p></div><div class='card'><div class='tabs'>"
+    "<button class='tab active' onclick='showTab(0)'>Status</button>"
+    "<button class='tab' onclick='showTab(1)'>Settings</button>"
+    "</div><div class='tab-content active' id='tab0'><h2>Status</h2><div class='status'>"
+    "<div class='stat'><div class='value' id='uptime'>-</div><div class='label'>Uptime</div></div>"
+    "<div class='stat'><div class='value' id='buildDate'>-</div><div class='label'>Build Date</div></div>"
+    "</div><div style='margin-top:15px'><div class='label'>RAM (80 KB)</div>"
+    "<div class='storage-bar'><div class='storage-fill' id='ramFill' style='width:0%'></div>"
+    "<div class='storage-text' id='ramText'>-</div></div></div>"
+    "<div style='margin-top:15px'><div class='label'>Program Flash (1 MB)</div>"
+    "<div class='storage-bar'><div class='storage-fill' id='storageFill' style='width:0%'></div>"
+    "<div class='storage-text' id='storageText'>-</div></div></div>"
+    "<div style='margin-top:20px'><h2>Controls</h2>"
+    "<div class='control-buttons'><button id='btnAllOn' onclick='allOn()'>All ON</button><button id='btnAllOff' onclick='allOff()'>All OFF</button></div>"
+    "<div class='brightness' style='margin-top:15px'><label style='display:block;margin-bottom:5px;color:#999;font-size:0.9rem'>Master Brightness:</label>"
+    "<input type='range' min='0' max='100' value='100' id='masterBrightness' oninput='this.nextElementSibling.textContent=this.value+\"%\"' onchange='setMasterBrightness(this.value)'>"
+    "<span style='color:#6c9bcf;font-weight:bold'>100%</span></div>"
+    "</div></div><div class='tab-content' id='tab1'><h2>Chasing Light Groups</h2>"
+    "<div style='background:#333;padding:15px;border-radius:6px;margin-bottom:15px'>"
+    "<div class='form-group'><label>Group ID:</label>"
+    "<input type='number' id='newGroupId' min='1' max='255' value='1'></div>"
+    "<div class='form-group'><label>Interval (ms):</label>"
+    "<input type='text' id='newGroupInterval' value='500'></div>"
+    "<div class='form-group'><label>Select Outputs (min. 2):</label>"
+    "<div id='outputSelector' class='checkbox-grid'></div></div>"
+    "<button onclick='createGroup()'>Create Group</button>"
+    "</div><div id='chasingGroups'></div>"
+    "<h2 style='margin-top:20px'>Outputs</h2><div class='outputs' id='outputs'></div></div></div>"
+    
+    // JavaScript chunk
+    "<script>function showTab(n){localStorage.setItem('activeTab',n);document.querySelectorAll('.tab').forEach((t,i)=>t.classList.toggle('active',i===n));"
+    "document.querySelectorAll('.tab-content').forEach((c,i)=>c.classList.toggle('active',i===n));}"
+    "let wsData=null;let bulkState=null;async function load(){let d;if(wsData||lastStatus){d=wsData||lastStatus;wsData=null;}else{try{const r=await fetch('/api/status');d=await r.json();}catch(err){console.error('[LOAD] Error:',err);return;}}if(!d)return;try{const activeEl=document.activeElement;const isFocused=activeEl&&activeEl.tagName==='INPUT'&&activeEl.type==='text'&&activeEl.closest('.interval');"
+    "const focusedPin=isFocused?activeEl.closest('.output')?.querySelector('.output-name')?.getAttribute('onclick')?.match(/\\d+/)?.[0]:null;"
+    "const cursorPos=isFocused?activeEl.selectionStart:null;const focusedVal=isFocused?activeEl.value:null;"
+    "const usedRam=80-(d.freeHeap/1024);const ramPct=Math.round((usedRam/80)*100);"
+    "document.getElementById('ramFill').style.width=ramPct+'%';"
+    "document.getElementById('ramText').textContent=usedRam.toFixed(1)+'KB / 80KB ('+ramPct+'%)';"
+    "const s=Math.floor(d.uptime/1000);document.getElementById('uptime').textContent=s+'s';"
+    "if(d.buildDate)document.getElementById('buildDate').textContent=d.buildDate;"
+    "if(d.flashUsed&&d.flashPartition){const pct=Math.round((d.flashUsed/d.flashPartition)*100);"
+    "document.getElementById('storageFill').style.width=pct+'%';"
+    "document.getElementById('storageText').textContent=(d.flashUsed/1024).toFixed(0)+'KB / '+(d.flashPartition/1024).toFixed(0)+'KB ('+pct+'%)';}"
+    "const sel=document.getElementById('outputSelector');"
+    "const checked=[];document.querySelectorAll('#outputSelector input:checked').forEach(cb=>checked.push(cb.value));"
+    "sel.innerHTML='';"
+    "d.outputs.forEach(out=>{"
+    "const lbl=document.createElement('label');lbl.className='checkbox-label';"
+    "if(out.chasingGroup>=0)lbl.classList.add('disabled');"
+    "const cb=document.createElement('input');cb.type='checkbox';cb.value=out.pin;cb.id='out_'+out.pin;"
+    "cb.disabled=out.chasingGroup>=0;"
+    "if(out.chasingGroup<0&&checked.includes(out.pin.toString()))cb.checked=true;"
+    "lbl.appendChild(cb);"
+    "const outName=out.name||'GPIO '+out.pin;"
+    "const span=document.createElement('span');span.textContent=outName;span.style.fontSize='0.85rem';"
+    "lbl.appendChild(span);"
+    "sel.appendChild(lbl);});"
+    "const cg=document.getElementById('chasingGroups');cg.innerHTML='';"
+    "if(d.chasingGroups&&d.chasingGroups.length>0){"
+    "d.chasingGroups.forEach(g=>{"
+    "const div=document.createElement('div');div.className='chasing-group';"
+    "const outNames=g.outputs.map(pin=>{const o=d.outputs.find(x=>x.pin===pin);return o?(o.name||'GPIO '+pin):'GPIO '+pin;}).join(', ');"
+    "div.innerHTML=`<h3 onclick='editGName(${g.groupId},\"${g.name}\")'>${g.name}</h3>"
+    "<div class='group-info'><strong>Outputs:</strong> ${outNames}<br><strong>Interval:</strong> ${g.interval}ms</div>"
+    "<div class='group-controls'><button class='delete' onclick='deleteGroup(${g.groupId})'>Delete Group</button></div>`;"
+    "cg.appendChild(div);});}else{cg.innerHTML='<div class=\"no-groups\">No active groups</div>';}"
+    "const o=document.getElementById('outputs');o.innerHTML='';"
+    "d.outputs.forEach((out,i)=>{"
+    "const div=document.createElement('div');"
+    "let cls='output'+(out.active?' on':'')+(out.interval>0?' blinking':'')+(out.chasingGroup>=0?' chasing':'');"
+    "div.className=cls;"
+    "let groupTag='';"
+    "if(out.chasingGroup>=0){const grp=d.chasingGroups.find(g=>g.groupId===out.chasingGroup);groupTag=grp?' ['+grp.name+']':' [G'+out.chasingGroup+']';}"
+    "div.innerHTML=`<div class='output-header'><span class='output-name' onclick='editOName(${out.pin},\"${out.name}\")'>${out.name || 'GPIO '+out.pin}${groupTag}</span>"
+    "<div class='toggle ${out.active?'on':''}' onclick='tog(${out.pin})'></div></div>"
+    "<div class='output-controls'><div class='brightness'><input type='range' min='0' max='100' value='${out.brightness}' "
+    "oninput='this.nextElementSibling.textContent=this.value+\"%\"' onchange='setBright(${out.pin},this.value)'>"
+    "<span>${out.brightness}%</span></div>"
+    "<div class='interval'><span>Interval:</span><input type='text' value='${out.interval}' "
+    "onchange='setInt(${out.pin},this.value)' ${out.chasingGroup>=0?'disabled':''}><span>ms</span></div></div>`;"
+    "o.appendChild(div);});"
+    "if(focusedPin){const inputs=document.querySelectorAll('.interval input[type=text]');"
+    "inputs.forEach(inp=>{const pin=inp.closest('.output')?.querySelector('.output-name')?.getAttribute('onclick')?.match(/\\d+/)?.[0];"
+    "if(pin===focusedPin){inp.focus();if(cursorPos!==null){inp.setSelectionRange(cursorPos,cursorPos);inp.value=focusedVal||inp.value;}}});}"
+    "const btnOn=document.getElementById('btnAllOn');const btnOff=document.getElementById('btnAllOff');"
+    "const everyOn=d.outputs.length>0&&d.outputs.every(out=>out.active);"
+    "const everyOff=d.outputs.length>0&&d.outputs.every(out=>!out.active);"
+    "bulkState=everyOn?'on':everyOff?'off':null;"
+    "if(btnOn)btnOn.classList.toggle('state-match',bulkState==='on');"
+    "if(btnOff)btnOff.classList.toggle('state-match',bulkState==='off');"
+    "}catch(e){console.error(e);}}"
+    
+    // Commands go over the open WebSocket and resolve on the matching ack; HTTP while it is down
+    "const cmdUrls={control:'/api/control',interval:'/api/interval',name:'/api/name',batch:'/api/control/batch',"
+    "'chasing.create':'/api/chasing/create','chasing.delete':'/api/chasing/delete'};const pendingCmds=new Map();let nextCmdId=1;let lastStatus=null;"
+    "function sendCommand(cmd,fields){if(!ws||ws.readyState!==WebSocket.OPEN){return fetch(cmdUrls[cmd],{method:'POST',"
+    "headers:{'Content-Type':'application/json'},body:JSON.stringify(fields)});}const id=nextCmdId++;"
+    "return new Promise((resolve,reject)=>{const timer=setTimeout(()=>{pendingCmds.delete(id);reject(new Error('No ack for '+cmd+' #'+id));},3000);"
+    "pendingCmds.set(id,{resolve,timer});ws.send(JSON.stringify(Object.assign({id:id,cmd:cmd},fields)));});}"
+    "function cmdAck(a){const p=pendingCmds.get(a.id);if(!p)return;pendingCmds.delete(a.id);clearTimeout(p.timer);"
+    "p.resolve({ok:a.status===200,status:a.status,error:a.error});}"
+    "async function outputStatus(pin){const d=lastStatus||await(await fetch('/api/status')).json();return d.outputs.find(o=>o.pin===pin);}"
+    
+    // Status model: hello + snapshot on connect, then deltas and telemetry; a sequence gap requests a new snapshot
+    "let devInfo={};let statusSeq=0;function resync(){sendCommand('snapshot',{}).catch(()=>{});}"
+    "function applyStatus(m){if(m.type==='hello'){devInfo=m;return false;}"
+    "if(m.type==='snapshot'){lastStatus=Object.assign({},devInfo,m);statusSeq=m.seq;return true;}"
+    "if(!lastStatus)return false;"
+    "if(m.type==='delta'){if(m.seq!==statusSeq+1){resync();return false;}statusSeq=m.seq;"
+    "m.outputs.forEach(c=>{const i=lastStatus.outputs.findIndex(o=>o.pin===c.pin);if(i>=0)lastStatus.outputs[i]=c;});"
+    "if(m.chasingGroups)lastStatus.chasingGroups=m.chasingGroups;return true;}"
+    "if(m.type==='telemetry'){if(m.seq!==statusSeq)resync();Object.assign(lastStatus,m);return true;}return false;}"
+    
+    "async function tog(pin){try{const out=await outputStatus(pin);"
+    "await sendCommand('control',{pin:pin,active:!out.active,brightness:out.brightness});load();}catch(e){console.error(e);}}"
+    
+    "async function setBright(pin,val){try{const out=await outputStatus(pin);"
+    "await sendCommand('control',{pin:pin,active:out.active,brightness:parseInt(val)});}catch(e){console.error(e);}}"
+    
+    "async function setInt(pin,val){try{await sendCommand('interval',{pin:pin,interval:parseInt(val)||0});}catch(e){console.error(e);}}"
+    
+    "let confirmCallback=null;function openConfirm(title,message,callback){"
+    "document.getElementById('confirmTitle').textContent=title;"
+    "document.getElementById('confirmMessage').textContent=message;"
+    "confirmCallback=callback;"
+    "document.getElementById('confirmModal').classList.add('show');}"
+    "function closeConfirm(){document.getElementById('confirmModal').classList.remove('show');confirmCallback=null;}"
+    "function confirmYes(){if(confirmCallback){confirmCallback();}closeConfirm();}"
+    "document.getElementById('confirmModal').addEventListener('click',e=>{"
+    "if(e.target.id==='confirmModal'){closeConfirm();}});"
+    
+    "function showAlert(title,message){"
+    "document.getElementById('alertTitle').textContent=title;"
+    "document.getElementById('alertMessage').textContent=message;"
+    "document.getElementById('alertModal').classList.add('show');}"
+    "function closeAlert(){document.getElementById('alertModal').classList.remove('show');}"
+    "document.getElementById('alertModal').addEventListener('click',e=>{"
+    "if(e.target.id==='alertModal'){closeAlert();}});"
+    
+    "async function deleteGroup(gid){"
+    "openConfirm('Delete Group','Are you sure you want to delete this chasing group?',async()=>{"
+    "try{await sendCommand('chasing.delete',{groupId:gid});load();}catch(e){console.error(e);}});}"
+    
+    "let modalCallback=null;function openModal(title,currentVal,callback){"
+    "document.getElementById('modalTitle').textContent=title;"
+    "const input=document.getElementById('modalInput');"
+    "input.value=currentVal||'';"
+    "modalCallback=callback;"
+    "document.getElementById('nameModal').classList.add('show');"
+    "setTimeout(()=>input.focus(),100);}"
+    "function closeModal(){document.getElementById('nameModal').classList.remove('show');modalCallback=null;}"
+    "function saveModalName(){const val=document.getElementById('modalInput').value.trim();"
+    "if(modalCallback){modalCallback(val);}closeModal();}"
+    "document.getElementById('modalInput').addEventListener('keydown',e=>{"
+    "if(e.key==='Enter'){saveModalName();}else if(e.key==='Escape'){closeModal();}});"
+    "document.getElementById('nameModal').addEventListener('click',e=>{"
+    "if(e.target.id==='nameModal'){closeModal();}});"
+    
+    "async function editGName(gid,oldName){"
+    "openModal('Edit Group Name',oldName,async(name)=>{"
+    "if(name===oldName)return;"
+    "const finalName=name.trim()||'Group '+gid;"
+    "try{await fetch('/api/chasing/name',{method:'POST',headers:{'Content-Type':'application/json'},"
+    "body:JSON.stringify({groupId:gid,name:finalName})});load();}catch(e){showAlert('Error',e.toString());console.error(e);}});}"
+    
+    "async function editOName(pin,oldName){"
+    "openModal('Edit Output Name',oldName||'GPIO '+pin,async(name)=>{"
+    "const finalName=name.trim();"
+    "if(finalName===(oldName||'GPIO '+pin))return;"
+    "try{await sendCommand('name',{pin:pin,name:finalName});load();}catch(e){showAlert('Error',e.toString());console.error(e);}});}"
+    
+    "async function createGroup(){try{"
+    "const gid=parseInt(document.getElementById('newGroupId').value);"
+    "const interval=parseInt(document.getElementById('newGroupInterval').value);"
+    "const outputs=[];"
+    "document.querySelectorAll('#outputSelector input[type=checkbox]:checked').forEach(cb=>outputs.push(parseInt(cb.value)));"
+    "if(outputs.length<2){showAlert('Validation Error','Please select at least 2 outputs');return;}"
+    "if(gid<1||gid>255){showAlert('Validation Error','Group ID must be 1-255');return;}"
+    "if(interval<50){showAlert('Validation Error','Interval must be at least 50ms');return;}"
+    "await sendCommand('chasing.create',{groupId:gid,interval:interval,outputs:outputs});"
+    "document.getElementById('newGroupId').value=parseInt(gid)+1;load();}catch(e){showAlert('Error',e.toString());console.error(e);}}"
+    
+    "async function controlBatch(c){const r=await sendCommand('batch',c);if(!r.ok)throw new Error('Batch control failed: '+r.status);}"
+    
+    "let isProcessing=false;async function allOn(){const btn=document.getElementById('btnAllOn');if(isProcessing)return;isProcessing=true;"
+    "bulkState='on';btn.classList.add('processing');btn.disabled=true;try{await controlBatch({select:'all',active:true,brightness:100});}"
+    "catch(e){console.error(e);}finally{btn.classList.remove('processing');btn.disabled=false;isProcessing=false;}}"
+    
+    "async function allOff(){const btn=document.getElementById('btnAllOff');if(isProcessing)return;isProcessing=true;"
+    "bulkState='off';btn.classList.add('processing');btn.disabled=true;try{await controlBatch({select:'all',active:false,brightness:0});}"
+    "catch(e){console.error(e);}finally{btn.classList.remove('processing');btn.disabled=false;isProcessing=false;}}"
+    
+    "async function setMasterBrightness(val){try{await controlBatch({select:'active',brightness:parseInt(val)});}catch(e){console.error(e);}}"
+    
+    "let ws;function connectWS(){const wsUrl='ws://'+window.location.hostname+':81';"
+    "ws=new WebSocket(wsUrl);ws.onopen=()=>{console.log('[WS] Connected');};"
+    "ws.onmessage=(e)=>{try{const m=JSON.parse(e.data);if(m.type==='ack'){cmdAck(m);return;}if(!applyStatus(m))return;wsData=lastStatus;if(!isProcessing){load();}}catch(err){console.error('[WS] Parse error:',err);}};"
+    "ws.onerror=(e)=>{console.error('[WS] Error:',e);};"
+    "ws.onclose=()=>{lastStatus=null;console.log('[WS] Disconnected, reconnecting...');setTimeout(connectWS,2000);}};"
+    "const savedTab=localStorage.getItem('activeTab');if(savedTab!==null){showTab(parseInt(savedTab));}load().then(()=>connectWS());</script>"
+    "<footer style='text-align:center;padding:20px;margin-top:40px;border-top:1px solid #333;color:#666;font-size:0.9em;'>Made with ❤️ by innoMO</footer>"
+    "</body></html>";
+
+static const PagePart PAGE_PARTS[] = {
+    { PAGE_HEAD, sizeof(PAGE_HEAD) - 1 },
+    { nullptr, 0 },                         // Device name
+    { PAGE_TAIL, sizeof(PAGE_TAIL) - 1 },
+};
+
+#endif
@@ -1,11 +1,25 @@
 #include <ESP8266WiFi.h>
 #include <ArduinoJson.h>
-#include <ESP8266WebServer.h>
-#include <WiFiManager.h>
+#include <ESPAsyncTCP.h>
+#include <ESPAsyncWebServer.h>
+#include <ESPAsyncWiFiManager.h>
 #include <EEPROM.h>
+#include <flash_hal.h>
 #include <ESP8266mDNS.h>
 #include <WebSocketsServer.h>
+#include <Ticker.h>
+#include <body_pool.h>
+#include <command_json.h>
+#include <command_parser.h>
+#include <flash_journal.h>
+#include <json_writer.h>
+#include <loop_profiler.h>
+#include <output_core.h>
+#include <page_stream.h>
+#include <pin_map.h>
+#include <tick_jitter.h>
 #include "config.h"
+#include "main_page.h"
 
 // Forward declarations
 void initializeOutputs();
@@ -14,8 +28,8 @@ void initializeWiFiManager();
 void checkConfigPortalTrigger();
 void initializeWebServer();
 void executeOutputCommand(int pin, bool active, int brightnessPercent);
-void updateBlinkingOutputs();
-void updateChasingLightGroups();
+void handleWebSocketCommand(uint8_t num, uint8_t* payload, size_t length);
+void effectTick();
 void setOutputInterval(int index, unsigned int intervalMs);
 void createChasingGroup(uint8_t groupId, uint8_t* outputIndices, uint8_t count, unsigned int intervalMs);
 void deleteChasingGroup(uint8_t groupId);
@@ -26,16 +40,49 @@ void loadOutputStates();
 void saveAllOutputStates();
 void saveCustomParameters();
 void loadCustomParameters();
+void initializeStorage();
+void loadPinMap();
+void commitEEPROMData();
+void setDefaultEEPROMData();
 
 // Global variables
-// Web Server
-ESP8266WebServer* server = nullptr;
+// Web Server: event-driven (ESPAsyncTCP), handlers run from the network stack
+// between loop() passes instead of inside a blocking handleClient()
+AsyncWebServer* server = nullptr;
+AsyncWebServer portalServer(80);
+DNSServer dns;
+AsyncWiFiManager wifiManager(&portalServer, &dns);
 WebSocketsServer* ws = nullptr;
-WiFiManager wifiManager;
 
-// WebSocket broadcast timer
+// HTTP requests in flight; more than MAX_HTTP_CONNECTIONS get a 503 right away
+uint8_t httpConnections = 0;
+
+// POST bodies are assembled here until all of their TCP pieces have arrived
+BodyPool<BODY_POOL_SLOTS, MAX_BODY_SIZE + 1> bodyPool;
+
+// WebSocket status sync: "hello" with static device info and a full "snapshot"
+// on connect, then a "delta" with only the changed outputs (and the group list
+// if it changed) from the next loop() pass. Every delta bumps statusSeq; a
+// client that sees a gap asks for a new snapshot. The timer only sends
+// "telemetry" (uptime, heap).
 unsigned long lastBroadcast = 0;
-const unsigned long BROADCAST_INTERVAL = 500; // Broadcast every 500ms
+const unsigned long BROADCAST_INTERVAL = 2000; // Telemetry every 2 seconds
+uint32_t statusSeq = 0;
+uint32_t statusDirtyOutputs = 0;  // Bit i = output i changed since the last delta
+bool statusDirtyGroups = false;
+
+// Every WebSocket status message is written into this one static buffer by a
+// JsonWriter: no JSON document and no String per message, so the periodic
+// traffic does not fragment the heap. The space in front is for the WebSocket
+// frame header, so the library sends it without a copy.
+#define STATUS_JSON_SIZE 2048
+char statusBuffer[WEBSOCKETS_MAX_HEADER_SIZE + STATUS_JSON_SIZE];
+JsonWriter statusJson(statusBuffer + WEBSOCKETS_MAX_HEADER_SIZE, STATUS_JSON_SIZE);
+
+// /api/status has its own buffer: its handler can run while loop() is
+// waiting for a WebSocket send that still reads statusBuffer
+char httpStatusBuffer[STATUS_JSON_SIZE];
+JsonWriter httpJson(httpStatusBuffer, STATUS_JSON_SIZE);
 
 #define MAX_CHASING_GROUPS 4
 
@@ -44,33 +91,74 @@ struct ChasingGroup {
     uint8_t groupId;
     bool active;
     char name[21]; // 20 chars + null terminator
-    uint8_t outputIndices[8]; // Max 8 outputs per group
+    uint8_t outputIndices[MAX_OUTPUTS];
     uint8_t outputCount;
     uint16_t interval; // Step interval in ms
     uint8_t currentStep; // Current active output in sequence
-    unsigned long lastStepTime;
 };
 
-// EEPROM structure for ESP8266
-struct EEPROMData {
+// EEPROM structure for ESP8266, with one slot per output
+template <uint8_t Slots>
+struct SettingsImage {
     char deviceName[40];
-    bool outputStates[8];
-    uint8_t outputBrightness[8];
-    char outputNames[8][21]; // 20 chars + null terminator
-    uint16_t outputIntervals[8]; // Blink interval in milliseconds (0 = no blink)
+    bool outputStates[Slots];
+    uint8_t outputBrightness[Slots];
+    char outputNames[Slots][21]; // 20 chars + null terminator
+    uint16_t outputIntervals[Slots]; // Blink interval in milliseconds (0 = no blink)
     // Chasing groups data
     uint8_t chasingGroupCount;
     struct {
         uint8_t groupId;
         bool active;
         char name[21];
-        uint8_t outputIndices[8];
+        uint8_t outputIndices[Slots];
         uint8_t outputCount;
         uint16_t interval;
     } chasingGroups[MAX_CHASING_GROUPS];
-    uint8_t checksum;
+    uint8_t outputPinCount; // Saved pin map: 0 = LED_PINS, else MAX_OUTPUTS
+    uint8_t outputPins[Slots];
+    uint32_t generation; // Incremented by every commit
+    uint32_t crc;        // CRC32 of everything above, sealed by commitEEPROMData()
 };
+typedef SettingsImage<MAX_OUTPUTS> EEPROMData;
+
+// The emulated EEPROM of earlier firmware: 8 slots whatever MAX_OUTPUTS was,
+// ending after chasingGroups (then a checksum byte, never checked)
+typedef SettingsImage<8> LegacyEEPROMData;
+
 EEPROMData eepromData;
+bool eepromDataValid = false; // CRC of the replayed image matched at boot
+
+// Raw access to the journal sectors: the last JOURNAL_SECTORS sectors of the
+// filesystem region, which this firmware does not mount.
+class EspFlashBackend {
+public:
+    static const uint32_t SECTOR_SIZE = SPI_FLASH_SEC_SIZE;
+    
+    uint16_t sectorCount() const { return JOURNAL_SECTORS; }
+    
+    bool eraseSector(uint16_t sector) {
+        return ESP.flashEraseSector(firstSector() + sector);
+    }
+    
+    bool write(uint16_t sector, uint32_t offset, const void* data, uint32_t length) {
+        return ESP.flashWrite((firstSector() + sector) * SECTOR_SIZE + offset, (const uint32_t*)data, length);
+    }
+    
+    bool read(uint16_t sector, uint32_t offset, void* data, uint32_t length) {
+        return ESP.flashRead((firstSector() + sector) * SECTOR_SIZE + offset, (uint8_t*)data, length);
+    }
+    
+    static uint32_t firstSector() {
+        return (FS_PHYS_ADDR + FS_PHYS_SIZE) / SECTOR_SIZE - JOURNAL_SECTORS;
+    }
+};
+const uint32_t EspFlashBackend::SECTOR_SIZE;
+
+// eepromData is the RAM view; commitEEPROMData() appends only the changed bytes
+// to the journal instead of rewriting the emulated EEPROM sector.
+EspFlashBackend journalFlash;
+FlashJournal<EspFlashBackend, sizeof(EEPROMData)> storageJournal(journalFlash);
 
 String macAddress;
 char customDeviceName[40] = DEVICE_NAME; // Custom device name from WiFiManager
@@ -78,23 +166,57 @@ bool portalRunning = false;
 unsigned long portalButtonPressTime = 0;
 bool wifiConnected = false;
 
-// Output pin configuration
-int outputPins[MAX_OUTPUTS] = LED_PINS;
-bool outputStates[MAX_OUTPUTS] = {false};
-int outputBrightness[MAX_OUTPUTS] = {255}; // 0-255 for PWM
+// Output pin configuration: LED_PINS unless a saved map replaces it at boot
+const int DEFAULT_OUTPUT_PINS[MAX_OUTPUTS] = LED_PINS;
+PinMap<MAX_OUTPUTS, 17> pinMap;
+unsigned long pinMapRestartAt = 0; // Set after a new map is saved; loop() restarts then
 String outputNames[MAX_OUTPUTS]; // Custom names for outputs
-unsigned int outputIntervals[MAX_OUTPUTS] = {0}; // Blink interval in ms (0 = no blink)
-unsigned long lastBlinkTime[MAX_OUTPUTS] = {0}; // Last blink toggle time
-bool blinkState[MAX_OUTPUTS] = {false}; // Current blink state (for internal tracking)
-int8_t outputChasingGroup[MAX_OUTPUTS] = {-1, -1, -1, -1, -1, -1, -1}; // Which chasing group owns this output (-1 = none)
 
 // Chasing light groups
 ChasingGroup chasingGroups[MAX_CHASING_GROUPS];
 uint8_t chasingGroupCount = 0;
 
+// Output state and effect engine (output_core.h): analogWrite on the mapped
+// pin, and the chasing groups step through stepGroup()
+struct Esp8266Outputs {
+    static void writeOutput(uint16_t index, uint8_t duty) { analogWrite(pinMap.pin(index), duty); }
+    static uint32_t stepGroup(uint8_t slot);
+};
+OutputCore<MAX_OUTPUTS, MAX_CHASING_GROUPS, Esp8266Outputs> outputCore;
+
+// Effect tick: Ticker (os_timer) callback instead of a loop() poll.
+// timer1 is owned by the analogWrite() waveform generator, so it is not used here.
+Ticker effectTicker;
+TickJitter effectJitter(EFFECT_TICK_MS * 1000UL);
+
+// loop() profiler (loop_profiler.h): a cycle counter reading after every
+// subsystem call; GET /api/debug/loop and the telemetry message report it.
+// The effect tick runs from the Ticker, so its time lands in whichever
+// section it interrupted.
+enum LoopSection : uint8_t {
+    LOOP_PORTAL,            // checkConfigPortalTrigger()
+    LOOP_WEBSOCKET,         // ws->loop()
+    LOOP_DELTAS,            // broadcastDelta()
+    LOOP_TELEMETRY,
+    LOOP_MDNS,
+    LOOP_OTHER,             // yield() (WiFi stack, async HTTP handlers) and the pin map restart check
+    LOOP_SECTIONS
+};
+const char* const LOOP_SECTION_NAMES[LOOP_SECTIONS] = {
+    "portal", "webSocket", "deltas", "telemetry", "mdns", "other"
+};
+LoopProfiler<LOOP_SECTIONS> loopProfiler(F_CPU / 1000000);
+
+// Charges the cycles since lapStart to a loop() section; returns the start of the next one
+uint32_t loopLap(LoopSection section, uint32_t lapStart) {
+    return loopProfiler.lap(section, lapStart, ESP.getCycleCount());
+}
+
 // Timing variables
 
-void broadcastStatus(); // Forward declaration
+// Forward declarations
+void sendHello(uint8_t num);
+void sendSnapshot(uint8_t num);
 
 void wsEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length) {
     switch(type) {
@@ -105,69 +227,176 @@ void wsEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length) {
             {
                 IPAddress ip = ws->remoteIP(num);
                 Serial.printf("[WS] Client #%u connected from %d.%d.%d.%d\n", num, ip[0], ip[1], ip[2], ip[3]);
-                broadcastStatus(); // Send current status to new client
+                // Static info and the full state go to the new client only
+                sendHello(num);
+                sendSnapshot(num);
             }
             break;
         case WStype_TEXT:
-            Serial.printf("[WS] Received from #%u: %s\n", num, payload);
+            Serial.printf("[WS] Command from #%u (%u bytes)\n", num, (unsigned)length);
+            handleWebSocketCommand(num, payload, length);
             break;
     }
 }
 
-void broadcastStatus() {
-    if (!ws) return;
-    
-    DynamicJsonDocument doc(2048);
-    doc["macAddress"] = macAddress;
-    doc["name"] = customDeviceName;
-    doc["wifiMode"] = WiFi.getMode() == WIFI_AP ? "AP" : "STA";
-    doc["ip"] = WiFi.getMode() == WIFI_AP ? WiFi.softAPIP().toString() : WiFi.localIP().toString();
-    doc["ssid"] = WiFi.getMode() == WIFI_AP ? String(AP_SSID) : WiFi.SSID();
-    doc["apClients"] = WiFi.softAPgetStationNum();
-    doc["freeHeap"] = ESP.getFreeHeap();
-    doc["uptime"] = millis();
-    doc["buildDate"] = String(__DATE__) + " " + String(__TIME__);
-    doc["flashUsed"] = ESP.getSketchSize();
-    doc["flashFree"] = ESP.getFreeSketchSpace();
-    doc["flashPartition"] = 1044464; // Program partition size (from platformio build output)
-    
-    JsonArray outputs = doc.createNestedArray("outputs");
-    for (int i = 0; i < MAX_OUTPUTS; i++) {
-        JsonObject output = outputs.createNestedObject();
-        output["pin"] = outputPins[i];
-        output["active"] = outputStates[i];
-        output["brightness"] = map(outputBrightness[i], 0, 255, 0, 100);
-        output["name"] = outputNames[i];
-        output["interval"] = outputIntervals[i];
-        output["chasingGroup"] = outputChasingGroup[i];
-    }
-    
-    JsonArray groups = doc.createNestedArray("chasingGroups");
+void markOutputChanged(int index) {
+    statusDirtyOutputs |= 1UL << index;
+}
+
+void addOutputStatus(JsonWriter& json, int index) {
+    json.beginObject();
+    json.add("pin", pinMap.pin(index));
+    json.add("active", outputCore.state[index]);
+    json.add("brightness", map(outputCore.duty[index], 0, 255, 0, 100));
+    json.add("name", outputNames[index].c_str());
+    json.add("interval", outputCore.interval[index]);
+    json.add("chasingGroup", outputCore.group[index]);
+    json.endObject();
+}
+
+void addChasingGroups(JsonWriter& json) {
+    json.beginArray("chasingGroups");
     for (int i = 0; i < MAX_CHASING_GROUPS; i++) {
         if (chasingGroups[i].active) {
-            JsonObject group = groups.createNestedObject();
-            group["groupId"] = chasingGroups[i].groupId;
-            group["name"] = chasingGroups[i].name;
-            group["interval"] = chasingGroups[i].interval;
-            group["outputCount"] = chasingGroups[i].outputCount;
-            JsonArray groupOutputs = group.createNestedArray("outputs");
+            json.beginObject();
+            json.add("groupId", chasingGroups[i].groupId);
+            json.add("name", chasingGroups[i].name);
+            json.add("interval", chasingGroups[i].interval);
+            json.add("outputCount", chasingGroups[i].outputCount);
+            json.beginArray("outputs");
             for (int j = 0; j < chasingGroups[i].outputCount; j++) {
-                groupOutputs.add(outputPins[chasingGroups[i].outputIndices[j]]);
+                json.add(nullptr, pinMap.pin(chasingGroups[i].outputIndices[j]));
             }
+            json.endArray();
+            json.endObject();
         }
     }
+    json.endArray();
+}
+
+void addTelemetry(JsonWriter& json) {
+    json.add("seq", statusSeq);
+    json.add("uptime", millis());
+    json.add("freeHeap", ESP.getFreeHeap());
+    json.add("apClients", WiFi.softAPgetStationNum());
+}
+
+// Station or soft-AP address and network name, without String temporaries
+void addNetworkInfo(JsonWriter& json) {
+    bool apMode = WiFi.getMode() == WIFI_AP;
+    IPAddress ip = apMode ? WiFi.softAPIP() : WiFi.localIP();
+    char ipText[16];
+    snprintf(ipText, sizeof(ipText), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    
+    char ssid[33] = AP_SSID;
+    if (!apMode) {
+        struct station_config config;
+        wifi_station_get_config(&config);
+        memcpy(ssid, config.ssid, 32);
+        ssid[32] = '\0';
+    }
     
-    String response;
-    serializeJson(doc, response);
-    ws->broadcastTXT(response);
+    json.add("wifiMode", apMode ? "AP" : "STA");
+    json.add("ip", ipText);
+    json.add("ssid", ssid);
+}
+
+// Message in statusJson to one client, or to all with num = -1
+void sendStatusJson(int num) {
+    if (!statusJson.ok()) {
+        Serial.println("[ERROR] Status message exceeds " + String(STATUS_JSON_SIZE) + " bytes - not sent");
+        return;
+    }
+    uint8_t* payload = (uint8_t*)statusBuffer + WEBSOCKETS_MAX_HEADER_SIZE;
+    if (num < 0) {
+        ws->broadcastTXT(payload, statusJson.length(), true);
+    } else {
+        ws->sendTXT((uint8_t)num, payload, statusJson.length(), true);
+    }
+}
+
+// Fields that do not change while connected; sent once per connection
+void sendHello(uint8_t num) {
+    statusJson.reset();
+    statusJson.beginObject();
+    statusJson.add("type", "hello");
+    statusJson.add("macAddress", macAddress.c_str());
+    statusJson.add("name", customDeviceName);
+    addNetworkInfo(statusJson);
+    statusJson.add("buildDate", __DATE__ " " __TIME__);
+    statusJson.add("flashUsed", ESP.getSketchSize());
+    statusJson.add("flashFree", ESP.getFreeSketchSpace());
+    statusJson.add("flashPartition", 1044464); // Program partition size (from platformio build output)
+    statusJson.endObject();
+    sendStatusJson(num);
+}
+
+// Every output and group plus telemetry, at the current sequence number
+void sendSnapshot(uint8_t num) {
+    statusJson.reset();
+    statusJson.beginObject();
+    statusJson.add("type", "snapshot");
+    addTelemetry(statusJson);
+    statusJson.beginArray("outputs");
+    for (int i = 0; i < MAX_OUTPUTS; i++) {
+        addOutputStatus(statusJson, i);
+    }
+    statusJson.endArray();
+    addChasingGroups(statusJson);
+    statusJson.endObject();
+    sendStatusJson(num);
+}
+
+// Changed outputs (and the group list if it changed) since the last delta
+void broadcastDelta() {
+    if (!ws || (statusDirtyOutputs == 0 && !statusDirtyGroups)) return;
+    
+    // Taken before sending: HTTP handlers may mark more changes while the send waits
+    uint32_t dirtyOutputs = statusDirtyOutputs;
+    bool dirtyGroups = statusDirtyGroups;
+    statusDirtyOutputs = 0;
+    statusDirtyGroups = false;
+    
+    statusSeq++;
+    if (ws->connectedClients() > 0) {
+        statusJson.reset();
+        statusJson.beginObject();
+        statusJson.add("type", "delta");
+        statusJson.add("seq", statusSeq);
+        statusJson.beginArray("outputs");
+        for (int i = 0; i < MAX_OUTPUTS; i++) {
+            if (dirtyOutputs & (1UL << i)) {
+                addOutputStatus(statusJson, i);
+            }
+        }
+        statusJson.endArray();
+        if (dirtyGroups) {
+            addChasingGroups(statusJson);
+        }
+        statusJson.endObject();
+        sendStatusJson(-1);
+    }
+}
+
+// Periodic heartbeat; its seq lets clients notice a missed delta
+void broadcastTelemetry() {
+    if (!ws || ws->connectedClients() == 0) return;
+    
+    statusJson.reset();
+    statusJson.beginObject();
+    statusJson.add("type", "telemetry");
+    addTelemetry(statusJson);
+    loopProfiler.write(statusJson, "loop", LOOP_SECTION_NAMES);
+    statusJson.endObject();
+    sendStatusJson(-1);
 }
 
 void setup() {
     Serial.begin(115200);
     delay(100);
     
-    // Initialize EEPROM for ESP8266
-    EEPROM.begin(EEPROM_SIZE);
+    // Replay the settings journal into eepromData
+    initializeStorage();
     
     Serial.println("\n\n========================================");
     Serial.println("  RailHub8266 ESP8266 Controller v1.0");
@@ -187,6 +416,7 @@ void setup() {
     
     // Initialize output pins
     Serial.println("[INIT] Initializing " + String(MAX_OUTPUTS) + " output pins...");
+    loadPinMap();
     initializeOutputs();
     
     // Load custom parameters from preferences
@@ -201,6 +431,10 @@ void setup() {
     Serial.println("[INIT] Loading chasing groups...");
     loadChasingGroups();
     
+    // Start stepping effects before WiFi so blinking runs during connect/portal
+    Serial.println("[INIT] Starting effect ticker (" + String(EFFECT_TICK_MS) + "ms tick)...");
+    effectTicker.attach_ms(EFFECT_TICK_MS, effectTick);
+    
     // Initialize WiFi with WiFiManager
     Serial.println("[INIT] Initializing WiFi Manager...");
     initializeWiFiManager();
@@ -208,7 +442,7 @@ void setup() {
     // Initialize web server after WiFi is connected
     if (wifiConnected) {
         Serial.println("[INIT] Starting web server on port 80...");
-        server = new ESP8266WebServer(80);
+        server = new AsyncWebServer(80);
         initializeWebServer();
         Serial.println("[WEB] Web server initialized successfully");
         
@@ -230,37 +464,42 @@ void setup() {
 }
 
 void loop() {
+    uint32_t lapStart = loopProfiler.beginIteration(ESP.getCycleCount());
+    
     // Check for config portal trigger button
     checkConfigPortalTrigger();
-    
-    // Handle web server requests
-    if (server) {
-        server->handleClient();
-    }
+    lapStart = loopLap(LOOP_PORTAL, lapStart);
     
     // Handle WebSocket events
     if (ws) {
         ws->loop();
+        lapStart = loopLap(LOOP_WEBSOCKET, lapStart);
         
-        // Broadcast status periodically for real-time updates
+        // Changes go out on the next pass; the timer only carries telemetry
+        broadcastDelta();
+        lapStart = loopLap(LOOP_DELTAS, lapStart);
         unsigned long now = millis();
         if (now - lastBroadcast >= BROADCAST_INTERVAL) {
-            broadcastStatus();
+            broadcastTelemetry();
             lastBroadcast = now;
+            lapStart = loopLap(LOOP_TELEMETRY, lapStart);
         }
     }
     
     // Update mDNS responder
     MDNS.update();
+    lapStart = loopLap(LOOP_MDNS, lapStart);
     
-    // Update chasing light groups (has priority)
-    updateChasingLightGroups();
-    
-    // Update blinking outputs (only for non-chasing outputs)
-    updateBlinkingOutputs();
+    // A new pin map takes effect on restart, once its response has gone out
+    if (pinMapRestartAt != 0 && (long)(millis() - pinMapRestartAt) >= 0) {
+        Serial.println("[PINS] Restarting ESP8266 to apply the new pin map...");
+        Serial.flush();
+        ESP.restart();
+    }
     
     // Handle any other tasks
     yield();
+    loopProfiler.endIteration(loopLap(LOOP_OTHER, lapStart));
 }
 
 // Periodic status logging (called every 60 seconds via timer)
@@ -282,7 +521,7 @@ void logSystemStatus() {
         // Count active outputs
         int activeCount = 0;
         for (int i = 0; i < MAX_OUTPUTS; i++) {
-            if (outputStates[i]) activeCount++;
+            if (outputCore.state[i]) activeCount++;
         }
         Serial.println("[STATUS] Active Outputs: " + String(activeCount) + "/" + String(MAX_OUTPUTS));
         Serial.println("[STATUS] ========================\n");
@@ -297,9 +536,9 @@ void initializeOutputs() {
     analogWriteFreq(1000); // 1kHz PWM frequency
     
     for (int i = 0; i < MAX_OUTPUTS; i++) {
-        Serial.print("[OUTPUT] Configuring Output " + String(i) + " on GPIO " + String(outputPins[i]));
-        pinMode(outputPins[i], OUTPUT);
-        analogWrite(outputPins[i], 0);
+        Serial.print("[OUTPUT] Configuring Output " + String(i) + " on GPIO " + String(pinMap.pin(i)));
+        pinMode(pinMap.pin(i), OUTPUT);
+        analogWrite(pinMap.pin(i), 0);
         Serial.println(" - OK (PWM 1kHz, 8-bit)");
     }
     
@@ -370,7 +609,7 @@ void initializeWiFiManager() {
     // WiFiManager already initialized globally
     
     // Set custom parameters
-    WiFiManagerParameter custom_device_name("device_name", "Device Name", customDeviceName, 40);
+    AsyncWiFiManagerParameter custom_device_name("device_name", "Device Name", customDeviceName, 40);
     
     // Add parameters to WiFiManager
     wifiManager.addParameter(&custom_device_name);
@@ -379,10 +618,6 @@ void initializeWiFiManager() {
     wifiManager.setMinimumSignalQuality(20);  // Higher = fewer networks shown = less RAM
     wifiManager.setRemoveDuplicateAPs(true);
     
-    // Disable features to save memory
-    wifiManager.setShowInfoUpdate(false);  // Don't show info in update mode
-    wifiManager.setShowInfoErase(false);   // Don't show erase button
-    
     // Set save config callback
     wifiManager.setSaveConfigCallback([]() {
         Serial.println("[WIFI] Configuration saved!");
@@ -403,7 +638,7 @@ void initializeWiFiManager() {
 
     
     // Set AP callback
-    wifiManager.setAPCallback([](WiFiManager *myWiFiManager) {
+    wifiManager.setAPCallback([](AsyncWiFiManager *myWiFiManager) {
         Serial.println("\n========================================");
         Serial.println("     CONFIGURATION MODE ACTIVE");
         Serial.println("========================================");
@@ -549,16 +784,11 @@ void checkConfigPortalTrigger() {
 void saveCustomParameters() {
     Serial.println("[EEPROM] Saving custom parameters...");
     
-    // Read current EEPROM data
-    EEPROM.get(0, eepromData);
-    
     // Update device name
     strncpy(eepromData.deviceName, customDeviceName, 39);
     eepromData.deviceName[39] = '\0';
     
-    // Write back to EEPROM
-    EEPROM.put(0, eepromData);
-    EEPROM.commit();
+    commitEEPROMData();
     
     Serial.print("[EEPROM] Custom parameters saved: Device Name = '");
     Serial.print(customDeviceName);
@@ -567,9 +797,7 @@ void saveCustomParameters() {
 
 void saveChasingGroups() {
     Serial.println("[EEPROM] Saving chasing groups...");
-    
-    // Read current EEPROM data
-    EEPROM.get(0, eepromData);
+    statusDirtyGroups = true;
     
     // Update chasing groups
     eepromData.chasingGroupCount = 0;
@@ -590,9 +818,7 @@ void saveChasingGroups() {
         }
     }
     
-    // Write back to EEPROM
-    EEPROM.put(0, eepromData);
-    EEPROM.commit();
+    commitEEPROMData();
     
     Serial.print("[EEPROM] Saved ");
     Serial.print(eepromData.chasingGroupCount);
@@ -602,9 +828,6 @@ void saveChasingGroups() {
 void loadChasingGroups() {
     Serial.println("[EEPROM] Loading chasing groups...");
     
-    // Read EEPROM data
-    EEPROM.get(0, eepromData);
-    
     int loadedGroups = 0;
     
     for (int i = 0; i < MAX_CHASING_GROUPS; i++) {
@@ -616,13 +839,14 @@ void loadChasingGroups() {
             chasingGroups[i].outputCount = eepromData.chasingGroups[i].outputCount;
             chasingGroups[i].interval = eepromData.chasingGroups[i].interval;
             chasingGroups[i].currentStep = 0;
-            chasingGroups[i].lastStepTime = millis();
+            outputCore.scheduleGroup(i, millis() + chasingGroups[i].interval);
             
             for (int j = 0; j < chasingGroups[i].outputCount; j++) {
                 uint8_t idx = eepromData.chasingGroups[i].outputIndices[j];
                 chasingGroups[i].outputIndices[j] = idx;
                 if (idx < MAX_OUTPUTS) {
-                    outputChasingGroup[idx] = chasingGroups[i].groupId;
+                    outputCore.group[idx] = chasingGroups[i].groupId;
+                    outputCore.cancel(idx); // The group drives this output, not its blink interval
                 }
             }
             
@@ -648,14 +872,147 @@ void loadChasingGroups() {
     Serial.println(" chasing groups");
 }
 
+uint32_t eepromDataCrc() {
+    return crc32(&eepromData, offsetof(EEPROMData, crc));
+}
+
+// Take over an 8-slot image; slots past MAX_OUTPUTS are dropped
+void importLegacyData(const LegacyEEPROMData& legacy) {
+    memset(&eepromData, 0, sizeof(eepromData));
+    memcpy(eepromData.deviceName, legacy.deviceName, sizeof(eepromData.deviceName));
+    for (int i = 0; i < MAX_OUTPUTS && i < 8; i++) {
+        eepromData.outputStates[i] = legacy.outputStates[i];
+        eepromData.outputBrightness[i] = legacy.outputBrightness[i];
+        memcpy(eepromData.outputNames[i], legacy.outputNames[i], sizeof(eepromData.outputNames[i]));
+        eepromData.outputIntervals[i] = legacy.outputIntervals[i];
+        eepromData.outputPins[i] = legacy.outputPins[i];
+    }
+    eepromData.outputPinCount = legacy.outputPinCount;
+    
+    eepromData.chasingGroupCount = legacy.chasingGroupCount;
+    for (int g = 0; g < MAX_CHASING_GROUPS; g++) {
+        eepromData.chasingGroups[g].groupId = legacy.chasingGroups[g].groupId;
+        eepromData.chasingGroups[g].active = legacy.chasingGroups[g].active;
+        memcpy(eepromData.chasingGroups[g].name, legacy.chasingGroups[g].name, sizeof(eepromData.chasingGroups[g].name));
+        eepromData.chasingGroups[g].interval = legacy.chasingGroups[g].interval;
+        uint8_t count = 0;
+        for (int j = 0; j < legacy.chasingGroups[g].outputCount && j < 8; j++) {
+            uint8_t idx = legacy.chasingGroups[g].outputIndices[j];
+            if (idx < MAX_OUTPUTS && count < MAX_OUTPUTS) {
+                eepromData.chasingGroups[g].outputIndices[count++] = idx;
+            }
+        }
+        eepromData.chasingGroups[g].outputCount = count;
+    }
+}
+
+// Pin maps other than LED_PINS are checked against the chip: strapping pins
+// only where the stock wiring already uses them, never the config button
+PinCheck checkPinMap(const int* pins, uint8_t& badIndex) {
+    PinRules rules = ESP8266_PIN_RULES;
+    rules.reserved |= PIN_BIT(PORTAL_TRIGGER_PIN);
+    return pinMap.check(rules, pinMap.mask(DEFAULT_OUTPUT_PINS, MAX_OUTPUTS), pins, badIndex);
+}
+
+// Saved map from a CRC-valid image if there is one, LED_PINS otherwise
+void loadPinMap() {
+    pinMap.set(DEFAULT_OUTPUT_PINS);
+    
+    if (!eepromDataValid || eepromData.outputPinCount != MAX_OUTPUTS) {
+        Serial.println("[EEPROM] No saved pin map, using LED_PINS");
+        return;
+    }
+    
+    int pins[MAX_OUTPUTS];
+    for (int i = 0; i < MAX_OUTPUTS; i++) {
+        pins[i] = eepromData.outputPins[i];
+    }
+    uint8_t badIndex = 0;
+    PinCheck result = checkPinMap(pins, badIndex);
+    if (result != PIN_OK) {
+        Serial.println("[ERROR] Saved pin map rejected (output " + String(badIndex) + ": " + pinCheckText(result) + ") - using LED_PINS");
+        return;
+    }
+    pinMap.set(pins);
+    Serial.println("[EEPROM] Loaded saved pin map");
+}
+
+void savePinMap(const int* pins) {
+    eepromData.outputPinCount = MAX_OUTPUTS;
+    for (int i = 0; i < MAX_OUTPUTS; i++) {
+        eepromData.outputPins[i] = pins[i];
+    }
+    commitEEPROMData();
+}
+
+void initializeStorage() {
+    Serial.println("[EEPROM] Mounting settings journal (" + String(JOURNAL_SECTORS) + " sectors at 0x" + String(EspFlashBackend::firstSector() * SPI_FLASH_SEC_SIZE, HEX) + ")...");
+    
+    // The journal replays only complete commits, newest sector generation first;
+    // the image CRC then covers the whole struct end to end
+    if (storageJournal.mount(&eepromData)) {
+        eepromDataValid = eepromData.crc == eepromDataCrc();
+        Serial.println("[EEPROM] Journal replayed from sector " + String(storageJournal.currentSector()) + 
+                       " (generation " + String(eepromData.generation) + ", " + String(storageJournal.bytesUsed()) + " bytes used)" +
+                       (eepromDataValid ? "" : " - CRC mismatch"));
+        return;
+    }
+    
+    // First boot with the journal: take over the emulated EEPROM contents once.
+    // That layout had no CRC; erased flash (0xFF) marks a device that never saved.
+    Serial.println("[EEPROM] No journal found, migrating from emulated EEPROM");
+    LegacyEEPROMData legacy;
+    EEPROM.begin(EEPROM_SIZE);
+    EEPROM.get(0, legacy);
+    EEPROM.end();
+    legacy.outputPinCount = 0; // Not part of that layout
+    importLegacyData(legacy);
+    eepromDataValid = (uint8_t)eepromData.deviceName[0] != 0xFF;
+    eepromData.generation = 0;
+    eepromData.crc = eepromDataCrc();
+    
+    if (!storageJournal.format(&eepromData)) {
+        Serial.println("[ERROR] Failed to format settings journal");
+    }
+}
+
+// Persist eepromData: seal generation and CRC, then append the changed bytes as one journal transaction
+void commitEEPROMData() {
+    eepromData.generation++;
+    eepromData.crc = eepromDataCrc();
+    if (!storageJournal.commit(&eepromData)) {
+        Serial.println("[ERROR] Settings journal commit failed");
+    }
+}
+
+void setDefaultEEPROMData() {
+    // Clear entire structure
+    memset(&eepromData, 0, sizeof(eepromData));
+    
+    // Set defaults
+    for (int i = 0; i < MAX_OUTPUTS; i++) {
+        eepromData.outputStates[i] = false;
+        eepromData.outputBrightness[i] = 255;
+        eepromData.outputNames[i][0] = '\0';
+        eepromData.outputIntervals[i] = 0;
+    }
+    
+    // Initialize chasing groups
+    eepromData.chasingGroupCount = 0;
+    for (int i = 0; i < MAX_CHASING_GROUPS; i++) {
+        eepromData.chasingGroups[i].active = false;
+        eepromData.chasingGroups[i].outputCount = 0;
+    }
+    
+    strncpy(eepromData.deviceName, DEVICE_NAME, 39);
+    eepromData.deviceName[39] = '\0';
+}
+
 void loadCustomParameters() {
     Serial.println("[EEPROM] Loading custom parameters...");
     
-    // Read EEPROM data
-    EEPROM.get(0, eepromData);
-    
-    // Check if data is valid (simple check - not empty)
-    if (eepromData.deviceName[0] != '\0' && eepromData.deviceName[0] != 0xFF) {
+    // Use the saved name only from a CRC-valid image
+    if (eepromDataValid && eepromData.deviceName[0] != '\0') {
         strncpy(customDeviceName, eepromData.deviceName, 39);
         customDeviceName[39] = '\0';
         Serial.print("[EEPROM] Loaded custom device name: '");
@@ -673,15 +1030,7 @@ void loadCustomParameters() {
 void executeOutputCommand(int pin, bool active, int brightnessPercent) {
     unsigned long startTime = millis();
     
-    // Find the output index for the given pin
-    int outputIndex = -1;
-    for (int i = 0; i < MAX_OUTPUTS; i++) {
-        if (outputPins[i] == pin) {
-            outputIndex = i;
-            break;
-        }
-    }
-    
+    int outputIndex = pinMap.indexOf(pin);
     if (outputIndex == -1) {
         Serial.println("[ERROR] Invalid GPIO pin: " + String(pin));
         return;
@@ -693,22 +1042,14 @@ void executeOutputCommand(int pin, bool active, int brightnessPercent) {
         brightnessPercent = constrain(brightnessPercent, 0, 100);
     }
     
-    // Update state
-    outputStates[outputIndex] = active;
-    outputBrightness[outputIndex] = map(brightnessPercent, 0, 100, 0, 255);
-    
-    // Apply the command
-    if (active) {
-        analogWrite(outputPins[outputIndex], outputBrightness[outputIndex]);
-    } else {
-        analogWrite(outputPins[outputIndex], 0);
-    }
+    // Update state and apply the command
+    outputCore.set(outputIndex, active, dutyFromPercent(brightnessPercent), millis());
     
     // Save the state to persistent storage
     saveOutputState(outputIndex);
     
-    // Broadcast update to all WebSocket clients
-    broadcastStatus();
+    // Sent to WebSocket clients as a delta from loop()
+    markOutputChanged(outputIndex);
     
     unsigned long duration = millis() - startTime;
     String nameStr = outputNames[outputIndex].length() > 0 ? " [" + outputNames[outputIndex] + "]" : "";
@@ -716,6 +1057,16 @@ void executeOutputCommand(int pin, bool active, int brightnessPercent) {
                    (active ? "ON" : "OFF") + " @ " + String(brightnessPercent) + "% (" + String(duration) + "ms)");
 }
 
+// Apply one batch entry to output state and PWM; fields the request leaves out keep the current value.
+// The caller saves and broadcasts once for the whole batch.
+void applyBatchEntry(int index, const CommandEntry& fields) {
+    bool active;
+    uint8_t duty;
+    uint32_t intervalMs;
+    outputCore.resolve(index, fields, active, duty, intervalMs);
+    outputCore.apply(index, active, duty, intervalMs, millis());
+}
+
 void saveOutputState(int index) {
     if (index < 0 || index >= MAX_OUTPUTS) {
         Serial.print("[ERROR] Invalid output index for state save: ");
@@ -723,28 +1074,23 @@ void saveOutputState(int index) {
         return;
     }
     
-    // Read current EEPROM data
-    EEPROM.get(0, eepromData);
-    
     // Update specific output
-    eepromData.outputStates[index] = outputStates[index];
-    eepromData.outputBrightness[index] = outputBrightness[index];
-    eepromData.outputIntervals[index] = outputIntervals[index];
+    eepromData.outputStates[index] = outputCore.state[index];
+    eepromData.outputBrightness[index] = outputCore.duty[index];
+    eepromData.outputIntervals[index] = outputCore.interval[index];
     
-    // Write back to EEPROM
-    EEPROM.put(0, eepromData);
-    EEPROM.commit();
+    commitEEPROMData();
     
     Serial.print("[EEPROM] Saved state for Output ");
     Serial.print(index);
     Serial.print(" (GPIO ");
-    Serial.print(outputPins[index]);
+    Serial.print(pinMap.pin(index));
     Serial.print("): ");
-    Serial.print(outputStates[index] ? "ON" : "OFF");
+    Serial.print(outputCore.state[index] ? "ON" : "OFF");
     Serial.print(" @ ");
-    Serial.print(outputBrightness[index]);
+    Serial.print(outputCore.duty[index]);
     Serial.print(" PWM, Interval: ");
-    Serial.print(outputIntervals[index]);
+    Serial.print(outputCore.interval[index]);
     Serial.println("ms");
 }
 
@@ -754,17 +1100,13 @@ void saveOutputName(int index, String name) {
         return;
     }
     
-    // Read current EEPROM data
-    EEPROM.get(0, eepromData);
-    
     // If name is empty or whitespace-only, clear the name
     name.trim(); // Trim modifies in place
     if (name.length() == 0) {
         eepromData.outputNames[index][0] = '\0';
         outputNames[index] = "";
-        EEPROM.put(0, eepromData);
-        EEPROM.commit();
-        Serial.println("[EEPROM] Removed custom name for Output " + String(index) + " (GPIO " + String(outputPins[index]) + ") - using default");
+        commitEEPROMData();
+        Serial.println("[EEPROM] Removed custom name for Output " + String(index) + " (GPIO " + String(pinMap.pin(index)) + ") - using default");
         return;
     }
     
@@ -772,63 +1114,21 @@ void saveOutputName(int index, String name) {
     strncpy(eepromData.outputNames[index], name.c_str(), 20);
     eepromData.outputNames[index][20] = '\0';
     
-    // Write back to EEPROM
-    EEPROM.put(0, eepromData);
-    EEPROM.commit();
+    commitEEPROMData();
     
     outputNames[index] = name;
-    Serial.println("[EEPROM] Saved name for Output " + String(index) + " (GPIO " + String(outputPins[index]) + "): '" + name + "'");
+    Serial.println("[EEPROM] Saved name for Output " + String(index) + " (GPIO " + String(pinMap.pin(index)) + "): '" + name + "'");
 }
 
 void loadOutputStates() {
     Serial.println("[EEPROM] Loading saved output states...");
     
-    // Read EEPROM data
-    EEPROM.get(0, eepromData);
-    
-    // Check if data is valid (check for uninitialized EEPROM)
-    bool validData = true;
-    
-    // Check device name for 0xFF pattern (uninitialized)
-    if (eepromData.deviceName[0] == 0xFF) {
-        validData = false;
-    }
-    
-    // Check brightness values
-    for (int i = 0; i < MAX_OUTPUTS; i++) {
-        if (eepromData.outputBrightness[i] > 255) {
-            validData = false;
-            break;
-        }
-    }
-    
-    // Initialize with defaults if invalid
-    if (!validData) {
+    // Initialize with defaults if the image failed its CRC (or never existed)
+    if (!eepromDataValid) {
         Serial.println("[EEPROM] No valid data found, initializing defaults");
-        
-        // Clear entire structure
-        memset(&eepromData, 0, sizeof(eepromData));
-        
-        // Set defaults
-        for (int i = 0; i < MAX_OUTPUTS; i++) {
-            eepromData.outputStates[i] = false;
-            eepromData.outputBrightness[i] = 255;
-            eepromData.outputNames[i][0] = '\0';
-            eepromData.outputIntervals[i] = 0;
-        }
-        
-        // Initialize chasing groups
-        eepromData.chasingGroupCount = 0;
-        for (int i = 0; i < MAX_CHASING_GROUPS; i++) {
-            eepromData.chasingGroups[i].active = false;
-            eepromData.chasingGroups[i].outputCount = 0;
-        }
-        
-        strncpy(eepromData.deviceName, DEVICE_NAME, 39);
-        eepromData.deviceName[39] = '\0';
-        
-        EEPROM.put(0, eepromData);
-        EEPROM.commit();
+        setDefaultEEPROMData();
+        commitEEPROMData();
+        eepromDataValid = true;
         Serial.println("[EEPROM] Defaults saved to EEPROM");
     }
     
@@ -838,9 +1138,9 @@ void loadOutputStates() {
     
     for (int i = 0; i < MAX_OUTPUTS; i++) {
         // Load state and brightness from EEPROM
-        outputStates[i] = eepromData.outputStates[i];
-        outputBrightness[i] = eepromData.outputBrightness[i];
-        outputIntervals[i] = eepromData.outputIntervals[i];
+        outputCore.state[i] = eepromData.outputStates[i];
+        outputCore.duty[i] = eepromData.outputBrightness[i];
+        outputCore.interval[i] = eepromData.outputIntervals[i];
         
         // Load custom name - validate it's printable ASCII
         if (eepromData.outputNames[i][0] != '\0' && 
@@ -855,21 +1155,16 @@ void loadOutputStates() {
             outputNames[i] = "";
         }
         
-        // Apply the loaded state to the output
-        if (outputStates[i]) {
-            // If blinking is enabled, start in ON state
-            if (outputIntervals[i] > 0) {
-                analogWrite(outputPins[i], outputBrightness[i]);
-                blinkState[i] = true;
-                lastBlinkTime[i] = millis();
+        // Apply the loaded state to the output; a blinking one starts lit
+        outputCore.set(i, outputCore.state[i], outputCore.duty[i], millis());
+        if (outputCore.state[i]) {
+            if (outputCore.interval[i] > 0) {
                 blinkingCount++;
-            } else {
-                analogWrite(outputPins[i], outputBrightness[i]);
             }
-            int brightPercent = map(outputBrightness[i], 0, 255, 0, 100);
-            Serial.print("[EEPROM] Output " + String(i) + " (GPIO " + String(outputPins[i]) + "): ON @ " + String(brightPercent) + "%");
-            if (outputIntervals[i] > 0) {
-                Serial.print(" [Blink: " + String(outputIntervals[i]) + "ms]");
+            int brightPercent = map(outputCore.duty[i], 0, 255, 0, 100);
+            Serial.print("[EEPROM] Output " + String(i) + " (GPIO " + String(pinMap.pin(i)) + "): ON @ " + String(brightPercent) + "%");
+            if (outputCore.interval[i] > 0) {
+                Serial.print(" [Blink: " + String(outputCore.interval[i]) + "ms]");
             }
             if (outputNames[i].length() > 0) {
                 Serial.println(" [Name: " + outputNames[i] + "]");
@@ -877,9 +1172,6 @@ void loadOutputStates() {
                 Serial.println("");
             }
             loadedCount++;
-        } else {
-            analogWrite(outputPins[i], 0);
-            blinkState[i] = false;
         }
     }
     
@@ -890,19 +1182,14 @@ void saveAllOutputStates() {
     unsigned long startTime = millis();
     Serial.println("[EEPROM] Saving all output states (batch operation)...");
     
-    // Read current EEPROM data
-    EEPROM.get(0, eepromData);
-    
     // Update all output states and brightness
     for (int i = 0; i < MAX_OUTPUTS; i++) {
-        eepromData.outputStates[i] = outputStates[i];
-        eepromData.outputBrightness[i] = outputBrightness[i];
-        eepromData.outputIntervals[i] = outputIntervals[i];
+        eepromData.outputStates[i] = outputCore.state[i];
+        eepromData.outputBrightness[i] = outputCore.duty[i];
+        eepromData.outputIntervals[i] = outputCore.interval[i];
     }
     
-    // Write back to EEPROM
-    EEPROM.put(0, eepromData);
-    EEPROM.commit();
+    commitEEPROMData();
     
     unsigned long duration = millis() - startTime;
     Serial.print("[EEPROM] Batch save complete: ");
@@ -912,80 +1199,37 @@ void saveAllOutputStates() {
     Serial.println("ms)");
 }
 
-void updateChasingLightGroups() {
-    unsigned long currentMillis = millis();
+// Chasing group step (from outputCore.step()): the lit output moves one place along the sequence.
+// Returns the delay to the next step, or 0 if the group is gone.
+uint32_t Esp8266Outputs::stepGroup(uint8_t slot) {
+    ChasingGroup* group = &chasingGroups[slot];
+    if (!group->active || group->outputCount == 0) return 0;
+    
+    // Turn off current output
+    uint8_t currentIdx = group->outputIndices[group->currentStep];
+    if (currentIdx < MAX_OUTPUTS) {
+        writeOutput(currentIdx, 0);
+    }
     
-    for (int g = 0; g < MAX_CHASING_GROUPS; g++) {
-        ChasingGroup* group = &chasingGroups[g];
-        
-        if (!group->active || group->outputCount == 0) continue;
-        
-        // Check if it's time to step to next output
-        if (currentMillis - group->lastStepTime >= group->interval) {
-            // Turn off current output
-            uint8_t currentIdx = group->outputIndices[group->currentStep];
-            if (currentIdx < MAX_OUTPUTS) {
-                analogWrite(outputPins[currentIdx], 0);
-                Serial.print("[CHASING] Group ");
-                Serial.print(group->groupId);
-                Serial.print(" OFF: idx=");
-                Serial.print(currentIdx);
-                Serial.print(" GPIO=");
-                Serial.println(outputPins[currentIdx]);
-            }
-            
-            // Move to next step
-            group->currentStep = (group->currentStep + 1) % group->outputCount;
-            group->lastStepTime = currentMillis;
-            
-            // Turn on next output (always, regardless of state)
-            uint8_t nextIdx = group->outputIndices[group->currentStep];
-            if (nextIdx < MAX_OUTPUTS) {
-                analogWrite(outputPins[nextIdx], outputBrightness[nextIdx]);
-                Serial.print("[CHASING] Group ");
-                Serial.print(group->groupId);
-                Serial.print(" ON: idx=");
-                Serial.print(nextIdx);
-                Serial.print(" GPIO=");
-                Serial.println(outputPins[nextIdx]);
-            }
-        }
+    // Move to next step
+    group->currentStep = (group->currentStep + 1) % group->outputCount;
+    
+    // Turn on next output (always, regardless of state)
+    uint8_t nextIdx = group->outputIndices[group->currentStep];
+    if (nextIdx < MAX_OUTPUTS) {
+        writeOutput(nextIdx, outputCore.duty[nextIdx]);
     }
+    return group->interval > 0 ? group->interval : 1;
 }
 
-void updateBlinkingOutputs() {
-    unsigned long currentMillis = millis();
-    
-    for (int i = 0; i < MAX_OUTPUTS; i++) {
-        // Skip if output is part of a chasing group
-        if (outputChasingGroup[i] >= 0) continue;
-        
-        // Only process if output is active and has a blink interval set
-        if (outputStates[i] && outputIntervals[i] > 0) {
-            // Check if it's time to toggle
-            if (currentMillis - lastBlinkTime[i] >= outputIntervals[i]) {
-                lastBlinkTime[i] = currentMillis;
-                blinkState[i] = !blinkState[i];
-                
-                // Toggle the output
-                if (blinkState[i]) {
-                    analogWrite(outputPins[i], outputBrightness[i]);
-                } else {
-                    analogWrite(outputPins[i], 0);
-                }
-            }
-        } else if (outputStates[i] && outputIntervals[i] == 0) {
-            // No blinking - ensure output is solid on
-            if (!blinkState[i]) {
-                analogWrite(outputPins[i], outputBrightness[i]);
-                blinkState[i] = true;
-            }
-        }
-    }
+// Ticker callback: fixed-rate effect step; only writes precomputed duties, no logging
+void effectTick() {
+    effectJitter.record(micros());
+    outputCore.step(millis());
 }
 
 void createChasingGroup(uint8_t groupId, uint8_t* outputIndices, uint8_t count, unsigned int intervalMs, const char* groupName = nullptr) {
-    if (groupId >= MAX_CHASING_GROUPS || count == 0 || count > 8) {
+    if (groupId >= MAX_CHASING_GROUPS || count == 0 || count > MAX_OUTPUTS) {
         Serial.println("[ERROR] Invalid chasing group parameters");
         return;
     }
@@ -1008,7 +1252,7 @@ void createChasingGroup(uint8_t groupId, uint8_t* outputIndices, uint8_t count,
     for (int i = 0; i < count; i++) {
         uint8_t idx = outputIndices[i];
         if (idx < MAX_OUTPUTS) {
-            outputChasingGroup[idx] = -1;
+            outputCore.group[idx] = -1;
         }
     }
     
@@ -1028,12 +1272,13 @@ void createChasingGroup(uint8_t groupId, uint8_t* outputIndices, uint8_t count,
     group->outputCount = count;
     group->interval = intervalMs;
     group->currentStep = 0;
-    group->lastStepTime = millis();
+    outputCore.scheduleGroup(groupSlot, millis() + intervalMs);
     
     for (int i = 0; i < count; i++) {
         group->outputIndices[i] = outputIndices[i];
         if (outputIndices[i] < MAX_OUTPUTS) {
-            outputChasingGroup[outputIndices[i]] = groupId;
+            outputCore.group[outputIndices[i]] = groupId;
+            outputCore.cancel(outputIndices[i]); // The group now drives this output
         }
     }
     
@@ -1041,7 +1286,8 @@ void createChasingGroup(uint8_t groupId, uint8_t* outputIndices, uint8_t count,
     for (int i = 0; i < count; i++) {
         uint8_t idx = outputIndices[i];
         if (idx < MAX_OUTPUTS) {
-            outputStates[idx] = true;
+            outputCore.state[idx] = true;
+            markOutputChanged(idx);
         }
     }
     
@@ -1050,9 +1296,9 @@ void createChasingGroup(uint8_t groupId, uint8_t* outputIndices, uint8_t count,
         uint8_t idx = outputIndices[i];
         if (idx < MAX_OUTPUTS) {
             if (i == 0) {
-                analogWrite(outputPins[idx], outputBrightness[idx]);
+                analogWrite(pinMap.pin(idx), outputCore.duty[idx]);
             } else {
-                analogWrite(outputPins[idx], 0);
+                analogWrite(pinMap.pin(idx), 0);
             }
         }
     }
@@ -1075,16 +1321,18 @@ void deleteChasingGroup(uint8_t groupId) {
             for (int j = 0; j < chasingGroups[i].outputCount; j++) {
                 uint8_t idx = chasingGroups[i].outputIndices[j];
                 if (idx < MAX_OUTPUTS) {
-                    outputChasingGroup[idx] = -1;
+                    outputCore.group[idx] = -1;
                     // Turn off output
-                    analogWrite(outputPins[idx], 0);
-                    outputStates[idx] = false;
+                    analogWrite(pinMap.pin(idx), 0);
+                    outputCore.state[idx] = false;
+                    markOutputChanged(idx);
                 }
             }
             
             // Clear group
             chasingGroups[i].active = false;
             chasingGroups[i].outputCount = 0;
+            outputCore.cancelGroup(i);
             
             saveChasingGroups();
             
@@ -1106,20 +1354,14 @@ void setOutputInterval(int index, unsigned int intervalMs) {
         return;
     }
     
-    outputIntervals[index] = intervalMs;
+    // Restart the blink cycle from the ON phase
+    outputCore.setInterval(index, intervalMs, millis());
     
-    // Reset blink timing
-    lastBlinkTime[index] = millis();
-    blinkState[index] = true;
-    
-    // If output is active and interval is set, start with ON state
-    if (outputStates[index]) {
+    if (outputCore.state[index]) {
         if (intervalMs > 0) {
-            analogWrite(outputPins[index], outputBrightness[index]);
-            Serial.println("[INTERVAL] Output " + String(index) + " (GPIO " + String(outputPins[index]) + ") set to blink every " + String(intervalMs) + "ms");
+            Serial.println("[INTERVAL] Output " + String(index) + " (GPIO " + String(pinMap.pin(index)) + ") set to blink every " + String(intervalMs) + "ms");
         } else {
-            analogWrite(outputPins[index], outputBrightness[index]);
-            Serial.println("[INTERVAL] Output " + String(index) + " (GPIO " + String(outputPins[index]) + ") blinking disabled (solid)");
+            Serial.println("[INTERVAL] Output " + String(index) + " (GPIO " + String(pinMap.pin(index)) + ") blinking disabled (solid)");
         }
     }
     
@@ -1127,612 +1369,611 @@ void setOutputInterval(int index, unsigned int intervalMs) {
     saveOutputState(index);
 }
 
+// Output and chasing command handlers shared by the HTTP endpoints and the WebSocket
+// command channel. Each returns an HTTP status code and, on failure, a short reason in error.
+
+// Fields of any command body, filled without a document tree (see command_parser.h);
+// room for a batch entry per output or a chasing group of every output
+typedef CommandFields<MAX_OUTPUTS> CommandRequest;
+
+// Largest command document for the ArduinoJson fallback: a batch with an entry per output
+const size_t COMMAND_JSON_CAPACITY = JSON_OBJECT_SIZE(6) + JSON_ARRAY_SIZE(MAX_OUTPUTS) + MAX_OUTPUTS * JSON_OBJECT_SIZE(4) + 64;
+
+// Command body into req: the schema parser, or ArduinoJson for shapes it leaves alone
+DeserializationError parseCommandRequest(const char* text, size_t length, CommandRequest& req) {
+    if (parseCommand(text, length, req)) {
+        return DeserializationError::Ok;
+    }
+    DynamicJsonDocument doc(COMMAND_JSON_CAPACITY);
+    DeserializationError error = deserializeJson(doc, text, length);
+    if (!error) {
+        commandFromJson(doc.as<JsonObjectConst>(), req);
+    }
+    return error;
+}
+
+int findOutputIndex(int pin) {
+    return pinMap.indexOf(pin);
+}
+
+String commandErrorJson(const char* error) {
+    return String("{\"error\":\"") + error + "\"}";
+}
+
+// {"pin":..,"active":..,"brightness":0-100}
+int controlCommand(const CommandRequest& req, const char*& error) {
+    int pin = req.has(FIELD_PIN) ? req.pin : -1;
+    bool active = req.active;
+    int brightness = req.has(FIELD_BRIGHTNESS) ? req.brightness : 100;
+    
+    Serial.print("[CMD] Control request: GPIO ");
+    Serial.print(pin);
+    Serial.print(" -> ");
+    Serial.print(active ? "ON" : "OFF");
+    Serial.print(" @ ");
+    Serial.print(brightness);
+    Serial.println("%");
+    
+    if (findOutputIndex(pin) < 0) {
+        Serial.println("[ERROR] Invalid GPIO pin: " + String(pin));
+        error = "Output not found";
+        return 404;
+    }
+    executeOutputCommand(pin, active, brightness);
+    return 200;
+}
+
+// {"pin":..,"interval":ms}
+int intervalCommand(const CommandRequest& req, const char*& error) {
+    int pin = req.has(FIELD_PIN) ? req.pin : -1;
+    unsigned int interval = req.has(FIELD_INTERVAL) ? req.interval : 0U;
+    
+    Serial.print("[CMD] Interval update request: GPIO ");
+    Serial.print(pin);
+    Serial.print(" -> ");
+    Serial.print(interval);
+    Serial.println("ms");
+    
+    int outputIndex = findOutputIndex(pin);
+    if (outputIndex < 0) {
+        Serial.print("[ERROR] GPIO pin not found: ");
+        Serial.println(pin);
+        error = "Output not found";
+        return 404;
+    }
+    setOutputInterval(outputIndex, interval);
+    markOutputChanged(outputIndex);
+    return 200;
+}
+
+// {"pin":..,"name":".."}; an empty name reverts to the default label
+int nameCommand(const CommandRequest& req, const char*& error) {
+    int pin = req.has(FIELD_PIN) ? req.pin : -1;
+    String name = req.name;
+    
+    Serial.print("[CMD] Name update request: GPIO ");
+    Serial.print(pin);
+    Serial.print(" -> '");
+    Serial.print(name);
+    Serial.println("'");
+    
+    int outputIndex = findOutputIndex(pin);
+    if (outputIndex < 0) {
+        Serial.print("[ERROR] GPIO pin not found: ");
+        Serial.println(pin);
+        error = "Output not found";
+        return 404;
+    }
+    saveOutputName(outputIndex, name);
+    markOutputChanged(outputIndex);
+    return 200;
+}
+
+// {"outputs":[{"pin":..,"active":..,"brightness":..,"interval":..}, ...]}
+// or {"select":"all"|"active"|"group", "group":<groupId>, "active":.., "brightness":.., "interval":..}
+int batchCommand(const CommandRequest& req, const char*& error, uint8_t& count) {
+    // Resolve the targets first, so a bad pin or group changes nothing
+    uint8_t targets[MAX_OUTPUTS];
+    bool perOutput = req.has(FIELD_OUTPUTS);
+    int status = outputCore.batchTargets(req, pinMap, targets, count, error);
+    
+    if (status == 0 && strcmp(req.select, "group") == 0) {
+        int groupId = req.has(FIELD_GROUP) ? req.group : -1;
+        int groupIndex = -1;
+        for (int g = 0; g < MAX_CHASING_GROUPS; g++) {
+            if (chasingGroups[g].active && chasingGroups[g].groupId == groupId) {
+                groupIndex = g;
+                break;
+            }
+        }
+        if (groupIndex < 0) {
+            error = "Group not found";
+            return 404;
+        }
+        for (int j = 0; j < chasingGroups[groupIndex].outputCount && count < MAX_OUTPUTS; j++) {
+            targets[count++] = chasingGroups[groupIndex].outputIndices[j];
+        }
+        status = 200;
+    } else if (status == 0) {
+        error = "Unknown selector";
+        status = 400;
+    }
+    if (status != 200) {
+        Serial.println(String("[ERROR] Batch rejected: ") + error);
+        return status;
+    }
+    
+    for (uint8_t t = 0; t < count; t++) {
+        applyBatchEntry(targets[t], perOutput ? req.outputs[t] : req.entry());
+        markOutputChanged(targets[t]);
+    }
+    saveAllOutputStates();
+    return 200;
+}
+
+// {"groupId":..,"interval":ms,"outputs":[pin, ...],"name":".."}
+int chasingCreateCommand(const CommandRequest& req, const char*& error) {
+    uint8_t groupId = req.groupId;
+    unsigned int interval = req.interval;
+    const char* groupName = req.has(FIELD_NAME) ? req.name : nullptr;
+    
+    if (req.outputTotal == 0 || req.outputTotal > MAX_OUTPUTS) {
+        error = "Invalid output count";
+        return 400;
+    }
+    
+    // Convert output pins to indices
+    uint8_t outputIndices[MAX_OUTPUTS];
+    uint8_t count = 0;
+    for (uint8_t e = 0; e < req.outputTotal; e++) {
+        int outputIndex = findOutputIndex(req.outputs[e].has(FIELD_VALUE) ? req.outputs[e].pin : 0);
+        if (outputIndex >= 0) {
+            outputIndices[count++] = outputIndex;
+        }
+    }
+    
+    if (count != req.outputTotal) {
+        error = "Invalid GPIO pin(s)";
+        return 400;
+    }
+    
+    createChasingGroup(groupId, outputIndices, count, interval, groupName);
+    return 200;
+}
+
+// {"groupId":..}
+int chasingDeleteCommand(const CommandRequest& req, const char*& error) {
+    uint8_t groupId = req.groupId;
+    deleteChasingGroup(groupId);
+    return 200;
+}
+
+// WebSocket command: {"id":<n>,"cmd":"control"|"interval"|"name"|"batch"|"chasing.create"|"chasing.delete"|"snapshot", ...fields of the HTTP endpoint}
+// Answered on the same socket with {"type":"ack","id":<n>,"status":<HTTP status>[,"error":".."]}
+void handleWebSocketCommand(uint8_t num, uint8_t* payload, size_t length) {
+    CommandRequest req;
+    DeserializationError parseError = parseCommandRequest((const char*)payload, length, req);
+    
+    uint32_t id = 0;
+    int status = 400;
+    const char* error = "Invalid JSON";
+    
+    if (!parseError) {
+        id = req.id;
+        const char* cmd = req.cmd;
+        uint8_t count = 0;
+        
+        error = nullptr;
+        if (strcmp(cmd, "control") == 0) {
+            status = controlCommand(req, error);
+        } else if (strcmp(cmd, "interval") == 0) {
+            status = intervalCommand(req, error);
+        } else if (strcmp(cmd, "name") == 0) {
+            status = nameCommand(req, error);
+        } else if (strcmp(cmd, "batch") == 0) {
+            status = batchCommand(req, error, count);
+        } else if (strcmp(cmd, "chasing.create") == 0) {
+            status = chasingCreateCommand(req, error);
+        } else if (strcmp(cmd, "chasing.delete") == 0) {
+            status = chasingDeleteCommand(req, error);
+        } else if (strcmp(cmd, "snapshot") == 0) {
+            // Client missed a delta; resync it
+            sendSnapshot(num);
+            status = 200;
+        } else {
+            status = 400;
+            error = "Unknown command";
+        }
+    }
+    
+    char ack[96];
+    if (status == 200) {
+        snprintf(ack, sizeof(ack), "{\"type\":\"ack\",\"id\":%lu,\"status\":200}", (unsigned long)id);
+    } else {
+        snprintf(ack, sizeof(ack), "{\"type\":\"ack\",\"id\":%lu,\"status\":%d,\"error\":\"%s\"}",
+                 (unsigned long)id, status, error);
+    }
+    ws->sendTXT(num, ack);
+}
+
+// Body of a POST from its TCP pieces, assembled in a bodyPool slot. Returns the
+// complete, NUL-terminated body once all of it has arrived; nullptr while pieces
+// are missing or when the request has already been answered with an error.
+const char* requestBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total, size_t& length) {
+    const char* body = nullptr;
+    switch (bodyPool.append(request, data, len, index, total, millis(), body, length)) {
+        case BODY_COMPLETE:
+            return body;
+        case BODY_PENDING:
+        case BODY_IGNORED:
+            return nullptr;
+        case BODY_TOO_LARGE:
+            Serial.println("[WEB] Request body of " + String(total) + " bytes refused (max " + String(MAX_BODY_SIZE) + ")");
+            request->send(413, "application/json", "{\"error\":\"Body too large\"}");
+            return nullptr;
+        case BODY_POOL_FULL:
+            Serial.println("[WEB] All " + String(BODY_POOL_SLOTS) + " body buffers busy - request refused");
+            request->send(503, "application/json", "{\"error\":\"Server busy\"}");
+            return nullptr;
+        default:
+            Serial.println("[ERROR] Request body pieces out of order");
+            request->send(400, "application/json", "{\"error\":\"Invalid body\"}");
+            return nullptr;
+    }
+}
+
+// Registered before every route: counts each request while its connection is
+// open and answers those over MAX_HTTP_CONNECTIONS with 503, so a burst of
+// clients cannot use up the heap with request buffers
+class HttpConnectionLimit : public AsyncWebHandler {
+public:
+    bool canHandle(AsyncWebServerRequest *request) override {
+        if (httpConnections >= MAX_HTTP_CONNECTIONS) {
+            return true; // Rejected in handleRequest()
+        }
+        httpConnections++;
+        request->onDisconnect([request]() {
+            httpConnections--;
+            bodyPool.release(request); // Client gone mid-body
+        });
+        return false; // On to the routes
+    }
+    
+    void handleRequest(AsyncWebServerRequest *request) override {
+        Serial.print("[WEB] Busy - rejecting ");
+        Serial.print(request->url());
+        Serial.print(" from ");
+        Serial.println(request->client()->remoteIP().toString());
+        
+        AsyncWebServerResponse *response = request->beginResponse(503, "application/json", "{\"error\":\"Too many connections\"}");
+        response->addHeader("Retry-After", "1");
+        request->send(response);
+    }
+};
+
 void initializeWebServer() {
     if (!server) return;
     
-    // Serve minimal HTML page optimized for ESP8266 low RAM - send in chunks
-    server->on("/", HTTP_GET, []() {
-        server->setContentLength(CONTENT_LENGTH_UNKNOWN);
-        server->send(200, "text/html", "");
-        
-        // Header chunk
-        server->sendContent(F("<!DOCTYPE html><html><head><meta charset='UTF-8'><meta name='viewport' content='width=device-width,initial-scale=1,maximum-scale=1,user-scalable=no'>"
-        "<title>RailHub8266</title><style>*{margin:0;padding:0;box-sizing:border-box}body{font-family:-apple-system,BlinkMacSystemFont,'Segoe UI',Arial,sans-serif;background:#1a1a1a;color:#e0e0e0;padding:15px;max-width:1200px;margin:0 auto}"
-        ".card{background:#2a2a2a;border:1px solid #3a3a3a;padding:15px;margin-bottom:15px;border-radius:8px}h1{font-size:1.5rem;margin-bottom:10px}h2{font-size:1.2rem;margin-bottom:10px}"
-        ".status{display:grid;grid-template-columns:repeat(auto-fit,minmax(140px,1fr));gap:10px;margin-bottom:20px}.stat{background:#333;padding:12px;text-align:center;border-radius:6px}"
-        ".value{font-size:1.5rem;color:#6c9bcf}.label{font-size:0.8rem;color:#999;margin-top:5px}"
-        ".outputs{display:grid;grid-template-columns:repeat(auto-fit,minmax(280px,1fr));gap:10px}.output{background:#333;padding:12px;display:flex;flex-direction:column;gap:10px;border-radius:6px}"
-        ".output-header{display:flex;justify-content:space-between;align-items:center;gap:10px}"
-        ".output-controls{display:flex;flex-direction:column;gap:8px;width:100%}"
-        ".output.on{border-left:4px solid #4a9b6f}.output.blinking{border-left:4px solid #f39c12}.toggle{width:60px;height:32px;background:#555;cursor:pointer;position:relative;border-radius:16px;flex-shrink:0}"
-        ".toggle.on{background:#4a9b6f}.toggle::after{content:'';position:absolute;width:28px;height:28px;background:#fff;top:2px;left:2px;transition:0.2s;border-radius:50%}"
-        ".toggle.on::after{left:30px}.brightness{display:flex;align-items:center;gap:10px}"
-        ".brightness input{flex:1;height:8px;border-radius:4px;background:#555;outline:none;-webkit-appearance:none;min-width:0}"
-        ".brightness input::-webkit-slider-thumb{-webkit-appearance:none;width:20px;height:20px;border-radius:50%;background:#6c9bcf;cursor:pointer;box-shadow:0 2px 4px rgba(0,0,0,0.3)}"
-        ".brightness input::-moz-range-thumb{width:20px;height:20px;border-radius:50%;background:#6c9bcf;cursor:pointer;border:none;box-shadow:0 2px 4px rgba(0,0,0,0.3)}"
-        ".brightness span{min-width:45px;text-align:right;font-size:0.9rem;color:#999}"
-        ".interval{display:flex;align-items:center;gap:8px;flex-wrap:wrap}"
-        ".interval input{width:80px;padding:6px 8px;background:#555;border:1px solid #666;color:#fff;border-radius:4px;font-size:0.9rem}"
-        ".interval span{font-size:0.85rem;color:#999}"
-        ".output.chasing{border-left:4px solid #9b59b6}"
-        ".chasing-group{background:#3a2a4a;padding:12px;margin-bottom:10px;border-left:4px solid #9b59b6;border-radius:6px}"
-        ".chasing-group h3{font-size:1rem;margin-bottom:8px;color:#bb79d6;cursor:pointer;word-break:break-word;display:flex;align-items:center;gap:8px}"
-        ".chasing-group h3:hover{color:#d699f0}"
-        ".chasing-group h3::before{content:'⚡';font-size:1.1rem}"
-        ".group-info{font-size:0.85rem;color:#b8b8b8;word-break:break-word;margin-bottom:10px;line-height:1.4}"
-        ".group-controls{display:flex;gap:8px;flex-wrap:wrap;margin-top:10px}"
-        ".output-name{cursor:pointer;font-weight:bold;color:#6c9bcf;word-break:break-word;flex:1}"
-        ".output-name:hover{color:#8bb5e0;text-decoration:underline}"
-        "button{background:#6c9bcf;color:#fff;border:none;padding:10px 20px;cursor:pointer;margin:5px 5px 5px 0;border-radius:6px;font-size:0.95rem;touch-action:manipulation;transition:background 0.3s,transform 0.1s}"
-        "button:hover{background:#5a8bc0}button:active{transform:scale(0.98)}button.processing{background:#4caf50!important;cursor:wait;transform:scale(1)!important}button.processing::before{content:'✓ ';font-size:1.3rem;font-weight:bold}"
-        "button.state-match{background:#4caf50!important;color:#fff;box-shadow:0 0 0 2px rgba(255,255,255,0.15) inset}"
-        "button:disabled{opacity:0.8;cursor:wait}button.delete{background:#e74c3c}button.delete:hover{background:#c0392b}"
-        ".info{font-size:0.9rem;color:#999}"
-        ".tabs{display:flex;gap:5px;margin-bottom:15px;overflow-x:auto;-webkit-overflow-scrolling:touch}.tab{background:#333;padding:12px 20px;cursor:pointer;border:none;color:#999;white-space:nowrap;border-radius:6px 6px 0 0;touch-action:manipulation}"
-        ".tab.active{background:#6c9bcf;color:#fff}.tab-content{display:none}.tab-content.active{display:block}"
-        ".storage-bar{background:#333;height:24px;border-radius:4px;overflow:hidden;margin-top:5px;position:relative}"
-        ".storage-fill{background:linear-gradient(90deg,#4a9b6f,#f39c12);height:100%;transition:width 0.3s}"
-        ".storage-text{position:absolute;top:4px;left:0;right:0;text-align:center;font-size:0.75rem;color:#fff;text-shadow:1px 1px 2px rgba(0,0,0,0.8)}"
-        ".modal{display:none;position:fixed;top:0;left:0;width:100%;height:100%;background:rgba(0,0,0,0.8);z-index:1000;align-items:center;justify-content:center;padding:20px}"
-        ".modal.show{display:flex}"
-        ".modal-content{background:#2a2a3a;padding:20px;border-radius:12px;width:100%;max-width:400px;box-shadow:0 4px 20px rgba(0,0,0,0.5)}"
-        ".modal-header{font-size:1.2rem;font-weight:bold;margin-bottom:15px;color:#6c9bcf}"
-        ".modal-input{width:100%;padding:12px;background:#555;border:1px solid #666;color:#fff;border-radius:6px;font-size:1rem;margin-bottom:15px}"
-        ".modal-input:focus{outline:none;border-color:#6c9bcf}"
-        ".modal-buttons{display:flex;gap:10px;justify-content:flex-end;flex-wrap:wrap}"
-        ".modal-buttons button{min-width:80px;flex:1}"
-        ".modal-buttons .cancel{background:#666}"
-        ".modal-buttons .cancel:hover{background:#555}"
-        ".control-buttons{display:flex;flex-wrap:wrap;gap:5px}"
-        ".form-group{margin-bottom:15px}"
-        ".form-group label{display:block;margin-bottom:5px;color:#999;font-size:0.9rem}"
-        ".form-group input[type=number],.form-group input[type=text]{width:100%;max-width:200px;padding:8px;background:#555;border:1px solid #666;color:#fff;border-radius:4px;font-size:0.95rem}"
-        ".checkbox-grid{display:grid;grid-template-columns:repeat(auto-fill,minmax(120px,1fr));gap:8px;padding:8px;background:#333;border-radius:4px}"
-        ".checkbox-label{display:flex;align-items:center;gap:10px;padding:10px 12px;background:#444;border-radius:4px;cursor:pointer;transition:background 0.2s}"
-        ".checkbox-label:hover:not(.disabled){background:#505050}"
-        ".checkbox-label input[type=checkbox]{appearance:none;-webkit-appearance:none;cursor:pointer;width:20px;height:20px;margin:0;flex-shrink:0;background:#555;border:2px solid #666;border-radius:4px;transition:all 0.2s;display:flex;align-items:center;justify-content:center}"
-        ".checkbox-label input[type=checkbox]:checked{background:#6c9bcf;border-color:#6c9bcf}"
-        ".checkbox-label input[type=checkbox]:checked::before{content:'✓';color:#fff;font-size:14px;font-weight:bold;line-height:1}"
-        ".checkbox-label input[type=checkbox]:disabled{opacity:0.4;cursor:not-allowed}"
-        ".checkbox-label.disabled{opacity:0.5;cursor:not-allowed}"
-        ".checkbox-label span{line-height:1.3;word-break:break-word;font-size:0.9rem}"
-        ".no-groups{text-align:center;padding:20px;color:#666;font-style:italic}"
-        "@media(min-width:768px){.output{flex-direction:row}.output-header{flex:0 0 auto}.output-controls{width:auto;flex:1}}"
-        "@media(max-width:480px){body{padding:10px}.card{padding:12px}h1{font-size:1.3rem}h2{font-size:1.1rem}button{padding:8px 16px;font-size:0.9rem}.toggle{width:50px;height:28px}.toggle::after{width:24px;height:24px}.toggle.on::after{left:24px}.stat{padding:10px}.value{font-size:1.3rem}}"
-        "</style></head><body>"));
-        
-        // Modal dialog for name editing
-        server->sendContent(F("<div id='nameModal' class='modal'><div class='modal-content'>"
-        "<div class='modal-header' id='modalTitle'>Edit Name</div>"
-        "<input type='text' id='modalInput' class='modal-input' maxlength='20' placeholder='Enter name...'>"
-        "<div class='modal-buttons'>"
-        "<button class='cancel' onclick='closeModal()'>Cancel</button>"
-        "<button onclick='saveModalName()'>Save</button>"
-        "</div></div></div>"));
-        
-        // Confirmation modal
-        server->sendContent(F("<div id='confirmModal' class='modal'><div class='modal-content'>"
-        "<div class='modal-header' id='confirmTitle'>Confirm</div>"
-        "<div id='confirmMessage' style='margin-bottom:20px;color:#ccc'></div>"
-        "<div class='modal-buttons'>"
-        "<button class='cancel' onclick='closeConfirm()'>Cancel</button>"
-        "<button class='delete' onclick='confirmYes()'>Delete</button>"
-        "</div></div></div>"));
-        
-        // Alert modal
-        server->sendContent(F("<div id='alertModal' class='modal'><div class='modal-content'>"
-        "<div class='modal-header' id='alertTitle'>Alert</div>"
-        "<div id='alertMessage' style='margin-bottom:20px;color:#ccc'></div>"
-        "<div class='modal-buttons'>"
-        "<button onclick='closeAlert()'>OK</button>"
-        "</div></div></div>"));
-        
-        // Body start
-        server->sendContent(F("<div class='card'><h1>🚂 RailHub8266</h1><p class='info'>"));
-        server->sendContent(String(customDeviceName));
-        server->sendContent(F("</p></div><div class='card'><div class='tabs'>"
-        "<button class='tab active' onclick='showTab(0)'>Status</button>"
-        "<button class='tab' onclick='showTab(1)'>Settings</button>"
-        "</div><div class='tab-content active' id='tab0'><h2>Status</h2><div class='status'>"
-        "<div class='stat'><div class='value' id='uptime'>-</div><div class='label'>Uptime</div></div>"
-        "<div class='stat'><div class='value' id='buildDate'>-</div><div class='label'>Build Date</div></div>"
-        "</div><div style='margin-top:15px'><div class='label'>RAM (80 KB)</div>"
-        "<div class='storage-bar'><div class='storage-fill' id='ramFill' style='width:0%'></div>"
-        "<div class='storage-text' id='ramText'>-</div></div></div>"
-        "<div style='margin-top:15px'><div class='label'>Program Flash (1 MB)</div>"
-        "<div class='storage-bar'><div class='storage-fill' id='storageFill' style='width:0%'></div>"
-        "<div class='storage-text' id='storageText'>-</div></div></div>"
-        "<div style='margin-top:20px'><h2>Controls</h2>"
-        "<div class='control-buttons'><button id='btnAllOn' onclick='allOn()'>All ON</button><button id='btnAllOff' onclick='allOff()'>All OFF</button></div>"
-        "<div class='brightness' style='margin-top:15px'><label style='display:block;margin-bottom:5px;color:#999;font-size:0.9rem'>Master Brightness:</label>"
-        "<input type='range' min='0' max='100' value='100' id='masterBrightness' oninput='this.nextElementSibling.textContent=this.value+\"%\"' onchange='setMasterBrightness(this.value)'>"
-        "<span style='color:#6c9bcf;font-weight:bold'>100%</span></div>"
-        "</div></div><div class='tab-content' id='tab1'><h2>Chasing Light Groups</h2>"
-        "<div style='background:#333;padding:15px;border-radius:6px;margin-bottom:15px'>"
-        "<div class='form-group'><label>Group ID:</label>"
-        "<input type='number' id='newGroupId' min='1' max='255' value='1'></div>"
-        "<div class='form-group'><label>Interval (ms):</label>"
-        "<input type='text' id='newGroupInterval' value='500'></div>"
-        "<div class='form-group'><label>Select Outputs (min. 2):</label>"
-        "<div id='outputSelector' class='checkbox-grid'></div></div>"
-        "<button onclick='createGroup()'>Create Group</button>"
-        "</div><div id='chasingGroups'></div>"
-        "<h2 style='margin-top:20px'>Outputs</h2><div class='outputs' id='outputs'></div></div></div>"));
-        
-        // JavaScript chunk
-        server->sendContent(F("<script>function showTab(n){localStorage.setItem('activeTab',n);document.querySelectorAll('.tab').forEach((t,i)=>t.classList.toggle('active',i===n));"
-        "document.querySelectorAll('.tab-content').forEach((c,i)=>c.classList.toggle('active',i===n));}"
-        "let wsData=null;let bulkState=null;async function load(){let d;if(wsData){d=wsData;wsData=null;}else{try{const r=await fetch('/api/status');d=await r.json();}catch(err){console.error('[LOAD] Error:',err);return;}}if(!d)return;try{const activeEl=document.activeElement;const isFocused=activeEl&&activeEl.tagName==='INPUT'&&activeEl.type==='text'&&activeEl.closest('.interval');"
-        "const focusedPin=isFocused?activeEl.closest('.output')?.querySelector('.output-name')?.getAttribute('onclick')?.match(/\\d+/)?.[0]:null;"
-        "const cursorPos=isFocused?activeEl.selectionStart:null;const focusedVal=isFocused?activeEl.value:null;"
-        "const usedRam=80-(d.freeHeap/1024);const ramPct=Math.round((usedRam/80)*100);"
-        "document.getElementById('ramFill').style.width=ramPct+'%';"
-        "document.getElementById('ramText').textContent=usedRam.toFixed(1)+'KB / 80KB ('+ramPct+'%)';"
-        "const s=Math.floor(d.uptime/1000);document.getElementById('uptime').textContent=s+'s';"
-        "if(d.buildDate)document.getElementById('buildDate').textContent=d.buildDate;"
-        "if(d.flashUsed&&d.flashPartition){const pct=Math.round((d.flashUsed/d.flashPartition)*100);"
-        "document.getElementById('storageFill').style.width=pct+'%';"
-        "document.getElementById('storageText').textContent=(d.flashUsed/1024).toFixed(0)+'KB / '+(d.flashPartition/1024).toFixed(0)+'KB ('+pct+'%)';}"
-        "const sel=document.getElementById('outputSelector');"
-        "const checked=[];document.querySelectorAll('#outputSelector input:checked').forEach(cb=>checked.push(cb.value));"
-        "sel.innerHTML='';"
-        "d.outputs.forEach(out=>{"
-        "const lbl=document.createElement('label');lbl.className='checkbox-label';"
-        "if(out.chasingGroup>=0)lbl.classList.add('disabled');"
-        "const cb=document.createElement('input');cb.type='checkbox';cb.value=out.pin;cb.id='out_'+out.pin;"
-        "cb.disabled=out.chasingGroup>=0;"
-        "if(out.chasingGroup<0&&checked.includes(out.pin.toString()))cb.checked=true;"
-        "lbl.appendChild(cb);"
-        "const outName=out.name||'GPIO '+out.pin;"
-        "const span=document.createElement('span');span.textContent=outName;span.style.fontSize='0.85rem';"
-        "lbl.appendChild(span);"
-        "sel.appendChild(lbl);});"
-        "const cg=document.getElementById('chasingGroups');cg.innerHTML='';"
-        "if(d.chasingGroups&&d.chasingGroups.length>0){"
-        "d.chasingGroups.forEach(g=>{"
-        "const div=document.createElement('div');div.className='chasing-group';"
-        "const outNames=g.outputs.map(pin=>{const o=d.outputs.find(x=>x.pin===pin);return o?(o.name||'GPIO '+pin):'GPIO '+pin;}).join(', ');"
-        "div.innerHTML=`<h3 onclick='editGName(${g.groupId},\"${g.name}\")'>${g.name}</h3>"
-        "<div class='group-info'><strong>Outputs:</strong> ${outNames}<br><strong>Interval:</strong> ${g.interval}ms</div>"
-        "<div class='group-controls'><button class='delete' onclick='deleteGroup(${g.groupId})'>Delete Group</button></div>`;"
-        "cg.appendChild(div);});}else{cg.innerHTML='<div class=\"no-groups\">No active groups</div>';}"
-        "const o=document.getElementById('outputs');o.innerHTML='';"
-        "d.outputs.forEach((out,i)=>{"
-        "const div=document.createElement('div');"
-        "let cls='output'+(out.active?' on':'')+(out.interval>0?' blinking':'')+(out.chasingGroup>=0?' chasing':'');"
-        "div.className=cls;"
-        "let groupTag='';"
-        "if(out.chasingGroup>=0){const grp=d.chasingGroups.find(g=>g.groupId===out.chasingGroup);groupTag=grp?' ['+grp.name+']':' [G'+out.chasingGroup+']';}"
-        "div.innerHTML=`<div class='output-header'><span class='output-name' onclick='editOName(${out.pin},\"${out.name}\")'>${out.name || 'GPIO '+out.pin}${groupTag}</span>"
-        "<div class='toggle ${out.active?'on':''}' onclick='tog(${out.pin})'></div></div>"
-        "<div class='output-controls'><div class='brightness'><input type='range' min='0' max='100' value='${out.brightness}' "
-        "oninput='this.nextElementSibling.textContent=this.value+\"%\"' onchange='setBright(${out.pin},this.value)'>"
-        "<span>${out.brightness}%</span></div>"
-        "<div class='interval'><span>Interval:</span><input type='text' value='${out.interval}' "
-        "onchange='setInt(${out.pin},this.value)' ${out.chasingGroup>=0?'disabled':''}><span>ms</span></div></div>`;"
-        "o.appendChild(div);});"
-        "if(focusedPin){const inputs=document.querySelectorAll('.interval input[type=text]');"
-        "inputs.forEach(inp=>{const pin=inp.closest('.output')?.querySelector('.output-name')?.getAttribute('onclick')?.match(/\\d+/)?.[0];"
-        "if(pin===focusedPin){inp.focus();if(cursorPos!==null){inp.setSelectionRange(cursorPos,cursorPos);inp.value=focusedVal||inp.value;}}});}"
-        "const btnOn=document.getElementById('btnAllOn');const btnOff=document.getElementById('btnAllOff');"
-        "const everyOn=d.outputs.length>0&&d.outputs.every(out=>out.active);"
-        "const everyOff=d.outputs.length>0&&d.outputs.every(out=>!out.active);"
-        "bulkState=everyOn?'on':everyOff?'off':null;"
-        "if(btnOn)btnOn.classList.toggle('state-match',bulkState==='on');"
-        "if(btnOff)btnOff.classList.toggle('state-match',bulkState==='off');"
-        "}catch(e){console.error(e);}}"));
-        
-        server->sendContent(F("async function tog(pin){try{const r=await fetch('/api/status');const d=await r.json();"
-        "const out=d.outputs.find(o=>o.pin===pin);await fetch('/api/control',{method:'POST',headers:{'Content-Type':'application/json'},"
-        "body:JSON.stringify({pin:pin,active:!out.active,brightness:out.brightness})});load();}catch(e){console.error(e);}}"));
-        
-        server->sendContent(F("async function setBright(pin,val){try{const r=await fetch('/api/status');const d=await r.json();"
-        "const out=d.outputs.find(o=>o.pin===pin);await fetch('/api/control',{method:'POST',headers:{'Content-Type':'application/json'},"
-        "body:JSON.stringify({pin:pin,active:out.active,brightness:parseInt(val)})});}catch(e){console.error(e);}}"));
-        
-        server->sendContent(F("async function setInt(pin,val){try{await fetch('/api/interval',{method:'POST',headers:{'Content-Type':'application/json'},"
-        "body:JSON.stringify({pin:pin,interval:parseInt(val)||0})});}catch(e){console.error(e);}}"));
-        
-        server->sendContent(F("let confirmCallback=null;function openConfirm(title,message,callback){"
-        "document.getElementById('confirmTitle').textContent=title;"
-        "document.getElementById('confirmMessage').textContent=message;"
-        "confirmCallback=callback;"
-        "document.getElementById('confirmModal').classList.add('show');}"
-        "function closeConfirm(){document.getElementById('confirmModal').classList.remove('show');confirmCallback=null;}"
-        "function confirmYes(){if(confirmCallback){confirmCallback();}closeConfirm();}"
-        "document.getElementById('confirmModal').addEventListener('click',e=>{"
-        "if(e.target.id==='confirmModal'){closeConfirm();}});"));
-        
-        server->sendContent(F("function showAlert(title,message){"
-        "document.getElementById('alertTitle').textContent=title;"
-        "document.getElementById('alertMessage').textContent=message;"
-        "document.getElementById('alertModal').classList.add('show');}"
-        "function closeAlert(){document.getElementById('alertModal').classList.remove('show');}"
-        "document.getElementById('alertModal').addEventListener('click',e=>{"
-        "if(e.target.id==='alertModal'){closeAlert();}});"));
-        
-        server->sendContent(F("async function deleteGroup(gid){"
-        "openConfirm('Delete Group','Are you sure you want to delete this chasing group?',async()=>{"
-        "try{await fetch('/api/chasing/delete',{method:'POST',headers:{'Content-Type':'application/json'},"
-        "body:JSON.stringify({groupId:gid})});load();}catch(e){console.error(e);}});}"));
-        
-        server->sendContent(F("let modalCallback=null;function openModal(title,currentVal,callback){"
-        "document.getElementById('modalTitle').textContent=title;"
-        "const input=document.getElementById('modalInput');"
-        "input.value=currentVal||'';"
-        "modalCallback=callback;"
-        "document.getElementById('nameModal').classList.add('show');"
-        "setTimeout(()=>input.focus(),100);}"
-        "function closeModal(){document.getElementById('nameModal').classList.remove('show');modalCallback=null;}"
-        "function saveModalName(){const val=document.getElementById('modalInput').value.trim();"
-        "if(modalCallback){modalCallback(val);}closeModal();}"
-        "document.getElementById('modalInput').addEventListener('keydown',e=>{"
-        "if(e.key==='Enter'){saveModalName();}else if(e.key==='Escape'){closeModal();}});"
-        "document.getElementById('nameModal').addEventListener('click',e=>{"
-        "if(e.target.id==='nameModal'){closeModal();}});"));
-        
-        server->sendContent(F("async function editGName(gid,oldName){"
-        "openModal('Edit Group Name',oldName,async(name)=>{"
-        "if(name===oldName)return;"
-        "const finalName=name.trim()||'Group '+gid;"
-        "try{await fetch('/api/chasing/name',{method:'POST',headers:{'Content-Type':'application/json'},"
-        "body:JSON.stringify({groupId:gid,name:finalName})});load();}catch(e){showAlert('Error',e.toString());console.error(e);}});}"));
-        
-        server->sendContent(F("async function editOName(pin,oldName){"
-        "openModal('Edit Output Name',oldName||'GPIO '+pin,async(name)=>{"
-        "const finalName=name.trim();"
-        "if(finalName===(oldName||'GPIO '+pin))return;"
-        "try{await fetch('/api/name',{method:'POST',headers:{'Content-Type':'application/json'},"
-        "body:JSON.stringify({pin:pin,name:finalName})});load();}catch(e){showAlert('Error',e.toString());console.error(e);}});}"));
-        
-        server->sendContent(F("async function createGroup(){try{"
-        "const gid=parseInt(document.getElementById('newGroupId').value);"
-        "const interval=parseInt(document.getElementById('newGroupInterval').value);"
-        "const outputs=[];"
-        "document.querySelectorAll('#outputSelector input[type=checkbox]:checked').forEach(cb=>outputs.push(parseInt(cb.value)));"
-        "if(outputs.length<2){showAlert('Validation Error','Please select at least 2 outputs');return;}"
-        "if(gid<1||gid>255){showAlert('Validation Error','Group ID must be 1-255');return;}"
-        "if(interval<50){showAlert('Validation Error','Interval must be at least 50ms');return;}"
-        "await fetch('/api/chasing/create',{method:'POST',headers:{'Content-Type':'application/json'},"
-        "body:JSON.stringify({groupId:gid,interval:interval,outputs:outputs})});"
-        "document.getElementById('newGroupId').value=parseInt(gid)+1;load();}catch(e){showAlert('Error',e.toString());console.error(e);}}"));;
-        
-        server->sendContent(F("let isProcessing=false;async function allOn(){const btn=document.getElementById('btnAllOn');if(isProcessing)return;isProcessing=true;"
-        "bulkState='on';btn.classList.add('processing');btn.disabled=true;try{const r=await fetch('/api/status');const d=await r.json();"
-        "for(const o of d.outputs){await fetch('/api/control',{method:'POST',headers:{'Content-Type':'application/json'},"
-        "body:JSON.stringify({pin:o.pin,active:true,brightness:100})});}}catch(e){console.error(e);}finally{await new Promise(r=>setTimeout(r,2000));"
-        "btn.classList.remove('processing');btn.disabled=false;isProcessing=false;}}"));
-        
-        server->sendContent(F("async function allOff(){const btn=document.getElementById('btnAllOff');if(isProcessing)return;isProcessing=true;"
-        "bulkState='off';btn.classList.add('processing');btn.disabled=true;try{const r=await fetch('/api/status');const d=await r.json();"
-        "for(const o of d.outputs){await fetch('/api/control',{method:'POST',headers:{'Content-Type':'application/json'},"
-        "body:JSON.stringify({pin:o.pin,active:false,brightness:0})});}}catch(e){console.error(e);}finally{await new Promise(r=>setTimeout(r,2000));"
-        "btn.classList.remove('processing');btn.disabled=false;isProcessing=false;}}"));
-        
-        server->sendContent(F("async function setMasterBrightness(val){try{const r=await fetch('/api/status');const d=await r.json();"
-        "for(const o of d.outputs){if(o.active){await fetch('/api/control',{method:'POST',headers:{'Content-Type':'application/json'},"
-        "body:JSON.stringify({pin:o.pin,active:true,brightness:parseInt(val)})});}}}catch(e){console.error(e);}}"));
-        
-        server->sendContent(F("let ws;function connectWS(){const wsUrl='ws://'+window.location.hostname+':81';"
-        "ws=new WebSocket(wsUrl);ws.onopen=()=>{console.log('[WS] Connected');};"
-        "ws.onmessage=(e)=>{try{wsData=JSON.parse(e.data);if(!isProcessing){load();}}catch(err){console.error('[WS] Parse error:',err);}};"
-        "ws.onerror=(e)=>{console.error('[WS] Error:',e);};"
-        "ws.onclose=()=>{console.log('[WS] Disconnected, reconnecting...');setTimeout(connectWS,2000);}};"
-        "const savedTab=localStorage.getItem('activeTab');if(savedTab!==null){showTab(parseInt(savedTab));}load().then(()=>connectWS());</script>"
-        "<footer style='text-align:center;padding:20px;margin-top:40px;border-top:1px solid #333;color:#666;font-size:0.9em;'>Made with ❤️ by innoMO</footer>"
-        "</body></html>"));
-        server->sendContent("");  // End chunked transfer
+    server->addHandler(new HttpConnectionLimit());
+    
+    // Main page: streamed from flash one TCP segment at a time, so a slow client
+    // costs a few short callbacks instead of holding up loop()
+    server->on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
+        Serial.print("[WEB] GET / from ");
+        Serial.println(request->client()->remoteIP().toString());
+        
+        String deviceName(customDeviceName);
+        request->send(request->beginChunkedResponse("text/html", [deviceName](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            return fillPage(PAGE_PARTS, sizeof(PAGE_PARTS) / sizeof(PAGE_PARTS[0]), deviceName.c_str(), index, buffer, maxLen);
+        }));
     });
     
     // API endpoint for status
-    server->on("/api/status", HTTP_GET, []() {
+    server->on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request) {
         unsigned long startTime = millis();
-        IPAddress clientIP = server->client().remoteIP();
+        IPAddress clientIP = request->client()->remoteIP();
         Serial.print("[WEB] GET /api/status from ");
         Serial.println(clientIP.toString());
         
-        DynamicJsonDocument doc(2048);
-        doc["macAddress"] = macAddress;
-        doc["name"] = customDeviceName;
-        doc["wifiMode"] = WiFi.getMode() == WIFI_AP ? "AP" : "STA";
-        doc["ip"] = WiFi.getMode() == WIFI_AP ? WiFi.softAPIP().toString() : WiFi.localIP().toString();
-        doc["ssid"] = WiFi.getMode() == WIFI_AP ? String(AP_SSID) : WiFi.SSID();
-        doc["apClients"] = WiFi.softAPgetStationNum();
-        doc["freeHeap"] = ESP.getFreeHeap();
-        doc["uptime"] = millis();
-        doc["flashTotal"] = ESP.getFlashChipSize();
-        doc["flashUsed"] = ESP.getSketchSize();
-        doc["flashFree"] = ESP.getFreeSketchSpace();
-        
-        JsonArray outputs = doc.createNestedArray("outputs");
+        httpJson.reset();
+        httpJson.beginObject();
+        httpJson.add("macAddress", macAddress.c_str());
+        httpJson.add("name", customDeviceName);
+        addNetworkInfo(httpJson);
+        httpJson.add("apClients", WiFi.softAPgetStationNum());
+        httpJson.add("freeHeap", ESP.getFreeHeap());
+        httpJson.add("uptime", millis());
+        httpJson.add("flashTotal", ESP.getFlashChipSize());
+        httpJson.add("flashUsed", ESP.getSketchSize());
+        httpJson.add("flashFree", ESP.getFreeSketchSpace());
+        
+        httpJson.beginObject("effectTick");
+        httpJson.add("periodUs", effectJitter.nominalUs());
+        httpJson.add("ticks", effectJitter.count());
+        httpJson.add("jitterMaxUs", effectJitter.maxUs());
+        httpJson.add("jitterAvgUs", effectJitter.avgUs());
+        httpJson.endObject();
+        
+        httpJson.beginObject("storage");
+        httpJson.add("commits", storageJournal.statistics().commits);
+        httpJson.add("unchanged", storageJournal.statistics().unchanged);
+        httpJson.add("erases", storageJournal.statistics().rotations);
+        httpJson.add("bytesWritten", storageJournal.statistics().bytesWritten);
+        httpJson.add("sector", storageJournal.currentSector());
+        httpJson.add("sectorUsed", storageJournal.bytesUsed());
+        httpJson.endObject();
+        
+        httpJson.beginArray("outputs");
         for (int i = 0; i < MAX_OUTPUTS; i++) {
-            JsonObject output = outputs.createNestedObject();
-            output["pin"] = outputPins[i];
-            output["active"] = outputStates[i];
-            output["brightness"] = map(outputBrightness[i], 0, 255, 0, 100);
-            output["name"] = outputNames[i];
-            output["interval"] = outputIntervals[i];
-            output["chasingGroup"] = outputChasingGroup[i];
+            addOutputStatus(httpJson, i);
         }
+        httpJson.endArray();
+        addChasingGroups(httpJson);
+        httpJson.endObject();
         
-        // Add chasing groups info
-        JsonArray groups = doc.createNestedArray("chasingGroups");
-        for (int i = 0; i < MAX_CHASING_GROUPS; i++) {
-            if (chasingGroups[i].active) {
-                JsonObject group = groups.createNestedObject();
-                group["groupId"] = chasingGroups[i].groupId;
-                group["name"] = chasingGroups[i].name;
-                group["interval"] = chasingGroups[i].interval;
-                group["outputCount"] = chasingGroups[i].outputCount;
-                JsonArray groupOutputs = group.createNestedArray("outputs");
-                for (int j = 0; j < chasingGroups[i].outputCount; j++) {
-                    groupOutputs.add(outputPins[chasingGroups[i].outputIndices[j]]);
-                }
-            }
+        if (!httpJson.ok()) {
+            Serial.println("[ERROR] Status response exceeds " + String(STATUS_JSON_SIZE) + " bytes");
+            request->send(500, "application/json", "{\"error\":\"Status too large\"}");
+            return;
         }
         
-        String response;
-        serializeJson(doc, response);
-        
         unsigned long duration = millis() - startTime;
         Serial.print("[WEB] Status response: ");
-        Serial.print(response.length());
+        Serial.print(httpJson.length());
         Serial.print(" bytes, ");
         Serial.print(duration);
         Serial.println("ms");
         
-        server->send(200, "application/json", response);
+        request->send(200, "application/json", httpJson.c_str());
     });
     
     // API endpoint for updating output name
-    server->on("/api/name", HTTP_POST, []() {
+    server->on("/api/name", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+    [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        size_t length = 0;
+        const char* body = requestBody(request, data, len, index, total, length);
+        if (!body) return;
+        
         unsigned long startTime = millis();
-        IPAddress clientIP = server->client().remoteIP();
-        String body = server->arg("plain");
+        IPAddress clientIP = request->client()->remoteIP();
         Serial.print("[WEB] POST /api/name from ");
         Serial.print(clientIP.toString());
         Serial.print(" (");
-        Serial.print(body.length());
+        Serial.print(length);
         Serial.println(" bytes)");
         
-        DynamicJsonDocument doc(512);
-        DeserializationError error = deserializeJson(doc, body);
+        CommandRequest req;
+        DeserializationError error = parseCommandRequest(body, length, req);
         
         if (error) {
             Serial.print("[ERROR] JSON deserialization failed: ");
             Serial.println(error.c_str());
-            server->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
             return;
         }
         
-        int pin = doc["pin"];
-        String name = doc["name"].as<String>();
-        
-        Serial.print("[WEB] Name update request: GPIO ");
-        Serial.print(pin);
-        Serial.print(" -> '");
-        Serial.print(name);
-        Serial.println("'");
-        
-        // Find output index by pin
-        int outputIndex = -1;
-        for (int i = 0; i < MAX_OUTPUTS; i++) {
-            if (outputPins[i] == pin) {
-                outputIndex = i;
-                break;
-            }
+        const char* reason = nullptr;
+        int status = nameCommand(req, reason);
+        if (status != 200) {
+            request->send(status, "application/json", commandErrorJson(reason));
+            return;
         }
         
-        if (outputIndex >= 0) {
-            saveOutputName(outputIndex, name);
-            unsigned long duration = millis() - startTime;
-            Serial.print("[WEB] Name update complete (");
-            Serial.print(duration);
-            Serial.println("ms)");
-            broadcastStatus();
-            server->send(200, "application/json", "{\"success\":true}");
-        } else {
-            Serial.print("[ERROR] GPIO pin not found: ");
-            Serial.println(pin);
-            server->send(404, "application/json", "{\"error\":\"Output not found\"}");
-        }
+        unsigned long duration = millis() - startTime;
+        Serial.print("[WEB] Name update complete (");
+        Serial.print(duration);
+        Serial.println("ms)");
+        request->send(200, "application/json", "{\"success\":true}");
     });
     
     // API endpoint for updating output blink interval
-    server->on("/api/interval", HTTP_POST, []() {
+    server->on("/api/interval", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+    [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        size_t length = 0;
+        const char* body = requestBody(request, data, len, index, total, length);
+        if (!body) return;
+        
         unsigned long startTime = millis();
-        IPAddress clientIP = server->client().remoteIP();
-        String body = server->arg("plain");
+        IPAddress clientIP = request->client()->remoteIP();
         Serial.print("[WEB] POST /api/interval from ");
         Serial.print(clientIP.toString());
         Serial.print(" (");
-        Serial.print(body.length());
+        Serial.print(length);
         Serial.println(" bytes)");
         
-        DynamicJsonDocument doc(512);
-        DeserializationError error = deserializeJson(doc, body);
+        CommandRequest req;
+        DeserializationError error = parseCommandRequest(body, length, req);
         
         if (error) {
             Serial.print("[ERROR] JSON deserialization failed: ");
             Serial.println(error.c_str());
-            server->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
             return;
         }
         
-        int pin = doc["pin"];
-        unsigned int interval = doc["interval"];
-        
-        Serial.print("[WEB] Interval update request: GPIO ");
-        Serial.print(pin);
-        Serial.print(" -> ");
-        Serial.print(interval);
-        Serial.println("ms");
-        
-        // Find output index by pin
-        int outputIndex = -1;
-        for (int i = 0; i < MAX_OUTPUTS; i++) {
-            if (outputPins[i] == pin) {
-                outputIndex = i;
-                break;
-            }
+        const char* reason = nullptr;
+        int status = intervalCommand(req, reason);
+        if (status != 200) {
+            request->send(status, "application/json", commandErrorJson(reason));
+            return;
         }
         
-        if (outputIndex >= 0) {
-            setOutputInterval(outputIndex, interval);
-            unsigned long duration = millis() - startTime;
-            Serial.print("[WEB] Interval update complete (");
-            Serial.print(duration);
-            Serial.println("ms)");
-            broadcastStatus();
-            server->send(200, "application/json", "{\"success\":true}");
-        } else {
-            Serial.print("[ERROR] GPIO pin not found: ");
-            Serial.println(pin);
-            server->send(404, "application/json", "{\"error\":\"Output not found\"}");
-        }
+        unsigned long duration = millis() - startTime;
+        Serial.print("[WEB] Interval update complete (");
+        Serial.print(duration);
+        Serial.println("ms)");
+        request->send(200, "application/json", "{\"success\":true}");
     });
     
     // API endpoint for control
-    server->on("/api/control", HTTP_POST, []() {
+    server->on("/api/control", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+    [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        size_t length = 0;
+        const char* body = requestBody(request, data, len, index, total, length);
+        if (!body) return;
+        
         unsigned long startTime = millis();
-        IPAddress clientIP = server->client().remoteIP();
-        String body = server->arg("plain");
+        IPAddress clientIP = request->client()->remoteIP();
         Serial.print("[WEB] POST /api/control from ");
         Serial.print(clientIP.toString());
         Serial.print(" (");
-        Serial.print(body.length());
+        Serial.print(length);
         Serial.println(" bytes)");
         
-        DynamicJsonDocument doc(1024);
-        DeserializationError error = deserializeJson(doc, body);
+        CommandRequest req;
+        DeserializationError error = parseCommandRequest(body, length, req);
         
         if (error) {
             Serial.print("[ERROR] JSON deserialization failed: ");
             Serial.println(error.c_str());
-            server->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
             return;
         }
         
-        int pin = doc["pin"];
-        bool active = doc["active"];
-        int brightness = doc["brightness"] | 100;
-        
-        Serial.print("[WEB] Control request: GPIO ");
-        Serial.print(pin);
-        Serial.print(" -> ");
-        Serial.print(active ? "ON" : "OFF");
-        Serial.print(" @ ");
-        Serial.print(brightness);
-        Serial.println("%");
-        
-        executeOutputCommand(pin, active, brightness);
+        const char* reason = nullptr;
+        int status = controlCommand(req, reason);
+        if (status != 200) {
+            request->send(status, "application/json", commandErrorJson(reason));
+            return;
+        }
         
         unsigned long duration = millis() - startTime;
         Serial.print("[WEB] Control complete (");
         Serial.print(duration);
         Serial.println("ms)");
         
-        server->send(200, "application/json", "{\"status\":\"ok\"}");
+        request->send(200, "application/json", "{\"status\":\"ok\"}");
     });
     
-    // API endpoint for creating chasing group
-    server->on("/api/chasing/create", HTTP_POST, []() {
+    // API endpoint for batch control: one EEPROM commit and one broadcast for many outputs
+    server->on("/api/control/batch", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+    [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        size_t length = 0;
+        const char* body = requestBody(request, data, len, index, total, length);
+        if (!body) return;
+        
         unsigned long startTime = millis();
-        IPAddress clientIP = server->client().remoteIP();
-        String body = server->arg("plain");
-        Serial.print("[WEB] POST /api/chasing/create from ");
+        IPAddress clientIP = request->client()->remoteIP();
+        Serial.print("[WEB] POST /api/control/batch from ");
         Serial.print(clientIP.toString());
         Serial.print(" (");
-        Serial.print(body.length());
+        Serial.print(length);
         Serial.println(" bytes)");
         
-        DynamicJsonDocument doc(1024);
-        DeserializationError error = deserializeJson(doc, body);
+        CommandRequest req;
+        DeserializationError error = parseCommandRequest(body, length, req);
         
         if (error) {
             Serial.print("[ERROR] JSON deserialization failed: ");
             Serial.println(error.c_str());
-            server->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
             return;
         }
         
-        uint8_t groupId = doc["groupId"];
-        unsigned int interval = doc["interval"];
-        JsonArray outputs = doc["outputs"];
-        const char* groupName = doc.containsKey("name") ? doc["name"].as<const char*>() : nullptr;
-        
-        if (outputs.size() == 0 || outputs.size() > 8) {
-            server->send(400, "application/json", "{\"error\":\"Invalid output count (1-8)\"}");
+        const char* reason = nullptr;
+        uint8_t count = 0;
+        int status = batchCommand(req, reason, count);
+        if (status != 200) {
+            request->send(status, "application/json", commandErrorJson(reason));
             return;
         }
         
-        // Convert output pins to indices
-        uint8_t outputIndices[8];
-        uint8_t count = 0;
-        for (JsonVariant v : outputs) {
-            int pin = v.as<int>();
-            // Find output index by pin
-            for (int i = 0; i < MAX_OUTPUTS; i++) {
-                if (outputPins[i] == pin) {
-                    outputIndices[count++] = i;
-                    break;
-                }
-            }
-        }
+        unsigned long duration = millis() - startTime;
+        Serial.print("[WEB] Batch control complete: ");
+        Serial.print(count);
+        Serial.print(" outputs (");
+        Serial.print(duration);
+        Serial.println("ms)");
         
-        if (count != outputs.size()) {
-            server->send(400, "application/json", "{\"error\":\"Invalid GPIO pin(s)\"}");
+        request->send(200, "application/json", "{\"status\":\"ok\",\"outputs\":" + String(count) + "}");
+    });
+    
+    // API endpoint for creating chasing group
+    server->on("/api/chasing/create", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+    [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        size_t length = 0;
+        const char* body = requestBody(request, data, len, index, total, length);
+        if (!body) return;
+        
+        unsigned long startTime = millis();
+        IPAddress clientIP = request->client()->remoteIP();
+        Serial.print("[WEB] POST /api/chasing/create from ");
+        Serial.print(clientIP.toString());
+        Serial.print(" (");
+        Serial.print(length);
+        Serial.println(" bytes)");
+        
+        CommandRequest req;
+        DeserializationError error = parseCommandRequest(body, length, req);
+        
+        if (error) {
+            Serial.print("[ERROR] JSON deserialization failed: ");
+            Serial.println(error.c_str());
+            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
             return;
         }
         
-        createChasingGroup(groupId, outputIndices, count, interval, groupName);
+        const char* reason = nullptr;
+        int status = chasingCreateCommand(req, reason);
+        if (status != 200) {
+            request->send(status, "application/json", commandErrorJson(reason));
+            return;
+        }
         
         unsigned long duration = millis() - startTime;
         Serial.print("[WEB] Chasing group created (");
         Serial.print(duration);
         Serial.println("ms)");
         
-        server->send(200, "application/json", "{\"success\":true}");
+        request->send(200, "application/json", "{\"success\":true}");
     });
     
     // API endpoint for deleting chasing group
-    server->on("/api/chasing/delete", HTTP_POST, []() {
-        IPAddress clientIP = server->client().remoteIP();
-        String body = server->arg("plain");
+    server->on("/api/chasing/delete", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+    [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        size_t length = 0;
+        const char* body = requestBody(request, data, len, index, total, length);
+        if (!body) return;
+        
+        IPAddress clientIP = request->client()->remoteIP();
         Serial.print("[WEB] POST /api/chasing/delete from ");
         Serial.println(clientIP.toString());
         
-        DynamicJsonDocument doc(256);
-        DeserializationError error = deserializeJson(doc, body);
+        CommandRequest req;
+        DeserializationError error = parseCommandRequest(body, length, req);
         
         if (error) {
-            server->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
             return;
         }
         
-        uint8_t groupId = doc["groupId"];
-        deleteChasingGroup(groupId);
+        const char* reason = nullptr;
+        chasingDeleteCommand(req, reason);
         
-        server->send(200, "application/json", "{\"success\":true}");
+        request->send(200, "application/json", "{\"success\":true}");
     });
     
     // API endpoint for updating chasing group name
-    server->on("/api/chasing/name", HTTP_POST, []() {
-        IPAddress clientIP = server->client().remoteIP();
-        String body = server->arg("plain");
+    server->on("/api/chasing/name", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+    [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        size_t length = 0;
+        const char* body = requestBody(request, data, len, index, total, length);
+        if (!body) return;
+        
+        IPAddress clientIP = request->client()->remoteIP();
         Serial.print("[WEB] POST /api/chasing/name from ");
         Serial.println(clientIP.toString());
         
-        DynamicJsonDocument doc(256);
-        DeserializationError error = deserializeJson(doc, body);
+        CommandRequest req;
+        DeserializationError error = parseCommandRequest(body, length, req);
         
         if (error) {
-            server->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
             return;
         }
         
-        uint8_t groupId = doc["groupId"];
-        const char* newName = doc["name"];
+        uint8_t groupId = req.groupId;
+        const char* newName = req.has(FIELD_NAME) ? req.name : nullptr;
         
         // If name is empty or null, use default "Group X"
         char finalName[21];
@@ -1761,16 +2002,92 @@ void initializeWebServer() {
         }
         
         if (found) {
-            broadcastStatus();
-            server->send(200, "application/json", "{\"success\":true}");
+            request->send(200, "application/json", "{\"success\":true}");
         } else {
-            server->send(404, "application/json", "{\"error\":\"Group not found\"}");
+            request->send(404, "application/json", "{\"error\":\"Group not found\"}");
+        }
+    });
+    
+    // loop() profile: {"iterations":..,"rateHz":..,"longestUs":..,"sections":{"portal":[calls,totalUs,maxUs], ...},
+    //                  "rateHistogram":[..],"longestHistogram":[..]}
+    // Shares httpJson with /api/status: both handlers run in the same (sys) context
+    server->on("/api/debug/loop", HTTP_GET, [](AsyncWebServerRequest *request) {
+        httpJson.reset();
+        httpJson.beginObject();
+        loopProfiler.write(httpJson, "loop", LOOP_SECTION_NAMES);
+        httpJson.endObject();
+        if (!httpJson.ok()) {
+            request->send(500, "application/json", "{\"error\":\"Profile exceeds buffer\"}");
+            return;
+        }
+        request->send(200, "application/json", httpJson.c_str());
+    });
+    
+    // Output-to-GPIO map: {"pins":[GPIO of output 0, ...],"default":[LED_PINS]}
+    server->on("/api/pins", HTTP_GET, [](AsyncWebServerRequest *request) {
+        char buffer[128];
+        JsonWriter json(buffer, sizeof(buffer));
+        json.beginObject();
+        json.beginArray("pins");
+        for (int i = 0; i < MAX_OUTPUTS; i++) {
+            json.add(nullptr, pinMap.pin(i));
+        }
+        json.endArray();
+        json.beginArray("default");
+        for (int i = 0; i < MAX_OUTPUTS; i++) {
+            json.add(nullptr, DEFAULT_OUTPUT_PINS[i]);
         }
+        json.endArray();
+        json.endObject();
+        request->send(200, "application/json", buffer);
+    });
+    
+    // Replace the pin map: {"outputs":[GPIO for output 0, 1, ...]} with one pin per output.
+    // Saved, then applied by a restart right after the response.
+    server->on("/api/pins", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+    [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        size_t length = 0;
+        const char* body = requestBody(request, data, len, index, total, length);
+        if (!body) return;
+        
+        IPAddress clientIP = request->client()->remoteIP();
+        Serial.print("[WEB] POST /api/pins from ");
+        Serial.println(clientIP.toString());
+        
+        CommandRequest req;
+        DeserializationError error = parseCommandRequest(body, length, req);
+        if (error) {
+            request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+            return;
+        }
+        if (req.outputTotal != MAX_OUTPUTS) {
+            request->send(400, "application/json", commandErrorJson("Need one pin per output"));
+            return;
+        }
+        
+        int pins[MAX_OUTPUTS];
+        for (int i = 0; i < MAX_OUTPUTS; i++) {
+            pins[i] = req.outputs[i].has(FIELD_VALUE) ? req.outputs[i].pin : -1;
+        }
+        uint8_t badIndex = 0;
+        PinCheck result = checkPinMap(pins, badIndex);
+        if (result != PIN_OK) {
+            char reason[64];
+            snprintf(reason, sizeof(reason), "Output %u: GPIO %d is a %s", badIndex, pins[badIndex], pinCheckText(result));
+            Serial.println(String("[ERROR] Pin map rejected - ") + reason);
+            request->send(400, "application/json", commandErrorJson(reason));
+            return;
+        }
+        
+        savePinMap(pins);
+        Serial.println("[EEPROM] Pin map saved, restarting to apply it");
+        pinMapRestartAt = millis() + 1000;
+        request->send(200, "application/json", "{\"status\":\"ok\",\"restart\":true}");
     });
     
     // API endpoint to reset saved states
-    server->on("/api/reset", HTTP_POST, []() {
-        IPAddress clientIP = server->client().remoteIP();
+    server->on("/api/reset", HTTP_POST, [](AsyncWebServerRequest *request) {
+        IPAddress clientIP = request->client()->remoteIP();
         Serial.print("[WEB] POST /api/reset from ");
         Serial.println(clientIP.toString());
         Serial.println("[EEPROM] Resetting all saved states...");
@@ -1778,18 +2095,16 @@ void initializeWebServer() {
         Serial.print(ESP.getFreeHeap());
         Serial.println(" bytes");
         
-        // Clear EEPROM data
-        for (int i = 0; i < EEPROM_SIZE; i++) {
-            EEPROM.write(i, 0xFF);
-        }
-        EEPROM.commit();
+        // Replace saved settings with defaults (current outputs keep running until reboot)
+        setDefaultEEPROMData();
+        commitEEPROMData();
         
         Serial.println("[EEPROM] All saved states cleared!");
         Serial.print("[EEPROM] Free heap after reset: ");
         Serial.print(ESP.getFreeHeap());
         Serial.println(" bytes");
         
-        server->send(200, "application/json", "{\"status\":\"reset_complete\"}");
+        request->send(200, "application/json", "{\"status\":\"reset_complete\"}");
     });
     
     server->begin();
@@ -1798,9 +2113,13 @@ void initializeWebServer() {
     Serial.println("[WEB]   GET  /                   - Main control interface");
     Serial.println("[WEB]   GET  /api/status         - System and output status");
     Serial.println("[WEB]   POST /api/control        - Control output state/brightness");
+    Serial.println("[WEB]   POST /api/control/batch  - Control several outputs at once");
     Serial.println("[WEB]   POST /api/name           - Update output name");
     Serial.println("[WEB]   POST /api/interval       - Set output blink interval");
+    Serial.println("[WEB]   GET/POST /api/pins       - Output-to-GPIO map (restarts on change)");
+    Serial.println("[WEB]   GET  /api/debug/loop     - Time spent per loop() subsystem");
     Serial.println("[WEB]   POST /api/chasing/create - Create chasing light group");
     Serial.println("[WEB]   POST /api/chasing/delete - Delete chasing light group");
     Serial.println("[WEB]   POST /api/reset          - Reset all saved preferences");
+    Serial.println("[WEB] Up to " + String(MAX_HTTP_CONNECTIONS) + " concurrent requests");
 }
\ No newline at end of file
@@ -0,0 +1,299 @@
+/**
+ * @file test_async_page.cpp
+ * @brief Tests for the streamed main page and a load model of the async server
+ *
+ * The page tests check that fillPage() reassembles the page exactly for any
+ * piece size, and stream the firmware's own page from main_page.h. The load test replays several clients reloading the UI on a
+ * virtual clock, once as the async server handles them (one segment per
+ * network callback) and once as the old blocking server did (handleClient()
+ * sends the whole page from inside loop(), yielding only while it waits for
+ * ACKs). It reports how late the 1 ms effect tick runs and the longest time
+ * between two loop() passes, which is what WebSocket service and deltas wait.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <page_stream.h>
+#include "../../include/main_page.h"
+
+#define HEAD_SIZE 6000
+#define TAIL_SIZE 14000
+
+static char pageHead[HEAD_SIZE + 1];
+static char pageTail[TAIL_SIZE + 1];
+static const char *deviceName = "Signal Box \"North\"";
+
+static PagePart pageParts[3];
+
+static void setupPage() {
+    for (int i = 0; i < HEAD_SIZE; i++) pageHead[i] = (char)('a' + i % 26);
+    for (int i = 0; i < TAIL_SIZE; i++) pageTail[i] = (char)('A' + i % 26);
+    pageHead[HEAD_SIZE] = '\0';
+    pageTail[TAIL_SIZE] = '\0';
+    pageParts[0].data = pageHead;
+    pageParts[0].length = HEAD_SIZE;
+    pageParts[1].data = nullptr;
+    pageParts[1].length = 0;
+    pageParts[2].data = pageTail;
+    pageParts[2].length = TAIL_SIZE;
+}
+
+static std::string expectedPage(const char *name) {
+    return std::string(pageHead) + name + pageTail;
+}
+
+// Test: Any piece size reassembles the exact page, then the filler reports the end
+void test_page_pieces_reassemble(void) {
+    setupPage();
+    static const size_t pieceSizes[] = {1, 7, 536, 1460, 4096, 65536};
+    static uint8_t buffer[65536];
+
+    for (size_t s = 0; s < sizeof(pieceSizes) / sizeof(pieceSizes[0]); s++) {
+        std::string page;
+        size_t n;
+        while ((n = fillPage(pageParts, 3, deviceName, page.size(), buffer, pieceSizes[s])) > 0) {
+            TEST_ASSERT_TRUE(n <= pieceSizes[s]);
+            page.append((const char *)buffer, n);
+        }
+        TEST_ASSERT_TRUE(page == expectedPage(deviceName));
+    }
+}
+
+// Test: Pieces straddle the name, an empty name is skipped, and reading past the end is harmless
+void test_page_edges(void) {
+    setupPage();
+    uint8_t buffer[32];
+
+    size_t n = fillPage(pageParts, 3, deviceName, HEAD_SIZE - 2, buffer, 8);
+    TEST_ASSERT_EQUAL(8, n);
+    TEST_ASSERT_EQUAL_MEMORY(pageHead + HEAD_SIZE - 2, buffer, 2);
+    TEST_ASSERT_EQUAL_MEMORY(deviceName, buffer + 2, 6);
+
+    n = fillPage(pageParts, 3, "", HEAD_SIZE, buffer, 4);
+    TEST_ASSERT_EQUAL(4, n);
+    TEST_ASSERT_EQUAL_MEMORY(pageTail, buffer, 4);
+
+    size_t total = HEAD_SIZE + strlen(deviceName) + TAIL_SIZE;
+    TEST_ASSERT_EQUAL(1, fillPage(pageParts, 3, deviceName, total - 1, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(0, fillPage(pageParts, 3, deviceName, total, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(0, fillPage(pageParts, 3, deviceName, total + 100, buffer, sizeof(buffer)));
+}
+
+// Test: The firmware's page streams whole, with the name between head and tail
+void test_main_page_streams(void) {
+    static uint8_t buffer[536];
+    std::string page;
+    size_t n;
+    while ((n = fillPage(PAGE_PARTS, 3, deviceName, page.size(), buffer, sizeof(buffer))) > 0) {
+        page.append((const char *)buffer, n);
+    }
+
+    TEST_ASSERT_EQUAL(sizeof(PAGE_HEAD) - 1 + strlen(deviceName) + sizeof(PAGE_TAIL) - 1, page.size());
+    TEST_ASSERT_EQUAL(0, page.find("<!DOCTYPE html>"));
+    TEST_ASSERT_EQUAL(sizeof(PAGE_HEAD) - 1, page.find(deviceName));
+    TEST_ASSERT_EQUAL(page.size() - strlen("</body></html>"), page.rfind("</body></html>"));
+    // One script block, and the code after the chasing group form is still part of it
+    size_t script = page.find("<script>");
+    size_t scriptEnd = page.find("</script>");
+    TEST_ASSERT_TRUE(script != std::string::npos && scriptEnd > script);
+    TEST_ASSERT_EQUAL(std::string::npos, page.find("<script>", script + 1));
+    size_t allOn = page.find("async function allOn()");
+    TEST_ASSERT_TRUE(allOn > script && allOn < scriptEnd);
+}
+
+// Load model. Costs are rough ESP8266 figures at 80 MHz; what matters is
+// that the async server does one of them per callback.
+#define MODEL_DURATION_US 10000000ULL   // 10 s of virtual time
+#define TICK_US 1000                    // EFFECT_TICK_MS
+#define EFFECT_US 40                    // One effect tick
+#define LOOP_US 300                     // ws->loop(), deltas, MDNS.update()
+#define SEGMENT_BYTES 536               // lwIP MSS of the low-memory variant
+#define CALLBACK_US 250                 // TCP callback and response bookkeeping
+#define COPY_NS_PER_BYTE 100            // memcpy_P from flash
+
+#define MODEL_CLIENTS 5
+
+struct ModelClient {
+    uint32_t rttUs;
+    uint64_t nextAt;                    // Request or ACK arrives
+    size_t sent;
+    uint32_t pages;
+};
+
+struct ModelResult {
+    uint32_t maxTickLateUs;
+    uint64_t maxLoopGapUs;
+    uint32_t pages[MODEL_CLIENTS];
+};
+
+struct Model {
+    uint64_t now;
+    uint64_t nextTick;
+    uint32_t maxTickLateUs;
+    uint64_t lastLoopStart;
+    uint64_t maxLoopGapUs;
+    ModelClient clients[MODEL_CLIENTS];
+    uint8_t buffer[SEGMENT_BYTES];
+
+    Model() : now(0), nextTick(TICK_US), maxTickLateUs(0), lastLoopStart(0), maxLoopGapUs(0) {
+        // Four phones on a good link and one on the edge of the WiFi
+        for (int i = 0; i < MODEL_CLIENTS; i++) {
+            clients[i].rttUs = i == MODEL_CLIENTS - 1 ? 200000 : 20000;
+            clients[i].nextAt = (uint64_t)i * 3000;
+            clients[i].sent = 0;
+            clients[i].pages = 0;
+        }
+    }
+
+    // Ticker callbacks run whenever the CPU is not inside a callback or loop pass
+    void runDueTicks() {
+        while (nextTick <= now) {
+            uint32_t late = (uint32_t)(now - nextTick);
+            if (late > maxTickLateUs) maxTickLateUs = late;
+            now += EFFECT_US;
+            nextTick += TICK_US;
+        }
+    }
+
+    // Yielding wait (delay() while the blocking server waits for an ACK)
+    void waitUntil(uint64_t t) {
+        runDueTicks();
+        while (nextTick < t) {
+            if (now < nextTick) now = nextTick;
+            runDueTicks();
+        }
+        if (now < t) now = t;
+    }
+
+    void loopPassStarts() {
+        if (lastLoopStart > 0 && now - lastLoopStart > maxLoopGapUs) maxLoopGapUs = now - lastLoopStart;
+        lastLoopStart = now;
+    }
+
+    ModelClient *dueClient() {
+        ModelClient *due = nullptr;
+        for (int i = 0; i < MODEL_CLIENTS; i++) {
+            if (clients[i].nextAt <= now && (!due || clients[i].nextAt < due->nextAt)) due = &clients[i];
+        }
+        return due;
+    }
+
+    // Copies the next segment; false once the page is complete
+    bool sendSegment(ModelClient *client) {
+        size_t n = fillPage(pageParts, 3, deviceName, client->sent, buffer, sizeof(buffer));
+        now += CALLBACK_US + n * COPY_NS_PER_BYTE / 1000;
+        client->sent += n;
+        if (n == 0) {
+            client->pages++;
+            client->sent = 0;
+        }
+        return n > 0;
+    }
+
+    ModelResult result() const {
+        ModelResult r;
+        r.maxTickLateUs = maxTickLateUs;
+        r.maxLoopGapUs = maxLoopGapUs;
+        for (int i = 0; i < MODEL_CLIENTS; i++) r.pages[i] = clients[i].pages;
+        return r;
+    }
+};
+
+// ESPAsyncWebServer: every request or ACK is one short callback between loop() passes
+static ModelResult runAsyncModel() {
+    Model m;
+    while (m.now < MODEL_DURATION_US) {
+        m.runDueTicks();
+        ModelClient *client = m.dueClient();
+        if (client) {
+            m.sendSegment(client);
+            client->nextAt = m.now + client->rttUs; // Next ACK, or the next reload
+            continue;
+        }
+        m.loopPassStarts();
+        m.now += LOOP_US;
+    }
+    m.loopPassStarts();
+    return m.result();
+}
+
+// ESP8266WebServer: handleClient() in loop() sends a whole page before returning
+static ModelResult runBlockingModel() {
+    Model m;
+    while (m.now < MODEL_DURATION_US) {
+        m.runDueTicks();
+        m.loopPassStarts();
+        m.now += LOOP_US;
+
+        ModelClient *client = m.dueClient();
+        if (client) {
+            while (m.sendSegment(client)) {
+                m.waitUntil(m.now + client->rttUs);
+            }
+            client->nextAt = m.now + client->rttUs;
+        }
+    }
+    m.loopPassStarts();
+    return m.result();
+}
+
+static void report(const char *label, const ModelResult &r) {
+    char line[160];
+    snprintf(line, sizeof(line), "%s: effect tick late max %lu us, longest gap between loop() passes %.1f ms, pages %lu/%lu/%lu/%lu/%lu (last client slow)",
+             label, (unsigned long)r.maxTickLateUs, r.maxLoopGapUs / 1000.0,
+             (unsigned long)r.pages[0], (unsigned long)r.pages[1], (unsigned long)r.pages[2],
+             (unsigned long)r.pages[3], (unsigned long)r.pages[4]);
+    TEST_MESSAGE(line);
+}
+
+// Test: With five clients reloading the UI, the effect tick stays within one period and loop() keeps running
+void test_effect_timing_under_ui_load(void) {
+    setupPage();
+    ModelResult async = runAsyncModel();
+    ModelResult blocking = runBlockingModel();
+    report("async", async);
+    report("blocking", blocking);
+
+    // Effect steps are at most one callback late: stable timing under load
+    TEST_ASSERT_TRUE(async.maxTickLateUs < TICK_US);
+    // WebSocket service and deltas wait for a few callbacks, not for a page
+    TEST_ASSERT_TRUE(async.maxLoopGapUs < 5000);
+    TEST_ASSERT_TRUE(blocking.maxLoopGapUs > 1000000);
+    // And every client, the slow one included, still gets its pages
+    for (int i = 0; i < MODEL_CLIENTS; i++) {
+        TEST_ASSERT_TRUE(async.pages[i] > 0);
+        TEST_ASSERT_TRUE(async.pages[i] >= blocking.pages[i]);
+    }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_page_pieces_reassemble);
+    RUN_TEST(test_page_edges);
+    RUN_TEST(test_main_page_streams);
+    RUN_TEST(test_effect_timing_under_ui_load);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
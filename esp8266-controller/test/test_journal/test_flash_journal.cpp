@@ -0,0 +1,316 @@
+/**
+ * @file test_flash_journal.cpp
+ * @brief Unit tests for the log-structured flash journal behind EEPROMData
+ *
+ * Runs the journal against a simulated NOR flash (erase sets bytes to 0xFF,
+ * programming can only clear bits) and counts erases per sector. The
+ * year-long simulation prints the erase count of every sector; the power-cut
+ * tests stop programming at every byte offset of a commit.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <flash_journal.h>
+
+#define SIM_SECTORS 4
+
+// Simulated NOR flash with per-sector erase counters and an optional write budget
+class SimFlash {
+public:
+    static const uint32_t SECTOR_SIZE = 4096;
+
+    SimFlash() : writeBudget(-1) {
+        memset(data, 0xFF, sizeof(data));
+        memset(erases, 0, sizeof(erases));
+    }
+
+    uint16_t sectorCount() const { return SIM_SECTORS; }
+
+    bool eraseSector(uint16_t sector) {
+        if (sector >= SIM_SECTORS || writeBudget == 0) return false;
+        memset(data[sector], 0xFF, SECTOR_SIZE);
+        erases[sector]++;
+        return true;
+    }
+
+    bool write(uint16_t sector, uint32_t offset, const void *src, uint32_t length) {
+        TEST_ASSERT_EQUAL(0, offset % 4);
+        TEST_ASSERT_EQUAL(0, length % 4);
+        if (sector >= SIM_SECTORS || offset + length > SECTOR_SIZE) return false;
+
+        const uint8_t *bytes = (const uint8_t *)src;
+        for (uint32_t i = 0; i < length; i++) {
+            if (writeBudget == 0) return false; // Power cut mid-write
+            if (writeBudget > 0) writeBudget--;
+            data[sector][offset + i] &= bytes[i];
+        }
+        return true;
+    }
+
+    bool read(uint16_t sector, uint32_t offset, void *dst, uint32_t length) {
+        if (sector >= SIM_SECTORS || offset + length > SECTOR_SIZE) return false;
+        memcpy(dst, data[sector] + offset, length);
+        return true;
+    }
+
+    uint8_t data[SIM_SECTORS][SECTOR_SIZE];
+    uint32_t erases[SIM_SECTORS];
+    long writeBudget; // Bytes that may still be programmed, -1 = unlimited
+};
+
+const uint32_t SimFlash::SECTOR_SIZE;
+
+// Same shape as the ESP8266 EEPROMData
+struct Settings {
+    char deviceName[40];
+    bool outputStates[8];
+    uint8_t outputBrightness[8];
+    char outputNames[8][21];
+    uint16_t outputIntervals[8];
+    uint8_t chasingGroupCount;
+    struct {
+        uint8_t groupId;
+        bool active;
+        char name[21];
+        uint8_t outputIndices[8];
+        uint8_t outputCount;
+        uint16_t interval;
+    } chasingGroups[4];
+    uint32_t generation;
+    uint32_t crc;
+};
+
+typedef FlashJournal<SimFlash, sizeof(Settings)> SettingsJournal;
+
+// What commitEEPROMData() does before every commit
+static void seal(Settings &settings) {
+    settings.generation++;
+    settings.crc = crc32(&settings, offsetof(Settings, crc));
+}
+
+static bool sealed(const Settings &settings) {
+    return settings.crc == crc32(&settings, offsetof(Settings, crc));
+}
+
+static void defaultSettings(Settings &settings) {
+    memset(&settings, 0, sizeof(settings));
+    strcpy(settings.deviceName, "ESP8266-Controller-01");
+    for (int i = 0; i < 8; i++) {
+        settings.outputBrightness[i] = 255;
+    }
+    seal(settings);
+}
+
+// Cut power after `budget` programmed bytes of the before -> after commit, then reboot
+static void commitWithPowerCut(SimFlash &flash, const Settings &before, const Settings &after, long budget) {
+    SettingsJournal journal(flash);
+    Settings loaded;
+    if (!journal.mount(&loaded)) {
+        TEST_ASSERT_TRUE(journal.format(&before));
+    }
+
+    flash.writeBudget = budget;
+    journal.commit(&after);
+    flash.writeBudget = -1;
+
+    SettingsJournal reboot(flash);
+    TEST_ASSERT_TRUE(reboot.mount(&loaded));
+    TEST_ASSERT_TRUE(sealed(loaded));
+    bool isOld = memcmp(&loaded, &before, sizeof(loaded)) == 0;
+    bool isNew = memcmp(&loaded, &after, sizeof(loaded)) == 0;
+    TEST_ASSERT_TRUE(isOld || isNew);
+
+    // The journal keeps working after the torn tail
+    loaded.outputStates[6] = !loaded.outputStates[6];
+    seal(loaded);
+    TEST_ASSERT_TRUE(reboot.commit(&loaded));
+    SettingsJournal again(flash);
+    Settings reloaded;
+    TEST_ASSERT_TRUE(again.mount(&reloaded));
+    TEST_ASSERT_EQUAL(0, memcmp(&loaded, &reloaded, sizeof(loaded)));
+}
+
+// Test: Blank flash has no journal; format then mount round-trips the image
+void test_journal_format_and_mount(void) {
+    SimFlash flash;
+    Settings settings;
+    defaultSettings(settings);
+
+    SettingsJournal journal(flash);
+    Settings loaded;
+    TEST_ASSERT_FALSE(journal.mount(&loaded));
+    TEST_ASSERT_TRUE(journal.format(&settings));
+
+    SettingsJournal reboot(flash);
+    TEST_ASSERT_TRUE(reboot.mount(&loaded));
+    TEST_ASSERT_EQUAL(0, memcmp(&settings, &loaded, sizeof(settings)));
+}
+
+// Test: Commits append small deltas that replay at boot; no-op commits write nothing
+void test_journal_replays_deltas(void) {
+    SimFlash flash;
+    Settings settings;
+    defaultSettings(settings);
+
+    SettingsJournal journal(flash);
+    TEST_ASSERT_TRUE(journal.format(&settings));
+    uint32_t afterFormat = journal.statistics().bytesWritten;
+
+    settings.outputStates[3] = true;
+    seal(settings);
+    TEST_ASSERT_TRUE(journal.commit(&settings));
+    uint32_t toggleBytes = journal.statistics().bytesWritten - afterFormat;
+    TEST_ASSERT_TRUE(toggleBytes <= 12 + 16); // The toggled byte, plus generation and CRC
+
+    strcpy(settings.outputNames[2], "Signal A");
+    settings.outputIntervals[7] = 500;
+    settings.chasingGroupCount = 1;
+    seal(settings);
+    TEST_ASSERT_TRUE(journal.commit(&settings));
+
+    uint32_t before = journal.statistics().bytesWritten;
+    TEST_ASSERT_TRUE(journal.commit(&settings));
+    TEST_ASSERT_EQUAL(before, journal.statistics().bytesWritten);
+    TEST_ASSERT_EQUAL(1, journal.statistics().unchanged);
+
+    SettingsJournal reboot(flash);
+    Settings loaded;
+    TEST_ASSERT_TRUE(reboot.mount(&loaded));
+    TEST_ASSERT_EQUAL(0, memcmp(&settings, &loaded, sizeof(settings)));
+    TEST_ASSERT_EQUAL(SIM_SECTORS, flash.erases[0] + flash.erases[1] + flash.erases[2] + flash.erases[3]);
+}
+
+// Test: Power lost at every byte offset of a delta commit leaves the old or the new image
+void test_journal_power_cut_every_byte_of_delta(void) {
+    Settings before;
+    defaultSettings(before);
+    Settings after = before;
+    after.outputStates[1] = true;
+    after.outputBrightness[1] = 128;
+    strcpy(after.outputNames[5], "Platform 2");
+    seal(after);
+
+    // Size of the commit when nothing goes wrong
+    SimFlash probe;
+    SettingsJournal journal(probe);
+    TEST_ASSERT_TRUE(journal.format(&before));
+    uint32_t start = journal.statistics().bytesWritten;
+    TEST_ASSERT_TRUE(journal.commit(&after));
+    long commitBytes = journal.statistics().bytesWritten - start;
+
+    for (long budget = 0; budget <= commitBytes; budget++) {
+        SimFlash flash;
+        commitWithPowerCut(flash, before, after, budget);
+    }
+}
+
+// Test: Power lost at every byte offset of a rotation (erase, header, snapshot) falls back cleanly
+void test_journal_power_cut_every_byte_of_rotation(void) {
+    Settings settings;
+    defaultSettings(settings);
+
+    // Commit until one rotates; keep the flash and image from just before that commit
+    SimFlash flash;
+    SettingsJournal journal(flash);
+    TEST_ASSERT_TRUE(journal.format(&settings));
+    SimFlash base;
+    Settings before;
+    uint32_t rotations = journal.statistics().rotations;
+    while (journal.statistics().rotations == rotations) {
+        base = flash;
+        before = settings;
+        settings.outputIntervals[0]++;
+        seal(settings);
+        TEST_ASSERT_TRUE(journal.commit(&settings));
+    }
+
+    long rotationBytes = 16 + 8 + ((sizeof(Settings) + 3) & ~3);
+    for (long budget = 0; budget <= rotationBytes; budget++) {
+        SimFlash torn = base;
+        commitWithPowerCut(torn, before, settings, budget);
+    }
+}
+
+// Test: A year of evening operation spreads erases evenly and far below one per commit
+void test_journal_year_of_toggles(void) {
+    SimFlash flash;
+    Settings settings;
+    defaultSettings(settings);
+
+    SettingsJournal journal(flash);
+    TEST_ASSERT_TRUE(journal.format(&settings));
+
+    // Every evening: each of 8 outputs toggled on and off 10 times, plus a few brightness tweaks
+    uint32_t commits = 0;
+    for (int day = 0; day < 365; day++) {
+        for (int round = 0; round < 10; round++) {
+            for (int output = 0; output < 8; output++) {
+                settings.outputStates[output] = !settings.outputStates[output];
+                seal(settings);
+                TEST_ASSERT_TRUE(journal.commit(&settings));
+                commits++;
+            }
+        }
+        for (int output = 0; output < 8; output += 3) {
+            settings.outputBrightness[output] = (uint8_t)(day * 7 + output);
+            seal(settings);
+            TEST_ASSERT_TRUE(journal.commit(&settings));
+            commits++;
+        }
+    }
+
+    uint32_t minErases = 0xFFFFFFFFUL;
+    uint32_t maxErases = 0;
+    char line[96];
+    for (int s = 0; s < SIM_SECTORS; s++) {
+        snprintf(line, sizeof(line), "sector %d: %lu erases", s, (unsigned long)flash.erases[s]);
+        TEST_MESSAGE(line);
+        if (flash.erases[s] < minErases) minErases = flash.erases[s];
+        if (flash.erases[s] > maxErases) maxErases = flash.erases[s];
+    }
+    snprintf(line, sizeof(line), "%lu commits, %lu rotations (EEPROM.commit(): %lu erases of one sector)",
+             (unsigned long)commits, (unsigned long)journal.statistics().rotations, (unsigned long)commits);
+    TEST_MESSAGE(line);
+
+    // Round-robin rotation keeps sectors within one erase of each other
+    TEST_ASSERT_TRUE(maxErases - minErases <= 1);
+    // At least two orders of magnitude fewer erases than one per commit
+    TEST_ASSERT_TRUE(maxErases * SIM_SECTORS * 100 < commits);
+
+    SettingsJournal reboot(flash);
+    Settings loaded;
+    TEST_ASSERT_TRUE(reboot.mount(&loaded));
+    TEST_ASSERT_EQUAL(0, memcmp(&settings, &loaded, sizeof(settings)));
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_journal_format_and_mount);
+    RUN_TEST(test_journal_replays_deltas);
+    RUN_TEST(test_journal_power_cut_every_byte_of_delta);
+    RUN_TEST(test_journal_power_cut_every_byte_of_rotation);
+    RUN_TEST(test_journal_year_of_toggles);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
@@ -0,0 +1,297 @@
+/**
+ * @file test_json_writer.cpp
+ * @brief Unit tests and benchmark for the zero-allocation status JSON writer
+ *
+ * Checks the output format, overflow handling, and that writing a full
+ * ESP8266 status (7 outputs, 4 chasing groups) performs no heap allocation.
+ * Natively every malloc/new is counted; the benchmark prints the time per
+ * status next to a growing-string baseline that mimics String += building.
+ */
+
+#ifndef NATIVE_BUILD
+#include <Arduino.h>
+#endif
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <string>
+#include <json_writer.h>
+
+#if defined(NATIVE_BUILD) && defined(__GLIBC__)
+#include <chrono>
+#define COUNT_ALLOCATIONS 1
+
+// Every heap allocation in the process goes through these
+static volatile unsigned long allocations = 0;
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size) { allocations++; return __libc_malloc(size); }
+void *calloc(size_t count, size_t size) { allocations++; return __libc_calloc(count, size); }
+void *realloc(void *ptr, size_t size) { allocations++; return __libc_realloc(ptr, size); }
+void free(void *ptr) { __libc_free(ptr); }
+}
+
+void *operator new(size_t size) { allocations++; return __libc_malloc(size); }
+void *operator new[](size_t size) { allocations++; return __libc_malloc(size); }
+void operator delete(void *ptr) noexcept { __libc_free(ptr); }
+void operator delete[](void *ptr) noexcept { __libc_free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { __libc_free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { __libc_free(ptr); }
+
+static uint32_t nowMicros() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#else
+static uint32_t nowMicros() {
+    return micros();
+}
+#endif
+
+#define BENCH_OUTPUTS 7
+#define BENCH_GROUPS 4
+#define BENCH_ROUNDS 2000
+
+struct BenchOutput {
+    int pin;
+    bool active;
+    int brightness;
+    char name[21];
+    uint16_t interval;
+    int chasingGroup;
+};
+
+struct BenchGroup {
+    uint8_t groupId;
+    char name[21];
+    uint16_t interval;
+    uint8_t outputCount;
+    int pins[BENCH_OUTPUTS];
+};
+
+static BenchOutput benchOutputs[BENCH_OUTPUTS];
+static BenchGroup benchGroups[BENCH_GROUPS];
+
+static void setupBenchState() {
+    static const int pins[BENCH_OUTPUTS] = {4, 5, 12, 13, 14, 16, 2};
+    for (int i = 0; i < BENCH_OUTPUTS; i++) {
+        benchOutputs[i].pin = pins[i];
+        benchOutputs[i].active = i % 2 == 0;
+        benchOutputs[i].brightness = 100 - i * 10;
+        snprintf(benchOutputs[i].name, sizeof(benchOutputs[i].name), "Platform %d \"Nord\"", i + 1);
+        benchOutputs[i].interval = (uint16_t)(i * 250);
+        benchOutputs[i].chasingGroup = i < 4 ? i % 2 + 1 : -1;
+    }
+    for (int g = 0; g < BENCH_GROUPS; g++) {
+        benchGroups[g].groupId = (uint8_t)(g + 1);
+        snprintf(benchGroups[g].name, sizeof(benchGroups[g].name), "Chase %d", g + 1);
+        benchGroups[g].interval = 400;
+        benchGroups[g].outputCount = 3;
+        for (int j = 0; j < 3; j++) benchGroups[g].pins[j] = pins[(g + j) % BENCH_OUTPUTS];
+    }
+}
+
+// Same shape as the ESP8266 snapshot message
+static void writeStatus(JsonWriter &json) {
+    json.reset();
+    json.beginObject();
+    json.add("type", "snapshot");
+    json.add("seq", 123456UL);
+    json.add("uptime", 86400000UL);
+    json.add("freeHeap", 38912U);
+    json.add("apClients", 0);
+    json.beginArray("outputs");
+    for (int i = 0; i < BENCH_OUTPUTS; i++) {
+        json.beginObject();
+        json.add("pin", benchOutputs[i].pin);
+        json.add("active", benchOutputs[i].active);
+        json.add("brightness", benchOutputs[i].brightness);
+        json.add("name", benchOutputs[i].name);
+        json.add("interval", (unsigned int)benchOutputs[i].interval);
+        json.add("chasingGroup", benchOutputs[i].chasingGroup);
+        json.endObject();
+    }
+    json.endArray();
+    json.beginArray("chasingGroups");
+    for (int g = 0; g < BENCH_GROUPS; g++) {
+        json.beginObject();
+        json.add("groupId", (unsigned int)benchGroups[g].groupId);
+        json.add("name", benchGroups[g].name);
+        json.add("interval", (unsigned int)benchGroups[g].interval);
+        json.add("outputCount", (unsigned int)benchGroups[g].outputCount);
+        json.beginArray("outputs");
+        for (int j = 0; j < benchGroups[g].outputCount; j++) {
+            json.add(nullptr, benchGroups[g].pins[j]);
+        }
+        json.endArray();
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+}
+
+// Baseline: the same text built by appending to a growing string, as String += does
+static size_t writeStatusString(std::string &out) {
+    char field[96];
+    out = "{\"type\":\"snapshot\",\"seq\":123456,\"uptime\":86400000,\"freeHeap\":38912,\"apClients\":0,\"outputs\":[";
+    for (int i = 0; i < BENCH_OUTPUTS; i++) {
+        snprintf(field, sizeof(field), "%s{\"pin\":%d,\"active\":%s,\"brightness\":%d,\"name\":\"",
+                 i ? "," : "", benchOutputs[i].pin, benchOutputs[i].active ? "true" : "false", benchOutputs[i].brightness);
+        out += field;
+        for (const char *p = benchOutputs[i].name; *p; p++) {
+            if (*p == '"' || *p == '\\') out += '\\';
+            out += *p;
+        }
+        snprintf(field, sizeof(field), "\",\"interval\":%u,\"chasingGroup\":%d}",
+                 benchOutputs[i].interval, benchOutputs[i].chasingGroup);
+        out += field;
+    }
+    out += "],\"chasingGroups\":[";
+    for (int g = 0; g < BENCH_GROUPS; g++) {
+        snprintf(field, sizeof(field), "%s{\"groupId\":%u,\"name\":\"%s\",\"interval\":%u,\"outputCount\":%u,\"outputs\":[",
+                 g ? "," : "", benchGroups[g].groupId, benchGroups[g].name, benchGroups[g].interval, benchGroups[g].outputCount);
+        out += field;
+        for (int j = 0; j < benchGroups[g].outputCount; j++) {
+            snprintf(field, sizeof(field), "%s%d", j ? "," : "", benchGroups[g].pins[j]);
+            out += field;
+        }
+        out += "]}";
+    }
+    out += "]}";
+    return out.length();
+}
+
+// Test: Nesting, commas, numbers and escaping produce valid JSON
+void test_writer_format(void) {
+    char buffer[256];
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject();
+    json.add("name", "Signal \"A\"\\1\n");
+    json.add("active", true);
+    json.add("pin", -5);
+    json.add("uptime", 4294967295UL);
+    json.add("load", 12.345f, 1);
+    json.add("tiny", 0.05f, 2);
+    json.beginArray("pins");
+    json.add(nullptr, 4);
+    json.add(nullptr, 5);
+    json.endArray();
+    json.beginArray("empty");
+    json.endArray();
+    json.beginObject("nested");
+    json.add("ok", false);
+    json.endObject();
+    json.endObject();
+
+    TEST_ASSERT_TRUE(json.ok());
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"name\":\"Signal \\\"A\\\"\\\\1\\u000a\",\"active\":true,\"pin\":-5,\"uptime\":4294967295,"
+        "\"load\":12.3,\"tiny\":0.05,\"pins\":[4,5],\"empty\":[],\"nested\":{\"ok\":false}}",
+        json.c_str());
+    TEST_ASSERT_EQUAL(strlen(buffer), json.length());
+}
+
+// Test: A full buffer stops writing, stays terminated and reports the overflow
+void test_writer_overflow(void) {
+    char buffer[32];
+    memset(buffer, 'x', sizeof(buffer));
+    JsonWriter json(buffer, 16);
+    json.beginObject();
+    json.add("name", "a name far longer than sixteen bytes");
+    json.endObject();
+
+    TEST_ASSERT_FALSE(json.ok());
+    TEST_ASSERT_EQUAL_STRING("{\"name\":\"", buffer); // Nothing after the value that did not fit
+    TEST_ASSERT_EQUAL(strlen(buffer), json.length());
+    TEST_ASSERT_EQUAL('x', buffer[16]);
+
+    // reset() makes the buffer usable again
+    json.reset();
+    json.beginObject();
+    json.endObject();
+    TEST_ASSERT_TRUE(json.ok());
+    TEST_ASSERT_EQUAL_STRING("{}", buffer);
+}
+
+// Test: Writing a full status allocates nothing and matches the string-built text
+void test_writer_status_zero_alloc_benchmark(void) {
+    setupBenchState();
+    static char buffer[2048];
+    JsonWriter json(buffer, sizeof(buffer));
+
+    std::string baseline;
+    writeStatusString(baseline);
+    writeStatus(json);
+    TEST_ASSERT_TRUE(json.ok());
+    TEST_ASSERT_EQUAL_STRING(baseline.c_str(), json.c_str());
+
+#ifdef COUNT_ALLOCATIONS
+    unsigned long before = allocations;
+#endif
+    uint32_t start = nowMicros();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        writeStatus(json);
+    }
+    uint32_t writerUs = nowMicros() - start;
+#ifdef COUNT_ALLOCATIONS
+    unsigned long writerAllocations = allocations - before;
+    before = allocations;
+#endif
+
+    start = nowMicros();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        std::string text;
+        writeStatusString(text);
+    }
+    uint32_t stringUs = nowMicros() - start;
+
+    char line[128];
+    snprintf(line, sizeof(line), "status: %u bytes, writer %.2f us/call, growing string %.2f us/call",
+             (unsigned)json.length(), (double)writerUs / BENCH_ROUNDS, (double)stringUs / BENCH_ROUNDS);
+    TEST_MESSAGE(line);
+
+#ifdef COUNT_ALLOCATIONS
+    unsigned long stringAllocations = allocations - before;
+    snprintf(line, sizeof(line), "heap allocations per call: writer %lu, growing string %lu",
+             writerAllocations / BENCH_ROUNDS, stringAllocations / BENCH_ROUNDS);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL(0, writerAllocations);
+    TEST_ASSERT_TRUE(stringAllocations >= BENCH_ROUNDS);
+#endif
+
+    // Well inside one 500 ms broadcast period even on an 80 MHz ESP8266
+    TEST_ASSERT_TRUE(writerUs / BENCH_ROUNDS < 2000);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_writer_format);
+    RUN_TEST(test_writer_overflow);
+    RUN_TEST(test_writer_status_zero_alloc_benchmark);
+
+    return UNITY_END();
+}
+
+#ifdef NATIVE_BUILD
+int main(int argc, char **argv) {
+    return runUnityTests();
+}
+#else
+void setup() {
+    delay(2000);
+    runUnityTests();
+}
+
+void loop() {}
+#endif
@@ -0,0 +1,128 @@
+/**
+ * @file body_pool.h
+ * @brief Assembles HTTP request bodies from their TCP pieces in fixed slots
+ *
+ * The async web servers hand a body to the handler piece by piece
+ * (data, len, index, total), split wherever TCP split it. A handler that
+ * parses the first piece alone mis-reads any body that arrives in two
+ * segments, and the piece is not NUL-terminated.
+ *
+ * BodyPool copies the pieces of each request into one of Slots static
+ * buffers, keyed by the request pointer, and reports BODY_COMPLETE only
+ * once all total bytes are there. Nothing is allocated. A body larger than
+ * a slot is refused at its first piece, before anything is buffered, and
+ * so is a request when every slot is in use. A slot whose request went
+ * away mid-body is reclaimed after STALE_MS.
+ *
+ * Not thread-safe: call it from the web server's task only. The completed
+ * body stays valid until the next append().
+ */
+
+#ifndef BODY_POOL_H
+#define BODY_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+enum BodyStatus : uint8_t {
+    BODY_PENDING,               // More pieces to come
+    BODY_COMPLETE,              // body/length hold the whole, NUL-terminated body
+    BODY_TOO_LARGE,             // total exceeds MAX_BODY; answer 413
+    BODY_POOL_FULL,             // Every slot is busy; answer 503
+    BODY_INVALID,               // Piece out of order or past total; answer 400
+    BODY_IGNORED                // Piece of a request that was already answered
+};
+
+template <uint8_t Slots, size_t SlotSize>
+class BodyPool {
+public:
+    static const size_t MAX_BODY = SlotSize - 1;   // One byte for the terminator
+    static const uint32_t STALE_MS = 10000;
+
+    BodyPool() {
+        memset(slots, 0, sizeof(slots));
+    }
+
+    BodyStatus append(const void *owner, const uint8_t *data, size_t len, size_t index, size_t total,
+                      uint32_t nowMs, const char *&body, size_t &length) {
+        if (index == 0) {
+            // A new request; its address may be that of an earlier one that died mid-body
+            release(owner);
+            if (total > MAX_BODY) return BODY_TOO_LARGE;
+
+            Slot *slot = freeSlot(nowMs);
+            if (!slot) return BODY_POOL_FULL;
+            slot->owner = owner;
+            slot->total = total;
+            slot->received = 0;
+            slot->lastMs = nowMs;
+        }
+
+        Slot *slot = find(owner);
+        if (!slot) return BODY_IGNORED;
+        if (index != slot->received || len > slot->total - slot->received) {
+            slot->owner = nullptr;
+            return BODY_INVALID;
+        }
+
+        memcpy(slot->buffer + slot->received, data, len);
+        slot->received += len;
+        slot->lastMs = nowMs;
+        if (slot->received < slot->total) return BODY_PENDING;
+
+        // Free for the next request; the bytes stay until a later append() reuses it
+        slot->buffer[slot->total] = '\0';
+        slot->owner = nullptr;
+        body = slot->buffer;
+        length = slot->total;
+        return BODY_COMPLETE;
+    }
+
+    void release(const void *owner) {
+        Slot *slot = find(owner);
+        if (slot) slot->owner = nullptr;
+    }
+
+    uint8_t inUse() const {
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < Slots; i++) {
+            if (slots[i].owner) count++;
+        }
+        return count;
+    }
+
+private:
+    struct Slot {
+        const void *owner;      // Request being assembled, nullptr = free
+        size_t total;
+        size_t received;
+        uint32_t lastMs;        // Time of the last piece
+        char buffer[SlotSize];
+    };
+
+    Slot slots[Slots];
+
+    Slot *find(const void *owner) {
+        if (!owner) return nullptr;
+        for (uint8_t i = 0; i < Slots; i++) {
+            if (slots[i].owner == owner) return &slots[i];
+        }
+        return nullptr;
+    }
+
+    Slot *freeSlot(uint32_t nowMs) {
+        for (uint8_t i = 0; i < Slots; i++) {
+            if (!slots[i].owner || nowMs - slots[i].lastMs > STALE_MS) return &slots[i];
+        }
+        return nullptr;
+    }
+};
+
+template <uint8_t Slots, size_t SlotSize>
+const size_t BodyPool<Slots, SlotSize>::MAX_BODY;
+
+template <uint8_t Slots, size_t SlotSize>
+const uint32_t BodyPool<Slots, SlotSize>::STALE_MS;
+
+#endif
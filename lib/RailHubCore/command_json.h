@@ -0,0 +1,74 @@
+/**
+ * @file command_json.h
+ * @brief ArduinoJson fallback for command bodies the schema parser leaves alone
+ *
+ * Fills the same CommandFields as parseCommand() from a parsed document,
+ * so the command handlers have one input type whichever path was taken.
+ * A key counts as present when its value has a usable type (string keys
+ * need a string, numeric keys any number, "active" a boolean), which is
+ * how the handlers read the document with ArduinoJson's operator|.
+ * Strings longer than their buffer are truncated.
+ */
+
+#ifndef COMMAND_JSON_H
+#define COMMAND_JSON_H
+
+#include <ArduinoJson.h>
+#include "command_parser.h"
+
+inline void commandTextFromJson(JsonVariantConst value, char *out, size_t size, uint16_t field, uint16_t &fields) {
+    if (!value.is<const char *>()) return;
+    strncpy(out, value.as<const char *>(), size - 1);
+    out[size - 1] = '\0';
+    fields |= field;
+}
+
+template <typename T>
+inline void commandNumberFromJson(JsonVariantConst value, T &out, uint16_t field, uint16_t &fields) {
+    if (!value.is<double>()) return;
+    out = value.as<T>();
+    fields |= field;
+}
+
+inline void commandEntryFromJson(JsonVariantConst value, CommandEntry &entry) {
+    memset(&entry, 0, sizeof(entry));
+    if (!value.is<JsonObjectConst>()) {
+        entry.pin = value.as<int32_t>();
+        entry.fields = FIELD_VALUE;
+        return;
+    }
+    JsonObjectConst item = value.as<JsonObjectConst>();
+    commandNumberFromJson(item["pin"], entry.pin, FIELD_PIN, entry.fields);
+    entry.active = item["active"].as<bool>();
+    if (item["active"].is<bool>()) entry.fields |= FIELD_ACTIVE;
+    commandNumberFromJson(item["brightness"], entry.brightness, FIELD_BRIGHTNESS, entry.fields);
+    commandNumberFromJson(item["interval"], entry.interval, FIELD_INTERVAL, entry.fields);
+}
+
+template <uint8_t MaxEntries>
+void commandFromJson(JsonObjectConst req, CommandFields<MaxEntries> &out) {
+    out.clear();
+    commandNumberFromJson(req["id"], out.id, FIELD_ID, out.fields);
+    commandTextFromJson(req["cmd"], out.cmd, sizeof(out.cmd), FIELD_CMD, out.fields);
+    commandNumberFromJson(req["pin"], out.pin, FIELD_PIN, out.fields);
+    // "active" without a boolean still reads as its truthiness, as req["active"] did
+    out.active = req["active"].as<bool>();
+    if (req["active"].is<bool>()) out.fields |= FIELD_ACTIVE;
+    commandNumberFromJson(req["brightness"], out.brightness, FIELD_BRIGHTNESS, out.fields);
+    commandNumberFromJson(req["interval"], out.interval, FIELD_INTERVAL, out.fields);
+    commandTextFromJson(req["name"], out.name, sizeof(out.name), FIELD_NAME, out.fields);
+    commandTextFromJson(req["select"], out.select, sizeof(out.select), FIELD_SELECT, out.fields);
+    commandNumberFromJson(req["group"], out.group, FIELD_GROUP, out.fields);
+    commandNumberFromJson(req["groupId"], out.groupId, FIELD_GROUP_ID, out.fields);
+    commandTextFromJson(req["format"], out.format, sizeof(out.format), FIELD_FORMAT, out.fields);
+
+    JsonArrayConst outputs = req["outputs"];
+    if (outputs.isNull()) return;
+    out.fields |= FIELD_OUTPUTS;
+    for (JsonVariantConst value : outputs) {
+        if (out.outputTotal < MaxEntries) commandEntryFromJson(value, out.outputs[out.outputTotal]);
+        if (out.outputTotal < UINT16_MAX) out.outputTotal++;
+    }
+}
+
+#endif
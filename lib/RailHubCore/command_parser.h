@@ -0,0 +1,419 @@
+/**
+ * @file command_parser.h
+ * @brief Single-pass parser for the fixed command schemas of the REST and WebSocket APIs
+ *
+ * Every command (control, interval, name, batch, chasing.*, and the WebSocket
+ * envelope with id/cmd/format) is a flat object with a handful of known keys,
+ * plus "outputs": an array of pins or of small per-output objects. Instead of
+ * building a document tree, parseCommand() walks the text once and stores
+ * the values it knows straight into a CommandFields struct. Nothing is
+ * allocated; the struct lives on the caller's stack.
+ *
+ * Keys are matched by their FNV-1a hash: keyHash() is constexpr, so the
+ * switch over known keys compiles to integer compares (and a collision
+ * between two known keys is a duplicate case label, i.e. a compile error).
+ * A matching hash is confirmed against the key text, so unknown keys that
+ * happen to collide are still skipped.
+ *
+ * The parser only takes what it can represent exactly: integers in range,
+ * true/false, strings with simple escapes that fit their buffer. For
+ * anything else (null, floats, \u escapes, a key with the wrong type,
+ * malformed text) it returns false and the caller falls back to ArduinoJson
+ * (see command_json.h), which also decides whether the body is valid JSON.
+ * Unknown keys are skipped, as the handlers never read them.
+ */
+
+#ifndef COMMAND_PARSER_H
+#define COMMAND_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Bit set in CommandFields::fields / CommandEntry::fields when the key was present
+enum CommandField : uint16_t {
+    FIELD_ID = 1 << 0,
+    FIELD_CMD = 1 << 1,
+    FIELD_PIN = 1 << 2,
+    FIELD_ACTIVE = 1 << 3,
+    FIELD_BRIGHTNESS = 1 << 4,
+    FIELD_INTERVAL = 1 << 5,
+    FIELD_NAME = 1 << 6,
+    FIELD_SELECT = 1 << 7,
+    FIELD_GROUP = 1 << 8,
+    FIELD_GROUP_ID = 1 << 9,
+    FIELD_FORMAT = 1 << 10,
+    FIELD_OUTPUTS = 1 << 11,
+    FIELD_VALUE = 1 << 12       // Entry is a bare number (chasing group pin list)
+};
+
+constexpr uint32_t keyHashFrom(const char *key, uint32_t hash) {
+    return *key ? keyHashFrom(key + 1, (hash ^ (uint8_t)*key) * 16777619UL) : hash;
+}
+
+// FNV-1a of a key literal, usable as a case label
+constexpr uint32_t keyHash(const char *key) {
+    return keyHashFrom(key, 2166136261UL);
+}
+
+// One element of "outputs": {"pin":..,"active":..,"brightness":..,"interval":..} or a bare pin
+struct CommandEntry {
+    uint16_t fields;
+    bool active;
+    int32_t pin;                // Also holds the number of a FIELD_VALUE entry
+    int32_t brightness;
+    uint32_t interval;
+
+    bool has(uint16_t field) const { return (fields & field) != 0; }
+};
+
+template <uint8_t MaxEntries>
+struct CommandFields {
+    static const size_t NAME_SIZE = 33;     // Longer names go through the fallback
+    static const size_t WORD_SIZE = 16;     // cmd, select, format
+
+    uint16_t fields;
+    uint32_t id;
+    int32_t pin;
+    bool active;
+    int32_t brightness;
+    uint32_t interval;
+    int32_t group;
+    uint8_t groupId;
+    char cmd[WORD_SIZE];
+    char select[WORD_SIZE];
+    char format[WORD_SIZE];
+    char name[NAME_SIZE];
+    uint16_t outputTotal;       // Elements in "outputs"; only the first MaxEntries are stored
+    CommandEntry outputs[MaxEntries];
+
+    void clear() { memset(this, 0, sizeof(*this)); }
+    bool has(uint16_t field) const { return (fields & field) != 0; }
+
+    // The per-output keys given at the top level (batch with "select")
+    CommandEntry entry() const {
+        CommandEntry e;
+        e.fields = fields & (FIELD_PIN | FIELD_ACTIVE | FIELD_BRIGHTNESS | FIELD_INTERVAL);
+        e.active = active;
+        e.pin = pin;
+        e.brightness = brightness;
+        e.interval = interval;
+        return e;
+    }
+};
+
+template <uint8_t MaxEntries>
+const size_t CommandFields<MaxEntries>::NAME_SIZE;
+
+template <uint8_t MaxEntries>
+const size_t CommandFields<MaxEntries>::WORD_SIZE;
+
+// Cursor over the command text; every read returns false on anything it does not take
+class CommandTokenizer {
+public:
+    static const uint8_t MAX_DEPTH = 8;     // Nesting of skipped values
+
+    CommandTokenizer(const char *text, size_t length) : p(text), end(text + length) {}
+
+    void skipSpace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    }
+
+    bool atEnd() {
+        skipSpace();
+        return p == end;
+    }
+
+    // Consumes c (after whitespace) if it is next
+    bool take(char c) {
+        skipSpace();
+        if (p < end && *p == c) {
+            p++;
+            return true;
+        }
+        return false;
+    }
+
+    char peek() {
+        skipSpace();
+        return p < end ? *p : '\0';
+    }
+
+    // Key and its ':'; keys with escapes are left to the fallback
+    bool key(uint32_t &hash, const char *&text, size_t &length) {
+        if (!take('"')) return false;
+        text = p;
+        hash = 2166136261UL;
+        while (p < end && *p != '"') {
+            if (*p == '\\') return false;
+            hash = (hash ^ (uint8_t)*p) * 16777619UL;
+            p++;
+        }
+        if (p == end) return false;
+        length = p - text;
+        p++;
+        return take(':');
+    }
+
+    // String value into out (NUL-terminated); false if it does not fit
+    bool string(char *out, size_t size) {
+        if (!take('"')) return false;
+        size_t used = 0;
+        while (p < end && *p != '"') {
+            char c = *p++;
+            if ((uint8_t)c < 0x20) return false;
+            if (c == '\\') {
+                if (p == end) return false;
+                switch (*p++) {
+                    case '"': c = '"'; break;
+                    case '\\': c = '\\'; break;
+                    case '/': c = '/'; break;
+                    case 'b': c = '\b'; break;
+                    case 'f': c = '\f'; break;
+                    case 'n': c = '\n'; break;
+                    case 'r': c = '\r'; break;
+                    case 't': c = '\t'; break;
+                    default: return false;  // \u and invalid escapes
+                }
+            }
+            if (used + 1 >= size) return false;
+            out[used++] = c;
+        }
+        if (p == end) return false;
+        p++;
+        out[used] = '\0';
+        return true;
+    }
+
+    // Integer in [min, max]; fractions and exponents are left to the fallback
+    bool integer(int64_t &value, int64_t min, int64_t max) {
+        skipSpace();
+        bool negative = p < end && *p == '-';
+        if (negative) p++;
+        if (p == end || *p < '0' || *p > '9') return false;
+        if (*p == '0' && p + 1 < end && p[1] >= '0' && p[1] <= '9') return false;
+
+        value = 0;
+        uint8_t digits = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (++digits > 12) return false;
+            value = value * 10 + (*p++ - '0');
+        }
+        if (p < end && (*p == '.' || *p == 'e' || *p == 'E')) return false;
+        if (negative) value = -value;
+        return value >= min && value <= max;
+    }
+
+    bool boolean(bool &value) {
+        skipSpace();
+        if (literal("true")) {
+            value = true;
+            return true;
+        }
+        if (literal("false")) {
+            value = false;
+            return true;
+        }
+        return false;
+    }
+
+    // Any JSON value, for keys the schemas do not use
+    bool skipValue(uint8_t depth = 0) {
+        char c = peek();
+        if (c == '"') {
+            p++;
+            while (p < end && *p != '"') {
+                if (*p == '\\') p++;
+                p++;
+            }
+            if (p >= end) return false;
+            p++;
+            return true;
+        }
+        if (c == '{' || c == '[') {
+            if (depth >= MAX_DEPTH) return false;
+            char close = c == '{' ? '}' : ']';
+            p++;
+            if (take(close)) return true;
+            do {
+                if (c == '{') {
+                    uint32_t hash;
+                    const char *text;
+                    size_t length;
+                    if (!key(hash, text, length)) return false;
+                }
+                if (!skipValue(depth + 1)) return false;
+            } while (take(','));
+            return take(close);
+        }
+        if (literal("true") || literal("false") || literal("null")) return true;
+
+        const char *start = p;
+        while (p < end && ((*p >= '0' && *p <= '9') || *p == '-' || *p == '+' || *p == '.' || *p == 'e' || *p == 'E')) p++;
+        return p > start;
+    }
+
+private:
+    const char *p;
+    const char *end;
+
+    bool literal(const char *word) {
+        size_t n = strlen(word);
+        if ((size_t)(end - p) < n || memcmp(p, word, n) != 0) return false;
+        p += n;
+        return true;
+    }
+};
+
+inline bool commandKeyIs(const char *text, size_t length, const char *key) {
+    return strlen(key) == length && memcmp(text, key, length) == 0;
+}
+
+inline bool parseCommandEntry(CommandTokenizer &in, CommandEntry &entry) {
+    memset(&entry, 0, sizeof(entry));
+    int64_t number;
+    if (in.peek() != '{') {
+        if (!in.integer(number, INT32_MIN, INT32_MAX)) return false;
+        entry.pin = (int32_t)number;
+        entry.fields = FIELD_VALUE;
+        return true;
+    }
+
+    in.take('{');
+    if (in.take('}')) return true;
+    do {
+        uint32_t hash;
+        const char *text;
+        size_t length;
+        if (!in.key(hash, text, length)) return false;
+
+        switch (hash) {
+            case keyHash("pin"):
+                if (!commandKeyIs(text, length, "pin")) break;
+                if (!in.integer(number, INT32_MIN, INT32_MAX)) return false;
+                entry.pin = (int32_t)number;
+                entry.fields |= FIELD_PIN;
+                continue;
+            case keyHash("active"):
+                if (!commandKeyIs(text, length, "active")) break;
+                if (!in.boolean(entry.active)) return false;
+                entry.fields |= FIELD_ACTIVE;
+                continue;
+            case keyHash("brightness"):
+                if (!commandKeyIs(text, length, "brightness")) break;
+                if (!in.integer(number, INT32_MIN, INT32_MAX)) return false;
+                entry.brightness = (int32_t)number;
+                entry.fields |= FIELD_BRIGHTNESS;
+                continue;
+            case keyHash("interval"):
+                if (!commandKeyIs(text, length, "interval")) break;
+                if (!in.integer(number, 0, UINT32_MAX)) return false;
+                entry.interval = (uint32_t)number;
+                entry.fields |= FIELD_INTERVAL;
+                continue;
+        }
+        if (!in.skipValue(1)) return false;
+    } while (in.take(','));
+    return in.take('}');
+}
+
+// Fills out from a complete command body; false means "use the fallback"
+template <uint8_t MaxEntries>
+bool parseCommand(const char *text, size_t length, CommandFields<MaxEntries> &out) {
+    out.clear();
+    CommandTokenizer in(text, length);
+    if (!in.take('{')) return false;
+
+    if (!in.take('}')) {
+        do {
+            uint32_t hash;
+            const char *key;
+            size_t keyLength;
+            if (!in.key(hash, key, keyLength)) return false;
+
+            int64_t number;
+            switch (hash) {
+                case keyHash("id"):
+                    if (!commandKeyIs(key, keyLength, "id")) break;
+                    if (!in.integer(number, 0, UINT32_MAX)) return false;
+                    out.id = (uint32_t)number;
+                    out.fields |= FIELD_ID;
+                    continue;
+                case keyHash("cmd"):
+                    if (!commandKeyIs(key, keyLength, "cmd")) break;
+                    if (!in.string(out.cmd, sizeof(out.cmd))) return false;
+                    out.fields |= FIELD_CMD;
+                    continue;
+                case keyHash("pin"):
+                    if (!commandKeyIs(key, keyLength, "pin")) break;
+                    if (!in.integer(number, INT32_MIN, INT32_MAX)) return false;
+                    out.pin = (int32_t)number;
+                    out.fields |= FIELD_PIN;
+                    continue;
+                case keyHash("active"):
+                    if (!commandKeyIs(key, keyLength, "active")) break;
+                    if (!in.boolean(out.active)) return false;
+                    out.fields |= FIELD_ACTIVE;
+                    continue;
+                case keyHash("brightness"):
+                    if (!commandKeyIs(key, keyLength, "brightness")) break;
+                    if (!in.integer(number, INT32_MIN, INT32_MAX)) return false;
+                    out.brightness = (int32_t)number;
+                    out.fields |= FIELD_BRIGHTNESS;
+                    continue;
+                case keyHash("interval"):
+                    if (!commandKeyIs(key, keyLength, "interval")) break;
+                    if (!in.integer(number, 0, UINT32_MAX)) return false;
+                    out.interval = (uint32_t)number;
+                    out.fields |= FIELD_INTERVAL;
+                    continue;
+                case keyHash("name"):
+                    if (!commandKeyIs(key, keyLength, "name")) break;
+                    if (!in.string(out.name, sizeof(out.name))) return false;
+                    out.fields |= FIELD_NAME;
+                    continue;
+                case keyHash("select"):
+                    if (!commandKeyIs(key, keyLength, "select")) break;
+                    if (!in.string(out.select, sizeof(out.select))) return false;
+                    out.fields |= FIELD_SELECT;
+                    continue;
+                case keyHash("group"):
+                    if (!commandKeyIs(key, keyLength, "group")) break;
+                    if (!in.integer(number, INT32_MIN, INT32_MAX)) return false;
+                    out.group = (int32_t)number;
+                    out.fields |= FIELD_GROUP;
+                    continue;
+                case keyHash("groupId"):
+                    if (!commandKeyIs(key, keyLength, "groupId")) break;
+                    if (!in.integer(number, 0, 255)) return false;
+                    out.groupId = (uint8_t)number;
+                    out.fields |= FIELD_GROUP_ID;
+                    continue;
+                case keyHash("format"):
+                    if (!commandKeyIs(key, keyLength, "format")) break;
+                    if (!in.string(out.format, sizeof(out.format))) return false;
+                    out.fields |= FIELD_FORMAT;
+                    continue;
+                case keyHash("outputs"):
+                    if (!commandKeyIs(key, keyLength, "outputs")) break;
+                    if (!in.take('[')) return false;
+                    out.fields |= FIELD_OUTPUTS;
+                    out.outputTotal = 0;
+                    if (in.take(']')) continue;
+                    do {
+                        CommandEntry entry;
+                        if (!parseCommandEntry(in, entry)) return false;
+                        if (out.outputTotal < MaxEntries) out.outputs[out.outputTotal] = entry;
+                        if (out.outputTotal < UINT16_MAX) out.outputTotal++;
+                    } while (in.take(','));
+                    if (!in.take(']')) return false;
+                    continue;
+            }
+            if (!in.skipValue()) return false;
+        } while (in.take(','));
+        if (!in.take('}')) return false;
+    }
+    return in.atEnd();
+}
+
+#endif
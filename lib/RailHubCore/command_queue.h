@@ -0,0 +1,115 @@
+/**
+ * @file command_queue.h
+ * @brief Bounded lock-free multi-producer/single-consumer command ring
+ *
+ * Front-ends (HTTP handlers, WebSocket events) push fixed-size commands from
+ * any task; the effect engine is the only consumer. Each cell carries a
+ * sequence number (Vyukov's bounded queue), so producers claim slots with a
+ * single compare-and-swap and never block. push() fails instead of waiting
+ * when the ring is full. pushBatch() claims several consecutive cells with
+ * one compare-and-swap and publishes them last-to-first, so the consumer
+ * sees either none of a batch or all of it.
+ */
+
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+
+template <typename T, uint16_t Capacity>
+class CommandQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    CommandQueue() : enqueuePos(0), dequeuePos(0), dropped(0) {
+        for (uint32_t i = 0; i < Capacity; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Any producer; returns false (and counts a drop) when the ring is full
+    bool push(const T &item) {
+        Cell *cell;
+        uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells[pos & (Capacity - 1)];
+            uint32_t seq = cell->sequence.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(seq - pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = item;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Any producer; queues all count items or none of them (each rejected item counts as a drop)
+    bool pushBatch(const T *items, uint16_t count) {
+        if (count == 0) return true;
+        if (count > Capacity) {
+            dropped.fetch_add(count, std::memory_order_relaxed);
+            return false;
+        }
+
+        // Cells free up in order, so if the last cell of the run is free the rest are too
+        uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            uint32_t last = pos + count - 1;
+            uint32_t seq = cells[last & (Capacity - 1)].sequence.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(seq - last);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                dropped.fetch_add(count, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        // The consumer stops at the first unpublished cell, so publishing it last releases the whole batch
+        for (uint16_t i = count; i-- > 0;) {
+            Cell *cell = &cells[(pos + i) & (Capacity - 1)];
+            cell->data = items[i];
+            cell->sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return true;
+    }
+
+    // Single consumer only
+    bool pop(T &item) {
+        uint32_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell *cell = &cells[pos & (Capacity - 1)];
+        uint32_t seq = cell->sequence.load(std::memory_order_acquire);
+        if ((int32_t)(seq - (pos + 1)) < 0) return false;
+
+        item = cell->data;
+        cell->sequence.store(pos + Capacity, std::memory_order_release);
+        dequeuePos.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    uint32_t droppedCount() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Cell {
+        std::atomic<uint32_t> sequence;
+        T data;
+    };
+
+    Cell cells[Capacity];
+    std::atomic<uint32_t> enqueuePos;
+    std::atomic<uint32_t> dequeuePos;
+    std::atomic<uint32_t> dropped;
+};
+
+#endif
@@ -0,0 +1,83 @@
+/**
+ * @file config_slots.h
+ * @brief A/B double-buffered configuration record with generation and CRC32
+ *
+ * Each save goes to the slot that is not active, stamped with the next
+ * generation number and a CRC32 over data and generation. The active slot is
+ * never touched, so a power cut mid-save leaves it intact and the torn slot
+ * fails its CRC. load() reads both slots once and takes the valid one with the
+ * newer generation (wrap-safe).
+ *
+ * Store must provide:
+ *   bool read(uint8_t slot, void *data, size_t length);   // false if the slot is missing
+ *   bool write(uint8_t slot, const void *data, size_t length);
+ */
+
+#ifndef CONFIG_SLOTS_H
+#define CONFIG_SLOTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "crc32.h"
+
+template <typename Store, typename T>
+class ConfigSlots {
+public:
+    struct Slot {
+        T data;
+        uint32_t generation;
+        uint32_t crc;           // CRC32 of data and generation
+    };
+
+    explicit ConfigSlots(Store &store) : store(store), active(0), currentGeneration(0), loaded(false) {}
+
+    // Newest valid slot into out; false if neither slot holds a valid record
+    bool load(T &out) {
+        loaded = false;
+        for (uint8_t s = 0; s < 2; s++) {
+            memset(&scratch, 0, sizeof(scratch));
+            if (!store.read(s, &scratch, sizeof(scratch))) continue;
+            if (scratch.crc != checksum(scratch)) continue;
+            if (loaded && (int32_t)(scratch.generation - currentGeneration) <= 0) continue;
+
+            memcpy(&out, &scratch.data, sizeof(T));
+            active = s;
+            currentGeneration = scratch.generation;
+            loaded = true;
+        }
+        return loaded;
+    }
+
+    // Write data to the inactive slot; it becomes active only once fully written
+    bool save(const T &data) {
+        uint8_t target = loaded ? 1 - active : 0;
+
+        memset(&scratch, 0, sizeof(scratch));
+        memcpy(&scratch.data, &data, sizeof(T));
+        scratch.generation = currentGeneration + 1;
+        scratch.crc = checksum(scratch);
+
+        if (!store.write(target, &scratch, sizeof(scratch))) return false;
+        active = target;
+        currentGeneration = scratch.generation;
+        loaded = true;
+        return true;
+    }
+
+    uint8_t activeSlot() const { return active; }
+    uint32_t generation() const { return currentGeneration; }
+
+private:
+    Store &store;
+    Slot scratch;               // One slot buffer instead of two on the stack
+    uint8_t active;
+    uint32_t currentGeneration;
+    bool loaded;
+
+    static uint32_t checksum(const Slot &slot) {
+        return crc32(&slot, offsetof(Slot, crc));
+    }
+};
+
+#endif
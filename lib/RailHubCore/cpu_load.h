@@ -0,0 +1,144 @@
+/**
+ * @file cpu_load.h
+ * @brief Per-core CPU load and per-task CPU share from cumulative counters
+ *
+ * Both classes turn counters that only grow (and wrap at 32 bits) into
+ * percentages over a sampling window:
+ *
+ *   CoreLoad   idle time per core, added by an idle hook running on that
+ *              core; load = 100 - idle share of the window
+ *   TaskLoad   run time per task (FreeRTOS run-time stats, or time the
+ *              firmware measures for its own tasks); share = run time
+ *              delta / window, as a percentage of one core
+ *
+ * sample() is called once per window with its length, in the same unit as
+ * the counters. Windows must be shorter than a counter wrap (17.8 s for
+ * cycles at 240 MHz).
+ */
+
+#ifndef CPU_LOAD_H
+#define CPU_LOAD_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <json_writer.h>
+
+#define TASK_LOAD_NAME_LEN 16   // configMAX_TASK_NAME_LEN
+
+template <uint8_t Cores>
+class CoreLoad {
+public:
+    CoreLoad() : sampled(false) {
+        for (uint8_t c = 0; c < Cores; c++) {
+            idle[c].store(0, std::memory_order_relaxed);
+            lastIdle[c] = 0;
+            percent[c] = 0.0f;
+        }
+    }
+
+    // Only from the given core (its idle hook), so a relaxed add is enough
+    void addIdle(uint8_t core, uint32_t amount) {
+        if (core >= Cores) return;
+        idle[core].store(idle[core].load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    // Ends a window of the given length
+    void sample(uint32_t elapsed) {
+        if (elapsed == 0) return;
+        for (uint8_t c = 0; c < Cores; c++) {
+            uint32_t now = idle[c].load(std::memory_order_relaxed);
+            uint32_t idleDelta = now - lastIdle[c];
+            lastIdle[c] = now;
+            float idleShare = idleDelta >= elapsed ? 1.0f : (float)idleDelta / elapsed;
+            percent[c] = 100.0f * (1.0f - idleShare);
+        }
+        sampled = true;
+    }
+
+    float load(uint8_t core) const { return core < Cores ? percent[core] : 0.0f; }
+    bool measured() const { return sampled; }
+
+private:
+    std::atomic<uint32_t> idle[Cores];
+    uint32_t lastIdle[Cores];
+    float percent[Cores];
+    bool sampled;
+};
+
+// One task's cumulative run time as read from the scheduler or measured by the firmware
+struct TaskRunTime {
+    uint32_t id;                // Stable per task (FreeRTOS task number)
+    const char *name;
+    int8_t core;                // Pinned core, -1 = either
+    uint32_t runTime;           // Cumulative, wraps
+};
+
+template <uint8_t MaxTasks>
+class TaskLoad {
+public:
+    TaskLoad() : entries(0) {}
+
+    // Ends a window; tasks beyond MaxTasks are ignored, tasks that are gone are dropped.
+    // A task seen for the first time has no baseline yet and shows 0 until the next window.
+    void sample(const TaskRunTime *tasks, uint8_t count, uint32_t elapsed) {
+        Entry next[MaxTasks];
+        uint8_t kept = 0;
+        for (uint8_t i = 0; i < count && kept < MaxTasks; i++) {
+            Entry &entry = next[kept++];
+            entry.id = tasks[i].id;
+            strncpy(entry.name, tasks[i].name ? tasks[i].name : "", TASK_LOAD_NAME_LEN - 1);
+            entry.name[TASK_LOAD_NAME_LEN - 1] = '\0';
+            entry.core = tasks[i].core;
+            entry.runTime = tasks[i].runTime;
+            entry.percent = 0.0f;
+
+            const Entry *previous = find(tasks[i].id);
+            if (previous && elapsed > 0) {
+                uint32_t delta = tasks[i].runTime - previous->runTime;
+                entry.percent = delta >= elapsed ? 100.0f : 100.0f * delta / elapsed;
+            }
+        }
+        for (uint8_t i = 0; i < kept; i++) table[i] = next[i];
+        entries = kept;
+    }
+
+    uint8_t count() const { return entries; }
+    const char *name(uint8_t i) const { return table[i].name; }
+    int8_t core(uint8_t i) const { return table[i].core; }
+    float load(uint8_t i) const { return table[i].percent; }
+
+    // "<key>":[["<name>",core,load],..]
+    void write(JsonWriter &json, const char *key) const {
+        json.beginArray(key);
+        for (uint8_t i = 0; i < entries; i++) {
+            json.beginArray();
+            json.add(nullptr, table[i].name);
+            json.add(nullptr, (int)table[i].core);
+            json.add(nullptr, table[i].percent, 1);
+            json.endArray();
+        }
+        json.endArray();
+    }
+
+private:
+    struct Entry {
+        uint32_t id;
+        char name[TASK_LOAD_NAME_LEN];
+        int8_t core;
+        uint32_t runTime;
+        float percent;
+    };
+
+    const Entry *find(uint32_t id) const {
+        for (uint8_t i = 0; i < entries; i++) {
+            if (table[i].id == id) return &table[i];
+        }
+        return nullptr;
+    }
+
+    Entry table[MaxTasks];
+    uint8_t entries;
+};
+
+#endif
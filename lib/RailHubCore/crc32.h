@@ -0,0 +1,34 @@
+/**
+ * @file crc32.h
+ * @brief CRC-32 (IEEE 802.3, reflected 0xEDB88320) for persisted blobs
+ *
+ * Nibble-table implementation: 64 bytes of table instead of 1 KB, fast
+ * enough for the few hundred bytes of output state written per flush.
+ * Pass the previous result as crc to checksum data in several pieces.
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+inline uint32_t crc32(const void *data, size_t length, uint32_t crc = 0) {
+    static const uint32_t table[16] = {
+        0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL,
+        0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+        0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL,
+        0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL
+    };
+
+    const uint8_t *bytes = (const uint8_t *)data;
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= bytes[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+#endif
@@ -0,0 +1,156 @@
+/**
+ * @file effect_scheduler.h
+ * @brief Deadline-ordered scheduler for blink and chase effects
+ *
+ * Binary min-heap of (deadline, id) entries. Every id (an output index or a
+ * chasing group slot) is queued at most once; a position table lets an entry
+ * be moved or cancelled in O(log n) without searching the heap. Deadlines are
+ * millis()-style 32-bit timestamps and are compared wrap-safe, so the heap
+ * keeps working across the 49-day millis() rollover.
+ */
+
+#ifndef EFFECT_SCHEDULER_H
+#define EFFECT_SCHEDULER_H
+
+#include <stdint.h>
+
+template <uint16_t Capacity>
+class EffectScheduler {
+public:
+    static const uint32_t NO_DEADLINE = 0xFFFFFFFFUL; // Returned by timeUntilNext() when idle
+    static const uint16_t NOT_QUEUED = 0xFFFF;
+
+    EffectScheduler() {
+        clear();
+    }
+
+    void clear() {
+        count = 0;
+        for (uint16_t i = 0; i < Capacity; i++) {
+            position[i] = NOT_QUEUED;
+        }
+    }
+
+    // Queue an id for the given deadline, or move it if already queued
+    void schedule(uint16_t id, uint32_t deadline) {
+        if (id >= Capacity) return;
+
+        uint16_t pos = position[id];
+        if (pos == NOT_QUEUED) {
+            pos = count++;
+            heap[pos].id = id;
+            heap[pos].deadline = deadline;
+            position[id] = pos;
+            siftUp(pos);
+            return;
+        }
+
+        uint32_t previous = heap[pos].deadline;
+        heap[pos].deadline = deadline;
+        if (before(deadline, previous)) {
+            siftUp(pos);
+        } else {
+            siftDown(pos);
+        }
+    }
+
+    // Remove an id from the queue (no-op if it is not queued)
+    void cancel(uint16_t id) {
+        if (id >= Capacity) return;
+
+        uint16_t pos = position[id];
+        if (pos == NOT_QUEUED) return;
+
+        position[id] = NOT_QUEUED;
+        count--;
+        if (pos == count) return;
+
+        // Move the last entry into the hole and restore heap order
+        heap[pos] = heap[count];
+        position[heap[pos].id] = pos;
+        if (pos > 0 && before(heap[pos].deadline, heap[(pos - 1) / 2].deadline)) {
+            siftUp(pos);
+        } else {
+            siftDown(pos);
+        }
+    }
+
+    bool isScheduled(uint16_t id) const {
+        return id < Capacity && position[id] != NOT_QUEUED;
+    }
+
+    // Pop the earliest entry if its deadline is at or before now
+    bool popDue(uint32_t now, uint16_t &id, uint32_t &deadline) {
+        if (count == 0 || before(now, heap[0].deadline)) return false;
+
+        id = heap[0].id;
+        deadline = heap[0].deadline;
+        cancel(id);
+        return true;
+    }
+
+    // Milliseconds until the earliest deadline (0 if overdue, NO_DEADLINE if empty)
+    uint32_t timeUntilNext(uint32_t now) const {
+        if (count == 0) return NO_DEADLINE;
+        int32_t remaining = (int32_t)(heap[0].deadline - now);
+        return remaining > 0 ? (uint32_t)remaining : 0;
+    }
+
+    uint16_t size() const {
+        return count;
+    }
+
+private:
+    struct Entry {
+        uint32_t deadline;
+        uint16_t id;
+    };
+
+    Entry heap[Capacity];
+    uint16_t position[Capacity]; // Heap slot of each id, NOT_QUEUED if absent
+    uint16_t count;
+
+    static bool before(uint32_t a, uint32_t b) {
+        return (int32_t)(a - b) < 0;
+    }
+
+    void swapEntries(uint16_t a, uint16_t b) {
+        Entry tmp = heap[a];
+        heap[a] = heap[b];
+        heap[b] = tmp;
+        position[heap[a].id] = a;
+        position[heap[b].id] = b;
+    }
+
+    void siftUp(uint16_t pos) {
+        while (pos > 0) {
+            uint16_t parent = (pos - 1) / 2;
+            if (!before(heap[pos].deadline, heap[parent].deadline)) break;
+            swapEntries(pos, parent);
+            pos = parent;
+        }
+    }
+
+    void siftDown(uint16_t pos) {
+        while (true) {
+            uint16_t left = 2 * pos + 1;
+            if (left >= count) break;
+            uint16_t smallest = left;
+            uint16_t right = left + 1;
+            if (right < count && before(heap[right].deadline, heap[left].deadline)) {
+                smallest = right;
+            }
+            if (!before(heap[smallest].deadline, heap[pos].deadline)) break;
+            swapEntries(pos, smallest);
+            pos = smallest;
+        }
+    }
+};
+
+template <uint16_t Capacity>
+const uint32_t EffectScheduler<Capacity>::NO_DEADLINE;
+
+template <uint16_t Capacity>
+const uint16_t EffectScheduler<Capacity>::NOT_QUEUED;
+
+#endif
@@ -0,0 +1,328 @@
+/**
+ * @file flash_journal.h
+ * @brief Log-structured, wear-leveled flash store for a fixed-size settings image
+ *
+ * The caller keeps a plain struct in RAM (EEPROMData on the ESP8266) and hands
+ * it to commit() after changing it. Only the byte ranges that differ from the
+ * last commit are appended to the active sector as CRC-protected delta records;
+ * the last record of a commit carries RECORD_END, so a commit is replayed
+ * all-or-nothing. When the active sector is full the journal rotates: it
+ * erases the next sector, writes a header with a higher sequence number and a
+ * full snapshot, and continues there. Erases are spread round-robin over all
+ * sectors, and the previous sector stays intact until the next rotation, so a
+ * power cut during rotation falls back to it at mount().
+ *
+ * Flash must provide:
+ *   static const uint32_t SECTOR_SIZE;
+ *   uint16_t sectorCount() const;
+ *   bool eraseSector(uint16_t sector);
+ *   bool write(uint16_t sector, uint32_t offset, const void *data, uint32_t length); // word-aligned offset/length
+ *   bool read(uint16_t sector, uint32_t offset, void *data, uint32_t length);
+ */
+
+#ifndef FLASH_JOURNAL_H
+#define FLASH_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "crc32.h"
+
+template <typename Flash, uint16_t ImageSize>
+class FlashJournal {
+public:
+    static const uint32_t MAGIC = 0x314A4852UL; // "RHJ1"
+
+    struct Stats {
+        uint32_t commits;       // Commits that wrote at least one record
+        uint32_t unchanged;     // Commits skipped because nothing changed
+        uint32_t rotations;     // Sector erases (one per rotation)
+        uint32_t bytesWritten;  // Record and header bytes programmed
+    };
+
+    explicit FlashJournal(Flash &flash)
+        : flash(flash), activeSector(0), sequence(0), writeOffset(0), mounted(false), needsRotation(false) {
+        memset(&stats, 0, sizeof(stats));
+        memset(image, 0, sizeof(image));
+    }
+
+    // Replay the newest intact sector into out; false if there is no journal yet
+    bool mount(void *out) {
+        bool haveLimit = false;
+        uint32_t limit = 0;
+
+        // Newest first; a sector whose snapshot never committed (torn rotation) is skipped
+        for (uint16_t attempt = 0; attempt < flash.sectorCount(); attempt++) {
+            int best = -1;
+            uint32_t bestSequence = 0;
+            for (uint16_t s = 0; s < flash.sectorCount(); s++) {
+                uint32_t seq;
+                if (!readSectorHeader(s, seq)) continue;
+                if (haveLimit && !newer(limit, seq)) continue;
+                if (best < 0 || newer(seq, bestSequence)) {
+                    best = s;
+                    bestSequence = seq;
+                }
+            }
+            if (best < 0) break;
+
+            if (replay((uint16_t)best, (uint8_t *)out)) {
+                activeSector = (uint16_t)best;
+                sequence = bestSequence;
+                mounted = true;
+                return true;
+            }
+            limit = bestSequence;
+            haveLimit = true;
+        }
+        return false;
+    }
+
+    // Start an empty journal holding data (first boot or migration)
+    bool format(const void *data) {
+        for (uint16_t s = 1; s < flash.sectorCount(); s++) {
+            if (!flash.eraseSector(s)) return false;
+        }
+        activeSector = flash.sectorCount() - 1; // Rotation moves on to sector 0
+        sequence = 0;
+        mounted = true;
+        return rotate((const uint8_t *)data);
+    }
+
+    // Append the bytes of data that differ from the last commit as one transaction
+    bool commit(const void *data) {
+        if (!mounted) return format(data);
+
+        const uint8_t *next = (const uint8_t *)data;
+        Range ranges[MAX_RANGES];
+        uint8_t rangeCount = diff(next, ranges);
+        if (rangeCount == 0) {
+            stats.unchanged++;
+            return true;
+        }
+
+        uint32_t needed = 0;
+        for (uint8_t i = 0; i < rangeCount; i++) {
+            needed += sizeof(RecordHeader) + align(ranges[i].length);
+        }
+        if (needsRotation || writeOffset + needed > Flash::SECTOR_SIZE) {
+            return rotate(next);
+        }
+
+        for (uint8_t i = 0; i < rangeCount; i++) {
+            if (!writeRecord(activeSector, writeOffset, ranges[i].offset, ranges[i].length,
+                             next + ranges[i].offset, i == rangeCount - 1)) {
+                needsRotation = true;
+                return false;
+            }
+        }
+        memcpy(image, next, ImageSize);
+        stats.commits++;
+        return true;
+    }
+
+    const Stats &statistics() const { return stats; }
+    uint16_t currentSector() const { return activeSector; }
+    uint32_t currentSequence() const { return sequence; }
+    uint32_t bytesUsed() const { return writeOffset; }
+
+private:
+    struct SectorHeader {
+        uint32_t magic;
+        uint32_t sequence;
+        uint16_t imageSize;
+        uint16_t reserved;
+        uint32_t crc;          // CRC32 of the fields above
+    };
+
+    struct RecordHeader {
+        uint16_t offset;       // Image offset of the payload
+        uint16_t length;       // Payload length, RECORD_END on the last record of a commit
+        uint32_t crc;          // CRC32 of offset, length and payload
+    };
+
+    struct Range {
+        uint16_t offset;
+        uint16_t length;
+    };
+
+    static const uint16_t RECORD_END = 0x8000;
+    static const uint8_t MAX_RANGES = 8;
+    static const uint16_t MERGE_GAP = sizeof(RecordHeader); // Cheaper to rewrite a short gap than to open a record
+
+    static_assert(ImageSize < RECORD_END, "Image too large for the record length field");
+    static_assert(sizeof(SectorHeader) + sizeof(RecordHeader) + ((ImageSize + 3) & ~3) <= Flash::SECTOR_SIZE / 2,
+                  "Sector must hold a snapshot and leave room for deltas");
+
+    Flash &flash;
+    uint8_t image[ImageSize];   // Last committed image, the base for diffs
+    uint16_t activeSector;
+    uint32_t sequence;
+    uint32_t writeOffset;
+    bool mounted;
+    bool needsRotation;         // Tail of the active sector is not cleanly erased
+    Stats stats;
+
+    static uint32_t align(uint32_t length) {
+        return (length + 3) & ~3UL;
+    }
+
+    static bool newer(uint32_t a, uint32_t b) {
+        return (int32_t)(a - b) > 0;
+    }
+
+    static bool erased(const void *data, uint32_t length) {
+        const uint8_t *bytes = (const uint8_t *)data;
+        for (uint32_t i = 0; i < length; i++) {
+            if (bytes[i] != 0xFF) return false;
+        }
+        return true;
+    }
+
+    bool readSectorHeader(uint16_t sector, uint32_t &seq) {
+        SectorHeader header;
+        if (!flash.read(sector, 0, &header, sizeof(header))) return false;
+        if (header.magic != MAGIC || header.imageSize != ImageSize) return false;
+        if (header.crc != crc32(&header, offsetof(SectorHeader, crc))) return false;
+        seq = header.sequence;
+        return true;
+    }
+
+    // Apply committed transactions to image; out doubles as scratch for the open one
+    bool replay(uint16_t sector, uint8_t *out) {
+        bool haveImage = false;
+        bool clean = false;
+        uint32_t offset = sizeof(SectorHeader);
+        uint32_t committedEnd = offset;
+
+        while (offset + sizeof(RecordHeader) <= Flash::SECTOR_SIZE) {
+            RecordHeader record;
+            if (!flash.read(sector, offset, &record, sizeof(record))) break;
+            if (erased(&record, sizeof(record))) {
+                clean = true;
+                break;
+            }
+
+            uint16_t length = record.length & ~RECORD_END;
+            if ((uint32_t)record.offset + length > ImageSize) break;
+            if (offset + sizeof(RecordHeader) + align(length) > Flash::SECTOR_SIZE) break;
+            if (!flash.read(sector, offset + sizeof(RecordHeader), out + record.offset, length)) break;
+
+            uint32_t crc = crc32(&record, offsetof(RecordHeader, crc));
+            if (record.crc != crc32(out + record.offset, length, crc)) break;
+
+            offset += sizeof(RecordHeader) + align(length);
+            if (record.length & RECORD_END) {
+                memcpy(image, out, ImageSize);
+                committedEnd = offset;
+                haveImage = true;
+            }
+        }
+
+        if (!haveImage) return false;
+
+        // Drop any half-written transaction; appending is only safe after erased flash
+        memcpy(out, image, ImageSize);
+        writeOffset = committedEnd;
+        needsRotation = !clean || offset != committedEnd;
+        return true;
+    }
+
+    // Collect changed byte ranges, merging those separated by short gaps
+    uint8_t diff(const uint8_t *next, Range *ranges) {
+        uint8_t count = 0;
+        uint16_t i = 0;
+        while (i < ImageSize) {
+            if (next[i] == image[i]) {
+                i++;
+                continue;
+            }
+            uint16_t start = i;
+            uint16_t end = i + 1;
+            uint16_t gap = 0;
+            for (i = end; i < ImageSize && gap <= MERGE_GAP; i++) {
+                if (next[i] != image[i]) {
+                    end = i + 1;
+                    gap = 0;
+                } else {
+                    gap++;
+                }
+            }
+            i = end;
+
+            if (count == MAX_RANGES) {
+                // Out of ranges: stretch the last one over the remaining changes
+                ranges[count - 1].length = end - ranges[count - 1].offset;
+            } else {
+                ranges[count].offset = start;
+                ranges[count].length = end - start;
+                count++;
+            }
+        }
+        return count;
+    }
+
+    bool writeRecord(uint16_t sector, uint32_t &offset, uint16_t imageOffset, uint16_t length,
+                     const uint8_t *payload, bool last) {
+        RecordHeader record;
+        record.offset = imageOffset;
+        record.length = length | (last ? RECORD_END : 0);
+        record.crc = crc32(payload, length, crc32(&record, offsetof(RecordHeader, crc)));
+
+        if (!flash.write(sector, offset, &record, sizeof(record))) return false;
+        offset += sizeof(record);
+
+        // Payload goes out in word-aligned chunks, padded with erased bytes
+        uint32_t chunk[8];
+        for (uint16_t pos = 0; pos < length; pos += sizeof(chunk)) {
+            uint16_t n = (uint32_t)(length - pos) < sizeof(chunk) ? length - pos : sizeof(chunk);
+            memset(chunk, 0xFF, sizeof(chunk));
+            memcpy(chunk, payload + pos, n);
+            if (!flash.write(sector, offset, chunk, align(n))) return false;
+            offset += align(n);
+        }
+        stats.bytesWritten += sizeof(record) + align(length);
+        return true;
+    }
+
+    // Erase the next sector and restart the log there with a full snapshot
+    bool rotate(const uint8_t *data) {
+        uint16_t next = (activeSector + 1) % flash.sectorCount();
+        if (!flash.eraseSector(next)) return false;
+        stats.rotations++;
+
+        SectorHeader header;
+        header.magic = MAGIC;
+        header.sequence = sequence + 1;
+        header.imageSize = ImageSize;
+        header.reserved = 0xFFFF;
+        header.crc = crc32(&header, offsetof(SectorHeader, crc));
+        if (!flash.write(next, 0, &header, sizeof(header))) return false;
+        stats.bytesWritten += sizeof(header);
+
+        uint32_t offset = sizeof(SectorHeader);
+        if (!writeRecord(next, offset, 0, ImageSize, data, true)) return false;
+
+        activeSector = next;
+        sequence++;
+        writeOffset = offset;
+        needsRotation = false;
+        memcpy(image, data, ImageSize);
+        stats.commits++;
+        return true;
+    }
+};
+
+template <typename Flash, uint16_t ImageSize>
+const uint32_t FlashJournal<Flash, ImageSize>::MAGIC;
+
+template <typename Flash, uint16_t ImageSize>
+const uint16_t FlashJournal<Flash, ImageSize>::RECORD_END;
+
+template <typename Flash, uint16_t ImageSize>
+const uint8_t FlashJournal<Flash, ImageSize>::MAX_RANGES;
+
+template <typename Flash, uint16_t ImageSize>
+const uint16_t FlashJournal<Flash, ImageSize>::MERGE_GAP;
+
+#endif
@@ -0,0 +1,199 @@
+/**
+ * @file json_writer.h
+ * @brief Streaming JSON writer into a caller-owned, size-checked buffer
+ *
+ * For the status messages that go out several times a second: no document
+ * tree and no String, so nothing touches the heap. Values are appended as
+ * they are added and commas are tracked per nesting level. Once the buffer
+ * is full the writer stops, keeps the text NUL-terminated and reports
+ * !ok(); callers drop the message rather than send truncated JSON.
+ *
+ * Keys are written as given (they are literals); string values are escaped.
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+class JsonWriter {
+public:
+    JsonWriter(char *buffer, size_t capacity) : buffer(buffer), capacity(capacity) {
+        reset();
+    }
+
+    void reset() {
+        used = 0;
+        depth = 0;
+        commaMask = 0;
+        overflow = capacity == 0;
+        if (capacity > 0) buffer[0] = '\0';
+    }
+
+    // Pass key = nullptr for values inside arrays and for the top level
+    void beginObject(const char *key = nullptr) { open(key, '{'); }
+    void endObject() { close('}'); }
+    void beginArray(const char *key = nullptr) { open(key, '['); }
+    void endArray() { close(']'); }
+
+    void add(const char *key, const char *value) {
+        prefix(key);
+        putString(value);
+    }
+
+    void add(const char *key, bool value) {
+        prefix(key);
+        putRaw(value ? "true" : "false");
+    }
+
+    void add(const char *key, int value) { addSigned(key, value); }
+    void add(const char *key, long value) { addSigned(key, value); }
+    void add(const char *key, unsigned int value) { addUnsigned(key, value); }
+    void add(const char *key, unsigned long value) { addUnsigned(key, value); }
+
+    // Cumulative counters; the 64-bit division only runs above unsigned long
+    void add(const char *key, unsigned long long value) {
+        prefix(key);
+        if (value <= (unsigned long)-1) {
+            putUnsigned((unsigned long)value);
+            return;
+        }
+        char digits[20];
+        char *p = digits + sizeof(digits);
+        do {
+            *--p = (char)('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+        append(p, digits + sizeof(digits) - p);
+    }
+
+    // Fixed-point rendering of a float, e.g. 12.5 with one decimal
+    void add(const char *key, float value, uint8_t decimals) {
+        prefix(key);
+        if (value < 0) {
+            putChar('-');
+            value = -value;
+        }
+        uint32_t scale = 1;
+        for (uint8_t i = 0; i < decimals; i++) scale *= 10;
+        uint32_t scaled = (uint32_t)(value * scale + 0.5f);
+        putUnsigned(scaled / scale);
+        if (decimals > 0) {
+            putChar('.');
+            uint32_t fraction = scaled % scale;
+            for (uint32_t digit = scale / 10; digit > 0; digit /= 10) {
+                putChar((char)('0' + (fraction / digit) % 10));
+            }
+        }
+    }
+
+    bool ok() const { return !overflow; }
+    size_t length() const { return used; }
+    const char *c_str() const { return buffer; }
+
+private:
+    static const uint8_t MAX_DEPTH = 16;
+
+    char *buffer;
+    size_t capacity;
+    size_t used;
+    uint8_t depth;
+    uint16_t commaMask;         // Bit n: the container at depth n already has a member
+    bool overflow;
+
+    void append(const char *text, size_t n) {
+        if (overflow || used + n >= capacity) {
+            overflow = true;
+            return;
+        }
+        memcpy(buffer + used, text, n);
+        used += n;
+        buffer[used] = '\0';
+    }
+
+    void putChar(char c) {
+        append(&c, 1);
+    }
+
+    void putRaw(const char *text) {
+        append(text, strlen(text));
+    }
+
+    void putUnsigned(unsigned long value) {
+        char digits[20];
+        char *p = digits + sizeof(digits);
+        do {
+            *--p = (char)('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+        append(p, digits + sizeof(digits) - p);
+    }
+
+    void putString(const char *value) {
+        static const char hex[] = "0123456789abcdef";
+        putChar('"');
+        const char *p = value ? value : "";
+        while (*p) {
+            // Copy the run of characters that need no escaping in one go
+            const char *run = p;
+            while (*p && *p != '"' && *p != '\\' && (uint8_t)*p >= 0x20) p++;
+            append(run, p - run);
+            if (!*p) break;
+
+            char c = *p++;
+            if (c == '"' || c == '\\') {
+                char escaped[2] = {'\\', c};
+                append(escaped, 2);
+            } else {
+                char escaped[6] = {'\\', 'u', '0', '0', hex[(uint8_t)c >> 4], hex[c & 0x0F]};
+                append(escaped, 6);
+            }
+        }
+        putChar('"');
+    }
+
+    void prefix(const char *key) {
+        if (commaMask & (1U << depth)) putChar(',');
+        commaMask |= 1U << depth;
+        if (key) {
+            putChar('"');
+            putRaw(key);
+            append("\":", 2);
+        }
+    }
+
+    void open(const char *key, char bracket) {
+        prefix(key);
+        putChar(bracket);
+        if (depth + 1 < MAX_DEPTH) {
+            depth++;
+        } else {
+            overflow = true;
+        }
+        commaMask &= ~(1U << depth);
+    }
+
+    void close(char bracket) {
+        if (depth > 0) depth--;
+        putChar(bracket);
+    }
+
+    void addSigned(const char *key, long value) {
+        prefix(key);
+        if (value < 0) {
+            putChar('-');
+            putUnsigned(0UL - (unsigned long)value);
+        } else {
+            putUnsigned((unsigned long)value);
+        }
+    }
+
+    void addUnsigned(const char *key, unsigned long value) {
+        prefix(key);
+        putUnsigned(value);
+    }
+};
+
+#endif
@@ -0,0 +1,162 @@
+/**
+ * @file loop_profiler.h
+ * @brief Always-on time accounting for the subsystems called from loop()
+ *
+ * loop() reads the CPU cycle counter once per subsystem call and hands
+ * the readings to lap(), which charges the time since the previous reading
+ * to that subsystem (cumulative time, calls, longest call). Each reading is
+ * a single register read, so the profiler can stay on in production.
+ *
+ * Per second of loop() time two histograms are filled, both with log2
+ * buckets (bucket 0 holds 0, bucket i holds 2^(i-1) to 2^i - 1, the last
+ * bucket everything above):
+ *
+ *   rate      iterations completed in that second
+ *   longest   the longest single iteration of that second, in us
+ *
+ * A hiccup shows up as a second with a low rate and a long iteration; the
+ * section whose maxUs matches it is the one that stole the loop.
+ */
+
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <stdint.h>
+#include <json_writer.h>
+
+#define LOOP_HISTOGRAM_BUCKETS 20
+
+template <uint8_t Sections>
+class LoopProfiler {
+public:
+    explicit LoopProfiler(uint32_t cyclesPerUs) : cyclesPerUs(cyclesPerUs > 0 ? cyclesPerUs : 1) {
+        reset();
+    }
+
+    void reset() {
+        for (uint8_t s = 0; s < Sections; s++) {
+            sections[s].cycles = 0;
+            sections[s].calls = 0;
+            sections[s].maxCycles = 0;
+        }
+        for (uint8_t b = 0; b < LOOP_HISTOGRAM_BUCKETS; b++) {
+            rateBuckets[b] = 0;
+            longestBuckets[b] = 0;
+        }
+        started = false;
+        iterationStart = 0;
+        iterationCount = 0;
+        windowCycles = 0;
+        windowIterations = 0;
+        windowLongestCycles = 0;
+        lastRate = 0;
+        longestCycles = 0;
+        busyCycleCount = 0;
+    }
+
+    // First reading of an iteration; returns it so laps can chain from it
+    uint32_t beginIteration(uint32_t nowCycles) {
+        if (started) {
+            // Start to start, so time spent outside loop() counts towards the second
+            windowCycles += nowCycles - iterationStart;
+            if (windowCycles >= (uint64_t)cyclesPerUs * 1000000UL) {
+                lastRate = windowIterations;
+                rateBuckets[bucket(windowIterations)]++;
+                longestBuckets[bucket(windowLongestCycles / cyclesPerUs)]++;
+                windowCycles = 0;
+                windowIterations = 0;
+                windowLongestCycles = 0;
+            }
+        }
+        started = true;
+        iterationStart = nowCycles;
+        return nowCycles;
+    }
+
+    // Charges startCycles..nowCycles to a section; returns nowCycles for the next lap
+    uint32_t lap(uint8_t section, uint32_t startCycles, uint32_t nowCycles) {
+        if (section < Sections) {
+            uint32_t elapsed = nowCycles - startCycles;
+            sections[section].cycles += elapsed;
+            sections[section].calls++;
+            if (elapsed > sections[section].maxCycles) sections[section].maxCycles = elapsed;
+        }
+        return nowCycles;
+    }
+
+    void endIteration(uint32_t nowCycles) {
+        uint32_t elapsed = nowCycles - iterationStart;
+        if (elapsed > windowLongestCycles) windowLongestCycles = elapsed;
+        if (elapsed > longestCycles) longestCycles = elapsed;
+        windowIterations++;
+        iterationCount++;
+        busyCycleCount += elapsed;
+    }
+
+    uint32_t calls(uint8_t section) const { return sections[section].calls; }
+    uint64_t totalUs(uint8_t section) const { return sections[section].cycles / cyclesPerUs; }
+    uint32_t maxUs(uint8_t section) const { return sections[section].maxCycles / cyclesPerUs; }
+    uint32_t iterations() const { return iterationCount; }
+    uint32_t loopRate() const { return lastRate; }              // Iterations in the last full second
+    uint32_t longestUs() const { return longestCycles / cyclesPerUs; }
+    uint32_t busyCycles() const { return busyCycleCount; }      // Inside iterations since boot; wraps
+    uint32_t rateHistogram(uint8_t b) const { return rateBuckets[b]; }
+    uint32_t longestHistogram(uint8_t b) const { return longestBuckets[b]; }
+
+    // "<key>":{"iterations":..,"rateHz":..,"longestUs":..,"sections":{"<name>":[calls,totalUs,maxUs],..},
+    //          "rateHistogram":[..],"longestHistogram":[..]}
+    void write(JsonWriter &json, const char *key, const char *const *names) const {
+        json.beginObject(key);
+        json.add("iterations", (unsigned long)iterationCount);
+        json.add("rateHz", (unsigned long)lastRate);
+        json.add("longestUs", (unsigned long)longestUs());
+        json.beginObject("sections");
+        for (uint8_t s = 0; s < Sections; s++) {
+            json.beginArray(names[s]);
+            json.add(nullptr, (unsigned long)sections[s].calls);
+            json.add(nullptr, (unsigned long long)totalUs(s));
+            json.add(nullptr, (unsigned long)maxUs(s));
+            json.endArray();
+        }
+        json.endObject();
+        json.beginArray("rateHistogram");
+        for (uint8_t b = 0; b < LOOP_HISTOGRAM_BUCKETS; b++) json.add(nullptr, (unsigned long)rateBuckets[b]);
+        json.endArray();
+        json.beginArray("longestHistogram");
+        for (uint8_t b = 0; b < LOOP_HISTOGRAM_BUCKETS; b++) json.add(nullptr, (unsigned long)longestBuckets[b]);
+        json.endArray();
+        json.endObject();
+    }
+
+    static uint8_t bucket(uint32_t value) {
+        uint8_t b = 0;
+        while (value > 0 && b < LOOP_HISTOGRAM_BUCKETS - 1) {
+            value >>= 1;
+            b++;
+        }
+        return b;
+    }
+
+private:
+    struct Section {
+        uint64_t cycles;
+        uint32_t calls;
+        uint32_t maxCycles;
+    };
+
+    const uint32_t cyclesPerUs;
+    Section sections[Sections];
+    uint32_t rateBuckets[LOOP_HISTOGRAM_BUCKETS];
+    uint32_t longestBuckets[LOOP_HISTOGRAM_BUCKETS];
+    bool started;
+    uint32_t iterationStart;
+    uint32_t iterationCount;
+    uint64_t windowCycles;
+    uint32_t windowIterations;
+    uint32_t windowLongestCycles;
+    uint32_t lastRate;
+    uint32_t longestCycles;
+    uint32_t busyCycleCount;
+};
+
+#endif
@@ -0,0 +1,202 @@
+/**
+ * @file output_core.h
+ * @brief Output model and blink engine shared by the ESP32 and ESP8266 builds
+ *
+ * OutputCore<Outputs, Groups, Platform> keeps the state of every output in
+ * arrays sized at compile time (16 on the ESP32, 7 on the ESP8266), steps
+ * blink effects from an EffectScheduler and resolves command bodies against
+ * the current state. Each board supplies only the hardware side, as a traits
+ * class with static functions:
+ *
+ *   static void writeOutput(uint16_t index, uint8_t duty);   // PWM duty 0-255
+ *   static uint32_t stepGroup(uint8_t slot);                  // Advance a chasing group:
+ *                                                             // next interval, 0 = stopped
+ *
+ * Scheduler ids 0..Outputs-1 are outputs, Outputs + slot the board's
+ * chasing groups (Groups may be 0). Nothing here calls Arduino APIs, so the
+ * core also builds and runs natively.
+ */
+
+#ifndef OUTPUT_CORE_H
+#define OUTPUT_CORE_H
+
+#include <stdint.h>
+#include <string.h>
+#include "command_parser.h"
+#include "effect_scheduler.h"
+
+// Narrowest type that holds an output index
+template <bool Small>
+struct OutputIndexType {
+    typedef uint8_t type;
+};
+
+template <>
+struct OutputIndexType<false> {
+    typedef uint16_t type;
+};
+
+// API brightness (0-100 %) to PWM duty, as map(percent, 0, 100, 0, 255)
+inline uint8_t dutyFromPercent(int32_t percent) {
+    if (percent < 0) percent = 0;
+    if (percent > 100) percent = 100;
+    return (uint8_t)(percent * 255 / 100);
+}
+
+template <uint16_t Outputs, uint8_t Groups, class Platform>
+class OutputCore {
+public:
+    typedef typename OutputIndexType<(Outputs <= 255)>::type Index;
+
+    bool state[Outputs];        // Commanded on/off
+    uint8_t duty[Outputs];      // PWM duty 0-255 while on
+    uint32_t interval[Outputs]; // Blink interval in ms (0 = solid)
+    bool phase[Outputs];        // Blink phase, true while lit
+    int8_t group[Outputs];      // Chasing group (board id) driving the output, -1 = none
+
+    OutputCore() {
+        reset();
+    }
+
+    void reset() {
+        for (uint16_t i = 0; i < Outputs; i++) {
+            state[i] = false;
+            duty[i] = 255;
+            interval[i] = 0;
+            phase[i] = false;
+            group[i] = -1;
+        }
+        scheduler.clear();
+    }
+
+    // On/off and duty; a blinking output keeps its toggle deadline
+    void set(Index i, bool active, uint8_t newDuty, uint32_t now) {
+        state[i] = active;
+        duty[i] = newDuty;
+        phase[i] = active;
+        Platform::writeOutput(i, active ? newDuty : 0);
+        schedule(i, now);
+    }
+
+    // Blink interval; the cycle restarts from the lit phase
+    void setInterval(Index i, uint32_t ms, uint32_t now) {
+        interval[i] = ms;
+        scheduler.cancel(i);
+        if (state[i]) {
+            phase[i] = true;
+            Platform::writeOutput(i, duty[i]);
+        }
+        schedule(i, now);
+    }
+
+    // State, duty and interval at once (batch entries)
+    void apply(Index i, bool active, uint8_t newDuty, uint32_t ms, uint32_t now) {
+        if (interval[i] != ms) {
+            interval[i] = ms;
+            scheduler.cancel(i);
+        }
+        set(i, active, newDuty, now);
+    }
+
+    // Fields a command entry leaves out keep the output's current value
+    void resolve(Index i, const CommandEntry &entry, bool &active, uint8_t &newDuty, uint32_t &ms) const {
+        active = entry.has(FIELD_ACTIVE) ? entry.active : state[i];
+        newDuty = entry.has(FIELD_BRIGHTNESS) ? dutyFromPercent(entry.brightness) : duty[i];
+        ms = entry.has(FIELD_INTERVAL) ? entry.interval : interval[i];
+    }
+
+    // Queue or drop an output's next toggle to match its state, interval and group
+    void schedule(Index i, uint32_t now) {
+        if (state[i] && interval[i] > 0 && group[i] < 0) {
+            if (!scheduler.isScheduled(i)) {
+                scheduler.schedule(i, now + interval[i]);
+            }
+        } else {
+            scheduler.cancel(i);
+        }
+    }
+
+    // Stop an output's own blinking (a chasing group takes it over)
+    void cancel(Index i) {
+        scheduler.cancel(i);
+    }
+
+    void scheduleGroup(uint8_t slot, uint32_t deadline) {
+        scheduler.schedule(Outputs + slot, deadline);
+    }
+
+    void cancelGroup(uint8_t slot) {
+        scheduler.cancel(Outputs + slot);
+    }
+
+    // Step every effect whose deadline has passed; only writes precomputed duties
+    void step(uint32_t now) {
+        uint16_t id;
+        uint32_t deadline;
+
+        while (scheduler.popDue(now, id, deadline)) {
+            uint32_t next;
+            if (id >= Outputs) {
+                next = Platform::stepGroup(id - Outputs);
+                if (next == 0) continue;
+            } else {
+                phase[id] = !phase[id];
+                Platform::writeOutput(id, phase[id] ? duty[id] : 0);
+                next = interval[id];
+            }
+            if (next == 0) next = 1; // Never re-queue into the same pass
+
+            // Stay phase-locked to the previous deadline; resync if a full interval was missed
+            uint32_t nextDeadline = deadline + next;
+            if ((int32_t)(nextDeadline - now) <= 0) {
+                nextDeadline = now + next;
+            }
+            scheduler.schedule(id, nextDeadline);
+        }
+    }
+
+    uint16_t pendingEffects() const {
+        return scheduler.size();
+    }
+
+    // Output indices a batch addresses: one per "outputs" entry, resolved
+    // through the pin map, or every (active) output for "select":"all"|"active".
+    // Returns an HTTP status and a reason in error; 0 means the selector is
+    // none of these and is left to the board.
+    template <uint8_t MaxEntries, class PinLookup>
+    int batchTargets(const CommandFields<MaxEntries> &req, const PinLookup &pins,
+                     Index *targets, Index &count, const char *&error) const {
+        count = 0;
+        if (req.has(FIELD_OUTPUTS)) {
+            if (req.outputTotal > Outputs || req.outputTotal > MaxEntries) {
+                error = "Too many outputs";
+                return 400;
+            }
+            // Every entry is checked before the caller changes anything
+            for (uint16_t e = 0; e < req.outputTotal; e++) {
+                int index = pins.indexOf(req.outputs[e].has(FIELD_PIN) ? req.outputs[e].pin : -1);
+                if (index < 0) {
+                    error = "Output not found";
+                    return 404;
+                }
+                targets[count++] = index;
+            }
+            return 200;
+        }
+
+        bool onlyActive = strcmp(req.select, "active") == 0;
+        if (!onlyActive && strcmp(req.select, "all") != 0) {
+            return 0;
+        }
+        for (uint16_t i = 0; i < Outputs; i++) {
+            if (onlyActive && !state[i]) continue;
+            targets[count++] = i;
+        }
+        return 200;
+    }
+
+private:
+    EffectScheduler<Outputs + Groups> scheduler;
+};
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * @file page_stream.h
+ * @brief Serves a page stored as flash parts piece by piece to an async server
+ *
+ * The async web servers ask for the next piece of a chunked response
+ * whenever the connection has room (usually one TCP segment). fillPage()
+ * answers from the byte offset alone: it keeps no per-request state and
+ * copies at most maxLen bytes, so each call is short no matter how large
+ * the page is or how slowly the client reads it.
+ *
+ * A part with data == nullptr stands for the dynamic text (e.g. the device
+ * name), which the caller copies when the request starts so it cannot
+ * change halfway through a response.
+ */
+
+#ifndef PAGE_STREAM_H
+#define PAGE_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <pgmspace.h>
+#endif
+#ifndef memcpy_P
+#define memcpy_P memcpy
+#endif
+
+struct PagePart {
+    const char *data;           // PROGMEM, or nullptr for the dynamic text
+    size_t length;
+};
+
+// Copies the page bytes starting at index into buffer; returns 0 at the end of the page
+inline size_t fillPage(const PagePart *parts, size_t count, const char *dynamicText,
+                       size_t index, uint8_t *buffer, size_t maxLen) {
+    size_t written = 0;
+    size_t dynamicLength = dynamicText ? strlen(dynamicText) : 0;
+
+    for (size_t i = 0; i < count && written < maxLen; i++) {
+        size_t length = parts[i].data ? parts[i].length : dynamicLength;
+        if (index >= length) {
+            index -= length;
+            continue;
+        }
+
+        size_t n = length - index;
+        if (n > maxLen - written) n = maxLen - written;
+        if (parts[i].data) {
+            memcpy_P(buffer + written, parts[i].data + index, n);
+        } else {
+            memcpy(buffer + written, dynamicText + index, n);
+        }
+        written += n;
+        index = 0;
+    }
+    return written;
+}
+
+#endif
@@ -0,0 +1,144 @@
+/**
+ * @file pin_map.h
+ * @brief Output-to-GPIO map with a validator and a constant-time reverse lookup
+ *
+ * The map is no longer fixed by LED_PINS alone: it is loaded from the saved
+ * settings at boot and can be replaced through the API. assign() accepts a
+ * new map only if check() passes for every pin, then rebuilds the reverse
+ * table (one int8_t per GPIO number), so the handlers turn a GPIO number
+ * from a request into an output index with one array read.
+ *
+ * PinRules describes which GPIO numbers a chip can drive. Strapping pins
+ * decide the boot mode or flash voltage when an output load pulls them, so
+ * they are refused unless the caller allows them (the stock wiring of each
+ * board uses some and is known to boot).
+ */
+
+#ifndef PIN_MAP_H
+#define PIN_MAP_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PIN_BIT(pin) (1ULL << (pin))
+
+enum PinCheck : uint8_t {
+    PIN_OK,
+    PIN_NOT_GPIO,               // No such GPIO on this chip
+    PIN_FLASH,                  // Wired to the SPI flash
+    PIN_INPUT_ONLY,             // Has no output driver
+    PIN_STRAPPING,              // Sampled at reset (boot mode, flash voltage)
+    PIN_RESERVED,               // Serial console, config button
+    PIN_DUPLICATE               // Already used by another output
+};
+
+struct PinRules {
+    uint8_t gpioCount;          // GPIO numbers are 0..gpioCount-1
+    uint64_t missing;
+    uint64_t flash;
+    uint64_t inputOnly;
+    uint64_t strapping;
+    uint64_t reserved;
+};
+
+// ESP32 (WROOM): no GPIO 20/24/28-31, 6-11 are the flash, 34-39 inputs only,
+// 0/2/5/12/15 strapping (12 selects the flash voltage), 1/3 the serial console
+const PinRules ESP32_PIN_RULES = {
+    40,
+    PIN_BIT(20) | PIN_BIT(24) | PIN_BIT(28) | PIN_BIT(29) | PIN_BIT(30) | PIN_BIT(31),
+    PIN_BIT(6) | PIN_BIT(7) | PIN_BIT(8) | PIN_BIT(9) | PIN_BIT(10) | PIN_BIT(11),
+    PIN_BIT(34) | PIN_BIT(35) | PIN_BIT(36) | PIN_BIT(37) | PIN_BIT(38) | PIN_BIT(39),
+    PIN_BIT(0) | PIN_BIT(2) | PIN_BIT(5) | PIN_BIT(12) | PIN_BIT(15),
+    PIN_BIT(1) | PIN_BIT(3)
+};
+
+// ESP8266: 6-11 are the flash, 0/2/15 strapping, 1/3 the serial console
+const PinRules ESP8266_PIN_RULES = {
+    17,
+    0,
+    PIN_BIT(6) | PIN_BIT(7) | PIN_BIT(8) | PIN_BIT(9) | PIN_BIT(10) | PIN_BIT(11),
+    0,
+    PIN_BIT(0) | PIN_BIT(2) | PIN_BIT(15),
+    PIN_BIT(1) | PIN_BIT(3)
+};
+
+inline const char *pinCheckText(PinCheck result) {
+    switch (result) {
+        case PIN_OK: return "OK";
+        case PIN_NOT_GPIO: return "not a GPIO";
+        case PIN_FLASH: return "flash pin";
+        case PIN_INPUT_ONLY: return "input-only pin";
+        case PIN_STRAPPING: return "strapping pin";
+        case PIN_RESERVED: return "reserved pin";
+        default: return "used twice";
+    }
+}
+
+template <uint8_t Outputs, uint8_t GpioCount>
+class PinMap {
+    static_assert(GpioCount <= 64, "Pin masks are 64 bits");
+
+public:
+    PinMap() {
+        memset(pins, 0, sizeof(pins));
+        memset(lookup, -1, sizeof(lookup));
+    }
+
+    // Bit mask of a pin list, e.g. the stock map whose strapping pins are allowed
+    static uint64_t mask(const int *list, uint8_t count) {
+        uint64_t bits = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            if (list[i] >= 0 && list[i] < 64) bits |= PIN_BIT(list[i]);
+        }
+        return bits;
+    }
+
+    // Checks a complete map; on failure badIndex is the first offending output
+    static PinCheck check(const PinRules &rules, uint64_t allowedStrapping, const int *candidate, uint8_t &badIndex) {
+        uint64_t used = 0;
+        for (uint8_t i = 0; i < Outputs; i++) {
+            badIndex = i;
+            int pin = candidate[i];
+            if (pin < 0 || pin >= rules.gpioCount || pin >= GpioCount) return PIN_NOT_GPIO;
+            uint64_t bit = PIN_BIT(pin);
+            if (rules.missing & bit) return PIN_NOT_GPIO;
+            if (rules.flash & bit) return PIN_FLASH;
+            if (rules.inputOnly & bit) return PIN_INPUT_ONLY;
+            if (rules.reserved & bit) return PIN_RESERVED;
+            if ((rules.strapping & ~allowedStrapping) & bit) return PIN_STRAPPING;
+            if (used & bit) return PIN_DUPLICATE;
+            used |= bit;
+        }
+        return PIN_OK;
+    }
+
+    // Takes the map if check() passes, and rebuilds the reverse table
+    PinCheck assign(const PinRules &rules, uint64_t allowedStrapping, const int *candidate, uint8_t &badIndex) {
+        PinCheck result = check(rules, allowedStrapping, candidate, badIndex);
+        if (result == PIN_OK) set(candidate);
+        return result;
+    }
+
+    // Takes the map unchecked: for the build's stock map (LED_PINS)
+    void set(const int *list) {
+        memset(lookup, -1, sizeof(lookup));
+        for (uint8_t i = 0; i < Outputs; i++) {
+            pins[i] = list[i];
+            if (list[i] >= 0 && list[i] < GpioCount) lookup[list[i]] = (int8_t)i;
+        }
+    }
+
+    // Output index driving a GPIO, or -1
+    int indexOf(int pin) const {
+        return pin >= 0 && pin < GpioCount ? lookup[pin] : -1;
+    }
+
+    int pin(uint8_t index) const { return pins[index]; }
+    const int *list() const { return pins; }
+
+private:
+    int pins[Outputs];
+    int8_t lookup[GpioCount];
+};
+
+#endif
@@ -0,0 +1,136 @@
+/**
+ * @file request_trace.h
+ * @brief In-memory per-stage timing of API and WebSocket commands
+ *
+ * Every command gets a trace id; each stage it passes through (receive,
+ * parse, validate, apply, persist, serialize, send) is recorded as one span
+ * with a microsecond start and duration. Spans go into a fixed ring that
+ * any task can write without locking: a writer claims a cell with one
+ * fetch_add and publishes it with a sequence number, so a reader skips
+ * cells that are being overwritten instead of waiting. The newest Size
+ * spans are kept.
+ *
+ * Work that is not tied to one command (the write-behind NVS flush, delta
+ * broadcasts) is recorded with id 0.
+ */
+
+#ifndef REQUEST_TRACE_H
+#define REQUEST_TRACE_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+
+enum TraceStage : uint8_t {
+    TRACE_RECEIVE,              // Body assembly and request logging
+    TRACE_PARSE,                // Command body into fields
+    TRACE_VALIDATE,             // Target lookup and queueing
+    TRACE_APPLY,                // Queued until written to the output
+    TRACE_PERSIST,              // NVS flush
+    TRACE_SERIALIZE,            // Response or status message encoding
+    TRACE_SEND,                 // Handing the message to the network stack
+    TRACE_STAGES
+};
+
+inline const char *traceStageName(uint8_t stage) {
+    static const char *const names[TRACE_STAGES] = {
+        "receive", "parse", "validate", "apply", "persist", "serialize", "send"
+    };
+    return stage < TRACE_STAGES ? names[stage] : "unknown";
+}
+
+struct TraceSpan {
+    uint32_t id;                // Trace id, 0 = not tied to one command
+    uint32_t startUs;           // Free-running microsecond clock (wraps)
+    uint32_t durationUs;
+    uint8_t stage;              // TraceStage
+};
+
+struct TraceStageStats {
+    uint16_t count;
+    uint32_t p50Us;
+    uint32_t p95Us;
+    uint32_t p99Us;
+    uint32_t maxUs;
+};
+
+template <uint16_t Size>
+class TraceRing {
+    static_assert(Size >= 2 && (Size & (Size - 1)) == 0, "Size must be a power of two");
+
+public:
+    TraceRing() : head(0), ids(0) {
+        for (uint16_t i = 0; i < Size; i++) {
+            cells[i].sequence.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Id for a new command; never 0
+    uint32_t nextId() {
+        uint32_t id = ids.fetch_add(1, std::memory_order_relaxed) + 1;
+        return id != 0 ? id : ids.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    // Any task; overwrites the oldest span
+    void record(uint32_t id, TraceStage stage, uint32_t startUs, uint32_t endUs) {
+        uint32_t pos = head.fetch_add(1, std::memory_order_relaxed);
+        Cell &cell = cells[pos & (Size - 1)];
+        cell.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        cell.span.id = id;
+        cell.span.startUs = startUs;
+        cell.span.durationUs = endUs - startUs;
+        cell.span.stage = stage;
+        cell.sequence.store(pos + 1, std::memory_order_release);
+    }
+
+    // Copies the kept spans oldest first into out (room for Size); returns how many
+    uint16_t snapshot(TraceSpan *out) const {
+        uint32_t end = head.load(std::memory_order_acquire);
+        uint32_t begin = end > Size ? end - Size : 0;
+        uint16_t count = 0;
+        for (uint32_t pos = begin; pos != end; pos++) {
+            const Cell &cell = cells[pos & (Size - 1)];
+            if (cell.sequence.load(std::memory_order_acquire) != pos + 1) continue;
+            TraceSpan span = cell.span;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (cell.sequence.load(std::memory_order_relaxed) != pos + 1) continue;
+            out[count++] = span;
+        }
+        return count;
+    }
+
+    // Spans recorded since boot, including overwritten ones
+    uint32_t recorded() const {
+        return head.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Cell {
+        std::atomic<uint32_t> sequence;     // Ring position + 1 once published, 0 while written
+        TraceSpan span;
+    };
+
+    Cell cells[Size];
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> ids;
+};
+
+// Nearest-rank percentiles of one stage; scratch needs room for count durations
+inline TraceStageStats traceStageStats(const TraceSpan *spans, uint16_t count, uint8_t stage, uint32_t *scratch) {
+    TraceStageStats stats = {0, 0, 0, 0, 0};
+    for (uint16_t i = 0; i < count; i++) {
+        if (spans[i].stage == stage) scratch[stats.count++] = spans[i].durationUs;
+    }
+    if (stats.count == 0) return stats;
+
+    std::sort(scratch, scratch + stats.count);
+    uint32_t n = stats.count;
+    stats.p50Us = scratch[(n * 50 + 99) / 100 - 1];
+    stats.p95Us = scratch[(n * 95 + 99) / 100 - 1];
+    stats.p99Us = scratch[(n * 99 + 99) / 100 - 1];
+    stats.maxUs = scratch[n - 1];
+    return stats;
+}
+
+#endif
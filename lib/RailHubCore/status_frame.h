@@ -0,0 +1,150 @@
+/**
+ * @file status_frame.h
+ * @brief Compact binary WebSocket status frame (opt-in alternative to JSON)
+ *
+ * Layout, little-endian:
+ *    0  u8   type         STATUS_FRAME_SNAPSHOT or STATUS_FRAME_DELTA
+ *    1  u8   version      STATUS_FRAME_VERSION
+ *    2  u8   count        n = outputs in this frame
+ *    3  u8   nameCount    entries in the name section
+ *    4  u32  seq
+ *    8  u32  outputMask   bit i = output index i is in this frame
+ *   12  ceil(n/8) bytes   state bits, LSB first, in output index order
+ *       n bytes           brightness in percent
+ *       n varints         interval in ms (LEB128, 1 byte below 128)
+ *       nameCount times   u8 output index, u8 length, UTF-8 bytes
+ *
+ * Pins are not repeated; clients map indices to pins from the "hello"
+ * message. Snapshots carry every name. Deltas only carry names that differ
+ * from the last delta, tracked by CRC, so a plain state change has no text.
+ */
+
+#ifndef STATUS_FRAME_H
+#define STATUS_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "crc32.h"
+
+#define STATUS_FRAME_SNAPSHOT 1
+#define STATUS_FRAME_DELTA    2
+#define STATUS_FRAME_VERSION  1
+
+struct StatusFrameOutput {
+    bool active;
+    uint8_t brightness;         // Percent, 0-100
+    uint32_t interval;          // Blink interval in ms, 0 = steady
+    const char *name;
+};
+
+template <uint8_t MaxOutputs, uint8_t MaxNameLength>
+class StatusFrameWriter {
+public:
+    static const uint8_t HEADER_SIZE = 12;
+    static const size_t CAPACITY = HEADER_SIZE + (MaxOutputs + 7) / 8 + MaxOutputs * (1 + 5 + 2 + MaxNameLength);
+
+    static_assert(MaxOutputs <= 32, "outputMask holds one bit per output");
+
+    StatusFrameWriter() : frameLength(0) {
+        memset(sentNameCrc, 0, sizeof(sentNameCrc));
+    }
+
+    // Every output, with names; leaves the delta name tracking alone
+    size_t snapshot(uint32_t seq, const StatusFrameOutput *outputs) {
+        uint32_t all = MaxOutputs == 32 ? 0xFFFFFFFFUL : (1UL << MaxOutputs) - 1;
+        return encode(STATUS_FRAME_SNAPSHOT, seq, all, outputs, all);
+    }
+
+    // Outputs in mask; a name is included only if it changed since the last delta
+    size_t delta(uint32_t seq, uint32_t mask, const StatusFrameOutput *outputs) {
+        uint32_t names = 0;
+        for (uint8_t i = 0; i < MaxOutputs; i++) {
+            if (!(mask & (1UL << i))) continue;
+            uint32_t crc = nameCrc(outputs[i].name);
+            if (crc != sentNameCrc[i]) {
+                sentNameCrc[i] = crc;
+                names |= 1UL << i;
+            }
+        }
+        return encode(STATUS_FRAME_DELTA, seq, mask, outputs, names);
+    }
+
+    const uint8_t *data() const { return buffer; }
+    size_t length() const { return frameLength; }
+
+private:
+    uint8_t buffer[CAPACITY];
+    size_t frameLength;
+    uint32_t sentNameCrc[MaxOutputs];
+
+    static uint32_t nameCrc(const char *name) {
+        // Never 0, so the zeroed table sends every name on the first delta
+        return crc32(name, strnlen(name, MaxNameLength)) | 1;
+    }
+
+    static void putU32(uint8_t *p, uint32_t value) {
+        p[0] = (uint8_t)value;
+        p[1] = (uint8_t)(value >> 8);
+        p[2] = (uint8_t)(value >> 16);
+        p[3] = (uint8_t)(value >> 24);
+    }
+
+    size_t encode(uint8_t type, uint32_t seq, uint32_t mask, const StatusFrameOutput *outputs, uint32_t names) {
+        uint8_t count = 0;
+        uint8_t nameCount = 0;
+        for (uint8_t i = 0; i < MaxOutputs; i++) {
+            if (mask & (1UL << i)) {
+                count++;
+                if (names & (1UL << i)) nameCount++;
+            }
+        }
+
+        buffer[0] = type;
+        buffer[1] = STATUS_FRAME_VERSION;
+        buffer[2] = count;
+        buffer[3] = nameCount;
+        putU32(buffer + 4, seq);
+        putU32(buffer + 8, mask);
+
+        uint8_t *bits = buffer + HEADER_SIZE;
+        uint8_t *brightness = bits + (count + 7) / 8;
+        uint8_t *p = brightness + count;
+        memset(bits, 0, brightness - bits);
+
+        uint8_t k = 0;
+        for (uint8_t i = 0; i < MaxOutputs; i++) {
+            if (!(mask & (1UL << i))) continue;
+            if (outputs[i].active) bits[k >> 3] |= 1 << (k & 7);
+            brightness[k] = outputs[i].brightness;
+            k++;
+
+            uint32_t interval = outputs[i].interval;
+            while (interval >= 0x80) {
+                *p++ = (uint8_t)(interval | 0x80);
+                interval >>= 7;
+            }
+            *p++ = (uint8_t)interval;
+        }
+
+        for (uint8_t i = 0; i < MaxOutputs; i++) {
+            if (!(mask & names & (1UL << i))) continue;
+            size_t len = strnlen(outputs[i].name, MaxNameLength);
+            *p++ = i;
+            *p++ = (uint8_t)len;
+            memcpy(p, outputs[i].name, len);
+            p += len;
+        }
+
+        frameLength = p - buffer;
+        return frameLength;
+    }
+};
+
+template <uint8_t MaxOutputs, uint8_t MaxNameLength>
+const uint8_t StatusFrameWriter<MaxOutputs, MaxNameLength>::HEADER_SIZE;
+
+template <uint8_t MaxOutputs, uint8_t MaxNameLength>
+const size_t StatusFrameWriter<MaxOutputs, MaxNameLength>::CAPACITY;
+
+#endif
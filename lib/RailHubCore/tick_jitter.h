@@ -0,0 +1,57 @@
+/**
+ * @file tick_jitter.h
+ * @brief Deviation of a periodic effect tick from its nominal period
+ *
+ * record() is called once per tick with a free-running microsecond
+ * timestamp; the absolute difference between the measured and the nominal
+ * period is accumulated as max/average jitter for /api/status.
+ */
+
+#ifndef TICK_JITTER_H
+#define TICK_JITTER_H
+
+#include <stdint.h>
+
+class TickJitter {
+public:
+    explicit TickJitter(uint32_t periodUs) : periodUs(periodUs) {
+        reset();
+    }
+
+    void reset() {
+        started = false;
+        lastUs = 0;
+        ticks = 0;
+        maxDeviationUs = 0;
+        totalDeviationUs = 0;
+    }
+
+    void record(uint32_t nowUs) {
+        if (started) {
+            uint32_t elapsed = nowUs - lastUs;
+            uint32_t deviation = elapsed > periodUs ? elapsed - periodUs : periodUs - elapsed;
+            if (deviation > maxDeviationUs) {
+                maxDeviationUs = deviation;
+            }
+            totalDeviationUs += deviation;
+            ticks++;
+        }
+        lastUs = nowUs;
+        started = true;
+    }
+
+    uint32_t nominalUs() const { return periodUs; }
+    uint32_t count() const { return ticks; }
+    uint32_t maxUs() const { return maxDeviationUs; }
+    uint32_t avgUs() const { return ticks > 0 ? (uint32_t)(totalDeviationUs / ticks) : 0; }
+
+private:
+    uint32_t periodUs;
+    bool started;
+    uint32_t lastUs;
+    uint32_t ticks;
+    uint32_t maxDeviationUs;
+    uint64_t totalDeviationUs;
+};
+
+#endif
@@ -0,0 +1,53 @@
+/**
+ * @file write_behind.h
+ * @brief When to write a dirty-output mask back to flash
+ *
+ * Changes only set bits in a mask. A write is due once changes have been
+ * quiet for quietMs, or maxDelayMs after the first change of a batch that
+ * never goes quiet (a brightness drag). A failed write restarts both
+ * timers, so a flash that keeps failing is retried once per quiet period
+ * instead of on every loop() pass. Times are millis(), wrap-safe.
+ */
+
+#ifndef WRITE_BEHIND_H
+#define WRITE_BEHIND_H
+
+#include <stdint.h>
+
+class WriteBehind {
+public:
+    WriteBehind(uint32_t quietMs, uint32_t maxDelayMs)
+        : quietMs(quietMs), maxDelayMs(maxDelayMs), mask(0), firstMs(0), lastMs(0) {}
+
+    // Outputs in changed were modified at now
+    void mark(uint32_t changed, uint32_t now) {
+        if (changed == 0) return;
+        if (mask == 0) firstMs = now;
+        mask |= changed;
+        lastMs = now;
+    }
+
+    bool due(uint32_t now) const {
+        return mask != 0 && (now - lastMs >= quietMs || now - firstMs >= maxDelayMs);
+    }
+
+    // Written, nothing left to write, or dropped
+    void clear() { mask = 0; }
+
+    // The write failed at now: keep the mask and wait before the next attempt
+    void failed(uint32_t now) {
+        firstMs = now;
+        lastMs = now;
+    }
+
+    uint32_t dirty() const { return mask; }
+
+private:
+    uint32_t quietMs;
+    uint32_t maxDelayMs;
+    uint32_t mask;
+    uint32_t firstMs;
+    uint32_t lastMs;
+};
+
+#endif